@@ -1,4 +1,3 @@
-#include <pthread.h>
 #include "libmigdet_2d.h"
 
 /*
@@ -33,6 +32,48 @@ typedef struct _det_thread_data
 
 } det_thread_data;
 
+/*
+******************************************************************************
+* DETECTION POOL WORKER SCRATCH DATA
+******************************************************************************
+*/
+
+typedef struct _det_worker_data
+{
+    float               *slice;         /* current slice converted to float and scaled to [0,1] */
+    mig_fradial_t       *FRadial;       /* fast radial structure ( own dump prefix ) */
+    mig_fradial_buf_t   *FRadialBuf;    /* fast radial scratch buffers */
+    mig_sspace_t        *SSpace[2];     /* scale space structure of each lung */
+    float               *SSpaceInput;   /* scale space input window */
+    float               *SSpaceMask;    /* segmented lung window ( lung mask only ) */
+
+} det_worker_data;
+
+/*
+******************************************************************************
+* DETECTION POOL RUN
+******************************************************************************
+*/
+
+/* fast radial regions handled by a single scale space task */
+#define DET_SS_CHUNK 8
+
+typedef struct _det_run_t
+{
+    det_thread_data     *lungs;         /* lungs to process */
+    int                 num_lungs;      /* number of lungs */
+    int                 num_slices;     /* slices of all lungs ( fast radial tasks ) */
+    mig_lst_t           *slice_res;     /* fast radial regions of each slice */
+    int                 num;            /* fast radial regions of all lungs */
+    mig_im_region_t     **fr;           /* fast radial regions in lung and slice order */
+    int                 *fr_lung;       /* lung of each fast radial region */
+    mig_im_region_t     **ss;           /* scale space region of each fast radial one ( NULL if none ) */
+    det_worker_data     *workers;       /* one per pool worker */
+    int                 max_workers;    /* allocated workers , no more than fast radial tasks */
+    int                 num_workers;    /* pool workers of the current phase */
+
+} det_run_t;
+
 
 /*
 ******************************************************************************
@@ -54,6 +95,7 @@ typedef struct _det_params_t
     float ss_sigma_end;         /* scale space final sigma in mm */
     float ss_sigma_inc;         /* scale space sigma increment */
     float ss_thr;               /* scale space responses threshold */
+    int   ss_lung_mask;         /* scale space extrema must lie inside segmented lung */
 
     /* debugging */
     int dump;                   /* shall we dump fast radial images to disk */
@@ -63,8 +105,8 @@ typedef struct _det_params_t
     char *dir_results;
         
     /* threading */
-    pthread_t thread[2];            /* detection threads for left and right lung */ 
-    det_thread_data thread_data[2]; /* detection thread parameters for left and right lungs */
+    int num_threads;                /* pool workers shared by slices and candidates of both lungs */
+    det_thread_data thread_data[2]; /* detection parameters for left and right lungs */
 
 } det_params_t;
 
@@ -90,8 +132,23 @@ static det_params_t _DetectionParams;
 ******************************************************************************
 */
 
-static void*
-_det_thread_routine ( void *arg );
+static int
+_det_run ( det_thread_data *lungs , int num_lungs );
+
+static int
+_det_fr_task ( void *arg , int task , int worker );
+
+static int
+_det_ss_task ( void *arg , int task , int worker );
+
+static int
+_det_workers_fr_alloc ( det_run_t *run );
+
+static int
+_det_workers_ss_alloc ( det_run_t *run );
+
+static void
+_det_workers_free ( det_run_t *run );
 
 /*
 ******************************************************************************
@@ -172,7 +229,16 @@ mig_init ( mig_dic_t *d ,
 
     _DetectionParams.ss_thr = 
        mig_ut_ini_getfloat ( d , PARAM_DET_SSPACE_THR , DEFAULT_PARAM_DET_SSPACE_THR );        
+
+    _DetectionParams.ss_lung_mask = 
+       mig_ut_ini_getint ( d , PARAM_DET_SSPACE_LUNG_MASK , DEFAULT_PARAM_DET_SSPACE_LUNG_MASK );
    
+   /* threading */
+   _DetectionParams.num_threads =
+       mig_ut_ini_getint ( d , PARAM_DET_NUM_THREADS , DEFAULT_PARAM_DET_NUM_THREADS );
+   if ( _DetectionParams.num_threads < 1 )
+       _DetectionParams.num_threads = 1;
+
    /* debug */
    _DetectionParams.dump = 
        mig_ut_ini_getint ( d , PARAM_DET_DUMP , DEFAULT_PARAM_DET_DUMP );
@@ -191,6 +257,7 @@ mig_init ( mig_dic_t *d ,
         os << "\n\t DUMP        : " << _DetectionParams.dump;
         os << "\n\t DUMP DIR    : " << _DetectionParams.dir_dump;
         os << "\n\t RESULTS DIR : " << _DetectionParams.dir_results;
+        os << "\n\t THREADS     : " << _DetectionParams.num_threads;
 		os << "\nProcessing parameters Fast Radial : ";
         os << "\n\t FR num radii : " << _DetectionParams.fr_num_radii;
         os << "\n\t FR radii     : ";
@@ -204,6 +271,7 @@ mig_init ( mig_dic_t *d ,
         os << "\n\t SS end sigma       : " << _DetectionParams.ss_sigma_end;
         os << "\n\t SS sigma increment : " << _DetectionParams.ss_sigma_inc;
         os << "\n\t SS thr             : " << _DetectionParams.ss_thr;
+        os << "\n\t SS lung mask       : " << _DetectionParams.ss_lung_mask;
         LOG4CPLUS_INFO ( _log , os.str() );
     }
 
@@ -299,33 +367,19 @@ mig_run ()
 
     _CadData->det_l._free = &free;
 
-    /* spawn detection thread 0 */
-    rc = pthread_create ( &( _DetectionParams.thread[0] ) ,
-            NULL , &( _det_thread_routine ) , &( _DetectionParams.thread_data[0] ) );
-    if ( rc != 0 )
-    {
-        LOG4CPLUS_FATAL ( _log , " libmigdet_2d -> mig_run pthread_create returned : " << rc );
-        return MIG_ERROR_THREAD;
-    }
-    
-    /* spawn detection thread 1 */
-    rc = pthread_create ( &( _DetectionParams.thread[1] ) ,
-        NULL , &( _det_thread_routine ) , &( _DetectionParams.thread_data[1] ) );
-    if ( rc != 0 )
-    {
-        LOG4CPLUS_FATAL ( _log , " libmigdet_2d -> mig_run pthread_create returned : " << rc );
-        return MIG_ERROR_THREAD;
-    }
-        
-    /* wait for left thread to finish */
-    pthread_join ( _DetectionParams.thread[0] , (void**) &rc );
-    _CadData->stack_r = NULL;
-    memset ( &( _DetectionParams.thread_data[0] ) , 0x00 , sizeof( det_thread_data ) );
+    /* slices and candidates of both lungs share one pool */
+    rc = _det_run ( _DetectionParams.thread_data , 2 );
 
-    /* wait for right thread to finish */
-    pthread_join ( _DetectionParams.thread[1] , (void**) &rc ); 
+    /* segmented lungs are freed by _det_run */
+    _CadData->stack_r = NULL;
     _CadData->stack_l = NULL;
-    memset ( &( _DetectionParams.thread_data[1] ) , 0x00 , sizeof( det_thread_data ) );
+    memset ( _DetectionParams.thread_data , 0x00 , sizeof( _DetectionParams.thread_data ) );
+
+    if ( rc != MIG_OK )
+    {
+        LOG4CPLUS_FATAL ( _log , " libmigdet_2d -> mig_run detection returned : " << rc );
+        return rc;
+    }
 
     LOG4CPLUS_DEBUG ( _log , " libmigdet_2d -> mig_run end..." );
 
@@ -407,196 +461,274 @@ mig_info ( mig_dll_info_t* info )
 ******************************************************************************
 */
 
-static void*
-_det_thread_routine ( void *arg )
+static int
+_det_run ( det_thread_data *lungs , int num_lungs )
 {
-    int i , j , rc;
+    det_run_t run;
+    mig_im_region_t *reg;
     time_t tot0 , tot1;             /* total timing */
     time_t t0 , t1;                 /* partial timing */
-
-    det_thread_data *data = 
-        (det_thread_data*) arg;     /* input parameters */
-    
-    float *slice;                   /* current slice converted to float and scaled to [0,1] */
-    float min , max;                /* min and max gray level values for current slice */
-
-    mig_fradial_t   *FRadial;         /* fast radial structure */
-    mig_lst_t       FRadialRes;       /* fast radial results list */
-    mig_lst_t       FRadialSliceRes;  /* fast radial results for a single slice */
-    mig_im_region_t *FRadialReg;      /* single fast radial result */
-    mig_lst_node    *Node;            /* fast radial list node */            
-
-    mig_sspace_t    *SSpace;           /* scale space structure */
-    float           *SSpaceInput;      /* scale space input cube */
-    mig_im_region_t *SSReg;            /* scale space single result */
+    int i , j , j0 , l , t , num_chunks;
+    int rc = MIG_ERROR_MEMORY;
 
     /* global timer */
     tot0 = getticks_sys();
 
-    LOG4CPLUS_DEBUG ( _log , " _det_thread_routine : " << data->id );
+    memset ( &run , 0x00 , sizeof(det_run_t) );
+    run.lungs       = lungs;
+    run.num_lungs   = num_lungs;
 
-    /* prepare fast radial structure */
-    FRadial = mig_im_fradial_get ( _DetectionParams.fr_radii , 
-                                   _DetectionParams.fr_num_radii , 
-                                   _DetectionParams.fr_thr ,
-                                   _DetectionParams.fr_thr_type,
-								   0.f);
-    if ( FRadial == NULL )
-    {
-        LOG4CPLUS_FATAL ( _log , "Aborting detection thread. Memory error in : " << data->id );
-        pthread_exit ( (void*)MIG_ERROR_MEMORY );
-    }
+    for ( l = 0 ; l < num_lungs ; ++l )
+        run.num_slices += lungs[l].SrcSize->slices;
 
-    /* setup fast radial dumping */
-    FRadial->dump = _DetectionParams.dump;
-    
-    /* zero fast radial result */
-    mig_lst_zero ( &FRadialRes );
+    /* each worker owns its scratch : no more workers than slices */
+    run.max_workers = MIG_MAX2 ( MIG_MIN2 ( _DetectionParams.num_threads , run.num_slices ) , 1 );
+    run.num_workers = run.max_workers;
 
-    /* allocate memory for slice data buffer */
-    slice = (float*) malloc ( data->SrcSize->dim * sizeof(float) );
-    if ( slice == NULL )
-    {
-        LOG4CPLUS_FATAL ( _log , "Aborting detection thread. Memory error in : " << data->id );
-        pthread_exit ( (void*)MIG_ERROR_MEMORY );
-    }
+    run.workers = (det_worker_data*) calloc ( run.max_workers , sizeof(det_worker_data) );
+    run.slice_res = (mig_lst_t*) calloc ( MIG_MAX2 ( run.num_slices , 1 ) , sizeof(mig_lst_t) );
+    if ( ( run.workers == NULL ) || ( run.slice_res == NULL ) )
+        goto cleanup;
+
+    for ( t = 0 ; t < run.num_slices ; ++t )
+        mig_lst_zero ( &( run.slice_res[t] ) );
+
+    /*********************************/
+    /* PERFORM FAST RADIAL FILTERING */
+    /*********************************/
 
     /* fast radial timer */
     t0 = getticks_sys();
 
-    /* for each slice perform 2d fast radial */
-    for ( i = 0 ; i < data->SrcSize->slices ; ++i )
+    if ( run.num_slices > 0 )
     {
-        /*******************************/
-        /* PREPARE DATA FOR PROCESSING */
-        /*******************************/
+        if ( _det_workers_fr_alloc ( &run ) != 0 )
+            goto cleanup;
 
-        /* zero slice buffer */
-        memset ( slice , 0x00 , data->SrcSize->dim * sizeof(float) ); 
+        if ( mig_ut_pool_run ( run.num_slices , run.num_workers , &_det_fr_task , &run ) != 0 )
+            goto cleanup;
+    }
 
-        /* copy original slice data into local buffer */
-        mig_im_util_conv_16u_32f ( data->Src + i * data->SrcSize->dim , slice , data->SrcSize->dim );
-    
-        /* find min and max values for current slice : needed for scaling */
-        mig_im_util_min_max_32f ( slice , data->SrcSize->dim , &min , &max );
-        if ( min == max )
-            continue;
+    t1 = getticks_sys();
+    LOG4CPLUS_INFO ( _log , "FR timing : " << ( elapsed_sys( t1 , t0 ) / 60.0f ) << " min." );
+
+    /* gather fast radial regions in slice order , slices are in lung order */
+    for ( t = 0 ; t < run.num_slices ; ++t )
+        run.num += mig_lst_len ( &( run.slice_res[t] ) );
 
-        /* scale input slice to [0,1] */
-        mig_im_util_mat2gray_32f ( slice , data->SrcSize->dim , min , max );
+    if ( run.num == 0 )
+    {
+        rc = MIG_OK;
+        goto cleanup;
+    }
 
-        /*********************************/
-        /* PERFORM FAST RADIAL FILTERING */
-        /*********************************/
+    run.fr = (mig_im_region_t**) malloc ( run.num * sizeof(mig_im_region_t*) );
+    run.fr_lung = (int*) malloc ( run.num * sizeof(int) );
+    run.ss = (mig_im_region_t**) calloc ( run.num , sizeof(mig_im_region_t*) );
+    if ( ( run.fr == NULL ) || ( run.fr_lung == NULL ) || ( run.ss == NULL ) )
+        goto cleanup;
 
-        /* current slice regions */
-        mig_lst_zero ( &FRadialSliceRes );
-        /* path prefix for dumping fast radial results */
-        if ( FRadial->dump == 1 )
+    for ( l = 0 , t = 0 , i = 0 ; l < num_lungs ; ++l )
+    {
+        j0 = i;
+        for ( j = 0 ; j < lungs[l].SrcSize->slices ; ++j , ++t )
         {
-            snprintf ( FRadial->prefix , MAX_PATH , "%s%c%s_%s_%s_%d_%03d" ,
-            _DetectionParams.dir_dump , MIG_PATH_SEPARATOR ,
-            _CadData->dicom_data.patient_id ,
-            _CadData->dicom_data.study_uid ,
-            _CadData->dicom_data.series_uid , 
-            data->id , i );
+            while ( ( reg = (mig_im_region_t*) mig_lst_get_head ( &( run.slice_res[t] ) ) ) != NULL )
+            {
+                run.fr[i]      = reg;
+                run.fr_lung[i] = l;
+                ++i;
+            }
         }
-        
-        /* perform fast radial filtering */
-        rc = mig_im_fradial_2d ( slice , data->SrcSize->w , data->SrcSize->h , FRadial , &FRadialSliceRes );
-        if ( rc != 0 )
+
+        LOG4CPLUS_DEBUG ( _log , "lung : " << lungs[l].id << " , number of fr regions :  " << ( i - j0 ) );
+
+        /* free segmented lung before scale space processing unless it masks extrema */
+        if ( _DetectionParams.ss_lung_mask == 0 )
         {
-            pthread_exit( (void*)MIG_ERROR_MEMORY );
+            _CadData->seg_cleanup ( lungs[l].Src );
+            lungs[l].Src = NULL;
         }
+    }
 
-        
-        /* if there are no results go to next slice */
-        if ( mig_lst_len( &FRadialSliceRes) == 0 )
+    /************************************/
+    /* PERFORM SCALE SPACE CALCULATIONS */
+    /************************************/
+
+    LOG4CPLUS_DEBUG ( _log , " number of fr regions :  " << run.num );
+
+    /* scale space timing */
+    t0 = getticks_sys();
+
+    /* no more workers than candidate chunks , at least one for the parameter dump */
+    num_chunks = mig_ut_pool_chunks ( run.num , DET_SS_CHUNK );
+    run.num_workers = MIG_MAX2 ( MIG_MIN2 ( run.max_workers , num_chunks ) , 1 );
+
+    if ( _det_workers_ss_alloc ( &run ) != 0 )
+        goto cleanup;
+
+    if ( mig_ut_pool_run ( num_chunks , run.num_workers , &_det_ss_task , &run ) != 0 )
+        goto cleanup;
+
+    /* add scale space regions to the tail of their lung list in candidate order */
+    for ( i = 0 ; i < run.num ; ++i )
+    {
+        if ( run.ss[i] == NULL )
             continue;
 
-        /* update FRadialSliceRes z coordinate */
-        Node = FRadialSliceRes.head;
-        while ( Node != NULL )
-        {
-            FRadialReg = (mig_im_region_t*) Node->data;
-            FRadialReg->centroid[2] = (float) i;
-            Node = Node->next;
-        }
-        
-        /* add current slice list to global list */
-        mig_lst_cat ( &FRadialSliceRes , &FRadialRes );
-    
-    }   /* for each slice */
+        if ( mig_lst_put_tail ( lungs[run.fr_lung[i]].Results , run.ss[i] ) != 0 )
+            goto cleanup;
+
+        run.ss[i] = NULL;
+    }
 
-    /* fast radial timer */
     t1 = getticks_sys();
-    LOG4CPLUS_INFO ( _log , "thread : " << data->id << " FR timing : " << ( elapsed_sys( t1 , t0 )  / 60 ) << " min." );
-    
-    LOG4CPLUS_DEBUG ( _log , "thread : " << data->id << " , number of fr regions :  " << FRadialRes.num );
+    LOG4CPLUS_INFO ( _log , "SS timing : " << ( elapsed_sys( t1 , t0 ) / 60.0f ) << " min." );
+
+    for ( l = 0 ; l < num_lungs ; ++l )
+        LOG4CPLUS_DEBUG ( _log , "lung : " << lungs[l].id << " number of ss regions :  " << lungs[l].Results->num );
 
-    /* free segmented lung */
-    _CadData->seg_cleanup ( data->Src );
-    mig_im_fradial_del ( FRadial );
+    rc = MIG_OK;
+
+cleanup :
+
+    if ( rc != MIG_OK )
+        LOG4CPLUS_FATAL ( _log , "Aborting detection. Memory error..." );
 
-    if ( mig_lst_len ( &FRadialRes) == 0 )
-    {    
-        pthread_exit( (void*)MIG_OK );
+    /* segmented lungs are freed on every path */
+    for ( l = 0 ; l < num_lungs ; ++l )
+    {
+        if ( lungs[l].Src != NULL )
+        {
+            _CadData->seg_cleanup ( lungs[l].Src );
+            lungs[l].Src = NULL;
+        }
     }
-    
-    /* prepare scale space structure */
-    SSpace = mig_im_sspace_get ( 1 , /* scale space type -> 2D */
-                                 _DetectionParams.ss_spacing ,
-                                 _DetectionParams.ss_sigma_start / ( data->SrcSize->h_res ) ,
-                                 _DetectionParams.ss_sigma_end   / ( data->SrcSize->h_res ) ,
-                                 _DetectionParams.ss_sigma_inc ,
-                                 _DetectionParams.ss_thr );
-    if ( SSpace == NULL )
+
+    if ( run.slice_res )
     {
-        mig_lst_empty ( &FRadialRes );
-        LOG4CPLUS_FATAL ( _log , "Aborting detection thread. Memory error in : " << data->id );
-        pthread_exit ( (void*)MIG_ERROR_MEMORY );
+        for ( t = 0 ; t < run.num_slices ; ++t )
+            mig_lst_empty ( &( run.slice_res[t] ) );
+        free ( run.slice_res );
     }
 
-    if ( _log.getLogLevel() <= DEBUG_LOG_LEVEL )
+    for ( i = 0 ; i < run.num ; ++i )
     {
-        std::stringstream os;
-        os << "Scale space parameters : ";
-        os << "\n\t WINDOW RADIUS     : " << SSpace->window_radius;
-        os << "\n\t WINDOW LENGTH     : " << SSpace->window_len;
-        os << "\n\t WINDOW PIXELS     : " << SSpace->window_voxels;
-        os << "\n\t START SIGMA       : " << SSpace->sigma_start;
-        os << "\n\t END SIGMA         : " << SSpace->sigma_end;
-        os << "\n\t NUM SIGMAS        : " << SSpace->num_sigmas;
-        os << "\n\t SIGMAS            : ";
-        for ( j = 0 ; j < SSpace->num_sigmas ; ++j )
-            os << "(" << SSpace->kernels[j]->sigma << "," << SSpace->kernels[j]->scale << ")";
-    
-        LOG4CPLUS_DEBUG ( _log , os.str() );
-	}
+        if ( run.fr && run.fr[i] )
+            free ( run.fr[i] );
+        if ( run.ss && run.ss[i] )
+            free ( run.ss[i] );
+    }
+
+    if ( run.fr )
+        free ( run.fr );
+    if ( run.fr_lung )
+        free ( run.fr_lung );
+    if ( run.ss )
+        free ( run.ss );
+
+    _det_workers_free ( &run );
+
+    /* global timer */
+    tot1 = getticks_sys();
+    LOG4CPLUS_INFO ( _log , "Detection pool total timing : " << ( elapsed_sys( tot1 , tot0 ) / 60.0f ) << " min." );
+
+    return rc;
+}
+
+/*******************************************************************************/
 
-    /* prepare scale space input buffer */
-    SSpaceInput = (float*) calloc ( SSpace->window_voxels , sizeof(float) );
-    if ( SSpaceInput == NULL )
+static int
+_det_fr_task ( void *arg , int task , int worker )
+{
+    det_run_t *run = (det_run_t*) arg;
+    det_worker_data *wd = &( run->workers[worker] );
+    det_thread_data *data;
+    mig_lst_t *Res = &( run->slice_res[task] );
+    mig_im_region_t *FRadialReg;    /* single fast radial result */
+    mig_lst_node *Node;             /* fast radial list node */
+    float min , max;                /* min and max gray level values for current slice */
+    int l , i;
+
+    /* task -> lung and slice */
+    for ( l = 0 , i = task ; i >= run->lungs[l].SrcSize->slices ; ++l )
+        i -= run->lungs[l].SrcSize->slices;
+
+    data = &( run->lungs[l] );
+
+    /*******************************/
+    /* PREPARE DATA FOR PROCESSING */
+    /*******************************/
+
+    /* copy original slice data into local buffer */
+    mig_im_util_conv_16u_32f ( data->Src + i * data->SrcSize->dim , wd->slice , data->SrcSize->dim );
+
+    /* find min and max values for current slice : needed for scaling */
+    mig_im_util_min_max_32f ( wd->slice , data->SrcSize->dim , &min , &max );
+    if ( min == max )
+        return 0;
+
+    /* scale input slice to [0,1] */
+    mig_im_util_mat2gray_32f ( wd->slice , data->SrcSize->dim , min , max );
+
+    /* path prefix for dumping fast radial results */
+    if ( wd->FRadial->dump == 1 )
     {
-        mig_lst_empty ( &FRadialRes );
-        mig_im_sspace_del ( SSpace );
-            
-        LOG4CPLUS_FATAL ( _log , "Aborting detection thread. Memory error in : " << data->id );
-        pthread_exit ( (void*)MIG_ERROR_MEMORY );
+        snprintf ( wd->FRadial->prefix , MAX_PATH , "%s%c%s_%s_%s_%d_%03d" ,
+                   _DetectionParams.dir_dump , MIG_PATH_SEPARATOR ,
+                   _CadData->dicom_data.patient_id ,
+                   _CadData->dicom_data.study_uid ,
+                   _CadData->dicom_data.series_uid ,
+                   data->id , i );
     }
-              
-    LOG4CPLUS_DEBUG ( _log , " number of fr regions :  " << mig_lst_len( &FRadialRes )  );
-    
-    /************************************/
-    /* PERFORM SCALE SPACE CALCULATIONS */
-    /************************************/
-    
-    /* scale space timing */
-    t0 = getticks_sys();
 
-    /* process regions left after fast radial */
-    while ( ( FRadialReg = (mig_im_region_t*) mig_lst_get_head ( &FRadialRes ) ) != NULL )
+    /* perform fast radial filtering */
+    if ( mig_im_fradial_2d_buf ( wd->slice , data->SrcSize->w , data->SrcSize->h ,
+                                 wd->FRadial , wd->FRadialBuf , Res ) != 0 )
+        return -1;
+
+    /* update slice regions z coordinate */
+    for ( Node = Res->head ; Node != NULL ; Node = Node->next )
+    {
+        FRadialReg = (mig_im_region_t*) Node->data;
+        FRadialReg->centroid[2] = (float) i;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************/
+
+static int
+_det_ss_task ( void *arg , int task , int worker )
+{
+    det_run_t *run = (det_run_t*) arg;
+    det_worker_data *wd = &( run->workers[worker] );
+    det_thread_data *data;
+    mig_sspace_t *SSpace;
+    mig_im_region_t *FRadialReg;
+    mig_im_region_t *SSReg;
+    float *Mask = NULL;
+    int i , end;
+
+    end = MIG_MIN2 ( ( task + 1 ) * DET_SS_CHUNK , run->num );
+
+    for ( i = task * DET_SS_CHUNK ; i < end ; ++i )
     {
+        FRadialReg = run->fr[i];
+        data       = &( run->lungs[run->fr_lung[i]] );
+        SSpace     = wd->SSpace[run->fr_lung[i]];
+
+        /* segmented lung window : zero outside lung */
+        if ( wd->SSpaceMask != NULL )
+        {
+            mig_im_bb_cut_2d ( data->Src + ( (int) FRadialReg->centroid[2] ) * data->SrcSize->dim ,
+                               data->SrcSize->w , data->SrcSize->h ,
+                               (int)( FRadialReg->centroid[0] + 0.5f ) , (int)( FRadialReg->centroid[1] + 0.5f ) ,
+                               wd->SSpaceMask , SSpace->window_radius );
+            Mask = wd->SSpaceMask;
+        }
+
         /* adjust fast radial region coordinates to global coordinates system */
         FRadialReg->centroid[0] += data->SrcBoundingBox->x0;
         FRadialReg->centroid[1] += data->SrcBoundingBox->y0;
@@ -607,43 +739,171 @@ _det_thread_routine ( void *arg )
                            ( (int) FRadialReg->centroid[2] ) * data->OriginalSize->dim , 
                            data->OriginalSize->w , data->OriginalSize->h , 
                            (int)( FRadialReg->centroid[0] + 0.5f ) , (int)( FRadialReg->centroid[1] + 0.5f ) ,
-                           SSpaceInput , SSpace->window_radius );
+                           wd->SSpaceInput , SSpace->window_radius );
 
         /* scale to [0,1] interval */
-        mig_im_util_mat2gray_32f ( SSpaceInput , SSpace->window_voxels , 0.0f , 65535.0f );
+        mig_im_util_mat2gray_32f ( wd->SSpaceInput , SSpace->window_voxels , 0.0f , 65535.0f );
     
         /* perform scale space processing */
-        SSReg = mig_im_sspace ( SSpaceInput , SSpace );
+        SSReg = mig_im_sspace_masked ( wd->SSpaceInput , Mask , SSpace );
         if ( SSReg != NULL )
         {
             /* adjust coordinates to global coordinate system */
             SSReg->centroid[0] += FRadialReg->centroid[0];
             SSReg->centroid[1] += FRadialReg->centroid[1];
             SSReg->centroid[2]  = FRadialReg->centroid[2];
-                        
-            /* add resulting region to tail of output list */
-            mig_lst_put_tail( data->Results , SSReg );
         }
 
-        free ( FRadialReg );
+        run->ss[i] = SSReg;
     }
-    
-    t1 = getticks_sys();
-    LOG4CPLUS_INFO ( _log , "thread : " << data->id << " SS timing : " << ( elapsed_sys( t1 , t0 ) / 60.0f ) << " min." );
-    
-    free ( slice );
-    
-    mig_lst_empty  ( &FRadialRes );
-    
-    free ( SSpaceInput );
-    mig_im_sspace_del ( SSpace );
 
-    /* global timer */
-    tot1 = getticks_sys();
-    LOG4CPLUS_INFO ( _log , "Thread " << data->id << " total timing : " << ( elapsed_sys( tot1 , tot0 ) / 60.0f ) << " min." );
-    
-    LOG4CPLUS_DEBUG ( _log , "thread : " << data->id << " number of ss regions :  " << data->Results->num );
+    return 0;
+}
+
+/*******************************************************************************/
+
+static int
+_det_workers_fr_alloc ( det_run_t *run )
+{
+    det_worker_data *wd;
+    int max_w = 0 , max_h = 0 , max_dim = 0;
+    int l , k;
+
+    for ( l = 0 ; l < run->num_lungs ; ++l )
+    {
+        if ( run->lungs[l].SrcSize->slices == 0 )
+            continue;
+
+        max_w   = MIG_MAX2 ( max_w , run->lungs[l].SrcSize->w );
+        max_h   = MIG_MAX2 ( max_h , run->lungs[l].SrcSize->h );
+        max_dim = MIG_MAX2 ( max_dim , run->lungs[l].SrcSize->dim );
+    }
+
+    /* scratch is sized once for the largest lung and reused for every slice */
+    for ( k = 0 ; k < run->num_workers ; ++k )
+    {
+        wd = &( run->workers[k] );
+
+        wd->FRadial = mig_im_fradial_get ( _DetectionParams.fr_radii , 
+                                           _DetectionParams.fr_num_radii , 
+                                           _DetectionParams.fr_thr ,
+                                           _DetectionParams.fr_thr_type ,
+                                           0.f );
+        if ( wd->FRadial == NULL )
+            return -1;
+
+        /* setup fast radial dumping */
+        wd->FRadial->dump = _DetectionParams.dump;
+
+        wd->FRadialBuf = mig_im_fradial_buf_get ( max_w , max_h , wd->FRadial );
+        if ( wd->FRadialBuf == NULL )
+            return -1;
+
+        wd->slice = (float*) malloc ( max_dim * sizeof(float) );
+        if ( wd->slice == NULL )
+            return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************/
+
+static int
+_det_workers_ss_alloc ( det_run_t *run )
+{
+    det_worker_data *wd;
+    mig_sspace_t *SSpace;
+    int max_voxels = 0;
+    int j , l , k;
+
+    for ( k = 0 ; k < run->num_workers ; ++k )
+    {
+        wd = &( run->workers[k] );
 
-    return ( (void*)MIG_OK );
+        /* scale space keeps per call state : one structure per worker and lung */
+        for ( l = 0 ; l < run->num_lungs ; ++l )
+        {
+            wd->SSpace[l] = mig_im_sspace_get ( 1 , /* scale space type -> 2D */
+                                                _DetectionParams.ss_spacing ,
+                                                _DetectionParams.ss_sigma_start / ( run->lungs[l].SrcSize->h_res ) ,
+                                                _DetectionParams.ss_sigma_end   / ( run->lungs[l].SrcSize->h_res ) ,
+                                                _DetectionParams.ss_sigma_inc ,
+                                                _DetectionParams.ss_thr );
+            if ( wd->SSpace[l] == NULL )
+                return -1;
+
+            max_voxels = MIG_MAX2 ( max_voxels , wd->SSpace[l]->window_voxels );
+        }
+
+        wd->SSpaceInput = (float*) calloc ( max_voxels , sizeof(float) );
+        if ( wd->SSpaceInput == NULL )
+            return -1;
+
+        if ( _DetectionParams.ss_lung_mask )
+        {
+            wd->SSpaceMask = (float*) calloc ( max_voxels , sizeof(float) );
+            if ( wd->SSpaceMask == NULL )
+                return -1;
+        }
+    }
+
+    if ( _log.getLogLevel() <= DEBUG_LOG_LEVEL )
+    {
+        for ( l = 0 ; l < run->num_lungs ; ++l )
+        {
+            SSpace = run->workers[0].SSpace[l];
+
+            std::stringstream os;
+            os << "Scale space parameters lung " << run->lungs[l].id << " : ";
+            os << "\n\t WINDOW RADIUS     : " << SSpace->window_radius;
+            os << "\n\t WINDOW LENGTH     : " << SSpace->window_len;
+            os << "\n\t WINDOW PIXELS     : " << SSpace->window_voxels;
+            os << "\n\t START SIGMA       : " << SSpace->sigma_start;
+            os << "\n\t END SIGMA         : " << SSpace->sigma_end;
+            os << "\n\t NUM SIGMAS        : " << SSpace->num_sigmas;
+            os << "\n\t SIGMAS            : ";
+            for ( j = 0 ; j < SSpace->num_sigmas ; ++j )
+                os << "(" << SSpace->kernels[j]->sigma << "," << SSpace->kernels[j]->scale << ")";
+
+            LOG4CPLUS_DEBUG ( _log , os.str() );
+        }
+    }
+
+    return 0;
 }
 
+/*******************************************************************************/
+
+static void
+_det_workers_free ( det_run_t *run )
+{
+    det_worker_data *wd;
+    int k , l;
+
+    if ( run->workers == NULL )
+        return;
+
+    for ( k = 0 ; k < run->max_workers ; ++k )
+    {
+        wd = &( run->workers[k] );
+
+        if ( wd->slice )
+            free ( wd->slice );
+        if ( wd->FRadial )
+            mig_im_fradial_del ( wd->FRadial );
+        mig_im_fradial_buf_del ( wd->FRadialBuf );
+
+        for ( l = 0 ; l < 2 ; ++l )
+            if ( wd->SSpace[l] )
+                mig_im_sspace_del ( wd->SSpace[l] );
+
+        if ( wd->SSpaceInput )
+            free ( wd->SSpaceInput );
+        if ( wd->SSpaceMask )
+            free ( wd->SSpaceMask );
+    }
+
+    free ( run->workers );
+    run->workers = NULL;
+}
@@ -38,12 +38,22 @@ typedef struct _det_thread_data
 
 typedef struct _det_params_t
 {
+	int             anisotropic;    /* work on native slice spacing instead of cubic voxels */
+
 	/* Fast Radial */
 	float           *fr_radii;      /* fast radial radii */
 	int             fr_num_radii;   /* fast radial number of radii */
 	ThresholdType   fr_thr_type;    /* fast radial thresholding type */
 	float           fr_thr;         /* fast radial threshold */
 	float			fr_beta_thr;
+	int             fr_num_threads; /* fast radial smoothing threads per lung */
+	int             fr_tile_len;    /* fast radial skips tiles far from lung mask ( 0 -> off ) */
+	FrPrecision     fr_precision;   /* fast radial intermediate buffers precision */
+	int             fr_validate;    /* compare reduced precision fast radial with float */
+	float           fr_coarse_radius; /* fast radial radii from this one on run coarse to fine ( 0 -> off ) */
+	int             fr_coarse_scale;  /* fast radial coarse level downsampling factor */
+	float           fr_coarse_thr;    /* fast radial coarse responses refinement threshold */
+	float           fr_merge_dist;    /* fast radial candidates merge distance relative to radius ( 0 -> off ) */
 
 	/* Scale Space */
 	SigmaSpacing ss_spacing;    /* scale space structure */
@@ -51,6 +61,7 @@ typedef struct _det_params_t
 	float ss_sigma_end;         /* scale space final sigma in mm */
 	float ss_sigma_inc;         /* scale space sigma increment */
 	float ss_thr;               /* scale space responses threshold */
+	int   ss_num_threads;       /* scale space threads inside each lung thread */
 
 	/* debugging */
 	int dump;                   /* shall we dump fast radial images to disk */
@@ -149,12 +160,35 @@ mig_init ( mig_dic_t *d ,
 	if ( _DetectionParams.fr_radii == NULL )
 		return MIG_ERROR_IO;
 
+	_DetectionParams.anisotropic = mig_ut_ini_getint ( d , PARAM_DET_ANISOTROPIC , DEFAULT_PARAM_DET_ANISOTROPIC );
+
 	_DetectionParams.fr_thr_type = (ThresholdType) mig_ut_ini_getint ( d , PARAM_DET_FR_THR_TYPE , DEFAULT_PARAM_DET_FR_THR_TYPE );
 
 	_DetectionParams.fr_thr = mig_ut_ini_getfloat ( d , PARAM_DET_FR_THR , DEFAULT_PARAM_DET_FR_THR );
 
 	_DetectionParams.fr_beta_thr = mig_ut_ini_getfloat ( d , PARAM_DET_FR_BETA_THR , DEFAULT_PARAM_DET_FR_BETA_THR );
 
+	_DetectionParams.fr_num_threads = mig_ut_ini_getint ( d , PARAM_DET_FR_NUM_THREADS , DEFAULT_PARAM_DET_FR_NUM_THREADS );
+	if ( _DetectionParams.fr_num_threads < 1 )
+		_DetectionParams.fr_num_threads = 1;
+
+	_DetectionParams.fr_tile_len = mig_ut_ini_getint ( d , PARAM_DET_FR_TILE_LEN , DEFAULT_PARAM_DET_FR_TILE_LEN );
+	if ( _DetectionParams.fr_tile_len < 0 )
+		_DetectionParams.fr_tile_len = 0;
+
+	_DetectionParams.fr_precision = (FrPrecision) mig_ut_ini_getint ( d , PARAM_DET_FR_PRECISION , DEFAULT_PARAM_DET_FR_PRECISION );
+	if ( _DetectionParams.fr_precision < FR_PRECISION_FLOAT || _DetectionParams.fr_precision > FR_PRECISION_FIXED16 )
+		_DetectionParams.fr_precision = FR_PRECISION_FLOAT;
+
+	_DetectionParams.fr_validate = mig_ut_ini_getint ( d , PARAM_DET_FR_VALIDATE , DEFAULT_PARAM_DET_FR_VALIDATE );
+
+	_DetectionParams.fr_coarse_radius = mig_ut_ini_getfloat ( d , PARAM_DET_FR_COARSE_RADIUS , DEFAULT_PARAM_DET_FR_COARSE_RADIUS );
+	_DetectionParams.fr_coarse_scale = mig_ut_ini_getint ( d , PARAM_DET_FR_COARSE_SCALE , DEFAULT_PARAM_DET_FR_COARSE_SCALE );
+	if ( _DetectionParams.fr_coarse_scale < 2 )
+		_DetectionParams.fr_coarse_radius = 0.0f;
+	_DetectionParams.fr_coarse_thr = mig_ut_ini_getfloat ( d , PARAM_DET_FR_COARSE_THR , DEFAULT_PARAM_DET_FR_COARSE_THR );
+	_DetectionParams.fr_merge_dist = mig_ut_ini_getfloat ( d , PARAM_DET_FR_MERGE_DIST , DEFAULT_PARAM_DET_FR_MERGE_DIST );
+
 
 	/* scale space parameters */
 	_DetectionParams.ss_spacing = (SigmaSpacing) 
@@ -172,6 +206,11 @@ mig_init ( mig_dic_t *d ,
 	_DetectionParams.ss_thr = 
 		mig_ut_ini_getfloat ( d , PARAM_DET_SSPACE_THR , DEFAULT_PARAM_DET_SSPACE_THR );        
 
+	_DetectionParams.ss_num_threads = 
+		mig_ut_ini_getint ( d , PARAM_DET_SSPACE_NUM_THREADS , DEFAULT_PARAM_DET_SSPACE_NUM_THREADS );
+	if ( _DetectionParams.ss_num_threads < 1 )
+		_DetectionParams.ss_num_threads = 1;
+
 	/* debug */
 	_DetectionParams.dump = 
 		mig_ut_ini_getint ( d , PARAM_DET_DUMP , DEFAULT_PARAM_DET_DUMP );
@@ -192,10 +231,19 @@ mig_init ( mig_dic_t *d ,
 		os << "Processing options : ";
 		os << "\n\t DUMP     : " << _DetectionParams.dump;
 		os << "\n\t DUMP DIR : " << _DetectionParams.dir_dump;
+		os << "\n\t ANISOTROPIC : " << _DetectionParams.anisotropic;
 		os << "\nProcessing parameters Fast Radial : ";
 		os << "\n\t FR thr is %  : " << (int)_DetectionParams.fr_thr_type;
 		os << "\n\t FR thr       : " << _DetectionParams.fr_thr;
 		os << "\n\t FR num radii : " << _DetectionParams.fr_num_radii;
+		os << "\n\t FR threads   : " << _DetectionParams.fr_num_threads;
+		os << "\n\t FR mask tile : " << _DetectionParams.fr_tile_len;
+		os << "\n\t FR precision : " << (int)_DetectionParams.fr_precision;
+		os << "\n\t FR validate  : " << _DetectionParams.fr_validate;
+		os << "\n\t FR coarse radius : " << _DetectionParams.fr_coarse_radius;
+		os << "\n\t FR coarse scale  : " << _DetectionParams.fr_coarse_scale;
+		os << "\n\t FR coarse thr    : " << _DetectionParams.fr_coarse_thr;
+		os << "\n\t FR merge dist    : " << _DetectionParams.fr_merge_dist;
 		os << "\n\t FR radii     : ";
 		for ( i = 0 ; i < _DetectionParams.fr_num_radii ; ++i )
 			os << " " << _DetectionParams.fr_radii[i];        
@@ -205,6 +253,7 @@ mig_init ( mig_dic_t *d ,
 		os << "\n\t SS end sigma       : " << _DetectionParams.ss_sigma_end;
 		os << "\n\t SS sigma increment : " << _DetectionParams.ss_sigma_inc;
 		os << "\n\t SS thr             : " << _DetectionParams.ss_thr;
+		os << "\n\t SS threads         : " << _DetectionParams.ss_num_threads;
 		LOG4CPLUS_INFO ( _log , os.str() );
 	}
 
@@ -444,7 +493,7 @@ _det_thread_routine ( void *arg )
 	mig_im_region_t *FRadialReg;  /* single fast radial result */
 
 	mig_sspace_t    *SSpace;       /* scale space structure */
-	float           *SSpaceInput;  /* scale space input cube */
+	mig_lst_node    *SSNode;       /* scale space results iterator */
 	mig_im_region_t *SSReg;        /* scale space single result */
 
 	/* global timer */
@@ -464,6 +513,29 @@ _det_thread_routine ( void *arg )
 		pthread_exit ( (void*)MIG_ERROR_MEMORY );
 	}
 
+	/* setup fast radial smoothing threads */
+	FRadial->num_threads = _DetectionParams.fr_num_threads;
+
+	/* restrict fast radial to lung mask neighbourhood : segmented stacks
+	   are zero outside the mask */
+	FRadial->tile_len = _DetectionParams.fr_tile_len;
+
+	/* setup fast radial intermediate precision */
+	FRadial->precision = _DetectionParams.fr_precision;
+	FRadial->validate = _DetectionParams.fr_validate;
+
+	/* setup fast radial coarse to fine processing of large radii */
+	FRadial->coarse_radius = _DetectionParams.fr_coarse_radius;
+	FRadial->coarse_scale = _DetectionParams.fr_coarse_scale;
+	FRadial->coarse_threshold = _DetectionParams.fr_coarse_thr;
+
+	/* setup fast radial merging of candidates of the same blob */
+	FRadial->merge_distance = _DetectionParams.fr_merge_dist;
+
+	/* radii are in-plane voxels : votes and smoothing shrink along z */
+	if ( _DetectionParams.anisotropic && data->SrcSize->h_res > 0.0f && data->SrcSize->z_res > 0.0f )
+		FRadial->z_ratio = data->SrcSize->z_res / data->SrcSize->h_res;
+
 	/* setup fast radial dumping */
 	FRadial->dump = _DetectionParams.dump;
 
@@ -483,6 +555,15 @@ _det_thread_routine ( void *arg )
 	rc = mig_im_fradial_3d ( data->Src , data->SrcSize->w , data->SrcSize->h , 
 		data->SrcSize->slices , FRadial , &FRadialRes );
 
+	if ( rc == 0 && FRadial->validate == 1 && FRadial->precision != FR_PRECISION_FLOAT )
+	{
+		LOG4CPLUS_INFO ( _log , " fr precision " << (int)FRadial->precision << " vs float in " << data->id
+			<< " : candidates " << FRadial->val.num << " / " << FRadial->val.num_ref
+			<< " , unmatched " << FRadial->val.num_unmatched
+			<< " , max centroid dev " << FRadial->val.max_centroid_dev
+			<< " , max score dev " << FRadial->val.max_score_dev
+			<< " , max response dev " << FRadial->val.max_response_dev );
+	}
 
 	/* free segmented lung */
 	/* GF20101001: comment following line if seg data is needed in further analysis */
@@ -510,12 +591,14 @@ _det_thread_routine ( void *arg )
 	/******************************************************/
 
     /* prepare scale space structure */
-    SSpace = mig_im_sspace_get ( 0 , /* scale space type -> D */
+    SSpace = mig_im_sspace_get_aniso ( 0 , /* scale space type -> D */
                                  _DetectionParams.ss_spacing ,
                                  _DetectionParams.ss_sigma_start / ( data->SrcSize->h_res ) ,
                                  _DetectionParams.ss_sigma_end   / ( data->SrcSize->h_res ) ,
                                  _DetectionParams.ss_sigma_inc ,
-                                 _DetectionParams.ss_thr );
+                                 _DetectionParams.ss_thr ,
+                                 ( _DetectionParams.anisotropic && data->SrcSize->h_res > 0.0f ) ?
+                                     data->SrcSize->z_res / data->SrcSize->h_res : 1.0f );
     if ( SSpace == NULL )
     {
         mig_lst_empty ( &FRadialRes );
@@ -529,6 +612,7 @@ _det_thread_routine ( void *arg )
         os << "Scale space parameters : ";
         os << "\n\t WINDOW RADIUS     : " << SSpace->window_radius;
         os << "\n\t WINDOW LENGTH     : " << SSpace->window_len;
+        os << "\n\t WINDOW Z LENGTH   : " << SSpace->window_len_z;
         os << "\n\t WINDOW PIXELS     : " << SSpace->window_voxels;
         os << "\n\t START SIGMA       : " << SSpace->sigma_start;
         os << "\n\t END SIGMA         : " << SSpace->sigma_end;
@@ -540,34 +624,20 @@ _det_thread_routine ( void *arg )
         LOG4CPLUS_DEBUG ( _log , os.str() );
 	}
 
-    /* prepare scale space input buffer */
-    SSpaceInput = (float*) calloc ( SSpace->window_voxels , sizeof(float) );
-    if ( SSpaceInput == NULL )
-    {
-        mig_lst_empty ( &FRadialRes );
-        mig_im_sspace_del ( SSpace );
-            
-        LOG4CPLUS_FATAL ( _log , "Aborting detection thread. Memory error in : " << data->id );
-        pthread_exit ( (void*)MIG_ERROR_MEMORY );
-    }
-              
     LOG4CPLUS_DEBUG ( _log , " number of fr regions :  " << mig_lst_len( &FRadialRes )  );
 
-	///************************************/
-	//   /* PERFORM SCALE SPACE CALCULATIONS */
-	//   /************************************/
-	//
-	///* scale space timing */
-	   t0 = getticks_sys();
-
+	/************************************/
+	/* PERFORM SCALE SPACE CALCULATIONS */
+	/************************************/
 
+	/* scale space timing */
+	t0 = getticks_sys();
 
-	//
-	//
-	/* process regions left after fast radial */
-	while ( ( FRadialReg = (mig_im_region_t*) mig_lst_get_head ( &FRadialRes ) ) != NULL )
+	/* adjust fast radial region coordinates to global coordinates system */
+	for ( SSNode = FRadialRes.head ; SSNode != NULL ; SSNode = SSNode->next )
 	{
-		/* adjust fast radial region coordinates to global coordinates system */
+		FRadialReg = (mig_im_region_t*) SSNode->data;
+
 		FRadialReg->centroid[0] += data->SrcBoundingBox->x0;
 		FRadialReg->centroid[1] += data->SrcBoundingBox->y0;
 		FRadialReg->centroid[2] += data->SrcBoundingBox->z0;
@@ -575,50 +645,34 @@ _det_thread_routine ( void *arg )
 		LOG4CPLUS_DEBUG ( _log , " thread : " << data->id << " fr region :  "
 			<< FRadialReg->centroid[0] << "," << FRadialReg->centroid[1] << ","
 			<< FRadialReg->centroid[2] );
+	}
 
+	/*****************************************************************/
+	/* SIMPLIFIED SCALE SPACE ANALYSIS								 */
+	/*(just compute responses of 3d mexican hat in the center)		 */
+	/*****************************************************************/
+
+	/* all candidates of this lung at once : results keep fast radial order */
+	SSNode = data->Results->tail;
+	rc = mig_im_sspace_radius_batch ( data->Original , data->OriginalSize->w ,
+	                                  data->OriginalSize->h , data->OriginalSize->slices ,
+	                                  &FRadialRes , SSpace , data->Results ,
+	                                  _DetectionParams.ss_num_threads );
+	if ( rc != 0 )
+	{
+		mig_lst_empty ( &FRadialRes );
+		mig_im_sspace_del ( SSpace );
 
+		LOG4CPLUS_FATAL ( _log , "Aborting detection thread. Memory error in : " << data->id );
+		pthread_exit ( (void*)MIG_ERROR_MEMORY );
+	}
 
-		/*****************************************************************/
-		/* SIMPLIFIED SCALE SPACE ANALYSIS								 */
-		/*(just compute responses of 3d mexican hat in the center)		 */
-		/*****************************************************************/
-
-
-		
-		/* copy data from original stack into scale space input buffer */
-	    mig_im_bb_cut_3d ( data->Original , data->OriginalSize->w , 
-	                       data->OriginalSize->h , data->OriginalSize->slices ,
-	                       (int)( FRadialReg->centroid[0] + 0.5f ) ,
-	                       (int)( FRadialReg->centroid[1] + 0.5f ) ,
-	                       (int)( FRadialReg->centroid[2] + 0.5f ) ,
-	                       SSpaceInput , SSpace->window_radius );
-
-
-		/* scale to [0,1] interval */
-	    mig_im_util_mat2gray_32f ( SSpaceInput , SSpace->window_voxels , 0.0f , 65535.0f );
-		
-		/* perform scale space processing */
-		SSReg = mig_im_sspace_radius ( SSpaceInput , SSpace ); 
-		
-
-	    if ( SSReg != NULL )
-	    {
-	        /* adjust coordinates to global coordinate system */
-	        SSReg->centroid[0] += FRadialReg->centroid[0];
-	        SSReg->centroid[1] += FRadialReg->centroid[1];
-	        SSReg->centroid[2] += FRadialReg->centroid[2];
-	                
-	        /* add resulting region to tail of output list */
-	        mig_lst_put_tail( data->Results , SSReg );
-	        LOG4CPLUS_DEBUG ( _log , " thread : " << data->id << " ss region :  " \
-		    << SSReg->centroid[0] << "," << SSReg->centroid[1] << "," << SSReg->centroid[2] );
-	    }
-
-		free ( FRadialReg );
-		
-
+	for ( SSNode = ( SSNode == NULL ) ? data->Results->head : SSNode->next ; SSNode != NULL ; SSNode = SSNode->next )
+	{
+		SSReg = (mig_im_region_t*) SSNode->data;
+		LOG4CPLUS_DEBUG ( _log , " thread : " << data->id << " ss region :  " \
+			<< SSReg->centroid[0] << "," << SSReg->centroid[1] << "," << SSReg->centroid[2] );
 	}
-	free ( SSpaceInput );
 
 	t1 = getticks_sys();
 	LOG4CPLUS_INFO ( _log , "thread : " << data->id << " SS timing : " << ( elapsed_sys( t1 , t0 ) / 60.0f ) << " min." );
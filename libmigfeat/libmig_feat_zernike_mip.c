@@ -26,10 +26,57 @@ int
 extract_features ( mig_im_region_t *obj3d, Mig16u* src, int w, int h, int z,
 					  fpr2_params_feat_t *featparams, feat_t *featstruct )
 {
-	int idir = 0;
-	int diam_valid , r_valid;
+	feat_work_t work = { NULL , 0 };
+	float *resized = NULL;
+	int rc;
+
+	if ( featstruct == NULL )
+	{
+		return MIG_ERROR_PARAM;
+	}
+
+	/* memory for resized mips of all directions */
+	resized = (float*) malloc ( NDIR * MIG_POW2( featparams->resized_len ) * sizeof(float) );
+	if ( resized == NULL )
+		return MIG_ERROR_MEMORY;
+
+	rc = extract_mips ( obj3d, src, w, h, z, featparams, &work, resized );
+
+	/* moments of all directions at once */
+	if ( rc == MIG_OK )
+		rc = mig_im_mom_batch_2D ( resized, NDIR,
+					featparams->resized_len ,
+                    featparams->mom_masks , 
+					featstruct->feats[0] );
+
+	free ( resized );
+	feat_work_free ( &work );
+	return rc;
+}
+
+/***************************************************************/
+
+int
+extract_mips ( mig_im_region_t *obj3d, Mig16u* src, int w, int h, int z,
+					  fpr2_params_feat_t *featparams, feat_work_t *work, float *mips )
+{
+	return extract_mips_radii ( obj3d, src, w, h, z, featparams,
+					&( obj3d->radius ), 1, work, mips );
+}
+
+/***************************************************************/
+
+int
+extract_mips_radii ( mig_im_region_t *obj3d, Mig16u* src, int w, int h, int z,
+					  fpr2_params_feat_t *featparams, const float *radii, int num_radii,
+					  feat_work_t *work, float *mips )
+{
+	int idir = 0 , irad = 0;
+	int diam_valid[MIG_PROJ_MAX_CUTS] , r_valid[MIG_PROJ_MAX_CUTS];
 	/*int diam_valid_z;*/
-	float *cut = NULL , *mipped = NULL , *resized = NULL;
+	int mips_len = 0;
+	float *mipped = NULL , *resized = NULL , *tmp;
+	int rc;
 	
 	//TODO: handle, differently
 	/*#define _DEBUG_WIN_FEAT_DUMP*/
@@ -41,138 +88,126 @@ extract_features ( mig_im_region_t *obj3d, Mig16u* src, int w, int h, int z,
 	static int nelem = -1;
 	#endif
 
-	if ( featstruct == NULL )
-	{
+	if ( num_radii < 1 || num_radii > MIG_PROJ_MAX_CUTS )
 		return MIG_ERROR_PARAM;
-	}
 
 	/* centroid & radius */
 	/* crop 3d */
-	/* crop cutting radii */
-	r_valid = (int) ( 2.0f *( obj3d->radius * 2.0f + 0.5f ) );
+	for ( irad = 0; irad != num_radii; irad++ )
+	{
+		/* crop cutting radii */
+		r_valid[irad] = (int) ( 2.0f *( radii[irad] * 2.0f + 0.5f ) );
+
+		/* crop cutting diameters */
+		diam_valid[irad] = 2 * r_valid[irad] + 1;
 
-	/* crop cutting diameters */
-	diam_valid = 2 * r_valid + 1;
+		mips_len += NDIR * MIG_POW2( diam_valid[irad] );
+	}
 	
 	/*diam_valid_z = (int) _zdiam_from_diam((float) diam_valid,
 		_CadData->stack_s.h_res, _CadData->stack_s.z_res );*/
 
-	/* memory for cut */
-	cut = (float*) calloc ( MIG_POW3( diam_valid ), sizeof(float) );
-	if (cut == NULL)
-		goto error;
-
-	/* memory for mipped */
-	mipped = (float*) calloc ( MIG_POW2( diam_valid ), sizeof(float) );
-	if ( mipped == NULL )
-		goto error;
-
-	/* memory for resized */
-	resized = (float*) calloc ( MIG_POW2( featparams->resized_len ), sizeof(float) );
-	if ( resized == NULL )
-		goto error;
+	/* memory for mips of all directions , kept for next crops */
+	if ( work->mips_len < mips_len )
+	{
+		tmp = (float*) realloc ( work->mips , mips_len * sizeof(float) );
+		if ( tmp == NULL )
+			return MIG_ERROR_MEMORY;
 
-	/* cut 3d volume */
-	/* mig_im_bb_cut_3d ( _CadData->stack ,
-		_CadData->stack_s.w , _CadData->stack_s.h , _CadData->stack_s.slices ,
-                   obj3d->centroid[0] , obj3d->centroid[1] , obj3d->centroid[2] ,
-                   cut ,
-                   diam_valid / 2); */
+		work->mips = tmp;
+		work->mips_len = mips_len;
+	}
 
-	mig_im_bb_cut_3d ( src , w, h, z,
+	/* crop and mip of every radius in a single pass over the stack */
+	rc = mig_im_proj_mip_axes_cuts_16u ( src , w, h, z,
                    obj3d->centroid[0] , obj3d->centroid[1] , obj3d->centroid[2] ,
-                   cut ,
-                   diam_valid / 2);
+                   r_valid , num_radii , featparams->mip_ratio , work->mips );
+	if ( rc != MIG_OK )
+		return rc;
 
-	for (idir = 0; idir != NDIR; idir++){
-		/* mip */
-		mig_im_proj_mip_axes_vol_32f (  cut , mipped , diam_valid ,
-			diam_valid, diam_valid, idir, featparams->mip_ratio );
-		/* resize */
-		mig_im_geom_resize ( mipped , diam_valid , diam_valid , resized ,
-					featparams->resized_len , featparams->resized_len , BILINEAR );
+	mipped = work->mips;
+	resized = mips;
+	for (irad = 0; irad != num_radii; irad++){
+		for (idir = 0; idir != NDIR; idir++){
+			/* resize */
+			mig_im_geom_resize ( mipped , diam_valid[irad] , diam_valid[irad] , resized ,
+						featparams->resized_len , featparams->resized_len , BILINEAR );
 
 
-		/* DEBUG: write down the first three images */
+			/* DEBUG: write down the first three images */
 		#ifdef _DEBUG_WIN_FEAT_DUMP
-		if ( dumpresized )
-		{
-			sprintf ( res_fname, "%s%s%d%s", res_fnamedir,
-				"\\dump_resized_", idir + ielem * NDIR, ".pgm" );
-			/*TODO: put in libmigim,  write resized values */
-			_pgm_write ( resized, featparams->resized_len,
-				featparams->resized_len,  res_fname );
+			if ( dumpresized )
+			{
+				sprintf ( res_fname, "%s%s%d%s", res_fnamedir,
+					"\\dump_resized_", idir + ielem * NDIR, ".pgm" );
+				/*TODO: put in libmigim,  write resized values */
+				_pgm_write ( resized, featparams->resized_len,
+					featparams->resized_len,  res_fname );
 			
 
-			if ( idir == NDIR - 1)
-			{
-				ielem++;
-				if (nelem >0 && ielem == nelem)
-					dumpresized = 0;
+				if ( idir == NDIR - 1)
+				{
+					ielem++;
+					if (nelem >0 && ielem == nelem)
+						dumpresized = 0;
+				}
 			}
-		}
 		#endif
 
-		/* moments */
-		mig_im_mom_crop_2D ( resized,
-					featparams->resized_len ,
-                    featparams->mom_masks , 
-					featstruct->feats[idir] );
-
-		memset ( mipped , 0x00 ,  MIG_POW2( diam_valid ) * sizeof(float) );
-		memset ( resized , 0x00 ,  MIG_POW2( featparams->resized_len ) * sizeof(float) );
+			/* mip and resized mip of next direction */
+			mipped += MIG_POW2( diam_valid[irad] );
+			resized += MIG_POW2( featparams->resized_len );
+		}
 	}
 
-	
-	free ( cut );
-	free ( mipped );
-	free ( resized );
 	return MIG_OK;
+}
 
+/***************************************************************/
 
-	error :
-
-	if ( cut )
-		free ( cut );
-
-	if ( mipped )
-		free ( mipped );
-
-	if ( resized )
-		free ( resized );
+void
+feat_work_free ( feat_work_t *work )
+{
+	if ( work->mips )
+		free ( work->mips );
 
-	return MIG_ERROR_MEMORY;   
+	work->mips = NULL;
+	work->mips_len = 0;
 }
 
 
 feat_t*
 feat_t_alloc ( int ndir, int nfeats )
 {
-	int idir, i;
+	int idir;
 	float **moments;
 
 
 	feat_t *featstruct;
 
 	featstruct = (feat_t*) calloc ( 1, sizeof(feat_t));
+	if ( featstruct == NULL )
+		return NULL;
 
-	/*memory for moments */
+	/*memory for moments : one block , a row per direction */
 	moments = (float**) calloc ( ndir, sizeof(float*));
 	if ( moments == NULL )
+	{
+		free ( featstruct );
+		return NULL;
+	}
+
+	moments[0] = (float*) calloc ( ndir * nfeats, sizeof(float) );
+	if ( moments[0] == NULL )
+	{
+		free ( moments );
+		free ( featstruct );
 		return NULL;
+	}
 	
-	for ( idir = 0; idir != ndir; idir++)
+	for ( idir = 1; idir < ndir; idir++)
 	{
-		moments[idir] = (float*) calloc ( nfeats, sizeof(float) );
-		if ( moments[idir] == NULL )
-		{
-			for ( i = 0; i < idir - 1; ++i )
-			{
-				free (moments[i]);
-			}
-			free ( moments );
-			return NULL;
-		}
+		moments[idir] = moments[0] + idir * nfeats;
 	}
 
 	featstruct->ndir = ndir;
@@ -185,12 +220,11 @@ feat_t_alloc ( int ndir, int nfeats )
 void
 feat_t_free ( feat_t* featstruct )
 {
-	int i;
-
-	for ( i = 0; i < featstruct->ndir; ++i )
+	if ( featstruct->feats )
 	{
-		if ( featstruct->feats[i] )
-			free ( featstruct->feats[i] );
+		if ( featstruct->feats[0] )
+			free ( featstruct->feats[0] );
+		free ( featstruct->feats );
 	}
 
 	free ( featstruct );
@@ -68,10 +68,22 @@ typedef struct _feat_t
 	int label;
 	int feat_len;
 	int ndir;
-	float **feats;
+	float **feats;		/* ndir rows of feat_len features , contiguous from feats[0] */
 } feat_t;
 
 
+/*
+ ***********************************************************
+ *  FEATURE EXTRACTION BUFFERS OF A THREAD
+ **********************************************************
+ */
+typedef struct _feat_work_t
+{
+	float *mips;	/* mips of the 3 axes before resizing */
+	int mips_len;	/* allocated length of mips : grows with the largest crop */
+} feat_work_t;
+
+
 feat_t*
 feat_t_alloc ( int ndir, int nfeats );
 
@@ -82,6 +94,31 @@ int
 extract_features ( mig_im_region_t *obj3d, Mig16u* src, int w, int h, int z,
 						fpr2_params_feat_t *featparams, feat_t *featstruct );
 
+/*
+ * resized mips of obj3d along the 3 axes , one after the other in mips
+ * ( 3 * resized_len^2 values ) : moments of many objects can then be
+ * extracted at once with mig_im_mom_batch_2D. Crop , mip and resize
+ * only use work ( zeroed before first use ) , which is reallocated just
+ * when a larger crop comes.
+ */
+int
+extract_mips ( mig_im_region_t *obj3d, Mig16u* src, int w, int h, int z,
+						fpr2_params_feat_t *featparams, feat_work_t *work, float *mips );
+
+/*
+ * extract_mips at num_radii radii ( at most MIG_PROJ_MAX_CUTS ) around
+ * the centroid of obj3d , whose radius is not used : the stack is read
+ * once for the largest crop and mips holds 3 * resized_len^2 values per
+ * radius , in radii order.
+ */
+int
+extract_mips_radii ( mig_im_region_t *obj3d, Mig16u* src, int w, int h, int z,
+						fpr2_params_feat_t *featparams, const float *radii, int num_radii,
+						feat_work_t *work, float *mips );
+
+void
+feat_work_free ( feat_work_t *work );
+
  MIG_C_LINKAGE_END
 #endif /*__FEATURE_EXTRACTION_H__*/
 
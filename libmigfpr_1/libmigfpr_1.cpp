@@ -1,5 +1,14 @@
 #include "libmigfpr_1.h"
 
+/* 3d objects per selection task */
+#define FPR1_SELECT_CHUNK 16
+
+/* object lengths in slices covered by the rule table : 0 ... 9 + 1 */
+#define FPR1_RULE_LENGTHS 11
+
+/* shortest object length with a rule */
+#define FPR1_MIN_RULE_LENGTH 2
+
 /*
 ******************************************************************************
 *                               PRIVATE DATA
@@ -22,6 +31,51 @@ typedef struct _fpr1_thread_data
 
 } fpr1_thread_data;
 
+/*
+******************************************************************************
+* FPR1 POOL RUN
+******************************************************************************
+*/
+
+typedef struct _fpr1_run_t
+{
+    fpr1_thread_data    *lungs;     /* lungs whose regions are built and pruned */
+    mig_lst_t           *built;     /* built 3d regions of each lung */
+    mig_im_region_t     **regions;  /* built 3d regions of all lungs , in list order */
+    int                 *keep;      /* _build_obj3d_select result of each region */
+    int                 num;        /* number of built 3d regions */
+
+} fpr1_run_t;
+
+/*
+******************************************************************************
+* FPR1 RULE FOR 3D OBJECTS OF ONE LENGTH
+******************************************************************************
+*/
+
+typedef struct _fpr1_rule_t
+{
+    float max_angle;        /* maximum inclination angle allowed */
+    float min_volume;       /* volume low threshold */
+    float max_volume;       /* volume high threshold */
+
+} fpr1_rule_t;
+
+/*
+******************************************************************************
+* FPR1 GEOMETRIC FEATURES OF A 3D OBJECT
+******************************************************************************
+*/
+
+typedef struct _fpr1_feat_t
+{
+    int   length;           /* number of 2d views */
+    float max_radius;       /* greatest 2d view radius in mm */
+    float volume;           /* sum of squared 2d view radii in mm */
+    float angle;            /* slant angle in degrees */
+
+} fpr1_feat_t;
+
 /*
 ******************************************************************************
 * FPR1 PARAMETERS ACCESSIBLE BY ALL THREADS
@@ -46,42 +100,16 @@ typedef struct _fpr1_params_t
     float min_mean_GL;
 	float max_mean_GL;
 
-    float max_angle_l2; /* maximum inclination angle allowed for structures of z lenght 2 */
-    float max_angle_l3; /* maximum inclination angle allowed for structures of z lenght 3 */ 
-    float max_angle_l4;
-    float max_angle_l5;
-    float max_angle_l6;
-    float max_angle_l7;
-    float max_angle_l8;
-    float max_angle_l9;
-    float max_angle_l10;
-
-    float max_obj_volume_low_l2;    /* maximum volume in pixel allowed for structures of z lenght 2 low threshold */
-    float max_obj_volume_low_l3;
-    float max_obj_volume_low_l4;
-    float max_obj_volume_low_l5;
-    float max_obj_volume_low_l6;
-    float max_obj_volume_low_l7;
-    float max_obj_volume_low_l8;
-    float max_obj_volume_low_l9;
-    float max_obj_volume_low_l10;
-
-    float max_obj_volume_high_l2; /* maximum volume in pixel allowed for structures of z lenght 2 hight threshold */
-    float max_obj_volume_high_l3;
-    float max_obj_volume_high_l4;
-    float max_obj_volume_high_l5;
-    float max_obj_volume_high_l6;
-    float max_obj_volume_high_l7;
-    float max_obj_volume_high_l8;
-    float max_obj_volume_high_l9;
-    float max_obj_volume_high_l10;
+    /* rule cascade indexed by object length in z , objects of lengths
+       below FPR1_MIN_RULE_LENGTH or above the table are cut */
+    fpr1_rule_t rules[FPR1_RULE_LENGTHS];
 
 	/* results directory where to dump intermediate results */
     char *dir_results;
 
     /* threading */
-    pthread_t           thread[2];      /* frp1 threads for left and right lung */ 
-    fpr1_thread_data    thread_data[2]; /* fpr1 thread parameters for left and right lungs */
+    int                 num_threads;    /* pool workers shared by both lungs */
+    fpr1_thread_data    thread_data[2]; /* fpr1 parameters for left and right lungs */
 
 } fpr1_params_t;
 
@@ -101,6 +129,22 @@ static mig_cad_data_t *_CadData = NULL;
 /* fpr1 parameters */
 static fpr1_params_t _Fpr1Params;
 
+/* ini keys of the rule table : max angle , volume low , volume high */
+static char *_RuleKeys[FPR1_RULE_LENGTHS][3] =
+{
+    { NULL , NULL , NULL } ,
+    { NULL , NULL , NULL } ,
+    { PARAM_FPR1_MAX_ANGLE_L2  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L2  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L2  } ,
+    { PARAM_FPR1_MAX_ANGLE_L3  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L3  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L3  } ,
+    { PARAM_FPR1_MAX_ANGLE_L4  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L4  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L4  } ,
+    { PARAM_FPR1_MAX_ANGLE_L5  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L5  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L5  } ,
+    { PARAM_FPR1_MAX_ANGLE_L6  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L6  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L6  } ,
+    { PARAM_FPR1_MAX_ANGLE_L7  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L7  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L7  } ,
+    { PARAM_FPR1_MAX_ANGLE_L8  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L8  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L8  } ,
+    { PARAM_FPR1_MAX_ANGLE_L9  , PARAM_FPR1_MAX_OBJ_VOL_LOW_L9  , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L9  } ,
+    { PARAM_FPR1_MAX_ANGLE_L10 , PARAM_FPR1_MAX_OBJ_VOL_LOW_L10 , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L10 }
+};
+
 /*
 ******************************************************************************
 *                               PRIVATE PROTOTYPE DECLARATIONS
@@ -147,72 +191,54 @@ _build_obj3d_select  ( const void *a );
 
 /*
 ******************************************************************************
-*                       CALCULATE VOLUME OF 3D OBJECTS
-*
-* Description : This function calculates the volume in pixels of a 3d object.
-*
-* Arguments   :  reg - 3d object.
-*
-* Returns     :  volume in pixels.
-*
-* Notes       : Volume is calcualted as sum of circular areas of each 2d object
-*               makeing up the current 3d object.
-*
-******************************************************************************
-*/
-
-static float
-_obj3d_volume ( mig_im_region_t *reg );
-
-/*
-******************************************************************************
-*                       CALCULATE SLANT ANGLE OF 3D OBJECTS
+*                       KEEP ALL 3D OBJECTS
 *
-* Description : This function calculates the slant angle of a 3d object.
+* Description : Selection function keeping every 3d object : pruning is
+*               done afterwards on the pool.
 *
-* Arguments   :  reg - 3d object.
+* Arguments   :  a - 3d object ( unused )
 *
-* Returns     :  angle in degrees
-*
-* Notes       : Angle is calculated using linear fitting on the centroids of all 2d objects
-*               makeing up the current 3d object.
+* Returns     :  -1
 *
 ******************************************************************************
 */
 
-static float
-_obj3d_angle ( mig_im_region_t *reg );
-
+static int 
+_build_obj3d_keep  ( const void *a );
 
 /*
 ******************************************************************************
-*               CALCULATE GREATEST RADIUS OF 2D SLICES OF 3D OBJECTS
-*
-* Description : This function calculates the maximum radius among 2D slices of 3d object.
+*                       CALCULATE GEOMETRIC FEATURES OF 3D OBJECTS
 *
-* Arguments   :  reg - 3d object.
+* Description : This function calculates length , greatest radius , volume
+*               and slant angle of a 3d object in a single pass over its
+*               2d views , without temporary memory.
 *
-* Returns     :  radius in float
+* Arguments   :  reg  - 3d object.
+*                feat - features
 *
-* Notes       : 
+* Notes       : Volume is calcualted as sum of circular areas of each 2d object
+*               makeing up the current 3d object. Angle is calculated using
+*               linear fitting on the centroids of all 2d objects : abscissae
+*               are known in advance , so fitting sums are gathered in the
+*               same pass. Angle is -10 for objects shorter than 2.
 *
 ******************************************************************************
 */
 
-static float
-_obj3d_max_radius ( mig_im_region_t *reg );
+static void
+_obj3d_features ( mig_im_region_t *reg , fpr1_feat_t *feat );
 
 /******************************************************************************
 *               CALCULATE MEAN GRAY LEVEL OF 2D CROPS OF 3D OBJECTS
 *
-* Description : This function calculates the maximum radius among 2D slices of 3d object.
+* Description : This function calculates the mean of the 2d views mean gray
+*               levels of a 3d object.
 *
 * Arguments   :  reg - 3d object.
 *
 * Returns     :  mean gray level in float
 *
-* Notes       : 
-*
 ******************************************************************************
 */
 
@@ -222,13 +248,15 @@ _obj3d_mean_GL ( mig_im_region_t *reg );
 /******************************************************************************
 *               CALCULATE MEAN GRAY LEVEL OF 2D CROP
 *
-* Description : This function calculates the maximum radius among 2D slices of 3d object.
+* Description : This function calculates the mean of the non zero pixels in
+*               the crop around a 2d object.
 *
 * Arguments   :  reg - 2d object.
 *
 * Returns     :  mean gray level in float
 *
-* Notes       : 
+* Notes       : pixels are read in place over the window mig_im_bb_cut_2d
+*               would cut , in the same order.
 *
 ******************************************************************************
 */
@@ -236,20 +264,50 @@ _obj3d_mean_GL ( mig_im_region_t *reg );
 static float
 _obj2d_mean_GL ( mig_im_region_t *reg );
 
+/*
+******************************************************************************
+*                       FPR1 ON BOTH LUNGS
+*
+* Description : This function builds the 3d objects of every lung , one
+*               pool task per lung , then evaluates the selection criteria
+*               of all 3d objects in chunks on the same pool and finally
+*               prunes the lung lists keeping their order.
+*
+* Arguments   :  lungs     - lungs parameters
+*                num_lungs - number of lungs
+*
+* Returns     :  MIG_OK on success
+*                MIG_ERROR_MEMORY on error
+*
+******************************************************************************
+*/
+
+static int
+_fpr1_run ( fpr1_thread_data *lungs , int num_lungs );
 
 /*
 ******************************************************************************
-*                       FPR1 THREAD ROUTINE
+*                       FPR1 POOL TASKS
 *
-* Description : Thread routine for FPR1 on single segmented stack.
+* Description : _fpr1_build_task builds the 3d objects of lung task ,
+*               _fpr1_select_task evaluates the selection criteria of
+*               chunk task of the built 3d objects.
 *
-* Arguments   :  arg - input of type _fpr1_thread_data.
+* Arguments   :  arg    - fpr1_run_t
+*                task   - lung or chunk index
+*                worker - pool worker ( unused )
+*
+* Returns     :  0 on success
+*                -1 on error
 *
 ******************************************************************************
 */
 
-static void*
-_fpr1_thread_routine ( void *arg );
+static int
+_fpr1_build_task ( void *arg , int task , int worker );
+
+static int
+_fpr1_select_task ( void *arg , int task , int worker );
 
 /*
 ******************************************************************************
@@ -280,6 +338,8 @@ int
 mig_init ( mig_dic_t *d ,
            mig_cad_data_t *data )
 {
+    int l;
+
     /* setup logging system */
     char *_logger_ini_f_name =
         mig_ut_ini_getstring ( d , PARAM_LOG_INI , DEFAULT_PARAM_LOG_INI );
@@ -338,91 +398,30 @@ mig_init ( mig_dic_t *d ,
 	_Fpr1Params.max_obj_length = 
         mig_ut_ini_getint ( d , PARAM_FPR1_MAX_OBJ_LENGHT , DEFAULT_PARAM_FPR1_MAX_OBJ_LENGHT );
 
-    _Fpr1Params.max_angle_l2 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L2 , 0.0f );
-
-    _Fpr1Params.max_angle_l3 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L3 , 0.0f );
-
-    _Fpr1Params.max_angle_l4 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L4 , 0.0f );
-
-    _Fpr1Params.max_angle_l5 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L5 , 0.0f );
-
-    _Fpr1Params.max_angle_l6 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L6 , 0.0f );
-
-    _Fpr1Params.max_angle_l7 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L7 , 0.0f );
-
-    _Fpr1Params.max_angle_l8 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L8 , 0.0f );
-
-    _Fpr1Params.max_angle_l9 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L9 , 0.0f );
+    /* per length rules */
+    memset ( _Fpr1Params.rules , 0 , sizeof(_Fpr1Params.rules) );
+    for ( l = FPR1_MIN_RULE_LENGTH ; l < FPR1_RULE_LENGTHS ; ++l )
+    {
+        _Fpr1Params.rules[l].max_angle =
+            mig_ut_ini_getfloat ( d , _RuleKeys[l][0] , 0.0f );
 
-    _Fpr1Params.max_angle_l10 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_ANGLE_L10 , 0.0f );
+        _Fpr1Params.rules[l].min_volume =
+            mig_ut_ini_getfloat ( d , _RuleKeys[l][1] , 0.0f );
 
-    _Fpr1Params.max_obj_volume_low_l2 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L2 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l3 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L3 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l4 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L4 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l5 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L5 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l6 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L6 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l7 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L7 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l8 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L8 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l9 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L9 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_low_l10 = 
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_LOW_L10 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l2 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L2 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l3 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L3 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l4 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L4 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l5 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L5 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l6 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L6 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l7 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L7 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l8 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L8 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l9 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L9 , 0.0f );
-    
-    _Fpr1Params.max_obj_volume_high_l10 =
-        mig_ut_ini_getfloat ( d , PARAM_FPR1_MAX_OBJ_VOL_HIGH_L10 , 0.0f );
+        _Fpr1Params.rules[l].max_volume =
+            mig_ut_ini_getfloat ( d , _RuleKeys[l][2] , 0.0f );
+    }
     
 	/* results */
 	_Fpr1Params.dir_results = 
 	mig_ut_ini_getstring ( d , PARAM_CAD_DIR_OUT , DEFAULT_PARAM_CAD_DIR_OUT );
 
+    /* threading */
+    _Fpr1Params.num_threads =
+        mig_ut_ini_getint ( d , PARAM_FPR1_NUM_THREADS , DEFAULT_PARAM_FPR1_NUM_THREADS );
+    if ( _Fpr1Params.num_threads < 1 )
+        _Fpr1Params.num_threads = 1;
+
 
     /* log parameters */
     if ( _log.getLogLevel() <= INFO_LOG_LEVEL )
@@ -433,33 +432,13 @@ mig_init ( mig_dic_t *d ,
         os << "\n\tmax scan distance : " << _Fpr1Params.max_scan_dist;
         os << "\nFPR1 3D object cutting parameters : ";
         os << "\n\tmax object lenght   : " << _Fpr1Params.max_obj_length;
-        os << "\n\tmax angle l2        : " << _Fpr1Params.max_angle_l2;
-        os << "\n\tmax angle l3        : " << _Fpr1Params.max_angle_l3;
-        os << "\n\tmax angle l4        : " << _Fpr1Params.max_angle_l4;
-        os << "\n\tmax angle l5        : " << _Fpr1Params.max_angle_l5;
-        os << "\n\tmax angle l6        : " << _Fpr1Params.max_angle_l6;
-        os << "\n\tmax angle l7        : " << _Fpr1Params.max_angle_l7;
-        os << "\n\tmax angle l8        : " << _Fpr1Params.max_angle_l8;
-        os << "\n\tmax angle l9        : " << _Fpr1Params.max_angle_l9;
-        os << "\n\tmax angle l9        : " << _Fpr1Params.max_angle_l10;
-        os << "\n\tmax volume low l2   : " << _Fpr1Params.max_obj_volume_low_l2;
-        os << "\n\tmax volume low l3   : " << _Fpr1Params.max_obj_volume_low_l3;
-        os << "\n\tmax volume low l4   : " << _Fpr1Params.max_obj_volume_low_l4;
-        os << "\n\tmax volume low l5   : " << _Fpr1Params.max_obj_volume_low_l5;
-        os << "\n\tmax volume low l6   : " << _Fpr1Params.max_obj_volume_low_l6;
-        os << "\n\tmax volume low l7   : " << _Fpr1Params.max_obj_volume_low_l7;
-        os << "\n\tmax volume low l8   : " << _Fpr1Params.max_obj_volume_low_l8;
-        os << "\n\tmax volume low l9   : " << _Fpr1Params.max_obj_volume_low_l9;
-        os << "\n\tmax volume low l10  : " << _Fpr1Params.max_obj_volume_low_l10;
-        os << "\n\tmax volume high l2  : " << _Fpr1Params.max_obj_volume_high_l2;
-        os << "\n\tmax volume high l3  : " << _Fpr1Params.max_obj_volume_high_l3;
-        os << "\n\tmax volume high l4  : " << _Fpr1Params.max_obj_volume_high_l4;
-        os << "\n\tmax volume high l5  : " << _Fpr1Params.max_obj_volume_high_l5;
-        os << "\n\tmax volume high l6  : " << _Fpr1Params.max_obj_volume_high_l6;
-        os << "\n\tmax volume high l7  : " << _Fpr1Params.max_obj_volume_high_l7;
-        os << "\n\tmax volume high l8  : " << _Fpr1Params.max_obj_volume_high_l8;
-        os << "\n\tmax volume high l9  : " << _Fpr1Params.max_obj_volume_high_l9;
-        os << "\n\tmax volume high l10 : " << _Fpr1Params.max_obj_volume_high_l10;
+        for ( l = FPR1_MIN_RULE_LENGTH ; l < FPR1_RULE_LENGTHS ; ++l )
+        {
+            os << "\n\tl" << l << " : max angle " << _Fpr1Params.rules[l].max_angle
+               << " , volume [ " << _Fpr1Params.rules[l].min_volume
+               << " , " << _Fpr1Params.rules[l].max_volume << " ]";
+        }
+        os << "\nFPR1 threads : " << _Fpr1Params.num_threads;
         LOG4CPLUS_INFO ( _log , os.str() );
     }
 
@@ -525,36 +504,19 @@ mig_run ()
     LOG4CPLUS_INFO( _log , " Could not load fpr1 data from disk. Performing full fpr1..." );
 
 
-    /* setup input to detection threads */
+    /* setup input to fpr1 */
     _Fpr1Params.thread_data[0].id      = 0;
     _Fpr1Params.thread_data[0].Input   = &( _CadData->det_r );
 
     _Fpr1Params.thread_data[1].id      = 1;
     _Fpr1Params.thread_data[1].Input   = &( _CadData->det_l );
 
-    /* spawn fpr1 thread 0 */
-    rc = pthread_create ( &( _Fpr1Params.thread[0] ) , NULL ,
-            &( _fpr1_thread_routine ),  &( _Fpr1Params.thread_data[0] ) );
-    if ( rc != 0 )
-    {
-        LOG4CPLUS_FATAL ( _log , " libmigfpr1 -> mig_run pthread_create returned : " << rc );
-        return MIG_ERROR_THREAD;
-    }
-    
-    /* spawn fpr1 thread 1 */
-    rc = pthread_create ( &( _Fpr1Params.thread[1] ) , NULL ,
-            &( _fpr1_thread_routine ),  &( _Fpr1Params.thread_data[1] ) );
-    if ( rc != 0 )
+    rc = _fpr1_run ( _Fpr1Params.thread_data , 2 );
+    if ( rc != MIG_OK )
     {
-        LOG4CPLUS_FATAL ( _log , " libmigfpr1 -> mig_run pthread_create returned : " << rc );
-        return MIG_ERROR_THREAD;
+        LOG4CPLUS_FATAL ( _log , " libmigfpr1 -> mig_run fpr1 returned : " << rc );
+        return rc;
     }
-
-    /* wait for left thread to finish */
-    pthread_join ( _Fpr1Params.thread[0] , (void**) &rc );
-   
-    /* wait for right thread to finish */
-    pthread_join ( _Fpr1Params.thread[1] , (void**) &rc );
    
 
 	
@@ -639,29 +601,118 @@ mig_info ( mig_dll_info_t* info )
 ******************************************************************************
 */
 
-static void*
-_fpr1_thread_routine ( void *arg )
+static int
+_fpr1_run ( fpr1_thread_data *lungs , int num_lungs )
+{
+    fpr1_run_t run = { lungs , NULL , NULL , NULL , 0 };
+    mig_im_region_t *reg;
+    mig_lst_node *node;
+    int i , l;
+    int rc = MIG_ERROR_MEMORY;
+
+    run.built = (mig_lst_t*) calloc ( num_lungs , sizeof(mig_lst_t) );
+    if ( run.built == NULL )
+        return MIG_ERROR_MEMORY;
+
+    for ( l = 0 ; l < num_lungs ; ++l )
+        run.built[l]._free = &free;
+
+    /* build 3d objects : grouping is sequential inside a lung */
+    if ( mig_ut_pool_run ( num_lungs , _Fpr1Params.num_threads , &_fpr1_build_task , &run ) != 0 )
+        goto error;
+
+    /* select 3d objects of all lungs in chunks */
+    for ( l = 0 ; l < num_lungs ; ++l )
+        run.num += mig_lst_len ( &( run.built[l] ) );
+
+    if ( run.num > 0 )
+    {
+        run.regions = (mig_im_region_t**) malloc ( run.num * sizeof(mig_im_region_t*) );
+        run.keep = (int*) malloc ( run.num * sizeof(int) );
+        if ( run.regions == NULL || run.keep == NULL )
+            goto error;
+
+        for ( l = 0 , i = 0 ; l < num_lungs ; ++l )
+            for ( node = run.built[l].head ; node != NULL ; node = node->next )
+                run.regions[i++] = (mig_im_region_t*) node->data;
+
+        if ( mig_ut_pool_run ( mig_ut_pool_chunks ( run.num , FPR1_SELECT_CHUNK ) ,
+                               _Fpr1Params.num_threads , &_fpr1_select_task , &run ) != 0 )
+            goto error;
+    }
+
+    /* prune lung lists in region order */
+    for ( l = 0 , i = 0 ; l < num_lungs ; ++l )
+    {
+        while ( ( reg = (mig_im_region_t*) mig_lst_get_head ( &( run.built[l] ) ) ) != NULL )
+        {
+            if ( run.keep[i++] == 0 )
+                _CadData->det_cleanup ( reg );
+            else if ( mig_lst_put_tail ( lungs[l].Input , reg ) != 0 )
+            {
+                _CadData->det_cleanup ( reg );
+                goto error;
+            }
+        }
+
+        LOG4CPLUS_INFO ( _log , "lung id : " << lungs[l].id << " Number of 3D regions : " << mig_lst_len( lungs[l].Input ) );
+    }
+
+    rc = MIG_OK;
+
+error :
+
+    /* on error built regions go back to their lung */
+    for ( l = 0 ; l < num_lungs ; ++l )
+        mig_lst_cat ( &( run.built[l] ) , lungs[l].Input );
+
+    free ( run.built );
+    if ( run.regions )
+        free ( run.regions );
+    if ( run.keep )
+        free ( run.keep );
+
+    return rc;
+}
+
+/*******************************************************************************/
+
+static int
+_fpr1_build_task ( void *arg , int task , int worker )
 {
-    fpr1_thread_data *data = (fpr1_thread_data*) arg; /* input parameters */
-    mig_lst_t Results = { NULL , NULL , 0 , free };
+    fpr1_run_t *run = (fpr1_run_t*) arg;
+    fpr1_thread_data *data = &( run->lungs[task] );
     
-    LOG4CPLUS_DEBUG ( _log , " _fpr1_thread_routine : " << data->id );
+    LOG4CPLUS_DEBUG ( _log , " _fpr1_build_task : " << data->id );
 
-    /* build and prune 3d objects */
-    if ( mig_im_build_obj3d ( data->Input , &Results ,
-            & _build_obj3d_compare ,  & _build_obj3d_select ,
-            _CadData->det_cleanup , _Fpr1Params.skip_build3d) != 0 )
+    /* build 3d objects on a grid of the comparison tolerances ,
+       pruning is done on the pool afterwards */
+    if ( mig_im_build_obj3d_grid ( data->Input , &( run->built[task] ) ,
+            & _build_obj3d_compare ,  & _build_obj3d_keep ,
+            _CadData->det_cleanup , _Fpr1Params.skip_build3d ,
+            _Fpr1Params.delta_tol , _Fpr1Params.max_scan_dist ) != 0 )
     {
-        pthread_exit( (void*)MIG_ERROR_MEMORY );
+        return -1;
     }
-    /* copy local list to global cad data structure */
 
-	//maybe we need to clean data->Input first... NO! it's emptied in mig_im_build_obj3d
-	mig_lst_cat ( &Results , data->Input );
+	//data->Input is emptied in mig_im_build_obj3d
+    return 0;
+}
 
-    LOG4CPLUS_INFO ( _log , "thread id : " << data->id << " Number of 3D regions : " << mig_lst_len( data->Input ) );
-	
-    return ( (void*)MIG_OK );
+/*******************************************************************************/
+
+static int
+_fpr1_select_task ( void *arg , int task , int worker )
+{
+    fpr1_run_t *run = (fpr1_run_t*) arg;
+    int i , end;
+
+    end = MIG_MIN2 ( ( task + 1 ) * FPR1_SELECT_CHUNK , run->num );
+
+    for ( i = task * FPR1_SELECT_CHUNK ; i < end ; ++i )
+        run->keep[i] = _build_obj3d_select ( run->regions[i] );
+
+    return 0;
 }
 
 /*******************************************************************************/
@@ -687,289 +738,133 @@ _build_obj3d_compare ( const void *a , const void *b )
 
 /*******************************************************************************/
 
+/* keep every region */
+static int
+_build_obj3d_keep  ( const void *a )
+{
+    return -1;
+}
+
+/*******************************************************************************/
+
 /* return 0 if and only if region a should be eliminated */
 static int
 _build_obj3d_select  ( const void *a )
 {
-    int length;
-    float volume;
-    float angle;
-	float max_radius;
-	float mean_GL;
-
     mig_im_region_t *reg = (mig_im_region_t*)a;
+    const fpr1_rule_t *rule;
+    fpr1_feat_t feat;
+	float mean_GL;
 
-//DEBUG: returning 1, I need no pruning now (to check next step)
-//	return 1;
+    /* length , radius in mm , volume and angle in degrees */
+    _obj3d_features ( reg , &feat );
 
-    printf("before computing radius, reg->size = %d \n", reg->size);
-    
-    /* calculate region max_radius in mm */
-	max_radius = _obj3d_max_radius (reg);
-    printf("radius: %f\n", max_radius);
-        
-	if (max_radius < _Fpr1Params.min_max_radius)
+	if (feat.max_radius < _Fpr1Params.min_max_radius)
 		return 0;
 
-    if (max_radius > _Fpr1Params.max_max_radius)
+    if (feat.max_radius > _Fpr1Params.max_max_radius)
         return 0;
 
     if (_Fpr1Params.apply_only_radius)
         return 1; 
 
-	mean_GL = _obj3d_mean_GL (reg);
-	if (mean_GL >  _Fpr1Params.max_mean_GL || mean_GL < _Fpr1Params.min_mean_GL)
-		return 0;
+    /* check wether current region does not satisfy the rule of its length */
+    if ( ( feat.length < FPR1_MIN_RULE_LENGTH ) || ( feat.length >= FPR1_RULE_LENGTHS ) )
+        return 0;
 
-    /* calculate region lenght in z */
-    length = mig_lst_len( &(reg->objs) );
-    
-    /* calculate region volume */
-    volume = _obj3d_volume ( reg );
+    rule = &( _Fpr1Params.rules[feat.length] );
 
-    /* calculate region angle in degrees */
-    angle = _obj3d_angle ( reg );
+    if ( feat.angle > rule->max_angle )
+        return 0;
 
+    if ( ( feat.volume < rule->min_volume ) ||
+         ( feat.volume > rule->max_volume ) )
+         return 0;
 
-    /* check wether current region does not satisfy inclusion criteria */
-    switch (length)
-    {
-        case 1 :
-            
-            return 0;
-            break;
-
-        case 2 :
-            
-            if ( angle > _Fpr1Params.max_angle_l2 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l2  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l2 ) )
-                 return 0;
-            
-            break;
-
-        case 3 :
-            
-            if ( angle > _Fpr1Params.max_angle_l3 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l3  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l3 ) )
-                 return 0;
-            
-            break;
-
-        case 4 :
-            
-            if ( angle > _Fpr1Params.max_angle_l4 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l4  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l4 ) )
-                 return 0;
-            
-            break;
-
-       case 5 :
-            
-            if ( angle > _Fpr1Params.max_angle_l5 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l5  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l5 ) )
-                 return 0;
-            
-            break;
-
-       case 6 :
-            
-            if ( angle > _Fpr1Params.max_angle_l6 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l6  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l6 ) )
-                 return 0;
-            
-            break;
- 
-       case 7 :
-            
-            if ( angle > _Fpr1Params.max_angle_l7 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l7  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l7 ) )
-                 return 0;
-            
-            break;
-
-        case 8 :
-            
-            if ( angle > _Fpr1Params.max_angle_l8 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l8  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l8 ) )
-                 return 0;
-            
-            break;
-
-        case 9 :
-            
-            if ( angle > _Fpr1Params.max_angle_l9 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l9  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l9 ) )
-                 return 0;
-            
-            break;
-
-        case 10 :
-            
-            if ( angle > _Fpr1Params.max_angle_l10 )
-                return 0;
-            
-            if ( ( volume < _Fpr1Params.max_obj_volume_low_l10  ) ||
-                 ( volume > _Fpr1Params.max_obj_volume_high_l10 ) )
-                 return 0;
-            
-            break;
-
-        default :
-
-            return 0;
-            break;
-    }
+    /* gray level reads the stack : checked last */
+	mean_GL = _obj3d_mean_GL (reg);
+	if (mean_GL >  _Fpr1Params.max_mean_GL || mean_GL < _Fpr1Params.min_mean_GL)
+		return 0;
 
     return -1;
 }
 
 /*******************************************************************************/
 
-static float
-_obj3d_volume ( mig_im_region_t *reg )
-{
-    float volume = 0.0f;
-    mig_lst_t *objs = &( reg->objs );
-    mig_im_region_t *curr;
-    mig_lst_iter it;
-   
-    mig_lst_iter_get ( &it , objs );
-    while ( curr = (mig_im_region_t*) mig_lst_iter_next ( &it ) )
-    {
-            volume += MIG_POW2( curr->radius * _CadData->stack_s.h_res );
-    }
-
-    return volume;
-}
-
-/*******************************************************************************/
-
-static float
-_obj3d_angle ( mig_im_region_t *reg )
+static void
+_obj3d_features ( mig_im_region_t *reg , fpr1_feat_t *feat )
 {
     mig_lst_t *objs = &( reg->objs );   /* list of 2d objects belonging to current 3d object */
     mig_im_region_t *curr;              /* current 2d view */
     mig_lst_iter it;                    /* list iterator for all current 2d views */
-    float angle = 0.0f;                 /* 3d object orientation in degrees */
-    float d;
-    float *x = NULL , *y1 = NULL , *y2 = NULL;  /* linear fitting arrays */
-    int length , idx = 0;               
+    float h_res = _CadData->stack_s.h_res;
+    float radius , x , x_last , d;
     float coeff1[2]  = { 0.0f , 0.0f };         /* linear fitting coefficients */
     float coeff2[2]  = { 0.0f , 0.0f };         /* linear fitting coefficients */
-    float x_eval[2]  = { 0.0f , 0.0f };         /* linear fitting evaluation absciss */
     float f1_eval[2] = { 0.0f , 0.0f };         /* linear fitting evaluation ordinates */
     float f2_eval[2] = { 0.0f , 0.0f };         /* linear fitting evaluation ordinates */
+    double sx = 0.0 , sy1 = 0.0 , sy2 = 0.0 , meanx , st2 = 0.0 , t;
+    int idx;
 
-    /* 3D lenght of object */
-    length = mig_lst_len ( &(reg->objs) );
-    
-    if ( ( length == 0 ) || ( length == 1 )  )
-        return -10.0f;
- 
-    /* allocate array for x */
-    x = (float*) malloc ( length * sizeof(float) );
-    if ( x == NULL )
-        return -10.0f;
-
-    /* allocate array for y1 */
-    y1 = (float*) malloc ( length * sizeof(float) );
-    if ( y1 == NULL )
-    {
-        free ( x );
-        return -10.0f;
-    }
+    feat->length     = mig_lst_len ( objs );
+    feat->max_radius = 0.0f;
+    feat->volume     = 0.0f;
+    feat->angle      = -10.0f;
 
-    /* allocate array for y2 */
-    y2 = (float*) malloc ( length * sizeof(float) );
-    if ( y2 == NULL )
+    /* GF 20170302 made it work also for objs without regions (for 3d regs) */
+    if ( feat->length == 0 )
     {
-        free ( x );
-        free ( y1 );
-        return -10.0f;
+        feat->max_radius = reg->radius * h_res;
+        return;
     }
 
-    /* build up corrdinate arrays */
+    /* abscissae of 2d views are 3 * view index */
+    for ( idx = 0 ; idx < feat->length ; ++idx )
+        sx += 3.0f * idx;
+
+    meanx = sx / feat->length;
+
+    /* single pass over 2d views : same sums as mig_math_polyfit_linear */
+    idx = 0;
     mig_lst_iter_get ( &it , objs );
     while (  curr = (mig_im_region_t*) mig_lst_iter_next ( &it ) )
     {
-        x[idx] = 3.0f * idx;
-        y1[idx] = curr->centroid[0];
-        y2[idx] = curr->centroid[1];
+        radius = curr->radius * h_res;
+        if ( radius > feat->max_radius )
+            feat->max_radius = radius;
+
+        feat->volume += MIG_POW2( radius );
+
+        x = 3.0f * idx;
+        t = x - meanx;
+        st2 += t * t;
+        coeff1[1] += t * curr->centroid[0];
+        coeff2[1] += t * curr->centroid[1];
+        sy1 += curr->centroid[0];
+        sy2 += curr->centroid[1];
         idx ++ ;
     }
 
-    mig_math_polyfit_linear ( x , y1 , length , &(coeff1[0]) , &(coeff1[1]) );
-    mig_math_polyfit_linear ( x , y2 , length , &(coeff2[0]) , &(coeff2[1]) );
+    if ( feat->length == 1 )
+        return;
 
-    x_eval[0] = 0;
-    x_eval[1] = x[length-1];
+    coeff1[1] /= st2;
+    coeff2[1] /= st2;
+    coeff1[0] = ( sy1 - sx * coeff1[1] ) / feat->length;
+    coeff2[0] = ( sy2 - sx * coeff2[1] ) / feat->length;
 
-    mig_math_polyval_linear ( (float*) &(x_eval) , (float*) &f1_eval , 2 , coeff1[0] , coeff1[1] );
-    mig_math_polyval_linear ( (float*) &(x_eval) , (float*) &f2_eval , 2 , coeff2[0] , coeff2[1] );
-    
-    d = sqrtf ( MIG_POW2( f1_eval[1] - f1_eval[0] ) + MIG_POW2( f2_eval[1] - f2_eval[0] ) );
-    angle = ( ( 2.0f * atanf( d / length ) ) * MIG_RPI ) * 90.0f;
+    x_last = 3.0f * ( feat->length - 1 );
 
-    free ( x );
-    free ( y1 );
-    free ( y2 );
+    f1_eval[0] = coeff1[0] + coeff1[1] * 0.0f;
+    f1_eval[1] = coeff1[0] + coeff1[1] * x_last;
+    f2_eval[0] = coeff2[0] + coeff2[1] * 0.0f;
+    f2_eval[1] = coeff2[0] + coeff2[1] * x_last;
     
-    return angle;
+    d = sqrtf ( MIG_POW2( f1_eval[1] - f1_eval[0] ) + MIG_POW2( f2_eval[1] - f2_eval[0] ) );
+    feat->angle = ( ( 2.0f * atanf( d / feat->length ) ) * MIG_RPI ) * 90.0f;
 }
 
-
-/* GF 20170302 made it work also for objs without regions (for 3d regs) */
-static float
-_obj3d_max_radius ( mig_im_region_t *reg )
-{
-
-    if ( reg->objs.num == 0 )
-    {
-        return reg->radius * _CadData->stack_s.h_res;
-    } 
-
-
-    mig_lst_t *objs = &( reg->objs );   /* list of 2d objects belonging to current 3d object */
-    
-    mig_im_region_t *curr;              /* current 2d view */
-    mig_lst_iter it; 
-	float radius = 0;
-	float curr_radius_mm = 0;
-
-	/* build up coordinate arrays */
-    mig_lst_iter_get ( &it , objs );
-    while (  curr = (mig_im_region_t*) mig_lst_iter_next ( &it ) )
-    {
-		curr_radius_mm = curr->radius * _CadData->stack_s.h_res;
-        if (curr_radius_mm  > radius) radius = curr_radius_mm;
-    }
-
-	return radius;
-}
+/*******************************************************************************/
 
 static float
 _obj3d_mean_GL ( mig_im_region_t *reg )
@@ -979,7 +874,7 @@ _obj3d_mean_GL ( mig_im_region_t *reg )
     mig_lst_iter it; 
 	float mean_GL = 0;
 	int countreg = 0;
-	/* build up coordinate arrays */
+
     mig_lst_iter_get ( &it , objs );
     while (  curr = (mig_im_region_t*) mig_lst_iter_next ( &it ) )
     {
@@ -990,41 +885,45 @@ _obj3d_mean_GL ( mig_im_region_t *reg )
 	return mean_GL;
 }
 
+/*******************************************************************************/
+
 static float
 _obj2d_mean_GL (mig_im_region_t *reg )
 {
 	/*AAAA cambiare considerando che si deve usare float [0,1]*/
 	Mig16u* slice = _CadData->stack + (int)( reg->centroid[2] ) * _CadData->stack_s.dim;
-	
-	int diam, radius;
-	int i,pixcount;
-	float *crop = NULL;
-	float *pcrop = NULL;
-	float mean_GL;
+	int w = _CadData->stack_s.w;
+	int h = _CadData->stack_s.h;
+	int cx = (int) ( reg->centroid[0] );
+	int cy = (int) ( reg->centroid[1] );
+	int radius , x0 , x1 , y0 , y1;
+	int i , j , pixcount;
+	Mig16u *row;
+	float v , mean_GL;
 
 	/* crop cutting radii */
     radius = (int) ( reg->radius * 2.0f + 0.5f );
-        /* crop cutting diameters */
-    diam = 2 * radius + 1;
-    
-	/* memory for crop */
-    crop = (float*) malloc ( MIG_POW2( diam ) * sizeof(float) );
 
+    /* crop bounds , as in mig_im_bb_cut_2d */
+    x0 = ( ( cx - radius ) < 0 )? cx : radius;
+    x1 = ( ( cx + radius ) >= w )? w - cx : radius;
 
-	/* cut crop */
-    mig_im_bb_cut_2d ( slice  , _CadData->stack_s.w , _CadData->stack_s.h ,
-                       (int) ( reg->centroid[0] ) , (int) ( reg->centroid[1] ) , 
-                       crop , radius );
+    y0 = ( ( cy - radius ) < 0 )? cy : radius;
+    y1 = ( ( cy + radius ) >= h )? h - cy : radius;
 
 	mean_GL = 0;
 	pixcount = 0;
-	pcrop = crop;
-	for ( i = 0; i != MIG_POW2(diam); i++, pcrop++ )
+	for ( j = -y0 ; j < y1 ; ++j )
 	{
-		if ( *pcrop > 0.000001)
+		row = slice + cx + ( cy + j ) * w;
+		for ( i = -x0 ; i < x1 ; ++i )
 		{
-			mean_GL += *pcrop;
-			pixcount++;
+			v = (float) row[i];
+			if ( v > 0.000001)
+			{
+				mean_GL += v;
+				pixcount++;
+			}
 		}
 	}
 	
@@ -1033,4 +932,3 @@ _obj2d_mean_GL (mig_im_region_t *reg )
 	return mean_GL;
 
 }
-
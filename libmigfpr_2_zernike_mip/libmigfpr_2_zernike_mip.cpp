@@ -4,6 +4,16 @@
 
 #define NSIGMA_WHITE 1
 #define NDIR 3
+
+/* candidates per pool task : their mips share one moment batch */
+#define FPR2_BATCH 8
+
+/* radii tried on candidates without a radius estimation */
+#define FPR2_MULTIRES_LEN 4
+
+/* candidates and feature rows classified by a single _classify_feats call */
+#define FPR2_MAX_CANDS MIG_MAX2 ( FPR2_BATCH , FPR2_MULTIRES_LEN )
+#define FPR2_MAX_ROWS ( NDIR * FPR2_MAX_CANDS )
 /*
 ******************************************************************************
 *                               PRIVATE DATA
@@ -12,7 +22,7 @@
 
 typedef struct _fpr2_thread_data
 {
-	/* thread id */
+	/* lung id */
 	int id;
 
 	/* Input data -> segmented */
@@ -23,14 +33,41 @@ typedef struct _fpr2_thread_data
 	/* Input data -> results of fpr1 */
 	mig_lst_t *Input;
 
-	/* Buffers */
-	float *whitened;
+} fpr2_thread_data;
+
+/* buffers owned by a single pool worker */
+typedef struct _fpr2_worker_data
+{
+	double *dir_scores; /* FPR2_MAX_ROWS first stage scores of single directions */
+	float *rows;        /* FPR2_MAX_CANDS feature rows gathered for the full model */
+	int num_rows;       /* directions classified */
+	int num_evals;      /* directions the full model was evaluated on */
 	feat_t *featstruct;
+	float *mips;        /* FPR2_BATCH * NDIR resized mips */
+	float *moments;     /* FPR2_BATCH * NDIR rows of moments */
+	float *single;      /* FPR2_MULTIRES_LEN * NDIR resized mips of a multires candidate */
+	feat_work_t work;   /* crop and mip buffers */
 
+} fpr2_worker_data;
 
-} fpr2_thread_data;
+/* a single candidate classification */
+typedef struct _fpr2_task_t
+{
+	mig_im_region_t  *obj;      /* candidate 3d object */
+	fpr2_thread_data *lung;     /* lung the candidate comes from */
+	int              label;     /* classification label */
+	int              rc;        /* classification return code */
 
+} fpr2_task_t;
 
+/* candidates of both lungs classified on a single pool */
+typedef struct _fpr2_run_t
+{
+	fpr2_task_t      *tasks;    /* right lung candidates first , in list order */
+	int              num;       /* number of candidates */
+	fpr2_worker_data *workers;  /* one buffer set per worker */
+
+} fpr2_run_t;
 
 
 typedef struct _fpr2_params_t
@@ -38,6 +75,11 @@ typedef struct _fpr2_params_t
 	/* svm model */
 	mig_svm_t model;
 
+	/* cheap first stage rejecting directions before the full model */
+	mig_svm_t cascade;
+	int use_cascade;
+	double cascade_threshold;
+
 	/* svm feature normalization parameters */
 	/*mig_svm_scale_t scales;*/
 	EigenWhitener whitener;
@@ -55,8 +97,8 @@ typedef struct _fpr2_params_t
 	char *dir_results;
 
 	/* threading */
-	pthread_t           thread[2];      /* frp1 threads for left and right lung */ 
-	fpr2_thread_data    thread_data[2]; /* fpr1 thread parameters for left and right lungs */
+	int                 num_threads;    /* pool workers classifying candidates of both lungs */
+	fpr2_thread_data    thread_data[2]; /* fpr2 parameters for left and right lungs */
 
 } fpr2_params_t;
 
@@ -77,23 +119,41 @@ static mig_cad_data_t *_CadData = NULL;
 /* fpr2 parameters */
 static fpr2_params_t _Fpr2Params;
 
+/* multires radii , increasing */
+static const float _MultiresRadii[FPR2_MULTIRES_LEN] = { 3.0f , 6.0f , 12.0f , 24.0f };
+
 /*
 ******************************************************************************
 *                               PRIVATE PROTOTYPE DECLARATIONS
 ******************************************************************************
 */
 
-static void*
-_fpr2_thread_routine ( void *arg );
+static int
+_fpr2_run ( fpr2_thread_data *lungs , int num_lungs );
+
+static int
+_fpr2_task ( void *arg , int task , int worker );
 
-static int 
-_classify_obj_3d ( mig_im_region_t *obj3d , int *label  , fpr2_thread_data *data);
+static int
+_fpr2_multires ( fpr2_task_t *t , fpr2_worker_data *buffers );
 
 static int
-_thread_data_alloc( fpr2_thread_data *thread_data );
+_classify_feats ( float *feats , int num , int *labels , fpr2_worker_data *buffers );
+
+static char*
+_ini_file ( mig_dic_t *d , char *key );
+
+static int
+_model_load ( const char *bundle_file_name , const char *model_file_name , mig_svm_t *model );
+
+static void
+_obj3d_to_lung ( mig_im_region_t *obj3d , fpr2_thread_data *data , mig_im_region_t *local );
+
+static int
+_worker_data_alloc( fpr2_worker_data *worker_data );
 
 static void
-_thread_data_free( fpr2_thread_data *thread_data );
+_worker_data_free( fpr2_worker_data *worker_data );
 /*
 ******************************************************************************
 *                               GLOBAL FUNCTIONS
@@ -123,6 +183,9 @@ mig_init ( mig_dic_t *d ,
 {
 	char *model_file_name = NULL;
 	char *scale_file_name = NULL;
+	char *bundle_file_name = NULL;
+	char *cascade_model_name = NULL;
+	char *cascade_bundle_name = NULL;
 	int rc;
 
 	/* setup logging system */
@@ -152,6 +215,11 @@ mig_init ( mig_dic_t *d ,
 	_Fpr2Params.min_pos_labels = 
 		mig_ut_ini_getint ( d, PARAM_FPR2_MIN_POS_LABELS, DEFAULT_PARAM_FPR2_MIN_POS_LABELS );
 
+	_Fpr2Params.num_threads =
+		mig_ut_ini_getint ( d , PARAM_FPR2_NUM_THREADS , DEFAULT_PARAM_FPR2_NUM_THREADS );
+	if ( _Fpr2Params.num_threads < 1 )
+		_Fpr2Params.num_threads = 1;
+
 	_Fpr2Params.featparams.mip_ratio = 
 		mig_ut_ini_getdouble ( d, PARAM_FPR2_MIP_RATIO, DEFAULT_PARAM_FPR2_MIP_RATIO );
 
@@ -179,46 +247,67 @@ mig_init ( mig_dic_t *d ,
 	}
 
 
-		/* get model file name from ini file */
-	model_file_name = mig_ut_ini_getstring ( d , PARAM_FPR2_SVM_MODEL_FILE , NULL );
-	if ( model_file_name == NULL )
+	/* model files from ini file , empty names are not set */
+	bundle_file_name = _ini_file ( d , PARAM_FPR2_SVM_BUNDLE_FILE );
+	model_file_name = _ini_file ( d , PARAM_FPR2_SVM_MODEL_FILE );
+	if ( bundle_file_name == NULL && model_file_name == NULL )
 	{
 		LOG4CPLUS_FATAL ( _log , " Ini file does not contain a model file..." );
 		return MIG_ERROR_PARAM;
 	}
 
-	/* get scale file name from ini file */
-	scale_file_name = mig_ut_ini_getstring ( d , PARAM_FPR2_SVM_NORM_FILE , NULL );
-	if ( scale_file_name == NULL )
-	{
-		LOG4CPLUS_FATAL ( _log , " Ini file does not contain a scale file..." );
-		return MIG_ERROR_PARAM;
-	}
+	cascade_bundle_name = _ini_file ( d , PARAM_FPR2_CASCADE_BUNDLE_FILE );
+	cascade_model_name = _ini_file ( d , PARAM_FPR2_CASCADE_MODEL_FILE );
+	_Fpr2Params.use_cascade = ( cascade_bundle_name != NULL || cascade_model_name != NULL );
+	_Fpr2Params.cascade_threshold =
+		mig_ut_ini_getdouble ( d , PARAM_FPR2_CASCADE_THRESHOLD , DEFAULT_PARAM_FPR2_CASCADE_THRESHOLD );
 
-	/* load scale file into memory */
-	/* DEACTIVATED, WE ARE NOW USING REAL WHITENING
-	rc = mig_svm_scale_params_load ( scale_file_name , &( _Fpr2Params.scales ) );
-	if ( rc != MIG_OK )
+	/* text models need the whitening , bundles have it compiled in */
+	if ( bundle_file_name == NULL || ( cascade_bundle_name == NULL && cascade_model_name != NULL ) )
 	{
-		mig_svm_scale_params_free ( &( _Fpr2Params.scales ) );
-		LOG4CPLUS_FATAL ( _log , " Could not load scales file : " << scale_file_name );
-		return rc;
-	}
-	*/
+		/* get scale file name from ini file */
+		scale_file_name = mig_ut_ini_getstring ( d , PARAM_FPR2_SVM_NORM_FILE , NULL );
+		if ( scale_file_name == NULL )
+		{
+			LOG4CPLUS_FATAL ( _log , " Ini file does not contain a scale file..." );
+			return MIG_ERROR_PARAM;
+		}
+
+		/* load scale file into memory */
+		/* DEACTIVATED, WE ARE NOW USING REAL WHITENING
+		rc = mig_svm_scale_params_load ( scale_file_name , &( _Fpr2Params.scales ) );
+		if ( rc != MIG_OK )
+		{
+			mig_svm_scale_params_free ( &( _Fpr2Params.scales ) );
+			LOG4CPLUS_FATAL ( _log , " Could not load scales file : " << scale_file_name );
+			return rc;
+		}
+		*/
 	
-	rc = mig_whitening_load ( &(_Fpr2Params.whitener), scale_file_name);
-	if ( rc != MIG_OK )
-	{
-		LOG4CPLUS_FATAL ( _log , " Could not load scales file : " << scale_file_name );
-		return rc;
+		rc = mig_whitening_load ( &(_Fpr2Params.whitener), scale_file_name);
+		if ( rc != MIG_OK )
+		{
+			LOG4CPLUS_FATAL ( _log , " Could not load scales file : " << scale_file_name );
+			return rc;
+		}
 	}
-	/* load model file into memory */
-	rc = mig_svm_model_load ( model_file_name , &( _Fpr2Params.model ) );
+
+	rc = _model_load ( bundle_file_name , model_file_name , &( _Fpr2Params.model ) );
 	if ( rc != MIG_OK )
-	{
-		mig_svm_model_free ( &( _Fpr2Params.model ) );
-		LOG4CPLUS_FATAL ( _log , " Could not load model file : " << model_file_name );
 		return rc;
+
+	/* first stage of the cascade , same features as the full model */
+	if ( _Fpr2Params.use_cascade )
+	{
+		rc = _model_load ( cascade_bundle_name , cascade_model_name , &( _Fpr2Params.cascade ) );
+		if ( rc != MIG_OK )
+			return rc;
+
+		if ( _Fpr2Params.cascade.len_in != _Fpr2Params.model.len_in )
+		{
+			LOG4CPLUS_FATAL ( _log , " Cascade model does not match model : " << _Fpr2Params.cascade.len_in );
+			return MIG_ERROR_PARAM;
+		}
 	}
 
 	/* results */
@@ -230,8 +319,18 @@ mig_init ( mig_dic_t *d ,
 	{
 		std::stringstream os;
 		os << "\nFPR2 parameters : ";
-		os << "\nModel file  : " << model_file_name;
-		os << "\nScales file : " << scale_file_name;
+		if ( bundle_file_name != NULL )
+			os << "\nBundle file : " << bundle_file_name;
+		else
+			os << "\nModel file  : " << model_file_name;
+		if ( scale_file_name != NULL )
+			os << "\nScales file : " << scale_file_name;
+		if ( _Fpr2Params.use_cascade )
+		{
+			os << "\nCascade     : " << ( cascade_bundle_name ? cascade_bundle_name : cascade_model_name );
+			os << "\nThreshold   : " << _Fpr2Params.cascade_threshold;
+		}
+		os << "\nThreads     : " << _Fpr2Params.num_threads;
 		LOG4CPLUS_INFO ( _log , os.str() );
 	}
 
@@ -299,58 +398,26 @@ mig_run ()
 
 	LOG4CPLUS_INFO( _log , " Could not load fpr2 data from disk. Performing full fpr2..." );
 
-	/* setup input to detection threads */
+	/* setup input to fpr2 */
 	_Fpr2Params.thread_data[0].id      = 0;
 	_Fpr2Params.thread_data[0].Input   = &( _CadData->det_r );
 	_Fpr2Params.thread_data[0].Src            = _CadData->stack_r;
 	_Fpr2Params.thread_data[0].SrcSize        = &( _CadData->stack_r_s );
 	_Fpr2Params.thread_data[0].SrcBoundingBox = &( _CadData->bb[0] );
-	rc = _thread_data_alloc ( &_Fpr2Params.thread_data[0] );
-
-	if ( rc != 0 )
-	{
-		LOG4CPLUS_FATAL ( _log , " libmigfpr_2 -> mig_run thread_data_alloc : " << rc );
-		return MIG_ERROR_MEMORY;
-	}
 
 	_Fpr2Params.thread_data[1].id      = 1;
 	_Fpr2Params.thread_data[1].Input   = &( _CadData->det_l );
 	_Fpr2Params.thread_data[1].Src            = _CadData->stack_l;
 	_Fpr2Params.thread_data[1].SrcSize        = &( _CadData->stack_l_s );
 	_Fpr2Params.thread_data[1].SrcBoundingBox = &( _CadData->bb[1] );
-	rc = _thread_data_alloc ( &_Fpr2Params.thread_data[1] );
-
-	if ( rc != 0 )
-	{
-		LOG4CPLUS_FATAL ( _log , " libmigfpr_2 -> mig_run thread_data_alloc : " << rc );
-		return MIG_ERROR_MEMORY;
-	}
-
-	/* spawn detection thread 0 */
-	rc = pthread_create ( &( _Fpr2Params.thread[0] ) , NULL ,
-		&( _fpr2_thread_routine ),  &( _Fpr2Params.thread_data[0] ) );
 
-	if ( rc != 0 )
-	{
-		LOG4CPLUS_FATAL ( _log , " libmigfpr_2 -> mig_run pthread_create returned : " << rc );
-		return MIG_ERROR_THREAD;
-	}
-
-	/* spawn detection thread 1 */
-	rc = pthread_create ( &( _Fpr2Params.thread[1] ) , NULL ,
-		&( _fpr2_thread_routine ),  &( _Fpr2Params.thread_data[1] ) );
-	if ( rc != 0 )
+	rc = _fpr2_run ( _Fpr2Params.thread_data , 2 );
+	if ( rc != MIG_OK )
 	{
-		LOG4CPLUS_FATAL ( _log , " libmigfpr_2 -> mig_run pthread_create returned : " << rc );
-		return MIG_ERROR_THREAD;
+		LOG4CPLUS_FATAL ( _log , " libmigfpr_2 -> mig_run fpr2 returned : " << rc );
+		return rc;
 	}
 
-	/* wait for left thread to finish */
-	pthread_join ( _Fpr2Params.thread[0] , (void**) &rc );
-
-	/* wait for right thread to finish */
-	pthread_join ( _Fpr2Params.thread[1] , (void**) &rc ); 
-
 	LOG4CPLUS_DEBUG ( _log , " libmigfpr_2 -> mig_run end..." );
 
 	/******************************************************************************/
@@ -393,10 +460,6 @@ mig_run ()
 	}
 	
 
-	/* cleanup buffers */
-	_thread_data_free ( &(_Fpr2Params.thread_data[0]) );
-	_thread_data_free ( &(_Fpr2Params.thread_data[1]) );
-
 	return MIG_OK;
 }
 
@@ -431,12 +494,202 @@ mig_info ( mig_dll_info_t* info )
 ******************************************************************************
 */
 
-static void*
-_fpr2_thread_routine ( void *arg )
+static int
+_fpr2_run ( fpr2_thread_data *lungs , int num_lungs )
+{
+	fpr2_run_t run = { NULL , 0 , NULL };
+	mig_im_region_t *curr;
+	int i , l , num , num_chunks , num_workers;
+	long rows , evals;
+	int failed;
+	int rc = MIG_ERROR_MEMORY;
+
+	/* count candidates of all lungs */
+	for ( l = 0 , num = 0 ; l < num_lungs ; ++l )
+		if ( lungs[l].Input )
+			num += mig_lst_len ( lungs[l].Input );
+
+	if ( num == 0 )
+	{
+		LOG4CPLUS_DEBUG ( _log , " _fpr2_run : Input data was empty..." );
+		return MIG_OK;
+	}
+
+	num_chunks = mig_ut_pool_chunks ( num , FPR2_BATCH );
+	num_workers = MIG_MAX2 ( MIG_MIN2 ( _Fpr2Params.num_threads , num_chunks ) , 1 );
+
+	run.num = num;
+	run.tasks = (fpr2_task_t*) calloc ( num , sizeof(fpr2_task_t) );
+	run.workers = (fpr2_worker_data*) calloc ( num_workers , sizeof(fpr2_worker_data) );
+	if ( run.tasks == NULL || run.workers == NULL )
+		goto error;
+
+	for ( i = 0 ; i < num_workers ; ++i )
+		if ( _worker_data_alloc ( &( run.workers[i] ) ) != MIG_OK )
+			goto error;
+
+	/* move candidates into task slots , right lung first */
+	for ( l = 0 , i = 0 ; l < num_lungs ; ++l )
+	{
+		if ( lungs[l].Input == NULL )
+			continue;
+
+		while ( ( curr = (mig_im_region_t*) mig_lst_get_head ( lungs[l].Input ) ) != NULL )
+		{
+			run.tasks[i].obj   = curr;
+			run.tasks[i].lung  = &( lungs[l] );
+			run.tasks[i].label = 0;
+			run.tasks[i].rc    = MIG_OK;
+			++i;
+		}
+	}
+
+	/* classify : chunks of candidates of both lungs share the workers */
+	failed = ( mig_ut_pool_run ( num_chunks , num_workers , &_fpr2_task , &run ) != 0 );
+
+	/* directions left to the full model by the early exit and the cascade */
+	for ( i = 0 , rows = 0 , evals = 0 ; i < num_workers ; ++i )
+	{
+		rows  += run.workers[i].num_rows;
+		evals += run.workers[i].num_evals;
+	}
+	LOG4CPLUS_INFO ( _log , " _fpr2_run : full model on " << evals << " of " << rows << " directions" );
+
+	rc = MIG_OK;
+	if ( failed )
+	{
+		rc = MIG_ERROR_MEMORY;
+		for ( i = 0 ; i < num ; ++i )
+			if ( run.tasks[i].rc != MIG_OK )
+			{
+				rc = run.tasks[i].rc;
+				break;
+			}
+	}
+
+	/* rebuild lung lists in candidate order : on error every candidate is
+	   given back to its lung */
+	for ( i = 0 ; i < num ; ++i )
+	{
+		curr = run.tasks[i].obj;
+
+		/* if label is 1 add to survived objects list */
+		if ( failed || run.tasks[i].label == 1 )
+		{
+			if ( !failed )
+				LOG4CPLUS_DEBUG ( _log , " _fpr2_run : reg classified as positive" );
+
+			if ( mig_lst_put_tail ( run.tasks[i].lung->Input , curr ) == 0 )
+				continue;
+
+			rc = MIG_ERROR_MEMORY;
+		}
+
+		/* if label is 0 free all 2d objects belonging to current 3d object */
+		mig_lst_free_custom_static_data_and_node ( &( curr->objs ) , _CadData->det_cleanup , _CadData->fpr1_cleanup);
+		_CadData->det_cleanup ( curr );
+	}
+
+error :
+
+	if ( run.workers )
+	{
+		for ( i = 0 ; i < num_workers ; ++i )
+			_worker_data_free ( &( run.workers[i] ) );
+		free ( run.workers );
+	}
+	if ( run.tasks )
+		free ( run.tasks );
+
+	return rc;
+}
+
+/*******************************************************************************/
+
+static int
+_fpr2_task ( void *arg , int task , int worker )
+{
+	fpr2_run_t *run = (fpr2_run_t*) arg;
+	fpr2_worker_data *buffers = &( run->workers[worker] );
+	fpr2_task_t *t;
+	fpr2_task_t *batch[FPR2_BATCH];
+	int labels[FPR2_BATCH];
+	mig_im_region_t local;
+	int mip_len = NDIR * MIG_POW2( _Fpr2Params.featparams.resized_len );
+	int i , end , num_batch = 0;
+	int rc;
+
+	end = MIG_MIN2 ( ( task + 1 ) * FPR2_BATCH , run->num );
+
+	/* mips of candidates with an estimated radius go to one batch */
+	for ( i = task * FPR2_BATCH ; i < end ; ++i )
+	{
+		t = &( run->tasks[i] );
+
+		if ( t->obj->radius > 0.0001 )
+		{
+			_obj3d_to_lung ( t->obj , t->lung , &local );
+
+			rc = extract_mips ( &local , t->lung->Src ,
+				t->lung->SrcSize->w , t->lung->SrcSize->h , t->lung->SrcSize->slices ,
+				&(_Fpr2Params.featparams) , &( buffers->work ) ,
+				buffers->mips + num_batch * mip_len );
+			if ( rc != MIG_OK )
+				goto error;
+
+			batch[num_batch++] = t;
+		}
+		else
+		{
+			/* no radius estimation : multires , should never happen */
+			rc = _fpr2_multires ( t , buffers );
+			if ( rc != MIG_OK )
+				goto error;
+		}
+	}
+
+	if ( num_batch == 0 )
+		return 0;
+
+	/* moments of all directions of all candidates at once */
+	rc = mig_im_mom_batch_2D ( buffers->mips , num_batch * NDIR ,
+		_Fpr2Params.featparams.resized_len , _Fpr2Params.featparams.mom_masks ,
+		buffers->moments );
+	if ( rc != MIG_OK )
+	{
+		t = batch[0];
+		goto error;
+	}
+
+	/* labels of the whole batch at once */
+	rc = _classify_feats ( buffers->moments , num_batch , labels , buffers );
+	if ( rc != MIG_OK )
+	{
+		t = batch[0];
+		goto error;
+	}
+
+	for ( i = 0 ; i < num_batch ; ++i )
+		batch[i]->label = labels[i];
+
+	return 0;
+
+error :
+
+	LOG4CPLUS_FATAL ( _log , "Aborting fpr2. Error : " <<  rc << " in : " << t->lung->id );
+	t->rc = rc;
+	return -1;
+}
+
+/*******************************************************************************/
+
+static int
+_fpr2_multires ( fpr2_task_t *t , fpr2_worker_data *buffers )
 {
-	mig_lst_t survived_objs = { NULL , NULL , 0 , free };      /* list of survived 3d objects */
-	mig_im_region_t *curr;                                      /* current 3d region */
-	fpr2_thread_data *data = (fpr2_thread_data*) arg;           /* input parameters */
+	mig_im_region_t *curr = t->obj;                             /* current 3d region */
+	mig_im_region_t local;
+	float *feats = buffers->featstruct->feats[0];
+	int labels[FPR2_MULTIRES_LEN];
 	int label = 0;
 	int oldlabel = 0;
 	int rc;
@@ -453,132 +706,239 @@ _fpr2_thread_routine ( void *arg )
 	int multires_pos = 0;
 	float multires_radius = 0.0f;
 
-	int radii[] = { 3, 6, 12, 24};
-	int radii_len = 4;
 	int r_idx;
 
 	/*******************************/
 
-	LOG4CPLUS_DEBUG ( _log , " _fpr2_thread_routine : " << data->id );
+	/* mips of all radii from one crop , their moments in one batch */
+	_obj3d_to_lung ( curr , t->lung , &local );
 
-	if ( data->Input == NULL )
-	{
-		LOG4CPLUS_DEBUG ( _log , " _fpr2_thread_routine : " << data->id << " , Input data was empty..." );
-		return ( (void*)MIG_OK );
-	}
+	rc = extract_mips_radii ( &local , t->lung->Src ,
+		t->lung->SrcSize->w , t->lung->SrcSize->h , t->lung->SrcSize->slices ,
+		&(_Fpr2Params.featparams) , _MultiresRadii , FPR2_MULTIRES_LEN ,
+		&( buffers->work ) , buffers->single );
+	if ( rc != MIG_OK )
+		return MIG_ERROR_INTERNAL;
+
+	rc = mig_im_mom_batch_2D ( buffers->single , FPR2_MULTIRES_LEN * NDIR ,
+		_Fpr2Params.featparams.resized_len , _Fpr2Params.featparams.mom_masks ,
+		feats );
+	if ( rc != MIG_OK )
+		return MIG_ERROR_INTERNAL;
+
+	/* classify 3d object at every radius */
+	rc = _classify_feats ( feats , FPR2_MULTIRES_LEN , labels , buffers );
+	if ( rc != MIG_OK )
+		return rc;
 
-	/* classify each 3d object */
-	while ( curr = (mig_im_region_t*) mig_lst_get_head ( data->Input ) )
+	multires_pos = 0;
+	multires_radius = 0.0f;
+	oldlabel = 0;
+	for ( r_idx = 0 ; r_idx < FPR2_MULTIRES_LEN ; ++r_idx )
 	{
-		/* if radius is not 0 use estimated radius, else do multires */
+		label = labels[r_idx];
 
-		if (curr->radius > 0.0001)
+		if ( label == 1 )
 		{
-			/* classify 3d object */
-				rc = _classify_obj_3d ( curr , &label, data);
-				if ( rc != MIG_OK )
-				{
-					LOG4CPLUS_FATAL ( _log , "Aborting fpr2 thread. Error : " <<  rc << " in : " << data->id );
-					pthread_exit ( (void*)rc );    
-				}
+			
+			++multires_pos;
+			if ( multires_radius  < _MultiresRadii[r_idx] )
+				multires_radius = _MultiresRadii[r_idx];
 		}
-		else /* multires */
+		/* here we require at least two nearby positive labels */
+		/*if ( oldlabel && label )
 		{
+			multires_pos = 1;
+			multires_radius = _MultiresRadii[r_idx];
+			break;
+		}
+		*/
 
-			multires_pos = 0;
-			multires_radius = 0.0f;
-			oldlabel = 0;
-			for ( r_idx = 0 ; r_idx < radii_len ; ++r_idx )
-			{
-				label = 0;
-				curr->radius = radii[r_idx];
-				/* classify 3d object */
-				rc = _classify_obj_3d ( curr , &label, data);
-				if ( rc != MIG_OK )
-				{
-					LOG4CPLUS_FATAL ( _log , "Aborting fpr2 thread. Error : " <<  rc << " in : " << data->id );
-					pthread_exit ( (void*)rc );    
-				}
-
-				if ( label == 1 )
-				{
-					
-					++multires_pos;
-					if ( multires_radius  < curr->radius )
-						multires_radius = curr->radius;
-				}
-				/* here we require at least two nearby positive labels */
-				/*if ( oldlabel && label )
-				{
-					multires_pos = 1;
-					multires_radius = curr->radius;
-					break;
-				}
-				*/
-
-				oldlabel = label;
-			}
+		oldlabel = label;
+	}
 
-			/* assign final label and radius, here we can do better things */
-			if (multires_pos >= 1 )
-			{
-				label = 1;
-				curr->radius = multires_radius;
-			}
-			else
-			{
-				label = 0;
-			}
-		
-		}
+	/* assign final label and radius, here we can do better things */
+	if (multires_pos >= 1 )
+	{
+		label = 1;
+		curr->radius = multires_radius;
+	}
+	else
+	{
+		label = 0;
+		curr->radius = _MultiresRadii[FPR2_MULTIRES_LEN - 1];
+	}
 
-		/* if label is 1 add to survived objects list */
-		if ( label == 1 )
+	t->label = label;
+
+	return MIG_OK;
+}
+
+/*******************************************************************************/
+
+static int
+_classify_feats ( float *feats , int num , int *labels , fpr2_worker_data *buffers )
+{
+	const mig_svm_t *model = &( _Fpr2Params.model );
+	const mig_svm_t *cascade = &( _Fpr2Params.cascade );
+	int len = model->len_in;
+	int min_pos = _Fpr2Params.min_pos_labels;
+	int pos[FPR2_MAX_CANDS];        /* positive directions of a candidate so far */
+	int left[FPR2_MAX_CANDS];       /* directions of a candidate still to classify */
+	int cand[FPR2_MAX_CANDS];       /* candidate of every gathered row */
+	int dir_labels[FPR2_MAX_CANDS]; /* labels of gathered rows */
+	int i , idir , n , row;
+
+	/* load data into svm suitable format */
+	/* x.len  = MIG_POW2( diam_valid ); */
+	if ( _Fpr2Params.featparams.mom_orders_len != len || num > FPR2_MAX_CANDS )
+		return MIG_ERROR_INTERNAL;
+
+	/* first stage : directions scoring below threshold count as negative */
+	if ( _Fpr2Params.use_cascade )
+	{
+		if ( mig_svm_decision_batch ( cascade , feats , num * NDIR , buffers->dir_scores ) != MIG_OK )
+			return MIG_ERROR_INTERNAL;
+
+		/* decision is positive for the first label */
+		if ( cascade->labels[0] != 1 )
+			for ( row = 0 ; row < num * NDIR ; ++row )
+				buffers->dir_scores[row] = -buffers->dir_scores[row];
+	}
+
+	for ( i = 0 ; i != num ; i++ )
+	{
+		pos[i] = 0;
+		left[i] = NDIR;
+
+		if ( _Fpr2Params.use_cascade )
+			for ( idir = 0 ; idir != NDIR ; idir++ )
+				if ( buffers->dir_scores[i * NDIR + idir] < _Fpr2Params.cascade_threshold )
+					left[i]--;
+	}
+
+	/* full model one direction at a time , only on candidates whose label
+	   can still change : whitening is compiled into the model */
+	for ( idir = 0 ; idir != NDIR ; idir++ )
+	{
+		for ( i = 0 , n = 0 ; i != num ; i++ )
 		{
-			LOG4CPLUS_DEBUG ( _log , " _fpr2_thread_routine : reg classified as positive" );
+			row = i * NDIR + idir;
 
-			mig_lst_put_tail ( &survived_objs , curr );
+			if ( pos[i] >= min_pos || pos[i] + left[i] < min_pos )
+				continue;
+			if ( _Fpr2Params.use_cascade && buffers->dir_scores[row] < _Fpr2Params.cascade_threshold )
+				continue;
+
+			memcpy ( buffers->rows + n * len , feats + row * len , len * sizeof(float) );
+			cand[n++] = i;
 		}
-		/* if label is 0 free all 2d objects belonging to current 3d object */
-		else
+
+		if ( n == 0 )
+			continue;
+
+		if ( mig_svm_predict_batch ( model , buffers->rows , n , dir_labels ) != MIG_OK )
+			return MIG_ERROR_INTERNAL;
+
+		for ( i = 0 ; i != n ; i++ )
 		{
-			mig_lst_free_custom_static_data_and_node ( &( curr->objs ) , _CadData->det_cleanup , _CadData->fpr1_cleanup);
-			_CadData->det_cleanup ( curr );
+			left[cand[i]]--;
+			if ( dir_labels[i] == 1 )
+				pos[cand[i]]++;
 		}
 
-	} /* while */
+		buffers->num_evals += n;
+	}
 
-	/* copy survived list into input list */
-	mig_lst_cat ( &survived_objs , data->Input );
+	/* count positive directions */
+	for ( i = 0 ; i != num ; i++ )
+	{
+		if ( pos[i] >= min_pos )
+			labels[i] = 1;
+		else
+			labels[i] = 0;
+	}
+
+	buffers->num_rows += num * NDIR;
 
-	return ( (void*)MIG_OK );
+	return MIG_OK;   
 }
 
 /*******************************************************************************/
 
-static int 
-_classify_obj_3d ( mig_im_region_t *obj3d , int *label , fpr2_thread_data *data)
+static char*
+_ini_file ( mig_dic_t *d , char *key )
 {
-	
-	mig_svm_example_t x;
+	char *name = mig_ut_ini_getstring ( d , key , NULL );
 
-	int idir = 0;
+	if ( name == NULL || name[0] == '\0' )
+		return NULL;
 
-	float *whitened = data->whitened;
-	int pos = 0 , neg = 0;
+	return name;
+}
 
-	feat_t *featstruct = data->featstruct;
-	
-	mig_im_region_t _temp_obj3d;
-	/* get features */
-	/* from original */
-	/*
-	if ( extract_features (obj3d, _CadData->stack,
-		_CadData->stack_s.w , _CadData->stack_s.h , _CadData->stack_s.slices ,
-		&(_Fpr2Params.featparams), featstruct ))
-		return MIG_ERROR_INTERNAL;
-	*/
+/*******************************************************************************/
+
+static int
+_model_load ( const char *bundle_file_name , const char *model_file_name , mig_svm_t *model )
+{
+	float *whitening = NULL;
+	int rc;
+
+	/* binary bundle : compiled model mapped read only , no text parsing */
+	if ( bundle_file_name != NULL )
+	{
+		rc = mig_svm_bundle_load ( bundle_file_name , model );
+		if ( rc != MIG_OK )
+		{
+			LOG4CPLUS_FATAL ( _log , " Could not load bundle file : " << bundle_file_name );
+			return rc;
+		}
+
+		/* the whitening is not loaded for bundles : it must be compiled in */
+		if ( !model->compiled )
+		{
+			mig_svm_model_free ( model );
+			LOG4CPLUS_FATAL ( _log , " Bundle file has no whitening compiled in : " << bundle_file_name );
+			return MIG_ERROR_PARAM;
+		}
+		return MIG_OK;
+	}
+
+	/* load model file into memory */
+	rc = mig_svm_model_load ( model_file_name , model );
+	if ( rc != MIG_OK )
+	{
+		mig_svm_model_free ( model );
+		LOG4CPLUS_FATAL ( _log , " Could not load model file : " << model_file_name );
+		return rc;
+	}
 
+	/* whitening compiled into the model : moments are classified as they are */
+	if ( mig_whitening_len ( &(_Fpr2Params.whitener) ) != model->len_sv )
+	{
+		LOG4CPLUS_FATAL ( _log , " Scales file does not match model file : " << model_file_name );
+		return MIG_ERROR_PARAM;
+	}
+
+	whitening = (float*) malloc ( MIG_POW2( model->len_sv ) * sizeof(float) );
+	if ( whitening == NULL )
+		return MIG_ERROR_MEMORY;
+
+	mig_whitening_matrix ( &(_Fpr2Params.whitener), whitening );
+	rc = mig_svm_model_compile ( model , NULL , NSIGMA_WHITE , whitening , model->len_sv );
+	free ( whitening );
+	if ( rc != MIG_OK )
+		LOG4CPLUS_FATAL ( _log , " Could not compile whitening into model : " << model_file_name );
+
+	return rc;
+}
+
+/*******************************************************************************/
+
+static void
+_obj3d_to_lung ( mig_im_region_t *obj3d , fpr2_thread_data *data , mig_im_region_t *local )
+{
     /* GF 20170216: I don't remember the sense of this comment,
      * further investigation needed
      *
@@ -588,77 +948,59 @@ _classify_obj_3d ( mig_im_region_t *obj3d , int *label , fpr2_thread_data *data)
 
 	/* from segmented :TODO: NOT OK: we must change extract_feature in order to handle bb*/
 	
-	_temp_obj3d.centroid[0] = obj3d->centroid[0] - data->SrcBoundingBox->x0;
-	_temp_obj3d.centroid[1] = obj3d->centroid[1] - data->SrcBoundingBox->y0;
-	_temp_obj3d.centroid[2] = obj3d->centroid[2] - data->SrcBoundingBox->z0;
-	_temp_obj3d.radius = obj3d->radius;
-	_temp_obj3d.size = obj3d->size;
-
-	if ( extract_features (&_temp_obj3d, data->Src,
-		data->SrcSize->w , data->SrcSize->h , data->SrcSize->slices ,
-		&(_Fpr2Params.featparams), featstruct ))
-		return MIG_ERROR_INTERNAL;
-
-	for (idir = 0; idir != NDIR ; idir++){
-
-		/*
-		mig_im_scale_whitening ( featstruct->feats[idir], whitened , NSIGMA_WHITE,
-			_Fpr2Params.scales.len , _Fpr2Params.scales.mean ,  _Fpr2Params.scales.std );
-		*/
-		mig_whitening_apply ( &(_Fpr2Params.whitener), featstruct->feats[idir] , whitened );
-
-		/* load data into svm suitable format */
-		/* x.len  = MIG_POW2( diam_valid ); */
-		x.len  = _Fpr2Params.featparams.mom_orders_len;
-		x.feat = whitened;
-
-		/* label prediction */
-		if ( mig_svm_predict ( &( _Fpr2Params.model ) , &x ) != MIG_OK )
-			return MIG_ERROR_INTERNAL;  
-
-		/*increment pos or neg */
-		if ( x.label == 1 )
-			pos ++ ;
-		else
-			neg ++;
-
-	}
-	if (pos >= _Fpr2Params.min_pos_labels)
-		*label = 1;
-	else
-		*label = 0;   
-
-	return MIG_OK;   
+	local->centroid[0] = obj3d->centroid[0] - data->SrcBoundingBox->x0;
+	local->centroid[1] = obj3d->centroid[1] - data->SrcBoundingBox->y0;
+	local->centroid[2] = obj3d->centroid[2] - data->SrcBoundingBox->z0;
+	local->radius = obj3d->radius;
+	local->size = obj3d->size;
 }
 
 /*******************************************************************************/
 
 
 static int
-_thread_data_alloc( fpr2_thread_data *thread_data )
+_worker_data_alloc( fpr2_worker_data *worker_data )
 {
 
-	/* memory for whitened */
-	thread_data->whitened = (float*) calloc (
-		MIG_POW2( _Fpr2Params.featparams.mom_orders_len ), sizeof(float) );
-	if ( thread_data->whitened == NULL )
+	/* memory for scores of single directions and rows of the full model */
+	worker_data->dir_scores = (double*) calloc ( FPR2_MAX_ROWS, sizeof(double) );
+	worker_data->rows = (float*) malloc (
+		FPR2_MAX_CANDS * _Fpr2Params.featparams.mom_orders_len * sizeof(float) );
+	if ( worker_data->dir_scores == NULL || worker_data->rows == NULL )
 		return MIG_ERROR_MEMORY;
 
 
-	thread_data->featstruct = feat_t_alloc ( NDIR, _Fpr2Params.featparams.mom_orders_len );
-	if ( thread_data->featstruct == NULL )
-	{
-		free ( thread_data->whitened );
+	worker_data->featstruct = feat_t_alloc ( FPR2_MULTIRES_LEN * NDIR, _Fpr2Params.featparams.mom_orders_len );
+	if ( worker_data->featstruct == NULL )
 		return MIG_ERROR_MEMORY;
-	}
+
+	/* memory for a batch of mips and their moments */
+	worker_data->mips = (float*) malloc (
+		FPR2_BATCH * NDIR * MIG_POW2( _Fpr2Params.featparams.resized_len ) * sizeof(float) );
+	worker_data->moments = (float*) malloc (
+		FPR2_BATCH * NDIR * _Fpr2Params.featparams.mom_orders_len * sizeof(float) );
+	worker_data->single = (float*) malloc (
+		FPR2_MULTIRES_LEN * NDIR * MIG_POW2( _Fpr2Params.featparams.resized_len ) * sizeof(float) );
+	if ( worker_data->mips == NULL || worker_data->moments == NULL || worker_data->single == NULL )
+		return MIG_ERROR_MEMORY;
+
 	return MIG_OK;
 }
 
 static void 
-_thread_data_free ( fpr2_thread_data *thread_data )
+_worker_data_free ( fpr2_worker_data *worker_data )
 {
-	if ( thread_data->whitened )
-		free ( thread_data->whitened );
-	if ( thread_data->featstruct )
-		feat_t_free ( thread_data->featstruct );	
+	if ( worker_data->dir_scores )
+		free ( worker_data->dir_scores );
+	if ( worker_data->rows )
+		free ( worker_data->rows );
+	if ( worker_data->featstruct )
+		feat_t_free ( worker_data->featstruct );	
+	if ( worker_data->mips )
+		free ( worker_data->mips );
+	if ( worker_data->moments )
+		free ( worker_data->moments );
+	if ( worker_data->single )
+		free ( worker_data->single );
+	feat_work_free ( &( worker_data->work ) );
 }
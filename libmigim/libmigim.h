@@ -29,6 +29,7 @@
 #include "mig_im_scale.h"		/* scaling functions */
 #include "mig_im_sspace.h"      /* scale space */
 #include "mig_im_thr.h"		    /* thresholding */
+#include "mig_im_tile.h"	    /* 3d tile activity maps */
 #include "mig_im_util.h"	    /* conversion functions */
 #include "mig_im_mom.h"			/* image moments extraction */
 #include "mig_im_proj.h"		/* projection functions (MIP) */
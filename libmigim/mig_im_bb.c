@@ -68,21 +68,34 @@ mig_im_bb_cut_3d ( Mig16u *src ,
                    int cx , int cy , int cz ,
                    float *dst ,
                    int r )
+{
+    mig_im_bb_cut_3d_aniso ( src , w , h , z , cx , cy , cz , dst , r , r );
+}
+
+/**************************************************************************************************/
+
+void
+mig_im_bb_cut_3d_aniso ( Mig16u *src ,
+                         int w , int h , int z ,
+                         int cx , int cy , int cz ,
+                         float *dst ,
+                         int r , int rz )
 {
     int x0 , x1;
     int y0 , y1;
     int z0 , z1;
     int d = 2 * r + 1;
+    int dz = 2 * rz + 1;
     int i , j , k;
 
     /* zero output */
-    memset ( dst , 0x00 , d * d * d * sizeof(float) );
+    memset ( dst , 0x00 , d * d * dz * sizeof(float) );
 
     /* shift src to current pixel */
     src += cx + cy * w + cz * w * h;
 
     /* shift dst to its central pixel */
-    dst += r + r * d + r * d * d;
+    dst += r + r * d + rz * d * d;
 
     /* take care of boundary conditions */
     x0 = ( ( cx - r ) < 0 )? cx : r;
@@ -91,8 +104,8 @@ mig_im_bb_cut_3d ( Mig16u *src ,
     y0 = ( ( cy - r ) < 0 )? cy : r;
     y1 = ( ( cy + r ) >= h )? (h - cy) - 1 : r;
 
-    z0 = ( ( cz - r ) < 0 )? cz : r;
-    z1 = ( ( cz + r ) >= z )? (z - cz) - 1 : r;
+    z0 = ( ( cz - rz ) < 0 )? cz : rz;
+    z1 = ( ( cz + rz ) >= z )? (z - cz) - 1 : rz;
 
     /* cut region from src */
     for ( k = -z0 ; k <= z1 ; ++k )
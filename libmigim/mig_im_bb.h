@@ -39,6 +39,14 @@ mig_im_bb_cut_3d ( Mig16u *src ,
                    float *dst ,
                    int r );
 
+/* d x d x dz window , d = 2 * r + 1 and dz = 2 * rz + 1 */
+void
+mig_im_bb_cut_3d_aniso ( Mig16u *src ,
+                         int w , int h , int z ,
+                         int cx , int cy , int cz ,
+                         float *dst ,
+                         int r , int rz );
+
 MIG_C_LINKAGE_END
 
 #endif /* __MIG_IM_BB_H__ */
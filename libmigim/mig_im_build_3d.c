@@ -11,6 +11,9 @@
 
 #include "mig_im_build_3d.h"
 
+/* spatial hash of grid cells */
+#define BUILD3D_CELL_HASH(x,y,z) ( (unsigned int)(x) * 73856093u ^ (unsigned int)(y) * 19349663u ^ (unsigned int)(z) * 83492791u )
+
 /*
  ******************************************************************************
  *               PRIVATE PROTOTYPES DECLARATION
@@ -20,6 +23,14 @@
 static int
 _obj3d_list_sort_cmp ( const void *a , const void *b );
 
+/* compact and sort a finished 3d region and add it to results */
+static int
+_obj3d_close ( mig_im_region_t *Curr , mig_lst_t *Results );
+
+/* ascending order of 2d region indices */
+static int
+_obj3d_idx_cmp ( const void *a , const void *b );
+
 
 /*
  ******************************************************************************
@@ -78,17 +89,7 @@ mig_im_build_obj3d ( mig_lst_t *Src ,
             }
 
             /* here we have finished processing one 3D region */
-
-            /* compact newly found 3D region : only one 2D view
-               for each composing 2d object */
-            obj3d_compact ( Curr );
-
-            /* sort new found 3d region views with respect to coordinates */
-            /* AAAAAA doesn't work */
-            mig_lst_sort ( &( Curr->objs ) , &_obj3d_list_sort_cmp );
-
-            /* add 3D region to results list */
-            if ( mig_lst_put_head ( Results , Curr ) == -1 )
+            if ( _obj3d_close ( Curr , Results ) == -1 )
                 return -1;
         } 
     }
@@ -98,6 +99,180 @@ mig_im_build_obj3d ( mig_lst_t *Src ,
     return 0;
 }
 
+/*******************************************************************************/
+
+    int
+mig_im_build_obj3d_grid ( mig_lst_t *Src , 
+        mig_lst_t *Results ,
+        mig_lst_cmp_f build_f , 
+        mig_lst_sel_f cut_f ,
+        mig_lst_free_f free_f,
+        int just_copy_and_filter ,
+        float xy_tol ,
+        float z_tol )
+{
+    mig_im_region_t *Curr, *Tmp1;
+    mig_stack_t stack = { 0 , NULL , NULL , NULL };
+    mig_im_region_t **regs = NULL;
+    int *cells = NULL , *heads = NULL , *next = NULL , *prev = NULL , *found = NULL;
+    char *taken = NULL;
+    int i , j , num , num_found , num_buckets , first , cx , cy , cz , x , y , z;
+    float cell_xy , cell_z;
+    unsigned int b;
+    int rc = -1;
+
+    if ( just_copy_and_filter || xy_tol < 0.0f || z_tol < 0.0f )
+        return mig_im_build_obj3d ( Src , Results , build_f , cut_f , free_f , just_copy_and_filter );
+
+    num = mig_lst_len ( Src );
+
+    for ( num_buckets = 1 ; num_buckets < 2 * num ; num_buckets <<= 1 )
+        ;
+
+    regs  = (mig_im_region_t**) malloc ( MIG_MAX2 ( num , 1 ) * sizeof(mig_im_region_t*) );
+    cells = (int*) malloc ( 3 * MIG_MAX2 ( num , 1 ) * sizeof(int) );
+    next  = (int*) malloc ( MIG_MAX2 ( num , 1 ) * sizeof(int) );
+    prev  = (int*) malloc ( MIG_MAX2 ( num , 1 ) * sizeof(int) );
+    found = (int*) malloc ( MIG_MAX2 ( num , 1 ) * sizeof(int) );
+    taken = (char*) calloc ( MIG_MAX2 ( num , 1 ) , sizeof(char) );
+    heads = (int*) malloc ( num_buckets * sizeof(int) );
+    if ( regs == NULL || cells == NULL || next == NULL || prev == NULL ||
+         found == NULL || taken == NULL || heads == NULL )
+        goto error;
+
+    /* matching 2d regions are at most one cell apart along each axis ,
+       cells are slightly larger than tolerances against rounding */
+    cell_xy = MIG_MAX2 ( xy_tol , 1.0f ) * 1.001f;
+    cell_z  = MIG_MAX2 ( z_tol , 1.0f ) * 1.001f;
+
+    for ( b = 0 ; b < (unsigned int) num_buckets ; ++b )
+        heads[b] = -1;
+
+    /* source list order is kept through region indices */
+    for ( i = 0 ; i < num ; ++i )
+    {
+        regs[i] = (mig_im_region_t*) mig_lst_get_head ( Src );
+
+        cells[3*i]   = (int) floorf ( regs[i]->centroid[0] / cell_xy );
+        cells[3*i+1] = (int) floorf ( regs[i]->centroid[1] / cell_xy );
+        cells[3*i+2] = (int) floorf ( regs[i]->centroid[2] / cell_z );
+
+        b = BUILD3D_CELL_HASH ( cells[3*i] , cells[3*i+1] , cells[3*i+2] ) & ( num_buckets - 1 );
+        prev[i] = -1;
+        next[i] = heads[b];
+        if ( heads[b] >= 0 )
+            prev[heads[b]] = i;
+        heads[b] = i;
+    }
+
+    for ( first = 0 ; ; )
+    {
+        /* next 2d region still in source list starts a new 3D object */
+        while ( first < num && taken[first] )
+            ++first;
+        if ( first == num )
+            break;
+
+        Curr = regs[first];
+        found[0] = first;
+        num_found = 1;
+
+        /* register list free function for this 3d view */
+        Curr->objs._free = &free;
+
+        do
+        {
+            /* take found regions out of the grid and push them in source order */
+            for ( i = 0 ; i < num_found ; ++i )
+            {
+                j = found[i];
+                taken[j] = 1;
+
+                b = BUILD3D_CELL_HASH ( cells[3*j] , cells[3*j+1] , cells[3*j+2] ) & ( num_buckets - 1 );
+                if ( prev[j] >= 0 )
+                    next[prev[j]] = next[j];
+                else
+                    heads[b] = next[j];
+                if ( next[j] >= 0 )
+                    prev[next[j]] = prev[j];
+
+                if ( mig_stack_push ( & stack , regs[j] ) == -1 )
+                    goto error;
+            }
+
+            if ( mig_stack_pop ( &stack , (void**) &Tmp1 ) == -1 )
+                break;
+
+            /* add poped node to current region */
+            if ( mig_lst_put_head ( &( Curr->objs ) , Tmp1 ) == -1 )
+                goto error;
+
+            /* search neighbouring cells for all nodes matching inclusion criteria */
+            x = (int) floorf ( Tmp1->centroid[0] / cell_xy );
+            y = (int) floorf ( Tmp1->centroid[1] / cell_xy );
+            z = (int) floorf ( Tmp1->centroid[2] / cell_z );
+
+            num_found = 0;
+            for ( cz = z - 1 ; cz <= z + 1 ; ++cz )
+            for ( cy = y - 1 ; cy <= y + 1 ; ++cy )
+            for ( cx = x - 1 ; cx <= x + 1 ; ++cx )
+            {
+                b = BUILD3D_CELL_HASH ( cx , cy , cz ) & ( num_buckets - 1 );
+                for ( j = heads[b] ; j >= 0 ; j = next[j] )
+                {
+                    if ( cells[3*j] != cx || cells[3*j+1] != cy || cells[3*j+2] != cz )
+                        continue;
+
+                    if ( build_f ( Tmp1 , regs[j] ) == 0 )
+                        found[num_found++] = j;
+                }
+            }
+
+            /* same push order as a scan of the source list */
+            if ( num_found > 1 )
+                qsort ( found , num_found , sizeof(int) , &_obj3d_idx_cmp );
+        }
+        while ( 1 );
+
+        /* here we have finished processing one 3D region */
+        if ( _obj3d_close ( Curr , Results ) == -1 )
+            goto error;
+    }
+
+    /* here we have finished processing all 3D regions : now prune list */
+    mig_lst_rem_all ( Results , cut_f , free_f );
+
+    rc = 0;
+
+error :
+
+    /* on error 2d regions not yet taken go back to source list */
+    if ( rc != 0 && regs != NULL && taken != NULL )
+        for ( i = 0 ; i < num ; ++i )
+            if ( !taken[i] )
+                mig_lst_put_tail ( Src , regs[i] );
+
+    while ( mig_stack_pop ( &stack , (void**) &Tmp1 ) != -1 )
+        ;
+
+    if ( regs )
+        free ( regs );
+    if ( cells )
+        free ( cells );
+    if ( next )
+        free ( next );
+    if ( prev )
+        free ( prev );
+    if ( found )
+        free ( found );
+    if ( taken )
+        free ( taken );
+    if ( heads )
+        free ( heads );
+
+    return rc;
+}
+
 /*
  ******************************************************************************
  *               PRIVATE PROTOTYPES IMPLEMENTATION
@@ -126,6 +301,31 @@ _obj3d_list_sort_cmp ( const void *a , const void *b )
 }
 
 
+/*******************************************************************************/
+
+    static int
+_obj3d_close ( mig_im_region_t *Curr , mig_lst_t *Results )
+{
+    /* compact newly found 3D region : only one 2D view
+       for each composing 2d object */
+    obj3d_compact ( Curr );
+
+    /* sort new found 3d region views with respect to coordinates */
+    /* AAAAAA doesn't work */
+    mig_lst_sort ( &( Curr->objs ) , &_obj3d_list_sort_cmp );
+
+    /* add 3D region to results list */
+    return mig_lst_put_head ( Results , Curr );
+}
+
+/*******************************************************************************/
+
+    static int
+_obj3d_idx_cmp ( const void *a , const void *b )
+{
+    return *(const int*) a - *(const int*) b;
+}
+
 /*******************************************************************************/
 
     void
@@ -42,6 +42,39 @@ mig_im_build_obj3d ( mig_lst_t *Src ,
                      mig_lst_free_f free_f,
                      int just_copy_and_filter );
 
+/*
+******************************************************************************
+*                       BUILD OBJ3D ON A SPATIAL GRID
+*
+* Description : Same as mig_im_build_obj3d , but candidate 2D regions are
+*               looked up in a hash of grid cells around the popped region
+*               instead of scanning the whole source list , so linking is
+*               about linear in the number of 2D regions. Output ( objects ,
+*               their order and their views ) is the same as the one of
+*               mig_im_build_obj3d.
+*
+* Arguments   : xy_tol - build_f never matches regions whose centroids are
+*                        further apart than xy_tol in the x-y plane
+*               z_tol  - build_f never matches regions whose centroids are
+*                        further apart than z_tol along z
+*
+* Returns     : 0 on success , -1 on memory error
+*
+* Notes       : falls back to mig_im_build_obj3d if a tolerance is negative
+*
+******************************************************************************
+*/
+
+int
+mig_im_build_obj3d_grid ( mig_lst_t *Src , 
+                          mig_lst_t *Results ,
+                          mig_lst_cmp_f build_f , 
+                          mig_lst_sel_f cut_f ,
+                          mig_lst_free_f free_f,
+                          int just_copy_and_filter ,
+                          float xy_tol ,
+                          float z_tol );
+
 void
 obj3d_compact ( mig_im_region_t *Region );
 
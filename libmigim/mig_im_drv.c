@@ -21,6 +21,13 @@
 /* TODO: we could use mig_im_conv instead */
 static void _conv_sobel_3d ( float *in, float *out, int w, int h, int z, float *ker );
 
+/* sobel convolution restricted to voxel box [x0,x1) x [y0,y1) x [z0,z1) */
+static void _conv_sobel_3d_box ( float *in, float *out, int w, int h, int z, float *ker,
+                                 int x0, int x1, int y0, int y1, int z0, int z1 );
+
+/* gradient normalization and thresholding of a single voxel */
+static void _norm_sobel_3d ( float *dx, float *dy, float *dz, float *dmag, float thr );
+
 
 /*
 *****************************************************************************
@@ -104,21 +111,55 @@ mig_im_sobel_3d ( float *data, int w, int h, int z, float *dx, float *dy, float
     _conv_sobel_3d ( data, dz, w, h, z, _so_3d_z );
 
     for ( i = 0; i < w * h * z; ++i, ++dx, ++dy, ++dz, ++dmag )
-    {
-        *dmag = sqrtf ( MIG_POW2 ( *dx ) + MIG_POW2 ( *dy ) + MIG_POW2 ( *dz ) );
+        _norm_sobel_3d ( dx, dy, dz, dmag, thr );
+}
 
-        if ( *dmag > thr )
-        {
-            *dx /= *dmag;
-            *dy /= *dmag;
-            *dz /= *dmag;
-        }
-        else
+
+void
+mig_im_sobel_3d_tiles ( float *data, int w, int h, int z, float *dx, float *dy, float *dz, float *dmag, float thr,
+                        const mig_im_tiles_t *tiles )
+{
+    int i, j, k, tx, ty, tz;
+    int x0, x1, y0, y1, z0, z1;
+    int idx;
+
+    /* zero all output images */
+    memset ( dx, 0x00, w * h * z * sizeof ( float ) );
+    memset ( dy, 0x00, w * h * z * sizeof ( float ) );
+    memset ( dz, 0x00, w * h * z * sizeof ( float ) );
+    memset ( dmag, 0x00, w * h * z * sizeof ( float ) );
+
+    for ( tz = 0; tz < tiles->tz; ++tz )
+    {
+        for ( ty = 0; ty < tiles->th; ++ty )
         {
-            *dmag = 0.0f;
-            *dx = 0.0f;
-            *dy = 0.0f;
-            *dz = 0.0f;
+            for ( tx = 0; tx < tiles->tw; ++tx )
+            {
+                if ( !MIG_IM_TILE_ON ( tiles, tx, ty, tz ) )
+                    continue;
+
+                /* tile box clipped to the voxels sobel kernel can reach */
+                x0 = MIG_MAX2 ( tx * tiles->len, 1 );
+                y0 = MIG_MAX2 ( ty * tiles->len, 1 );
+                z0 = MIG_MAX2 ( tz * tiles->len, 1 );
+                x1 = MIG_MIN2 ( ( tx + 1 ) * tiles->len, w - 1 );
+                y1 = MIG_MIN2 ( ( ty + 1 ) * tiles->len, h - 1 );
+                z1 = MIG_MIN2 ( ( tz + 1 ) * tiles->len, z - 1 );
+
+                _conv_sobel_3d_box ( data, dx, w, h, z, _so_3d_x, x0, x1, y0, y1, z0, z1 );
+                _conv_sobel_3d_box ( data, dy, w, h, z, _so_3d_y, x0, x1, y0, y1, z0, z1 );
+                _conv_sobel_3d_box ( data, dz, w, h, z, _so_3d_z, x0, x1, y0, y1, z0, z1 );
+
+                for ( k = z0; k < z1; ++k )
+                {
+                    for ( j = y0; j < y1; ++j )
+                    {
+                        idx = x0 + j * w + k * w * h;
+                        for ( i = x0; i < x1; ++i, ++idx )
+                            _norm_sobel_3d ( dx + idx, dy + idx, dz + idx, dmag + idx, thr );
+                    }
+                }
+            }
         }
     }
 }
@@ -213,17 +254,25 @@ mig_im_drv_2d_central_diffs ( float *data , int w , int h , float *dx , float *d
 
 static void
 _conv_sobel_3d ( float *in, float *out, int w, int h, int z, float *ker )
+{
+    _conv_sobel_3d_box ( in, out, w, h, z, ker, 1, w - 1, 1, h - 1, 1, z - 1 );
+}
+
+
+static void
+_conv_sobel_3d_box ( float *in, float *out, int w, int h, int z, float *ker,
+                     int x0, int x1, int y0, int y1, int z0, int z1 )
 {
     int i, j, k, l, m, n;
 
     /* center kernel */
     ker += 13;
 
-    for ( k = 1; k < z - 1; ++k )
+    for ( k = z0; k < z1; ++k )
     {
-        for ( j = 1; j < h - 1; ++j )
+        for ( j = y0; j < y1; ++j )
         {
-            for ( i = 1; i < w - 1; ++i )
+            for ( i = x0; i < x1; ++i )
             {
                 for ( n = -1; n <= 1; ++n )
                 {
@@ -240,3 +289,24 @@ _conv_sobel_3d ( float *in, float *out, int w, int h, int z, float *ker )
         }
     }
 }
+
+
+static void
+_norm_sobel_3d ( float *dx, float *dy, float *dz, float *dmag, float thr )
+{
+    *dmag = sqrtf ( MIG_POW2 ( *dx ) + MIG_POW2 ( *dy ) + MIG_POW2 ( *dz ) );
+
+    if ( *dmag > thr )
+    {
+        *dx /= *dmag;
+        *dy /= *dmag;
+        *dz /= *dmag;
+    }
+    else
+    {
+        *dmag = 0.0f;
+        *dx = 0.0f;
+        *dy = 0.0f;
+        *dz = 0.0f;
+    }
+}
@@ -17,6 +17,8 @@
 #include "mig_data_types.h"
 #include "mig_error_codes.h"
 
+#include "mig_im_tile.h"
+
 MIG_C_LINKAGE_START
 
 /*
@@ -55,6 +57,36 @@ extern void
 mig_im_sobel_3d ( float *data, int w, int h, int z, float *dx, float *dy, float *dz,
 				 float *dmag, float thr );
 
+/*
+******************************************************************************
+*               3D SOBEL DERIVATIVE RESTRICTED TO TILES
+*
+* Description : Same as mig_im_sobel_3d but only voxels lying inside active
+*               tiles are processed. All other outputs are zero.
+*
+* Arguments   : data  - input 3D signal
+*               w     - input signal width
+*               h     - input signal height
+*               z     - input signal z
+*               dx    - preallocated. Output dx
+*               dy    - preallocated. Output dy
+*               dz    - preallocated. Output dz
+*               dmag  - preallocated. Output gradient magnitude
+*               thr   - threshold for gradient magnitude.
+*               tiles - active tiles
+*
+* Returns     :
+*
+* Notes       : result equals mig_im_sobel_3d when tiles cover every voxel
+*               lying within one voxel of non zero data
+*
+******************************************************************************
+*/
+
+extern void
+mig_im_sobel_3d_tiles ( float *data, int w, int h, int z, float *dx, float *dy, float *dz,
+				 float *dmag, float thr, const mig_im_tiles_t *tiles );
+
 
 
 
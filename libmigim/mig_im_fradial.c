@@ -13,6 +13,7 @@
 #include "mig_im_drv.h"
 #include "mig_im_gauss.h"
 #include "mig_im_regc.h"
+#include "mig_im_tile.h"
 
 
 //#define FR_NPARTS 4
@@ -59,6 +60,184 @@ extern "C" {
 #define NSIGMA_THR 1.f
 #define THR_BOX_RADIUS 15
 
+/* gaussian smoothing restricted to tiles ignores voxels farther than
+   GAUSS_TILE_NSIGMA sigmas from non zero input */
+#define GAUSS_TILE_NSIGMA 5.0f
+
+/* 16 bit fixed point gradient scales : directions are in [-1,1] and
+   sobel magnitude on [0,1] input stays below 1 */
+#define FR_FIXED_DIR_SCALE 32767.0f
+#define FR_FIXED_MAG_SCALE 65535.0f
+
+/* validation : float candidate with no reduced precision candidate
+   closer than this ( voxels ) is unmatched */
+#define FR_VALIDATE_MATCH_DIST 2.0f
+
+/* refinement window granularity of coarse radii when mask tiles are off */
+#define FR_COARSE_TILE_LEN 16
+
+/*
+******************************************************************************
+*                       FAST RADIAL RESPONSES ON 3D STACK
+*
+* Description : This function converts input to [0,1] float and performs
+*               fast radial filtering on overlapping z partitions.
+*
+* Arguments   : Input      - input signal
+*               w          - input signal width
+*               h          - input signal height
+*               z          - input signal z
+*               FastRadial - prepared fast radial structure
+*               precision  - storage precision of intermediate buffers
+*
+* Returns     : fast radial responses on success ( must be freed )
+*               NULL on error
+*
+******************************************************************************
+*/
+
+static float*
+_fradial_3d_response ( unsigned short *Input ,
+                       int w , int h , int z ,
+                       mig_fradial_t *FastRadial ,
+                       FrPrecision precision );
+
+/*
+******************************************************************************
+*                       FAST RADIAL REGIONS ON 3D STACK
+*
+* Description : This function thresholds fast radial responses and builds
+*               the list of 3D connected components' centroids.
+*
+* Arguments   : Buffer     - fast radial responses ( overwritten )
+*               w          - input signal width
+*               h          - input signal height
+*               z          - input signal z
+*               FastRadial - prepared fast radial structure
+*               dump       - dump responses to disk
+*               Regions    - found regions
+*
+* Returns     : 0 on success
+*               -1 on error
+*
+******************************************************************************
+*/
+
+static int
+_fradial_3d_regions ( float *Buffer ,
+                      int w , int h , int z ,
+                      mig_fradial_t *FastRadial ,
+                      int dump ,
+                      mig_lst_t *Regions );
+
+/*
+******************************************************************************
+*                       FAST RADIAL ON Z PARTITIONS
+*
+* Description : This function performs fast radial filtering with the given
+*               radii on overlapping z partitions of the input stack and
+*               stores unnormalized weighted responses.
+*
+* Arguments   : in_float   - [0,1] float input
+*               Buffer     - output responses ( w * h * z )
+*               w          - input signal width
+*               h          - input signal height
+*               z          - input signal z
+*               radii      - sorted radii
+*               num_radii  - number of radii
+*               first      - first radius adding its response
+*               FastRadial - prepared fast radial structure
+*               tile_len   - mask tiles side ( 0 -> off )
+*               precision  - storage precision of gradient buffers
+*
+* Returns     : 0 on success
+*               -1 on error
+*
+******************************************************************************
+*/
+
+static int
+_radial_3d_parts ( float *in_float , float *Buffer ,
+                   int w , int h , int z ,
+                   float *radii , int num_radii , int first ,
+                   mig_fradial_t *FastRadial ,
+                   int tile_len , FrPrecision precision );
+
+/*
+******************************************************************************
+*                       COARSE TO FINE FAST RADIAL FOR LARGE RADII
+*
+* Description : This function runs large radii on a downsampled pyramid
+*               level first. Smaller radii are processed too as their votes
+*               accumulate into the projections used by large radii. Tiles holding strong coarse responses are
+*               then refined at full resolution and their unnormalized
+*               responses are added to Buffer. Elsewhere large radii do
+*               not contribute.
+*
+* Arguments   : in_float   - [0,1] float input
+*               Buffer     - responses to update ( w * h * z )
+*               w          - input signal width
+*               h          - input signal height
+*               z          - input signal z
+*               radii      - all sorted radii
+*               num_radii  - number of radii
+*               first      - first large radius
+*               FastRadial - prepared fast radial structure
+*               precision  - storage precision of gradient buffers
+*
+* Returns     : 0 on success
+*               -1 on error
+*
+******************************************************************************
+*/
+
+static int
+_radial_3d_coarse ( float *in_float , float *Buffer ,
+                    int w , int h , int z ,
+                    float *radii , int num_radii , int first ,
+                    mig_fradial_t *FastRadial ,
+                    FrPrecision precision );
+
+/*
+******************************************************************************
+*                       DOWNSAMPLE 3D STACK
+*
+* Description : This function averages sc x sc x sc blocks of src. dst
+*               must hold ceil(w/sc) * ceil(h/sc) * ceil(z/sc) voxels.
+*
+******************************************************************************
+*/
+
+static void
+_downsample_3d ( const float *src , int w , int h , int z , float *dst , int sc );
+
+/*
+******************************************************************************
+*                       VALIDATE REDUCED PRECISION RESPONSES
+*
+* Description : This function runs float fast radial path and compares
+*               responses and candidates with the reduced precision ones.
+*               Results are stored in FastRadial->val.
+*
+* Arguments   : Input      - input signal
+*               w          - input signal width
+*               h          - input signal height
+*               z          - input signal z
+*               FastRadial - prepared fast radial structure
+*               Response   - reduced precision responses
+*
+* Returns     : 0 on success
+*               -1 on error
+*
+******************************************************************************
+*/
+
+static int
+_fradial_3d_validate ( unsigned short *Input ,
+                       int w , int h , int z ,
+                       mig_fradial_t *FastRadial ,
+                       const float *Response );
+
 /*
 ******************************************************************************
 *                       DUMP ARRAY TO DISK
@@ -110,9 +289,89 @@ _dump_to_disk ( const char *name , const float *data , int w , int h , int z );
 
 static void
 _proj_3d ( float *dx , float *dy , float *dz , float *dmag ,
-           float *o , float *m , float radius ,
+           float *o , float *m , float radius , float radius_z ,
            int w , int h , int z );
 
+/*
+******************************************************************************
+*                       MAGNITUDE AND ORIENTATION PROJECTIONS IN 3D ON TILES
+*
+* Description : Same as _proj_3d but only voxels of active tiles with non
+*               zero gradient vote. Gradient must be zero outside tiles.
+*
+******************************************************************************
+*/
+
+static void
+_proj_3d_tiles ( float *dx , float *dy , float *dz , float *dmag ,
+                 float *o , float *m , float radius , float radius_z ,
+                 int w , int h , int z , const mig_im_tiles_t *tiles );
+
+/*
+******************************************************************************
+*                       MAGNITUDE AND ORIENTATION PROJECTIONS FROM 16 BITS
+*
+* Description : Same as _proj_3d_tiles but gradient is read from a packed
+*               16 bit buffer holding dx , dy , dz , dmag of every voxel.
+*
+* Arguments   : g     - packed gradient
+*               lut   - half float decoding table ( NULL -> fixed point )
+*               tiles - active tiles ( NULL -> whole volume )
+*
+******************************************************************************
+*/
+
+static void
+_proj_3d_16 ( const Mig16u *g , const float *lut ,
+              float *o , float *m , float radius , float radius_z ,
+              int w , int h , int z , const mig_im_tiles_t *tiles );
+
+/*
+******************************************************************************
+*                       GRADIENT ON ANISOTROPIC GRID
+*
+* Description : This function turns sobel gradients computed in voxel units
+*               into physical gradients expressed in in-plane voxel units :
+*               z derivative is divided by z_ratio , directions are made
+*               unit again and magnitudes rescaled accordingly.
+*
+* Arguments   : dx , dy , dz , dmag - sobel output , modified in place
+*               dim                 - number of voxels
+*               z_ratio             - z voxel size / in-plane voxel size
+*
+******************************************************************************
+*/
+
+static void
+_grad_aniso_3d ( float *dx , float *dy , float *dz , float *dmag ,
+                 int dim , float z_ratio );
+
+/*
+******************************************************************************
+*                       PACK GRADIENT IN 16 BITS
+*
+* Description : This function interleaves dx , dy , dz and dmag of every
+*               voxel as half floats or 16 bit fixed point values.
+*
+******************************************************************************
+*/
+
+static void
+_pack_grad_3d ( const float *dx , const float *dy , const float *dz , const float *dmag ,
+                Mig16u *g , int dim , FrPrecision precision );
+
+/*
+******************************************************************************
+*                       FLOAT <-> HALF FLOAT CONVERSION
+******************************************************************************
+*/
+
+static Mig16u
+_flt2half ( float val );
+
+static float
+_half2flt ( Mig16u val );
+
 /*
 ******************************************************************************
 *                       MAGNITUDE AND ORIENTATION PROJECTIONS IN 2D
@@ -204,18 +463,32 @@ _f_2d ( float *o , float *m , float *f , float radius , int w , int h );
 *               z         - signals z.
 *               radii     - input array of radii ( radial distances ).
 *               num_radii - input number of radii inside radii array.
+*               first     - radii before this one only vote : projections
+*                           accumulate over radii but no response is added.
+*               beta      - gradient magnitude threshold.
+*               num_threads - threads used by gaussian smoothing.
+*               tile_len  - side of tiles used to skip voxels far from
+*                           non zero input ( 0 -> whole volume ).
+*               precision - storage precision of gradient buffers.
+*               z_ratio   - z voxel size / in-plane voxel size , radii are
+*                           in in-plane voxels.
 *
 * Returns     : 0 on success
 *               -1 on error
 *
-* Notes       :
+* Notes       : out holds weighted responses summed over radii ( not
+*               divided by number of radii nor thresholded ).
+*               With tiles gaussian tails are truncated at GAUSS_TILE_NSIGMA
 *
 ******************************************************************************
 */
 
 static int
 _radial_3d ( float *in , float *out , int w , int h , int z ,
-			float *radii , int num_radii , float beta);
+			float *radii , int num_radii , int first , float beta , int num_threads ,
+			int tile_len , FrPrecision precision , float z_ratio );
+
+#if defined(MATLAB_RADIAL)
 
 /*
 ******************************************************************************
@@ -241,6 +514,56 @@ _radial_3d ( float *in , float *out , int w , int h , int z ,
 static int
 _radial_2d ( float *in , float *out , int w , int h , float *radii , int num_radii );
 
+#endif /* MATLAB_RADIAL */
+
+/*
+******************************************************************************
+*                       FAST RADIAL FILTERING ON SCRATCH BUFFERS
+*
+* Description : This function performs fast radial filtering on input signal
+*               using caller provided scratch buffers.
+*
+* Arguments   : in        - input signal.
+*               out       - output filtered signal.
+*               w         - signals width.
+*               h         - signals height.
+*               radii     - input array of radii ( radial distances ).
+*               num_radii - input number of radii inside radii array.
+*               buf       - scratch buffers large enough for w x h.
+*
+* Returns     : 0 on success
+*               -1 if buf is too small
+*
+* Notes       : _radial_2d ( matlab only ) is this function on temporary buffers.
+*
+******************************************************************************
+*/
+
+static int
+_radial_2d_buf ( float *in , float *out , int w , int h ,
+                 float *radii , int num_radii , mig_fradial_buf_t *buf );
+
+/*
+******************************************************************************
+*                       ALLOCATE 2D SCRATCH BUFFERS
+*
+* Description : This function allocates scratch buffers for 2d fast radial
+*               filtering of images up to w x h with the given radii.
+*
+* Arguments   : w         - max image width.
+*               h         - max image height.
+*               radii     - input array of radii ( ascending ).
+*               num_radii - input number of radii inside radii array.
+*
+* Returns     : scratch buffers on success
+*               NULL on error
+*
+******************************************************************************
+*/
+
+static mig_fradial_buf_t*
+_fradial_buf_alloc ( int w , int h , float *radii , int num_radii );
+
 /*
 ******************************************************************************
 *                       MAXIMUM VALUE
@@ -275,6 +598,15 @@ mig_im_fradial_get ( float *radii , int num_radii , float threshold , ThresholdT
     FastRadial->threshold = threshold;
     FastRadial->thr_type = type;
 	FastRadial->beta_threshold = beta_thr;
+    FastRadial->num_threads = 1;
+    FastRadial->tile_len = 0;
+    FastRadial->precision = FR_PRECISION_FLOAT;
+    FastRadial->validate = 0;
+    FastRadial->coarse_radius = 0.0f;
+    FastRadial->coarse_scale = 2;
+    FastRadial->coarse_threshold = 0.1f;
+    FastRadial->z_ratio = 1.0f;
+    FastRadial->merge_distance = 0.0f;
 
     return FastRadial;
 }
@@ -392,110 +724,326 @@ mig_im_fradial_3d ( unsigned short *Input ,
                     mig_lst_t *Regions )
 {
     int rc = 0;
-	float *in_float;
     float *Buffer;
-	float *BufferFR;
-    float MaxResponse = 0.0f;
-    char fname[MAX_PATH];
-    float thr;
 
-	int z_part = 0;
-	int z_overlap = 0;
-	int z_part_overlap = 0;
-	//int nparts = FR_NPARTS;
-	int nparts = z / FR_MAXSLICEPERPART + 1;
-	int ipart = 0;
+    /* perform fast radial processing */
+    Buffer = _fradial_3d_response ( Input , w , h , z , FastRadial , FastRadial->precision );
+    if ( Buffer == NULL )
+        return -1;
 
-	int partoffset = 0;
+    /* compare reduced precision path against float path if asked to */
+    if ( ( FastRadial->validate == 1 ) &&
+         ( FastRadial->precision != FR_PRECISION_FLOAT ) )
+    {
+        rc = _fradial_3d_validate ( Input , w , h , z , FastRadial , Buffer );
+        if ( rc != 0 )
+        {
+            free ( Buffer );
+            return -1;
+        }
+    }
 
-	/* allocate buffer for float conversion */
-	in_float = (float*) calloc ( w * h * z , sizeof(float) );
-    if ( in_float == NULL )
-        return -1;
+    /* threshold responses and extract regions */
+    rc = _fradial_3d_regions ( Buffer , w , h , z , FastRadial , FastRadial->dump , Regions );
 
-    /* allocate 1 intermediate buffer for processing */
-    Buffer = (float*) calloc ( w * h * z , sizeof(float) );
-    if ( Buffer == NULL )
-	{
-		free (in_float);
-        return -1;
-	}
+    free ( Buffer );
+    return rc;
+}
 
-	/*convert to [0,1] float*/
-	mig_im_util_conv_16u_32f ( Input, in_float, w * h * z );
-	mig_im_util_mat2gray_32f ( in_float, w * h * z , 0.f , (float) MIG_MAX_16U );
-	
-	/* partitioning */
-	z_part = (z / nparts);
-	z_overlap = 2 * FastRadial->radii[FastRadial->num_radii-1];
-	
 
-	for ( ipart = 0; ipart < nparts; ++ipart )
-	{
-	
-		/*handle rounding: add the needed elements to the last partition*/
-		if (ipart == nparts -1 )
-		{
-			z_part = z_part + (z - nparts * z_part );
-		}
 
-		/* this should suffice for correct buffer handling */
-		if (nparts > 1)
-		{
-			z_part_overlap = (ipart == 0 || ipart == nparts-1)?
-				z_part + z_overlap :
-				z_part + 2 * z_overlap;
-		}
-		else
-		{
-			z_part_overlap = z_part;
-		}
 
-		/* allocate 1 intermediate buffer for processing */
-		BufferFR = (float*) calloc ( w * h * z_part_overlap , sizeof(float) );
-		if ( BufferFR == NULL )
-		{
-			free ( Buffer );
-			free ( in_float );
-			return -1;
+/****************************************************************************/
 
-		}
-		
-		/* perform fast radial processing */
+int
+mig_im_fradial_2d ( float *Input , int w , int h , mig_fradial_t *FastRadial , mig_lst_t *Regions )
+{
+        mig_fradial_buf_t *Buf;
+        int rc;
 
-		
-		if ( ipart == 0 )
-		{
-			rc = _radial_3d ( in_float ,
-				  BufferFR , w , h , z_part_overlap ,
-				  FastRadial->radii , FastRadial->num_radii, FastRadial->beta_threshold );
-		}
-		else 
-		{
-			rc = _radial_3d ( in_float + (w * h * ( partoffset - z_overlap) ) ,
-				  BufferFR , w , h , z_part_overlap ,
-				  FastRadial->radii , FastRadial->num_radii, FastRadial->beta_threshold );
-			
-		}
+        /* scratch buffers for this image only */
+        Buf = mig_im_fradial_buf_get ( w , h , FastRadial );
+        if ( Buf == NULL )
+                return -1;
 
-		if ( rc != 0 )
-		{
-			free ( Buffer );
-			free ( BufferFR );
-			free ( in_float );
-			return -1;
-		}
+        rc = mig_im_fradial_2d_buf ( Input , w , h , FastRadial , Buf , Regions );
 
-		/* copy to buffer */
-		if ( ipart == 0 )
-		{
-			/*starts from 0 */
-			memcpy ( Buffer, BufferFR ,
-				(w * h * z_part) * sizeof (float) );
-		}
-		else
-		{
-			/*skip overlap */
+        mig_im_fradial_buf_del ( Buf );
+        return rc;
+}
+
+/****************************************************************************/
+
+int
+mig_im_fradial_2d_buf ( float *Input , int w , int h ,
+                        mig_fradial_t *FastRadial ,
+                        mig_fradial_buf_t *Buf ,
+                        mig_lst_t *Regions )
+{
+        int rc = 0;
+        float *Buffer = Buf->tmp;
+        float MaxResponse = 0.0f;
+        char fname[MAX_PATH];
+        float thr;
+
+        /* perform 1st fast radial processing */
+        rc = _radial_2d_buf ( Input , Buffer , w , h , FastRadial->radii , FastRadial->num_radii , Buf );
+        if ( rc != 0 )
+                return -1;
+
+        /* perform 2nd fast radial processing */
+        rc = _radial_2d_buf ( Buffer, Input , w , h , FastRadial->radii , FastRadial->num_radii , Buf );
+        if ( rc != 0 )
+                return -1;
+
+        /* dump fast radial result if asked to */
+        if ( FastRadial->dump == 1 )
+        {
+            snprintf ( fname , MAX_PATH , "%s_res" , FastRadial->prefix );
+            rc = _dump_to_disk ( fname , Input , w , h , 1 );
+        }
+
+        if ( FastRadial->thr_type == PERCENT )
+        {
+            /* find maximum response of fast radial filter */
+            _find_max ( Input , w * h , &MaxResponse );
+
+            if ( MaxResponse == 0.0f )
+                return 0;
+
+            thr = FastRadial->threshold * MaxResponse;
+        }
+        else
+        {
+            thr = FastRadial->threshold;
+        }
+
+        /* binarize fast radial responses */
+        mig_im_thr_32f_i_val ( Input , w * h , thr );
+
+        /* dump thresholded fast radial result if asked to */
+        if ( FastRadial->dump == 1 )
+        {
+            snprintf ( fname , MAX_PATH , "%s_thr" , FastRadial->prefix );
+            rc = _dump_to_disk ( fname , Input , w , h , 1 );
+        }
+
+        /* construct 3d regions from binarized volume */
+        rc = mig_im_regc_2d ( Input , w , h , Regions );
+        if ( rc != 0 )
+                return -1;
+
+        return 0;
+}
+
+/****************************************************************************/
+
+mig_fradial_buf_t*
+mig_im_fradial_buf_get ( int w , int h , const mig_fradial_t *FastRadial )
+{
+        return _fradial_buf_alloc ( w , h , FastRadial->radii , FastRadial->num_radii );
+}
+
+/****************************************************************************/
+
+void
+mig_im_fradial_buf_del ( mig_fradial_buf_t *Buf )
+{
+        if ( Buf == NULL )
+                return;
+
+        if ( Buf->tmp )
+                free ( Buf->tmp );
+        if ( Buf->dx )
+                free ( Buf->dx );
+        if ( Buf->dy )
+                free ( Buf->dy );
+        if ( Buf->dmag )
+                free ( Buf->dmag );
+        if ( Buf->f )
+                free ( Buf->f );
+        if ( Buf->s )
+                free ( Buf->s );
+        if ( Buf->o )
+                free ( Buf->o );
+        if ( Buf->m )
+                free ( Buf->m );
+
+        free ( Buf );
+}
+
+/****************************************************************************/
+
+void
+mig_im_fradial_del ( mig_fradial_t *FastRadial )
+{
+        if ( FastRadial != NULL )
+                free ( FastRadial );
+}
+
+/*
+******************************************************************************
+*               LOCAL PROTOTYPES IMPLEMENTATION
+******************************************************************************
+*/
+
+static float*
+_fradial_3d_response ( unsigned short *Input ,
+                       int w , int h , int z ,
+                       mig_fradial_t *FastRadial ,
+                       FrPrecision precision )
+{
+    int rc = 0;
+    int i , nf;
+	float *in_float;
+    float *Buffer;
+
+	/* allocate buffer for float conversion */
+	in_float = (float*) calloc ( w * h * z , sizeof(float) );
+    if ( in_float == NULL )
+        return NULL;
+
+    /* allocate 1 intermediate buffer for processing */
+    Buffer = (float*) calloc ( w * h * z , sizeof(float) );
+    if ( Buffer == NULL )
+	{
+		free (in_float);
+        return NULL;
+	}
+
+	/*convert to [0,1] float*/
+	mig_im_util_conv_16u_32f ( Input, in_float, w * h * z );
+	mig_im_util_mat2gray_32f ( in_float, w * h * z , 0.f , (float) MIG_MAX_16U );
+
+    /* radii are sorted : split them in full resolution and coarse ones */
+    nf = FastRadial->num_radii;
+    if ( FastRadial->coarse_radius > 0.0f && FastRadial->coarse_scale > 1 )
+    {
+        for ( nf = 0 ; nf < FastRadial->num_radii ; ++nf )
+            if ( FastRadial->radii[nf] >= FastRadial->coarse_radius )
+                break;
+    }
+
+    if ( nf > 0 )
+    {
+        rc = _radial_3d_parts ( in_float , Buffer , w , h , z ,
+                                FastRadial->radii , nf , 0 ,
+                                FastRadial , FastRadial->tile_len , precision );
+    }
+
+    if ( rc == 0 && nf < FastRadial->num_radii )
+    {
+        rc = _radial_3d_coarse ( in_float , Buffer , w , h , z ,
+                                 FastRadial->radii , FastRadial->num_radii , nf ,
+                                 FastRadial , precision );
+    }
+
+	free ( in_float );
+
+    if ( rc != 0 )
+    {
+        free ( Buffer );
+        return NULL;
+    }
+
+    /* final result : mean weighted response over all radii */
+    for ( i = 0 ; i < w * h * z ; ++i )
+        Buffer[i] = ( Buffer[i] < MIG_EPS_32F ) ? 0.0f : Buffer[i] / FastRadial->num_radii;
+
+    return Buffer;
+}
+
+/****************************************************************************/
+
+static int
+_radial_3d_parts ( float *in_float , float *Buffer ,
+                   int w , int h , int z ,
+                   float *radii , int num_radii , int first ,
+                   mig_fradial_t *FastRadial ,
+                   int tile_len , FrPrecision precision )
+{
+    int rc = 0;
+	float *BufferFR;
+
+	int z_part = 0;
+	int z_overlap = 0;
+	int z_part_overlap = 0;
+	//int nparts = FR_NPARTS;
+	int nparts = z / FR_MAXSLICEPERPART + 1;
+	int ipart = 0;
+
+	int partoffset = 0;
+
+	/* partitioning */
+	z_part = (z / nparts);
+	z_overlap = 2 * radii[num_radii-1];
+
+	/* thin slices : votes reach further in z voxels */
+	if ( FastRadial->z_ratio < 1.0f )
+		z_overlap = (int) ceilf ( z_overlap / FastRadial->z_ratio );
+	
+
+	for ( ipart = 0; ipart < nparts; ++ipart )
+	{
+	
+		/*handle rounding: add the needed elements to the last partition*/
+		if (ipart == nparts -1 )
+		{
+			z_part = z_part + (z - nparts * z_part );
+		}
+
+		/* this should suffice for correct buffer handling */
+		if (nparts > 1)
+		{
+			z_part_overlap = (ipart == 0 || ipart == nparts-1)?
+				z_part + z_overlap :
+				z_part + 2 * z_overlap;
+		}
+		else
+		{
+			z_part_overlap = z_part;
+		}
+
+		/* allocate 1 intermediate buffer for processing */
+		BufferFR = (float*) calloc ( w * h * z_part_overlap , sizeof(float) );
+		if ( BufferFR == NULL )
+			return -1;
+		
+		/* perform fast radial processing */
+
+		
+		if ( ipart == 0 )
+		{
+			rc = _radial_3d ( in_float ,
+				  BufferFR , w , h , z_part_overlap ,
+				  radii , num_radii, first , FastRadial->beta_threshold ,
+				  FastRadial->num_threads , tile_len , precision , FastRadial->z_ratio );
+		}
+		else 
+		{
+			rc = _radial_3d ( in_float + (w * h * ( partoffset - z_overlap) ) ,
+				  BufferFR , w , h , z_part_overlap ,
+				  radii , num_radii, first , FastRadial->beta_threshold ,
+				  FastRadial->num_threads , tile_len , precision , FastRadial->z_ratio );
+			
+		}
+
+		if ( rc != 0 )
+		{
+			free ( BufferFR );
+			return -1;
+		}
+
+		/* copy to buffer */
+		if ( ipart == 0 )
+		{
+			/*starts from 0 */
+			memcpy ( Buffer, BufferFR ,
+				(w * h * z_part) * sizeof (float) );
+		}
+		else
+		{
+			/*skip overlap */
 			memcpy ( Buffer + w * h * ( partoffset ),
 				BufferFR + w * h * z_overlap,
 				(w * h * z_part) * sizeof (float) );
@@ -508,8 +1056,204 @@ mig_im_fradial_3d ( unsigned short *Input ,
 
 	}/* end partitioning */
 
+    return 0;
+}
+
+/****************************************************************************/
+
+static int
+_radial_3d_coarse ( float *in_float , float *Buffer ,
+                    int w , int h , int z ,
+                    float *radii , int num_radii , int first ,
+                    mig_fradial_t *FastRadial ,
+                    FrPrecision precision )
+{
+    int rc = -1;
+    int i , j , k , n;
+    int sc = FastRadial->coarse_scale;
+    int cw , ch , cz;                    /* pyramid level size */
+    int tile_len , margin;
+    float maxr , thr;
+    float *coarse_in = NULL;
+    float *coarse_out = NULL;
+    float *coarse_radii = NULL;
+    float *masked = NULL;
+    float *refined = NULL;
+    mig_im_tiles_t *roi = NULL;          /* tiles where coarse radii are refined */
+    mig_im_tiles_t *tmp = NULL;
+    mig_im_tiles_t *support = NULL;      /* input needed to refine roi tiles */
+    float *pi , *po;
+
+    maxr = radii[num_radii-1];
+    tile_len = ( FastRadial->tile_len > 0 ) ? FastRadial->tile_len : FR_COARSE_TILE_LEN;
+
+    /* 1. coarse level : downsampled input and radii */
+    cw = ( w + sc - 1 ) / sc;
+    ch = ( h + sc - 1 ) / sc;
+    cz = ( z + sc - 1 ) / sc;
+
+    coarse_in = (float*) malloc ( cw * ch * cz * sizeof(float) );
+    coarse_out = (float*) malloc ( cw * ch * cz * sizeof(float) );
+    coarse_radii = (float*) malloc ( num_radii * sizeof(float) );
+    if ( coarse_in == NULL || coarse_out == NULL || coarse_radii == NULL )
+        goto error;
+
+    _downsample_3d ( in_float , w , h , z , coarse_in , sc );
+
+    for ( n = 0 ; n < num_radii ; ++n )
+        coarse_radii[n] = radii[n] / sc;
+
+    /* coarse level is small enough to skip partitioning */
+    if ( _radial_3d ( coarse_in , coarse_out , cw , ch , cz ,
+                      coarse_radii , num_radii , first , FastRadial->beta_threshold ,
+                      FastRadial->num_threads , tile_len , precision , FastRadial->z_ratio ) != 0 )
+        goto error;
+
+    /* 2. refinement windows : tiles holding strong coarse responses */
+    _find_max ( coarse_out , cw * ch * cz , &thr );
+    thr *= FastRadial->coarse_threshold;
+
+    for ( i = 0 ; i < cw * ch * cz ; ++i )
+        coarse_out[i] = ( coarse_out[i] > thr && coarse_out[i] > MIG_EPS_32F ) ? 1.0f : 0.0f;
+
+    /* upsample mask over a zeroed full resolution buffer */
+    masked = (float*) calloc ( w * h * z , sizeof(float) );
+    if ( masked == NULL )
+        goto error;
+
+    for ( k = 0 ; k < z ; ++k )
+        for ( j = 0 ; j < h ; ++j )
+            for ( i = 0 ; i < w ; ++i )
+                masked[i+j*w+k*w*h] = coarse_out[(i/sc)+(j/sc)*cw+(k/sc)*cw*ch];
+
+    tmp = mig_im_tiles_get_32f ( masked , w , h , z , tile_len );
+    if ( tmp == NULL )
+        goto error;
+
+    /* blobs extend up to largest radius around their strong core ,
+       tiles are cubic in voxels : thin slices need a wider margin */
+    if ( FastRadial->z_ratio < 1.0f )
+        maxr /= FastRadial->z_ratio;
+
+    roi = mig_im_tiles_dilate ( tmp , (int) ceilf ( maxr ) );
+    if ( roi == NULL )
+        goto error;
+
+    if ( roi->num_on == 0 )
+    {
+        rc = 0;
+        goto error;
+    }
+
+    /* votes come from up to maxr away and gaussian spreads them further :
+       input outside this margin can not reach roi tiles */
+    margin = (int) ceilf ( maxr + GAUSS_TILE_NSIGMA * 0.25f * maxr );
+    support = mig_im_tiles_dilate ( roi , margin );
+    if ( support == NULL )
+        goto error;
+
+    /* 3. full resolution coarse radii on support tiles only : restricted
+       processing follows non zero input */
+    for ( k = 0 ; k < z ; ++k )
+    {
+        for ( j = 0 ; j < h ; ++j )
+        {
+            pi = in_float + j * w + k * w * h;
+            po = masked + j * w + k * w * h;
+
+            for ( i = 0 ; i < w ; ++i )
+                po[i] = MIG_IM_TILE_ON ( support , i / tile_len , j / tile_len , k / tile_len ) ? pi[i] : 0.0f;
+        }
+    }
+
+    refined = (float*) calloc ( w * h * z , sizeof(float) );
+    if ( refined == NULL )
+        goto error;
+
+    if ( _radial_3d_parts ( masked , refined , w , h , z , radii , num_radii , first ,
+                            FastRadial , tile_len , precision ) != 0 )
+        goto error;
+
+    /* add refined responses inside roi tiles only */
+    for ( k = 0 ; k < z ; ++k )
+        for ( j = 0 ; j < h ; ++j )
+            for ( i = 0 ; i < w ; ++i )
+                if ( MIG_IM_TILE_ON ( roi , i / tile_len , j / tile_len , k / tile_len ) )
+                    Buffer[i+j*w+k*w*h] += refined[i+j*w+k*w*h];
+
+    rc = 0;
+
+error :
+
+    if ( coarse_in )
+        free ( coarse_in );
+    if ( coarse_out )
+        free ( coarse_out );
+    if ( coarse_radii )
+        free ( coarse_radii );
+    if ( masked )
+        free ( masked );
+    if ( refined )
+        free ( refined );
+
+    mig_im_tiles_del ( tmp );
+    mig_im_tiles_del ( roi );
+    mig_im_tiles_del ( support );
+
+    return rc;
+}
+
+/****************************************************************************/
+
+static void
+_downsample_3d ( const float *src , int w , int h , int z , float *dst , int sc )
+{
+    int i , j , k , l , m , n;
+    int cw , ch , cz;
+    int cnt;
+    float sum;
+
+    cw = ( w + sc - 1 ) / sc;
+    ch = ( h + sc - 1 ) / sc;
+    cz = ( z + sc - 1 ) / sc;
+
+    for ( k = 0 ; k < cz ; ++k )
+    {
+        for ( j = 0 ; j < ch ; ++j )
+        {
+            for ( i = 0 ; i < cw ; ++i , ++dst )
+            {
+                /* mean of sc x sc x sc block , clipped at volume border */
+                sum = 0.0f;
+                cnt = 0;
+
+                for ( n = k * sc ; n < MIG_MIN2 ( ( k + 1 ) * sc , z ) ; ++n )
+                    for ( m = j * sc ; m < MIG_MIN2 ( ( j + 1 ) * sc , h ) ; ++m )
+                        for ( l = i * sc ; l < MIG_MIN2 ( ( i + 1 ) * sc , w ) ; ++l , ++cnt )
+                            sum += src[l+m*w+n*w*h];
+
+                *dst = sum / cnt;
+            }
+        }
+    }
+}
+
+/****************************************************************************/
+
+static int
+_fradial_3d_regions ( float *Buffer ,
+                      int w , int h , int z ,
+                      mig_fradial_t *FastRadial ,
+                      int dump ,
+                      mig_lst_t *Regions )
+{
+    int rc = 0;
+    float MaxResponse = 0.0f;
+    char fname[MAX_PATH];
+    float thr;
+
     /* dump fast radial result if asked to */
-    if ( FastRadial->dump == 1 )
+    if ( dump == 1 )
     {
         snprintf ( fname , MAX_PATH , "%s_res" , FastRadial->prefix );
         rc = _dump_to_disk ( fname , Buffer , w , h , z );
@@ -521,11 +1265,7 @@ mig_im_fradial_3d ( unsigned short *Input ,
         _find_max ( Buffer , w * h * z , &MaxResponse );
 
         if ( MaxResponse == 0.0f )
-        {
-            free ( Buffer );
-			free ( in_float );
             return 0;
-        }
 
         thr = FastRadial->threshold * MaxResponse;
     }
@@ -545,10 +1285,13 @@ mig_im_fradial_3d ( unsigned short *Input ,
 	*/
 
 	/* apply mean threshold */
-	mig_im_thr_32f_3d_local_mean ( Buffer, w , h, z, THR_BOX_RADIUS );
+	if ( FastRadial->tile_len > 0 )
+		mig_im_thr_32f_3d_local_mean_tiles ( Buffer, w , h, z, THR_BOX_RADIUS, FastRadial->tile_len );
+	else
+		mig_im_thr_32f_3d_local_mean ( Buffer, w , h, z, THR_BOX_RADIUS );
 	
     /* dump thresholded fast radial result if asked to */
-    if ( FastRadial->dump == 1 )
+    if ( dump == 1 )
     {
         snprintf ( fname , MAX_PATH , "%s_thr" , FastRadial->prefix );
         rc = _dump_to_disk ( fname , Buffer , w , h , z );
@@ -556,151 +1299,174 @@ mig_im_fradial_3d ( unsigned short *Input ,
 
 
     
-	/* TODO: SLOW, we should consider shrinking */
 	/* construct 3d regions from binarized volume */
-	rc = mig_im_regc_3d ( Buffer , w , h , z , Regions );
+	rc = mig_im_regc_3d_mt ( Buffer , w , h , z , Regions , FastRadial->num_threads );
 
 	/* if we want to work on fr masks instead of centroids, 
 		comment previous and uncomment next*/
 	/*just create one region for each pixel "on" */
 	/*rc = mig_im_regc_3d_odd ( Buffer, w, h , z , Regions );*/
     if ( rc != 0 )
-    {
-        free ( Buffer );
-        free ( in_float );
 		return -1;
 
-    }
+    /* neighbouring maxima of the same blob : keep the strongest one only
+       so that later stages see a single candidate */
+    if ( FastRadial->merge_distance > 0.0f &&
+         mig_im_regc_merge_near ( Regions , FastRadial->merge_distance , FastRadial->z_ratio ) < 0 )
+        return -1;
 
-    free ( Buffer );
-	free ( in_float );
     return 0;
 }
 
-
-
-
 /****************************************************************************/
 
-int
-mig_im_fradial_2d ( float *Input , int w , int h , mig_fradial_t *FastRadial , mig_lst_t *Regions )
+static int
+_fradial_3d_validate ( unsigned short *Input ,
+                       int w , int h , int z ,
+                       mig_fradial_t *FastRadial ,
+                       const float *Response )
 {
-        int rc = 0;
-        float *Buffer;
-        float MaxResponse = 0.0f;
-        char fname[MAX_PATH];
-        float thr;
+    int i , dim = w * h * z;
+    int rc = -1;
+    int x , y , k;
+    float d , dmin , dev;
+    float *Reference = NULL;     /* float path responses */
+    float *Buffer = NULL;        /* thresholding scratch */
+    mig_lst_t RefRegions;
+    mig_lst_t RedRegions;
+    mig_lst_node *ItRef , *ItRed;
+    mig_im_region_t *RefReg , *RedReg , *Match;
+
+    mig_lst_zero ( &RefRegions );
+    mig_lst_zero ( &RedRegions );
+
+    memset ( &( FastRadial->val ) , 0x00 , sizeof(mig_fradial_val_t) );
+
+    Reference = _fradial_3d_response ( Input , w , h , z , FastRadial , FR_PRECISION_FLOAT );
+    if ( Reference == NULL )
+        goto error;
 
-        /* allocate intermediate buffer for processing */
-        Buffer = (float*) calloc ( w * h , sizeof(float) );
-        if ( Buffer == NULL )
-                return -1;
+    for ( i = 0 ; i < dim ; ++i )
+    {
+        dev = fabsf ( Reference[i] - Response[i] );
+        if ( dev > FastRadial->val.max_response_dev )
+            FastRadial->val.max_response_dev = dev;
+    }
 
-        /* perform 1st fast radial processing */
-        rc = _radial_2d ( Input , Buffer , w , h , FastRadial->radii , FastRadial->num_radii );
-        if ( rc != 0 )
-        {
-                free ( Buffer );
-                return -1;
-        }
+    /* candidates of both paths : region extraction destroys its input */
+    Buffer = (float*) malloc ( dim * sizeof(float) );
+    if ( Buffer == NULL )
+        goto error;
 
-        /* perform 2nd fast radial processing */
-        rc = _radial_2d ( Buffer, Input , w , h , FastRadial->radii , FastRadial->num_radii );
-        if ( rc != 0 )
-        {
-                free ( Buffer );
-                return -1;
-        }
+    memcpy ( Buffer , Reference , dim * sizeof(float) );
+    if ( _fradial_3d_regions ( Buffer , w , h , z , FastRadial , 0 , &RefRegions ) != 0 )
+        goto error;
 
-        /* dump fast radial result if asked to */
-        if ( FastRadial->dump == 1 )
-        {
-            snprintf ( fname , MAX_PATH , "%s_res" , FastRadial->prefix );
-            rc = _dump_to_disk ( fname , Input , w , h , 1 );
-        }
+    memcpy ( Buffer , Response , dim * sizeof(float) );
+    if ( _fradial_3d_regions ( Buffer , w , h , z , FastRadial , 0 , &RedRegions ) != 0 )
+        goto error;
 
-        if ( FastRadial->thr_type == PERCENT )
-        {
-            /* find maximum response of fast radial filter */
-            _find_max ( Input , w * h , &MaxResponse );
+    FastRadial->val.num_ref = mig_lst_len ( &RefRegions );
+    FastRadial->val.num = mig_lst_len ( &RedRegions );
 
-            if ( MaxResponse == 0.0f )
-            {
-                free ( Buffer );
-                return 0;
-            }
+    /* match every float candidate with nearest reduced precision one */
+    for ( ItRef = RefRegions.head ; ItRef != NULL ; ItRef = ItRef->next )
+    {
+        RefReg = (mig_im_region_t*) ItRef->data;
+        Match = NULL;
+        dmin = 0.0f;
 
-            thr = FastRadial->threshold * MaxResponse;
-        }
-        else
+        for ( ItRed = RedRegions.head ; ItRed != NULL ; ItRed = ItRed->next )
         {
-            thr = FastRadial->threshold;
-        }
+            RedReg = (mig_im_region_t*) ItRed->data;
 
-        /* binarize fast radial responses */
-        mig_im_thr_32f_i_val ( Input , w * h , thr );
+            d = sqrtf ( MIG_POW2 ( RefReg->centroid[0] - RedReg->centroid[0] ) +
+                        MIG_POW2 ( RefReg->centroid[1] - RedReg->centroid[1] ) +
+                        MIG_POW2 ( RefReg->centroid[2] - RedReg->centroid[2] ) );
 
-        /* dump thresholded fast radial result if asked to */
-        if ( FastRadial->dump == 1 )
-        {
-            snprintf ( fname , MAX_PATH , "%s_thr" , FastRadial->prefix );
-            rc = _dump_to_disk ( fname , Input , w , h , 1 );
+            if ( Match == NULL || d < dmin )
+            {
+                Match = RedReg;
+                dmin = d;
+            }
         }
 
-        /* construct 3d regions from binarized volume */
-        rc = mig_im_regc_2d ( Input , w , h , Regions );
-        if ( rc != 0 )
+        if ( Match == NULL || dmin > FR_VALIDATE_MATCH_DIST )
         {
-                free ( Buffer );
-                return -1;
+            ++( FastRadial->val.num_unmatched );
+            continue;
         }
 
-        free ( Buffer );
-        return 0;
-}
+        if ( dmin > FastRadial->val.max_centroid_dev )
+            FastRadial->val.max_centroid_dev = dmin;
 
-/****************************************************************************/
+        /* candidate score is fast radial response at its centroid */
+        x = MIG_MIN2 ( MIG_MAX2 ( (int) floorf ( RefReg->centroid[0] + 0.5f ) , 0 ) , w - 1 );
+        y = MIG_MIN2 ( MIG_MAX2 ( (int) floorf ( RefReg->centroid[1] + 0.5f ) , 0 ) , h - 1 );
+        k = MIG_MIN2 ( MIG_MAX2 ( (int) floorf ( RefReg->centroid[2] + 0.5f ) , 0 ) , z - 1 );
 
-void
-mig_im_fradial_del ( mig_fradial_t *FastRadial )
-{
-        if ( FastRadial != NULL )
-                free ( FastRadial );
+        dev = fabsf ( Reference[x+y*w+k*w*h] - Response[x+y*w+k*w*h] );
+        if ( dev > FastRadial->val.max_score_dev )
+            FastRadial->val.max_score_dev = dev;
+    }
+
+    /* reduced precision candidates with no float counterpart */
+    if ( FastRadial->val.num > FastRadial->val.num_ref - FastRadial->val.num_unmatched )
+        FastRadial->val.num_unmatched += FastRadial->val.num -
+                ( FastRadial->val.num_ref - FastRadial->val.num_unmatched );
+
+    rc = 0;
+
+error :
+
+    mig_lst_free_custom_static ( &RefRegions , free );
+    mig_lst_free_custom_static ( &RedRegions , free );
+
+    if ( Reference )
+        free ( Reference );
+    if ( Buffer )
+        free ( Buffer );
+
+    return rc;
 }
 
-/*
-******************************************************************************
-*               LOCAL PROTOTYPES IMPLEMENTATION
-******************************************************************************
-*/
+/****************************************************************************/
 
 static int
 _radial_3d ( float *in ,
              float *out ,
              int w , int h , int z ,
-             float *radii , int num_radii, float beta )
+             float *radii , int num_radii, int first , float beta , int num_threads ,
+             int tile_len , FrPrecision precision , float z_ratio )
 {
     /* matrix data */
     float *dx = NULL;       /* gradient horizontal direction */
     float *dy = NULL;       /* gradient vertical direction */
     float *dz = NULL;       /* gradient z direction */
     float *dmag = NULL;     /* gradient magnitude */
+    Mig16u *grad16 = NULL;  /* gradient packed in 16 bits ( dx , dy , dz , dmag ) */
+    float *lut = NULL;      /* half float decoding table */
 
     float *o = NULL;        /* orientation projection image */
     float *IdxO;
     float *m = NULL;        /* magnitutde projection image */
     float *IdxM;
     float *f = NULL;
-    float *s = NULL;        /* accumulator for all radii */
+
+    mig_im_tiles_t *grad_tiles = NULL;   /* tiles where gradient may be non zero */
+    mig_im_tiles_t *f_tiles = NULL;      /* tiles where f is non zero */
+    mig_im_tiles_t *gauss_tiles = NULL;  /* tiles reached by gaussian smoothing */
 
     /* other vars */
     float maxr;             /* max input radius */
-    float *idx;
+    float maxrz;            /* max input radius in z voxels */
+    float zs;               /* z / in-plane sizes of tile margins */
     int n;                  /* current radius */
-    int i , j , k;          /* pixel indices */
+    int i;                  /* voxel index */
 	int dim;
 	
 	dim = w * h * z;
+	zs = ( z_ratio < 1.0f ) ? 1.0f / z_ratio : 1.0f;
 
     dx = (float*) malloc ( dim * sizeof(float) );
     if ( dx == NULL )
@@ -721,14 +1487,58 @@ _radial_3d ( float *in ,
     /* calculate 3D gradient */
     //mig_im_drv_3d_central_diffs ( in , w , h , z , dx , dy , dz , dmag );
 	
-	mig_im_sobel_3d ( in, w, h, z, dx, dy, dz, dmag, beta );
+	if ( tile_len > 0 )
+	{
+		/* input is zero outside lung masks : gradient can only be non
+		   zero one voxel away from non zero input */
+		f_tiles = mig_im_tiles_get_32f ( in , w , h , z , tile_len );
+		if ( f_tiles == NULL )
+			goto error;
+
+		grad_tiles = mig_im_tiles_dilate ( f_tiles , 1 );
+		mig_im_tiles_del ( f_tiles );
+		f_tiles = NULL;
+		if ( grad_tiles == NULL )
+			goto error;
+
+		mig_im_sobel_3d_tiles ( in, w, h, z, dx, dy, dz, dmag, beta, grad_tiles );
+	}
+	else
+	{
+		mig_im_sobel_3d ( in, w, h, z, dx, dy, dz, dmag, beta );
+	}
 
+	if ( z_ratio != 1.0f )
+		_grad_aniso_3d ( dx , dy , dz , dmag , dim , z_ratio );
 
-    /* radial filter matrices */
-    s = (float*) malloc ( num_radii * dim * sizeof( float ) );
-    if ( s == NULL )
-        goto error;
+    /* gradient is read once per radius by the voting pass which is
+       memory bound : keep it in 16 bits and release float volumes */
+    if ( precision != FR_PRECISION_FLOAT )
+    {
+        grad16 = (Mig16u*) malloc ( 4 * dim * sizeof(Mig16u) );
+        if ( grad16 == NULL )
+            goto error;
+
+        if ( precision == FR_PRECISION_HALF )
+        {
+            lut = (float*) malloc ( 65536 * sizeof(float) );
+            if ( lut == NULL )
+                goto error;
+
+            for ( i = 0 ; i < 65536 ; ++i )
+                lut[i] = _half2flt ( (Mig16u) i );
+        }
+
+        _pack_grad_3d ( dx , dy , dz , dmag , grad16 , dim , precision );
+
+        free ( dx );
+        free ( dy );
+        free ( dz );
+        free ( dmag );
+        dx = dy = dz = dmag = NULL;
+    }
 
+    /* radial filter matrices */
     f = (float*) malloc ( dim * sizeof(float) );
     if ( f == NULL )
         goto error;
@@ -736,65 +1546,96 @@ _radial_3d ( float *in ,
     /* get maximum input radius and allocate space for orientation and
        magnitude images so that we avoid boundary condition checking */
     maxr = floorf( radii[num_radii-1] + 0.5f );
+    maxrz = MIG_MAX2 ( maxr , floorf( radii[num_radii-1] / z_ratio + 0.5f ) );
 
     o = (float*) calloc ( ( w + 2.0f * maxr ) *
                           ( h + 2.0f * maxr ) *
-                          ( z + 2.0f * maxr ) ,
+                          ( z + 2.0f * maxrz ) ,
                           sizeof(float) );
     if ( o == NULL )
         goto error;
 
     m = (float*) calloc ( ( w + 2.0f * maxr ) *
                           ( h + 2.0f * maxr ) *
-                          ( z + 2.0f * maxr ) ,
+                          ( z + 2.0f * maxrz ) ,
                           sizeof(float) );
     if ( m == NULL )
         goto error;
 
     /* position variables to actual matrix starting positions */
-    IdxO = o + (int)( maxr + maxr * w + maxr * w * h );
-    IdxM = m + (int)( maxr + maxr * w + maxr * w * h );
+    IdxO = o + (int)( maxr + maxr * w + maxrz * w * h );
+    IdxM = m + (int)( maxr + maxr * w + maxrz * w * h );
+
+    /* weighted responses are accumulated radius by radius in out : same
+       summation order as a sum over a stack of per radius responses.
+       Normalization is left to the caller which may add more radii */
+    memset ( out , 0x00 , dim * sizeof( float ) );
 
     /* for each radius */
-    idx = s;
-    for ( n = 0 ; n < num_radii ; ++n , idx += w * h * z )
+    for ( n = 0 ; n < num_radii ; ++n )
     {
-        _proj_3d ( dx , dy , dz , dmag , IdxO , IdxM , radii[n] , w , h , z );
-        _f_3d ( IdxO , IdxM , f , radii[n] , w , h , z );
+        if ( grad16 != NULL )
+            _proj_3d_16 ( grad16 , lut , IdxO , IdxM , radii[n] , radii[n] / z_ratio , w , h , z , grad_tiles );
+        else if ( grad_tiles != NULL )
+            _proj_3d_tiles ( dx , dy , dz , dmag , IdxO , IdxM , radii[n] , radii[n] / z_ratio , w , h , z , grad_tiles );
+        else
+            _proj_3d ( dx , dy , dz , dmag , IdxO , IdxM , radii[n] , radii[n] / z_ratio , w , h , z );
 
-        mig_im_gauss_iir_3d ( f , idx , w , h , z , 0.25f * radii[n] );
-    }
+        _f_3d ( IdxO , IdxM , f , radii[n] , w , h , z );
 
-    /* final result */
-    memset ( out , 0x00 , w * h * z * sizeof( float ) );
+        /* smaller radii already accumulated elsewhere */
+        if ( n < first )
+            continue;
 
-    for ( k = 0 ; k < z ; ++k )                             /* z coordinate */
-    {
-        for ( j = 0 ; j < h ; ++j )                     /* y coordinate */
+        if ( grad_tiles == NULL )
         {
-            for ( i = 0 ; i < w ; ++i , ++out )     /* x coordinate */
-            {
-                /* current voxel */
-                idx = s + i + j * w + k * w * h;
-
-                for ( n = 0 ; n < num_radii ; ++n )     /* radius coordinate */
-                    *out += idx[n*w*h*z] * radii[n];
-
-                *out = ( *out < MIG_EPS_32F ) ? 0.0f : (*out) / num_radii;
-            }
+            mig_im_gauss_iir_3d_aniso ( f , f , w , h , z , 0.25f * radii[n] , 0.25f * radii[n] / z_ratio ,
+                                        NULL , num_threads );
         }
+        else
+        {
+            /* smooth only around voxels which received votes */
+            f_tiles = mig_im_tiles_get_32f ( f , w , h , z , tile_len );
+            if ( f_tiles == NULL )
+                goto error;
+
+            gauss_tiles = mig_im_tiles_dilate ( f_tiles ,
+                              (int) ceilf ( GAUSS_TILE_NSIGMA * 0.25f * radii[n] * zs ) );
+            mig_im_tiles_del ( f_tiles );
+            f_tiles = NULL;
+            if ( gauss_tiles == NULL )
+                goto error;
+
+            mig_im_gauss_iir_3d_aniso ( f , f , w , h , z , 0.25f * radii[n] , 0.25f * radii[n] / z_ratio ,
+                                        gauss_tiles , num_threads );
+
+            mig_im_tiles_del ( gauss_tiles );
+            gauss_tiles = NULL;
+        }
+
+        for ( i = 0 ; i < dim ; ++i )
+            out[i] += f[i] * radii[n];
     }
 
-    free ( dx );
-    free ( dy );
-    free ( dz );
-    free ( dmag );
+    if ( dx )
+        free ( dx );
+    if ( dy )
+        free ( dy );
+    if ( dz )
+        free ( dz );
+    if ( dmag )
+        free ( dmag );
+    if ( grad16 )
+        free ( grad16 );
+    if ( lut )
+        free ( lut );
 
     free ( o );
     free ( m );
-    free ( s );
     free ( f );
 
+    mig_im_tiles_del ( grad_tiles );
+
     return 0;
 
 error :
@@ -808,91 +1649,88 @@ error :
 
     if ( dmag )
         free ( dmag );
+    if ( grad16 )
+        free ( grad16 );
+    if ( lut )
+        free ( lut );
     if ( o )
         free ( o );
-    if ( s )
-        free ( s );
     if ( m )
         free ( m );
     if ( f )
         free ( f );
 
+    mig_im_tiles_del ( grad_tiles );
+    mig_im_tiles_del ( f_tiles );
+    mig_im_tiles_del ( gauss_tiles );
+
     return -1;
 }
 
 /****************************************************************************/
 
+#if defined(MATLAB_RADIAL)
+
 static int
 _radial_2d ( float *in , float *out , int w , int h , float *radii , int num_radii )
 {
-    /* matrix data */
-    float *dx = NULL;       /* gradient horizontal direction */
-    float *dy = NULL;       /* gradient vertical direction */
-    float *dmag = NULL;     /* gradient magnitude */
+    mig_fradial_buf_t *buf;
+    int rc;
 
-    float *o = NULL;        /* orientation projection image */
+    buf = _fradial_buf_alloc ( w , h , radii , num_radii );
+    if ( buf == NULL )
+        return -1;
+
+    rc = _radial_2d_buf ( in , out , w , h , radii , num_radii , buf );
+
+    mig_im_fradial_buf_del ( buf );
+    return rc;
+}
+
+#endif /* MATLAB_RADIAL */
+
+/****************************************************************************/
+
+static int
+_radial_2d_buf ( float *in , float *out , int w , int h ,
+                 float *radii , int num_radii , mig_fradial_buf_t *buf )
+{
     float *IdxO;
-    float *m = NULL;        /* magnitutde projection image */
     float *IdxM;
-    float *f = NULL;
-    float *s = NULL;        /* accumulator for all radii */
 
     /* other vars */
-    float maxr;             /* max input radius */
+    int maxr;               /* max input radius */
     float *idx;
     int n;                  /* current radius */
     int i , j;              /* pixel indices */
 
-    dx = (float*) malloc ( w * h * sizeof(float) );
-    if ( dx == NULL )
-        goto error;
-
-    dy = (float*) malloc ( w * h * sizeof(float) );
-    if ( dy == NULL )
-        goto error;
+    /* orientation and magnitude images are padded by the max radius
+       so that we avoid boundary condition checking */
+    maxr = (int) floorf( radii[num_radii-1] + 0.5f );
 
-    dmag = (float*) malloc ( w * h * sizeof(float) );
-    if ( dmag == NULL )
-        goto error;
+    if ( ( w > buf->w ) || ( h > buf->h ) ||
+         ( num_radii > buf->num_radii ) || ( maxr > buf->pad ) )
+        return -1;
 
     /* calculate 2D gradient */
-    mig_im_drv_2d_central_diffs ( in , w , h , dx , dy , dmag );
-
-    /* radial filter matrices */
-    s = (float*) malloc ( num_radii * w * h * sizeof( float ) );
-    if ( s == NULL )
-        goto error;
-
-    f = (float*) malloc ( w * h * sizeof(float) );
-    if ( f == NULL )
-        goto error;
-
-    /* get maximum input radius and
-       allocate sapce for orientation and
-       magnitude images so that we avoid
-       boundary condition checking */
-    maxr = floorf( radii[num_radii-1] + 0.5f );
-
-    o = (float*) calloc ( ( w + 2.0f * maxr ) * ( h + 2.0f * maxr ) , sizeof(float) );
-    if ( o == NULL )
-        goto error;
+    mig_im_drv_2d_central_diffs ( in , w , h , buf->dx , buf->dy , buf->dmag );
 
-    m = (float*) calloc ( ( w + 2.0f * maxr ) * ( h + 2.0f * maxr ) , sizeof(float) );
-    if ( m == NULL )
-        goto error;
+    /* projections accumulate over radii , start from zero */
+    memset ( buf->o , 0x00 , ( w + 2 * maxr ) * ( h + 2 * maxr ) * sizeof(float) );
+    memset ( buf->m , 0x00 , ( w + 2 * maxr ) * ( h + 2 * maxr ) * sizeof(float) );
 
     /* position variables to actual matrix starting positions */
-    IdxO = o + (int)( maxr + maxr * w );
-    IdxM = m + (int)( maxr + maxr * w );
+    IdxO = buf->o + ( maxr + maxr * w );
+    IdxM = buf->m + ( maxr + maxr * w );
 
     /* for each radius */
-    idx = s;
+    idx = buf->s;
     for ( n = 0 ; n < num_radii ; ++n , idx += w * h )
     {
-        _proj_2d ( dx , dy , dmag , IdxO , IdxM , radii[n] , w , h );
-        _f_2d ( IdxO , IdxM , f , radii[n] , w , h );
+        _proj_2d ( buf->dx , buf->dy , buf->dmag , IdxO , IdxM , radii[n] , w , h );
+        _f_2d ( IdxO , IdxM , buf->f , radii[n] , w , h );
 
-        mig_im_gauss_iir_2d ( f , idx , w , h , 0.25f * radii[n] );
+        mig_im_gauss_iir_2d ( buf->f , idx , w , h , 0.25f * radii[n] );
     }
 
     /* final result */
@@ -903,7 +1741,7 @@ _radial_2d ( float *in , float *out , int w , int h , float *radii , int num_rad
         for ( i = 0 ; i < w ; ++i , ++out )         /* x coordinate */
         {
             /* current pixel */
-            idx = s + i + j * w;
+            idx = buf->s + i + j * w;
 
             for ( n = 0 ; n < num_radii ; ++n )     /* radius coordinate */
                 *out += idx[n*w*h] * radii[n];
@@ -911,43 +1749,15 @@ _radial_2d ( float *in , float *out , int w , int h , float *radii , int num_rad
             *out = ( *out < MIG_EPS_32F ) ? 0.0f : (*out) / num_radii;
         }
     }
-        
-    free ( dx );
-    free ( dy );
-    free ( dmag );
-
-    free ( o );
-    free ( m );
-    free ( s );
-    free ( f );
 
     return 0;
-
-error :
-
-    if ( dx )
-        free ( dx );
-    if ( dy )
-        free ( dy );
-    if ( dmag )
-        free ( dmag );
-    if ( o )
-        free ( o );
-    if ( s )
-        free ( s );
-    if ( m )
-        free ( m );
-    if ( f )
-        free ( f );
-
-    return -1;
 }
 
 /****************************************************************************/
 
 static void
 _proj_3d ( float *dx , float *dy , float *dz , float *dmag ,
-           float *o , float *m , float radius ,
+           float *o , float *m , float radius , float radius_z ,
            int w , int h , int z )
 {
     int i , j , k;         /* counters */
@@ -962,7 +1772,7 @@ _proj_3d ( float *dx , float *dy , float *dz , float *dmag ,
                 /* affected pixel coordinates */
                 x0 = (int) floorf ( *dx * radius + 0.5f );
                 y0 = (int) floorf ( *dy * radius + 0.5f );
-                z0 = (int) floorf ( *dz * radius + 0.5f );
+                z0 = (int) floorf ( *dz * radius_z + 0.5f );
 
                 o[(i+x0)+(j+y0)*w+(k+z0)*w*h] += 1.0f;
                 o[(i-x0)+(j-y0)*w+(k-z0)*w*h] -= 1.0f;
@@ -976,6 +1786,283 @@ _proj_3d ( float *dx , float *dy , float *dz , float *dmag ,
 
 /****************************************************************************/
 
+static void
+_proj_3d_tiles ( float *dx , float *dy , float *dz , float *dmag ,
+                 float *o , float *m , float radius , float radius_z ,
+                 int w , int h , int z , const mig_im_tiles_t *tiles )
+{
+    int i , j , k;         /* counters */
+    int tx , ty , tz;      /* tile counters */
+    int x0 , y0 , z0;      /* affected pixel coordinates */
+    int len = tiles->len;
+    int v;
+
+    for ( tz = 0 ; tz < tiles->tz ; ++tz )
+    {
+        for ( ty = 0 ; ty < tiles->th ; ++ty )
+        {
+            for ( tx = 0 ; tx < tiles->tw ; ++tx )
+            {
+                if ( !MIG_IM_TILE_ON ( tiles , tx , ty , tz ) )
+                    continue;
+
+                for ( k = tz * len ; k < MIG_MIN2 ( ( tz + 1 ) * len , z ) ; ++k )
+                {
+                    for ( j = ty * len ; j < MIG_MIN2 ( ( ty + 1 ) * len , h ) ; ++j )
+                    {
+                        for ( i = tx * len ; i < MIG_MIN2 ( ( tx + 1 ) * len , w ) ; ++i )
+                        {
+                            v = i + j * w + k * w * h;
+
+                            /* null gradient votes +1 and -1 on itself */
+                            if ( dmag[v] == 0.0f )
+                                continue;
+
+                            /* affected pixel coordinates */
+                            x0 = (int) floorf ( dx[v] * radius + 0.5f );
+                            y0 = (int) floorf ( dy[v] * radius + 0.5f );
+                            z0 = (int) floorf ( dz[v] * radius_z + 0.5f );
+
+                            o[(i+x0)+(j+y0)*w+(k+z0)*w*h] += 1.0f;
+                            o[(i-x0)+(j-y0)*w+(k-z0)*w*h] -= 1.0f;
+
+                            m[(i+x0)+(j+y0)*w+(k+z0)*w*h] += dmag[v];
+                            m[(i-x0)+(j-y0)*w+(k-z0)*w*h] -= dmag[v];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/****************************************************************************/
+
+static void
+_proj_3d_16 ( const Mig16u *g , const float *lut ,
+              float *o , float *m , float radius , float radius_z ,
+              int w , int h , int z , const mig_im_tiles_t *tiles )
+{
+    int i , j , k;         /* counters */
+    int tx , ty , tz;      /* tile counters */
+    int ntx , nty , ntz;   /* number of tiles */
+    int x0 , y0 , z0;      /* affected pixel coordinates */
+    int len;
+    const Mig16u *gv;
+    float gx , gy , gz , gm;
+    int v;
+
+    /* without tiles whole volume is a single tile */
+    if ( tiles != NULL )
+    {
+        len = tiles->len;
+        ntx = tiles->tw;
+        nty = tiles->th;
+        ntz = tiles->tz;
+    }
+    else
+    {
+        len = MIG_MAX2 ( w , MIG_MAX2 ( h , z ) );
+        ntx = nty = ntz = 1;
+    }
+
+    for ( tz = 0 ; tz < ntz ; ++tz )
+    {
+        for ( ty = 0 ; ty < nty ; ++ty )
+        {
+            for ( tx = 0 ; tx < ntx ; ++tx )
+            {
+                if ( tiles && !MIG_IM_TILE_ON ( tiles , tx , ty , tz ) )
+                    continue;
+
+                for ( k = tz * len ; k < MIG_MIN2 ( ( tz + 1 ) * len , z ) ; ++k )
+                {
+                    for ( j = ty * len ; j < MIG_MIN2 ( ( ty + 1 ) * len , h ) ; ++j )
+                    {
+                        v  = tx * len + j * w + k * w * h;
+                        gv = g + 4 * v;
+
+                        for ( i = tx * len ; i < MIG_MIN2 ( ( tx + 1 ) * len , w ) ; ++i , gv += 4 )
+                        {
+                            /* null gradient votes +1 and -1 on itself */
+                            if ( gv[3] == 0 )
+                                continue;
+
+                            if ( lut != NULL )
+                            {
+                                gx = lut[gv[0]];
+                                gy = lut[gv[1]];
+                                gz = lut[gv[2]];
+                                gm = lut[gv[3]];
+                            }
+                            else
+                            {
+                                gx = (Mig16s) gv[0] * ( 1.0f / FR_FIXED_DIR_SCALE );
+                                gy = (Mig16s) gv[1] * ( 1.0f / FR_FIXED_DIR_SCALE );
+                                gz = (Mig16s) gv[2] * ( 1.0f / FR_FIXED_DIR_SCALE );
+                                gm = gv[3] * ( 1.0f / FR_FIXED_MAG_SCALE );
+                            }
+
+                            /* affected pixel coordinates */
+                            x0 = (int) floorf ( gx * radius + 0.5f );
+                            y0 = (int) floorf ( gy * radius + 0.5f );
+                            z0 = (int) floorf ( gz * radius_z + 0.5f );
+
+                            o[(i+x0)+(j+y0)*w+(k+z0)*w*h] += 1.0f;
+                            o[(i-x0)+(j-y0)*w+(k-z0)*w*h] -= 1.0f;
+
+                            m[(i+x0)+(j+y0)*w+(k+z0)*w*h] += gm;
+                            m[(i-x0)+(j-y0)*w+(k-z0)*w*h] -= gm;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/****************************************************************************/
+
+static void
+_grad_aniso_3d ( float *dx , float *dy , float *dz , float *dmag ,
+                 int dim , float z_ratio )
+{
+    int i;
+    float gz , n;
+
+    for ( i = 0 ; i < dim ; ++i )
+    {
+        /* thresholded voxels have no direction */
+        if ( dmag[i] == 0.0f )
+            continue;
+
+        gz = dz[i] / z_ratio;
+        n = sqrtf ( MIG_POW2 ( dx[i] ) + MIG_POW2 ( dy[i] ) + MIG_POW2 ( gz ) );
+
+        dx[i] /= n;
+        dy[i] /= n;
+        dz[i] = gz / n;
+        dmag[i] *= n;
+    }
+}
+
+/****************************************************************************/
+
+static void
+_pack_grad_3d ( const float *dx , const float *dy , const float *dz , const float *dmag ,
+                Mig16u *g , int dim , FrPrecision precision )
+{
+    int i;
+
+    for ( i = 0 ; i < dim ; ++i , g += 4 )
+    {
+        if ( precision == FR_PRECISION_HALF )
+        {
+            g[0] = _flt2half ( dx[i] );
+            g[1] = _flt2half ( dy[i] );
+            g[2] = _flt2half ( dz[i] );
+            g[3] = _flt2half ( dmag[i] );
+        }
+        else
+        {
+            /* unit vector components in [-1,1] , magnitude in [0,1) */
+            g[0] = (Mig16u)(Mig16s) floorf ( dx[i] * FR_FIXED_DIR_SCALE + 0.5f );
+            g[1] = (Mig16u)(Mig16s) floorf ( dy[i] * FR_FIXED_DIR_SCALE + 0.5f );
+            g[2] = (Mig16u)(Mig16s) floorf ( dz[i] * FR_FIXED_DIR_SCALE + 0.5f );
+            g[3] = (Mig16u) floorf ( MIG_MIN2 ( dmag[i] , 1.0f ) * FR_FIXED_MAG_SCALE + 0.5f );
+        }
+
+        /* a non zero gradient must keep voting */
+        if ( ( g[3] == 0 ) && ( dmag[i] > 0.0f ) )
+            g[3] = 1;
+    }
+}
+
+/****************************************************************************/
+
+static Mig16u
+_flt2half ( float val )
+{
+    Mig32u x , sign , mant;
+    int e;
+    union { float f; Mig32u u; } c;
+
+    c.f = val;
+    x = c.u;
+
+    sign = ( x >> 16 ) & 0x8000;
+    e    = (int)( ( x >> 23 ) & 0xff ) - 127 + 15;
+    mant = x & 0x007fffff;
+
+    /* nan and infinity */
+    if ( ( ( x >> 23 ) & 0xff ) == 0xff )
+        return (Mig16u)( sign | 0x7c00 | ( mant ? 0x200 : 0 ) );
+
+    /* overflow -> infinity */
+    if ( e >= 31 )
+        return (Mig16u)( sign | 0x7c00 );
+
+    /* subnormal half or zero */
+    if ( e <= 0 )
+    {
+        if ( e < -10 )
+            return (Mig16u) sign;
+
+        mant |= 0x00800000;
+        x = mant >> ( 14 - e );
+
+        /* round to nearest even */
+        if ( ( mant >> ( 13 - e ) ) & 1 )
+            if ( ( mant & ( ( 1u << ( 13 - e ) ) - 1 ) ) || ( x & 1 ) )
+                ++x;
+
+        return (Mig16u)( sign | x );
+    }
+
+    x = ( (Mig32u) e << 10 ) | ( mant >> 13 );
+
+    /* round to nearest even : a carry into exponent is still correct */
+    if ( mant & 0x1000 )
+        if ( ( mant & 0x0fff ) || ( x & 1 ) )
+            ++x;
+
+    return (Mig16u)( sign | x );
+}
+
+/****************************************************************************/
+
+static float
+_half2flt ( Mig16u val )
+{
+    Mig32u sign , mant;
+    int e;
+    union { float f; Mig32u u; } c;
+
+    sign = (Mig32u)( val & 0x8000 ) << 16;
+    e    = ( val >> 10 ) & 0x1f;
+    mant = val & 0x03ff;
+
+    if ( e == 0x1f )
+    {
+        /* nan and infinity */
+        c.u = sign | 0x7f800000 | ( mant << 13 );
+    }
+    else if ( e == 0 )
+    {
+        /* zero and subnormals */
+        c.f = mant * ( 1.0f / 16777216.0f );
+        c.u |= sign;
+    }
+    else
+    {
+        c.u = sign | ( (Mig32u)( e - 15 + 127 ) << 23 ) | ( mant << 13 );
+    }
+
+    return c.f;
+}
+
+/****************************************************************************/
+
 static void
 _proj_2d ( float *dx , float *dy , float *dmag ,
            float *o , float *m , float radius ,
@@ -1060,6 +2147,48 @@ _f_2d ( float *o , float *m , float *f ,
 
 /****************************************************************************/
 
+static mig_fradial_buf_t*
+_fradial_buf_alloc ( int w , int h , float *radii , int num_radii )
+{
+    mig_fradial_buf_t *buf;
+    int pad;
+
+    if ( ( w <= 0 ) || ( h <= 0 ) || ( num_radii <= 0 ) )
+        return NULL;
+
+    pad = (int) floorf( radii[num_radii-1] + 0.5f );
+
+    buf = (mig_fradial_buf_t*) calloc ( 1 , sizeof(mig_fradial_buf_t) );
+    if ( buf == NULL )
+        return NULL;
+
+    buf->w         = w;
+    buf->h         = h;
+    buf->num_radii = num_radii;
+    buf->pad       = pad;
+
+    buf->tmp  = (float*) malloc ( w * h * sizeof(float) );
+    buf->dx   = (float*) malloc ( w * h * sizeof(float) );
+    buf->dy   = (float*) malloc ( w * h * sizeof(float) );
+    buf->dmag = (float*) malloc ( w * h * sizeof(float) );
+    buf->f    = (float*) malloc ( w * h * sizeof(float) );
+    buf->s    = (float*) malloc ( num_radii * w * h * sizeof(float) );
+    buf->o    = (float*) malloc ( ( w + 2 * pad ) * ( h + 2 * pad ) * sizeof(float) );
+    buf->m    = (float*) malloc ( ( w + 2 * pad ) * ( h + 2 * pad ) * sizeof(float) );
+
+    if ( ( buf->tmp == NULL ) || ( buf->dx == NULL ) || ( buf->dy == NULL ) ||
+         ( buf->dmag == NULL ) || ( buf->f == NULL ) || ( buf->s == NULL ) ||
+         ( buf->o == NULL ) || ( buf->m == NULL ) )
+    {
+        mig_im_fradial_buf_del ( buf );
+        return NULL;
+    }
+
+    return buf;
+}
+
+/****************************************************************************/
+
 static void
 _find_max ( float *Input , int InputLen , float *MaxVal )
 {
@@ -41,6 +41,26 @@ typedef enum
 
 } ThresholdType;
 
+typedef enum
+{
+    FR_PRECISION_FLOAT = 0 ,    /* intermediate buffers are 32 bit floats */
+    FR_PRECISION_HALF = 1 ,     /* gradient buffers are 16 bit half floats */
+    FR_PRECISION_FIXED16 = 2    /* gradient buffers are scaled 16 bit integers */
+
+} FrPrecision;
+
+/* reduced precision vs float path comparison */
+typedef struct _mig_fradial_val_t
+{
+        int             num_ref;            /* float path candidates */
+        int             num;                /* reduced precision candidates */
+        int             num_unmatched;      /* candidates found by one path only */
+        float           max_centroid_dev;   /* max centroid distance of matched candidates ( voxels ) */
+        float           max_score_dev;      /* max response difference at matched candidates */
+        float           max_response_dev;   /* max response difference over whole volume */
+
+} mig_fradial_val_t;
+
 /*
 ******************************************************************************
 *                               FAST RADIAL REPRESENTATION
@@ -56,9 +76,42 @@ typedef struct _mig_fradial_t
         float           threshold;          /* threshold for fast radial responses */
         ThresholdType   thr_type;           /* threshold type */        
 		float			beta_threshold;		/* threshold on gradient magnitude */
+        int             num_threads;        /* threads used by 3d gaussian smoothing ( 1 -> serial ) */
+        int             tile_len;           /* 3d processing skips tiles of this side far from non zero input ( 0 -> off ) */
+        FrPrecision     precision;          /* 3d intermediate buffers precision */
+        int             validate;           /* compare reduced precision against float path */
+        mig_fradial_val_t val;              /* validation results ( filled in if validate is 1 ) */
+        float           coarse_radius;      /* 3d radii from this one on run coarse to fine ( 0 -> off ) */
+        int             coarse_scale;       /* coarse pyramid level downsampling factor */
+        float           coarse_threshold;   /* coarse responses refined if above this fraction of coarse max */
+        float           z_ratio;            /* z voxel size / in-plane voxel size ( 1 -> isotropic ) */
+        float           merge_distance;     /* 3d regions closer than this times their radius are merged ( 0 -> off ) */
 
 } mig_fradial_t;
 
+/*
+******************************************************************************
+*                       2D FAST RADIAL SCRATCH BUFFERS
+******************************************************************************
+*/
+
+typedef struct _mig_fradial_buf_t
+{
+        int             w;                  /* max image width */
+        int             h;                  /* max image height */
+        int             num_radii;          /* max number of radii */
+        int             pad;                /* max radius ( projection images border ) */
+        float           *tmp;               /* 1st pass output */
+        float           *dx;                /* gradient horizontal direction */
+        float           *dy;                /* gradient vertical direction */
+        float           *dmag;              /* gradient magnitude */
+        float           *f;                 /* radial simmetry of a single radius */
+        float           *s;                 /* smoothed radial simmetry of all radii */
+        float           *o;                 /* orientation projection image */
+        float           *m;                 /* magnitude projection image */
+
+} mig_fradial_buf_t;
+
 
 /*
 ******************************************************************************
@@ -101,6 +154,8 @@ mig_im_fradial_get ( float *radii , int num_radii , float threshold , ThresholdT
 *                       1. Filter input signal once using fast radial filter
 *                       2. Binarize responses using relative threshold
 *                       3. Build a list of 3D connected components' centroids
+*                       4. Merge components of the same blob if
+*                          merge_distance is not 0 ( strongest one kept )
 *
 * Arguments   : Input      - input signal on which to perform fast radial filtering
 *               w          - input signal width
@@ -113,6 +168,9 @@ mig_im_fradial_get ( float *radii , int num_radii , float threshold , ThresholdT
 *               -1 on error
 *
 * Notes       : Only one fast radial pass is performed !
+*               If FastRadial->validate is 1 and precision is not float the
+*               float path is run too and the comparison is stored in
+*               FastRadial->val.
 *
 ******************************************************************************
 */
@@ -156,6 +214,67 @@ mig_im_fradial_2d ( float *Input ,
                     mig_fradial_t *FastRadial ,
                     mig_lst_t *Regions );
 
+/*
+******************************************************************************
+*                       PERFORM 2D FAST RADIAL ON SCRATCH BUFFERS
+*
+* Description : Same as mig_im_fradial_2d but intermediate images live in
+*               caller provided scratch buffers , so that many slices can
+*               be filtered without allocating memory for each of them.
+*
+* Arguments   : Input      - input signal on which to perform fast radial filtering
+*               w          - input signal width
+*               h          - input signal height
+*               FastRadial - prepared fast radial structure
+*               Buf        - scratch buffers from mig_im_fradial_buf_get
+*               Regions    - results of fast radial filtering - list of coordinates
+*
+* Returns     : 0 on success
+*               -1 on error or if Buf is smaller than w x h
+*
+* Notes       : A scratch buffer must not be shared by concurrent calls.
+*
+******************************************************************************
+*/
+
+int
+mig_im_fradial_2d_buf ( float *Input ,
+                        int w , int h ,
+                        mig_fradial_t *FastRadial ,
+                        mig_fradial_buf_t *Buf ,
+                        mig_lst_t *Regions );
+
+/*
+******************************************************************************
+*                       PREPARE 2D SCRATCH BUFFERS
+*
+* Description : This function allocates scratch buffers for 2d fast radial
+*               filtering of images up to w x h.
+*
+* Arguments   : w          - max image width
+*               h          - max image height
+*               FastRadial - prepared fast radial structure ( radii )
+*
+* Returns     : scratch buffers on success
+*               NULL on error
+*
+* Notes       : scratch buffers must be freed using mig_im_fradial_buf_del
+*
+******************************************************************************
+*/
+
+mig_fradial_buf_t*
+mig_im_fradial_buf_get ( int w , int h , const mig_fradial_t *FastRadial );
+
+/*
+******************************************************************************
+*                       DELETE 2D SCRATCH BUFFERS
+******************************************************************************
+*/
+
+void
+mig_im_fradial_buf_del ( mig_fradial_buf_t *Buf );
+
 /*
 ******************************************************************************
 *                       DELETE FAST RADIAL STRUCTURE
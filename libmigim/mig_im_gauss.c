@@ -10,6 +10,49 @@
 */
 
 #include "mig_im_gauss.h"
+#include "mig_im_tile.h"
+#include "mig_ut_pool.h"
+
+/*
+******************************************************************************
+*               LOCAL DEFINITIONS
+******************************************************************************
+*/
+
+/* number of adjacent columns filtered together by the y and z passes :
+   256 floats per row keep the 3 previous rows of every column block
+   inside L1 while giving the compiler a long contiguous inner loop */
+#define GAUSS_IIR_BLOCK 256
+
+/* slabs per thread : masked volumes make slabs uneven , smaller slabs let
+   the pool rebalance them */
+#define GAUSS_IIR_SLABS_PER_THREAD 4
+
+/* work assigned to a single filtering thread */
+typedef struct _gauss_iir_slab_t
+{
+        float           *in;        /* input signal */
+        float           *out;       /* output signal */
+        int             w;          /* signal width */
+        int             h;          /* signal height */
+        int             z;          /* signal z */
+        int             start;      /* first slice ( xy pass ) or plane offset ( z pass ) */
+        int             end;        /* one past last slice or plane offset */
+        const float     *b;         /* filter coefficients */
+        const double    *M;         /* Triggs boundary matrix */
+        const mig_im_tiles_t *tiles;    /* lines to filter ( NULL -> all ) */
+
+} gauss_iir_slab_t;
+
+/* filtering pass split in slabs of a pool run */
+typedef struct _gauss_iir_pass_t
+{
+        void* (*routine)( void* );      /* slab routine */
+        const gauss_iir_slab_t *tmpl;   /* slab template */
+        int             len;            /* total range length */
+        int             chunk;          /* slab length */
+
+} gauss_iir_pass_t;
 
 /*
 ******************************************************************************
@@ -26,8 +69,9 @@
 *
 * Arguments   : in    - input row to filter
 *               out   - output of row filtering operation
-*               w     - total width of input signal
-*               sigma - gaussian sigma
+*               w     - row width
+*               b     - filter coefficients
+*               M     - Triggs boundary matrix
 *
 * Returns     :
 *
@@ -37,64 +81,123 @@
 */
 
 static void
-_gauss_iir_1d_x ( float *in , float *out , const int w , const float sigma );
+_gauss_iir_1d_x ( float *in , float *out , const int w , const float *b , const double *M );
 
 /*
 ******************************************************************************
-*                       IIR GAUSS FILTER IN VERTICAL DIRECTION
+*                       IIR GAUSS FILTER ON ADJACENT COLUMNS
 *
-* Description : This function filters a single column of an input 3D array in vertical
-*               direction using 1D Gaussian IIR filter.
+* Description : This function filters n adjacent columns of an input array
+*               at once along a direction with the given stride. The recursion
+*               runs along the filtering direction while the inner loop walks
+*               the n contiguous columns, so every row access is sequential
+*               and can be vectorized.
 *
-* Arguments   : in    - input column to filter
-*               out   - output of column filtering operation
-*               w     - total width of input signal
-*               h     - total height of input signal
-*               sigma - gaussian sigma
+* Arguments   : in     - first sample of first column to filter
+*               out    - output of filtering operation ( may be equal to in )
+*               n      - number of adjacent columns ( <= GAUSS_IIR_BLOCK )
+*               len    - number of samples along filtering direction
+*               stride - distance between two samples along filtering direction
+*               b      - filter coefficients
+*               M      - Triggs boundary matrix
 *
 * Returns     :
 *
-* Notes       :
+* Notes       : y pass uses stride w, z pass uses stride w*h
 *
 ******************************************************************************
 */
 
 static void
-_gauss_iir_1d_y ( float *in , float *out , const int w , const int h , const float sigma );
+_gauss_iir_1d_cols ( float *in , float *out , const int n , const int len ,
+                     const int stride , const float *b , const double *M );
 
 /*
 ******************************************************************************
-*                       IIR GAUSS FILTER IN Z DIRECTION
+*                       IIR GAUSS FILTER XY PASSES ON A SLAB
 *
-* Description : This function filters a single z dimension of an input 3D array in z
-*               direction using 1D Gaussian IIR filter.
+* Description : This function filters slices [start,end) of a 3D array
+*               in horizontal and vertical direction.
 *
-* Arguments   : in    - input z signal to filter
-*               out   - output of z filtering operation
-*               w     - total width of input 3D signal
-*               h     - total height of input 3D signal
-*               sigma - gaussian sigma
+* Arguments   : arg - gauss_iir_slab_t describing the slab
+*
+* Returns     : NULL
+*
+******************************************************************************
+*/
+
+static void*
+_gauss_iir_xy_slab ( void *arg );
+
+/*
+******************************************************************************
+*                       IIR GAUSS FILTER Z PASS ON A PLANE RANGE
+*
+* Description : This function filters in z direction every column whose
+*               offset inside a single slice lies in [start,end).
+*
+* Arguments   : arg - gauss_iir_slab_t describing the plane range
+*
+* Returns     : NULL
+*
+******************************************************************************
+*/
+
+static void*
+_gauss_iir_z_slab ( void *arg );
+
+/*
+******************************************************************************
+*                       RUN A FILTERING PASS ON MULTIPLE THREADS
+*
+* Description : This function splits [0,len) into contiguous slabs and
+*               runs routine on each of them on a work stealing pool.
+*
+* Arguments   : routine     - slab routine
+*               tmpl        - slab template ( start and end are filled in )
+*               len         - total range length
+*               num_threads - number of threads to use
 *
 * Returns     :
 *
-* Notes       :
+* Notes       : falls back to serial processing if threads can not be created
 *
 ******************************************************************************
 */
 
 static void
-_gauss_iir_1d_z ( float *in , float *out , const int w , const int h , const int z , const float sigma );
+_gauss_iir_run ( void* (*routine)( void* ) , const gauss_iir_slab_t *tmpl ,
+                 int len , int num_threads );
 
 /*
 ******************************************************************************
-*                       IIR GAUSS FILTER IN HORIZONTAL DIRECTION
+*                       FILTER A SINGLE SLAB OF A PASS
 *
-* Description : This function filters a single row of an input 3D array in horizontal
-*               direction using 1D Gaussian IIR filter.
+* Description : Pool task running the pass routine on slab task.
 *
-* Arguments   : in    - input row to filter
-*               out   - output of row filtering operation
-*               w     - row width
+* Arguments   : arg    - gauss_iir_pass_t
+*               task   - slab index
+*               worker - pool worker ( unused )
+*
+* Returns     : 0
+*
+******************************************************************************
+*/
+
+static int
+_gauss_iir_task ( void *arg ,
+                  int task ,
+                  int worker );
+
+/*
+******************************************************************************
+*                       IIR GAUSS FILTER COEFFICIENTS
+*
+* Description : This function calculates Young / Van Vliet recursive filter
+*               coefficients and Triggs boundary matrix.
+*
+* Arguments   : b     - output filter coefficients ( 6 floats )
+*               M     - output boundary matrix ( 9 doubles )
 *               sigma - gaussian sigma
 *
 * Returns     :
@@ -116,41 +219,63 @@ _FilterCoeffs_TriggsCoeffs ( float *b , double *M , const float sigma );
 void
 mig_im_gauss_iir_3d ( float *in , float *out , int w , int h , int z , float sigma )
 {
-        int i , j , k;
-        float *idx;
+        mig_im_gauss_iir_3d_mt ( in , out , w , h , z , sigma , 1 );
+}
 
-        /* first convolution goes in horizontal direction ( x's ) */
-        idx = out;
-        for ( k = 0 ; k < z ; ++k )
-        {
-                for ( j = 0 ; j < h ; ++j , in += w , idx += w )
-                {
-                        /* perform 1d convolution */
-                        _gauss_iir_1d_x ( in , idx , w , sigma );
-                }
-        }
+/******************************************************************************/
 
-        /* second convolution goes in vertical direction ( y's ) */
-        for ( k = 0 ; k < z ; ++k )
-        {
-                idx = out + k * w * h;
+void
+mig_im_gauss_iir_3d_mt ( float *in , float *out , int w , int h , int z , float sigma , int num_threads )
+{
+        mig_im_gauss_iir_3d_tiles ( in , out , w , h , z , sigma , NULL , num_threads );
+}
 
-                for ( i = 0 ; i < w ; ++i , ++idx )
-                {
-                        /* perform 1 d convolution */
-                        _gauss_iir_1d_y ( idx , idx , w , h , sigma );
-                }
-        }
+/******************************************************************************/
 
-        /* third and final convolution goes in z direction ( z's ) */
-        for ( j = 0 ; j < h ; ++j )
+void
+mig_im_gauss_iir_3d_tiles ( float *in , float *out , int w , int h , int z , float sigma ,
+                            const mig_im_tiles_t *tiles , int num_threads )
+{
+        mig_im_gauss_iir_3d_aniso ( in , out , w , h , z , sigma , sigma , tiles , num_threads );
+}
+
+/******************************************************************************/
+
+void
+mig_im_gauss_iir_3d_aniso ( float *in , float *out , int w , int h , int z ,
+                            float sigma , float sigma_z ,
+                            const mig_im_tiles_t *tiles , int num_threads )
+{
+        float  b[6] , bz[6];
+        double M[9] , Mz[9];
+        gauss_iir_slab_t slab;
+
+        /* coefficients depend only on sigma : compute them once */
+        _FilterCoeffs_TriggsCoeffs ( b , M , sigma );
+        if ( sigma_z != sigma )
+                _FilterCoeffs_TriggsCoeffs ( bz , Mz , sigma_z );
+
+        slab.in  = in;
+        slab.out = out;
+        slab.w   = w;
+        slab.h   = h;
+        slab.z   = z;
+        slab.b   = b;
+        slab.M   = M;
+        slab.tiles = tiles;
+
+        /* first and second convolution ( x's and y's ) are independent
+           slice by slice -> split volume in z slabs */
+        _gauss_iir_run ( &_gauss_iir_xy_slab , &slab , z , num_threads );
+
+        /* third and final convolution goes in z direction ( z's ) and is
+           independent for every voxel of a slice -> split slice plane */
+        if ( sigma_z != sigma )
         {
-                for ( i = 0 ; i < w ; ++i , ++out )
-                {
-                        /* perform 1 d convolution */
-                        _gauss_iir_1d_z ( out , out , w , h , z , sigma );
-                }
+                slab.b = bz;
+                slab.M = Mz;
         }
+        _gauss_iir_run ( &_gauss_iir_z_slab , &slab , w * h , num_threads );
 }
 
 /******************************************************************************/
@@ -158,22 +283,28 @@ mig_im_gauss_iir_3d ( float *in , float *out , int w , int h , int z , float sig
 void
 mig_im_gauss_iir_2d ( float *in , float *out , int w , int h , float sigma )
 {
-    int i;
+    int i , n;
+    float  b[6];
+    double M[9];
     float *idx;
 
+    _FilterCoeffs_TriggsCoeffs ( b , M , sigma );
+
     /* first convolution goes in horizontal direction ( x's ) */
     idx = out;
     for ( i = 0 ; i < h ; ++i , in += w , idx += w )
     {
         /* perform 1d convolution */
-        _gauss_iir_1d_x ( in , idx , w , sigma );
+        _gauss_iir_1d_x ( in , idx , w , b , M );
     }
         
     /* second convolution goes in vertical direction ( y's ) */
-    for ( i = 0 ; i < w ; ++i , ++out )
+    for ( i = 0 ; i < w ; i += GAUSS_IIR_BLOCK )
     {
-        /* perform 1 d convolution */
-        _gauss_iir_1d_y ( out , out , w , h , sigma );
+        n = MIG_MIN2 ( GAUSS_IIR_BLOCK , w - i );
+
+        /* perform 1d convolution on n adjacent columns */
+        _gauss_iir_1d_cols ( out + i , out + i , n , h , w , b , M );
     }
 }
 
@@ -184,18 +315,15 @@ mig_im_gauss_iir_2d ( float *in , float *out , int w , int h , float sigma )
 */
 
 static void
-_gauss_iir_1d_x ( float *in , float *out , const int w , const float sigma )
+_gauss_iir_1d_x ( float *in , float *out , const int w , const float *b , const double *M )
 {
         int i;
         float iminus;   //  hypothetical signal value before start time, i.e. t=-1,-2,-3
         float iplus;    // last sample of original signal, needed for right hand boundary values
 
-        float  b[6];
-        double M[9];
         float  v[4];
         float uu[3];
 
-        _FilterCoeffs_TriggsCoeffs ( b , M , sigma );
         iplus = in[w-1];
 
         // Initialize first three steps of the causal filter
@@ -229,91 +357,223 @@ _gauss_iir_1d_x ( float *in , float *out , const int w , const float sigma )
 /*****************************************************************************/
 
 static void
-_gauss_iir_1d_y ( float *in , float *out , const int w , const int h , const float sigma )
+_gauss_iir_1d_cols ( float *in , float *out , const int n , const int len ,
+                     const int stride , const float *b , const double *M )
 {
-        int i;
-        float iminus;   //  hypothetical signal value before start time, i.e. t=-1,-2,-3
-        float iplus;    // last sample of original signal, needed for right hand boundary values
-
-        float  b[6];
-        double M[9];
-        float  v[4];
-        float uu[3];
-
-        _FilterCoeffs_TriggsCoeffs ( b , M , sigma );
-        iplus = in[(h-1)*w];
-
-        // Initialize first three steps of the causal filter
-        iminus = in[0];
-        out[0] = in[0] - ( - b[1]*(iminus-in[0]) + b[2]*(iminus-in[0]) - b[3]*(iminus-in[0]) );
-        out[w] = in[w] - ( - b[1]*(out[0]-in[w]) + b[2]*(iminus-in[w]) - b[3]*(iminus-in[w]) );
-        out[2*w] = in[2*w] - ( - b[1]*(out[w]-in[2*w]) + b[2]*(out[0]-in[2*w]) - b[3]*(iminus-in[2*w]) );
+        int i , c;
+        const float b1 = b[1] , b2 = b[2] , b3 = b[3];
+
+        /* last sample of every column, needed for right hand boundary
+           values : saved before causal pass as filtering may be in place */
+        float iplus[GAUSS_IIR_BLOCK];
+        float v0[GAUSS_IIR_BLOCK] , v1[GAUSS_IIR_BLOCK] , v2[GAUSS_IIR_BLOCK];
+        float uu0 , uu1 , uu2;
+
+        const float *pi;
+        float *po , *p1 , *p2 , *p3;
+
+        pi = in + ( len - 1 ) * stride;
+        for ( c = 0 ; c < n ; ++c )
+                iplus[c] = pi[c];
+
+        // Initialize first three steps of the causal filter ( iminus = in[0] )
+        p1 = out;
+        for ( c = 0 ; c < n ; ++c )
+                p1[c] = in[c] - ( - b1*(in[c]-in[c]) + b2*(in[c]-in[c]) - b3*(in[c]-in[c]) );
+
+        pi = in + stride;
+        po = out + stride;
+        for ( c = 0 ; c < n ; ++c )
+                po[c] = pi[c] - ( - b1*(p1[c]-pi[c]) + b2*(in[c]-pi[c]) - b3*(in[c]-pi[c]) );
+
+        pi = in + 2 * stride;
+        p2 = p1;
+        p1 = po;
+        po = out + 2 * stride;
+        for ( c = 0 ; c < n ; ++c )
+                po[c] = pi[c] - ( - b1*(p1[c]-pi[c]) + b2*(p2[c]-pi[c]) - b3*(in[c]-pi[c]) );
 
         // the remainder of the causal filter
-        for ( i = 3 ; i < h ; ++i )
-                out[i*w] = in[i*w] - ( - b[1]*(out[(i-1)*w]-in[i*w]) + b[2]*(out[(i-2)*w]-in[i*w]) - b[3]*(out[(i-3)*w]-in[i*w]) );
+        for ( i = 3 ; i < len ; ++i )
+        {
+                pi = in + i * stride;
+                po = out + i * stride;
+                p1 = po - stride;
+                p2 = p1 - stride;
+                p3 = p2 - stride;
+
+                for ( c = 0 ; c < n ; ++c )
+                        po[c] = pi[c] - ( - b1*(p1[c]-pi[c]) + b2*(p2[c]-pi[c]) - b3*(p3[c]-pi[c]) );
+        }
 
         // The first three steps of the anticausal filter
-        uu[0] = out[w*(h-1)] - iplus;
-        uu[1] = out[w*(h-2)] - iplus;
-        uu[2] = out[w*(h-3)] - iplus;
+        p1 = out + ( len - 1 ) * stride;
+        p2 = p1 - stride;
+        p3 = p2 - stride;
+        for ( c = 0 ; c < n ; ++c )
+        {
+                uu0 = p1[c] - iplus[c];
+                uu1 = p2[c] - iplus[c];
+                uu2 = p3[c] - iplus[c];
 
-        v[0] = M[0]*uu[0] - M[1]*uu[1] + M[2]*uu[2] + iplus;
-        v[1] = M[3]*uu[0] - M[4]*uu[1] + M[5]*uu[2] + iplus;
-        v[2] = M[6]*uu[0] - M[7]*uu[1] + M[8]*uu[2] + iplus;
+                v0[c] = M[0]*uu0 - M[1]*uu1 + M[2]*uu2 + iplus[c];
+                v1[c] = M[3]*uu0 - M[4]*uu1 + M[5]*uu2 + iplus[c];
+                v2[c] = M[6]*uu0 - M[7]*uu1 + M[8]*uu2 + iplus[c];
+        }
 
-        out[w*(h-1)] -= - b[1]*(v[0] - out[w*(h-1)]) + b[2]*(v[1]-out[w*(h-1)] ) - b[3]*(v[2]-out[w*(h-1)]);
-        out[w*(h-2)] -= - b[1]*(out[w*(h-1)]-out[w*(h-2)]) + b[2]*(v[0]-out[w*(h-2)] ) - b[3]*(v[1]-out[w*(h-2)]);
-        out[w*(h-3)] -= - b[1]*(out[w*(h-2)]-out[w*(h-3)]) + b[2]*(out[w*(h-1)]-out[w*(h-3)]) - b[3]*(v[0]-out[w*(h-3)]);
+        for ( c = 0 ; c < n ; ++c )
+                p1[c] -= - b1*(v0[c]-p1[c]) + b2*(v1[c]-p1[c]) - b3*(v2[c]-p1[c]);
+        for ( c = 0 ; c < n ; ++c )
+                p2[c] -= - b1*(p1[c]-p2[c]) + b2*(v0[c]-p2[c]) - b3*(v1[c]-p2[c]);
+        for ( c = 0 ; c < n ; ++c )
+                p3[c] -= - b1*(p2[c]-p3[c]) + b2*(p1[c]-p3[c]) - b3*(v0[c]-p3[c]);
 
         // the remainder of the anti-causal filter
-        for ( i = h - 4 ; i >= 0 ; --i )
-                out[i*w] -= - b[1]*(out[w*(i+1)]-out[w*i]) + b[2]*(out[w*(i+2)]-out[w*i]) - b[3]*(out[w*(i+3)]-out[w*i]);
+        for ( i = len - 4 ; i >= 0 ; --i )
+        {
+                po = out + i * stride;
+                p1 = po + stride;
+                p2 = p1 + stride;
+                p3 = p2 + stride;
+
+                for ( c = 0 ; c < n ; ++c )
+                        po[c] -= - b1*(p1[c]-po[c]) + b2*(p2[c]-po[c]) - b3*(p3[c]-po[c]);
+        }
 }
 
 /*****************************************************************************/
 
-static void
-_gauss_iir_1d_z ( float *in , float *out , const int w , const int h , const int z , const float sigma )
+static void*
+_gauss_iir_xy_slab ( void *arg )
 {
-        int i;
-        float iminus;   //  hypothetical signal value before start time, i.e. t=-1,-2,-3
-        float iplus;    // last sample of original signal, needed for right hand boundary values
+        gauss_iir_slab_t *slab = (gauss_iir_slab_t*) arg;
+        const mig_im_tiles_t *t = slab->tiles;
+        int i , j , k , n;
+        int w = slab->w , h = slab->h;
+        float *in , *out;
 
-        float  b[6];
-        double M[9];
-        float  v[4];
-        float uu[3];
+        for ( k = slab->start ; k < slab->end ; ++k )
+        {
+                in  = slab->in  + k * w * h;
+                out = slab->out + k * w * h;
 
-        _FilterCoeffs_TriggsCoeffs ( b , M , sigma );
-        iplus = in[w*h*(z-1)];
+                /* first convolution goes in horizontal direction ( x's ) :
+                   rows crossing no active tile hold zeros only */
+                for ( j = 0 ; j < h ; ++j )
+                {
+                        if ( t && !mig_im_tiles_any ( t , 0 , w - 1 , j , j , k , k ) )
+                                memset ( out + j * w , 0x00 , w * sizeof(float) );
+                        else
+                                _gauss_iir_1d_x ( in + j * w , out + j * w , w , slab->b , slab->M );
+                }
 
-        // Initialize first three steps of the causal filter
-        iminus = in[0];
-        out[0] = in[0] - ( - b[1]*(iminus-in[0]) + b[2]*(iminus-in[0]) - b[3]*(iminus-in[0]) );
-        out[w*h] = in[w*h] - ( - b[1]*(out[0]-in[w*h]) + b[2]*(iminus-in[w*h]) - b[3]*(iminus-in[w*h]) );
-        out[2*w*h] = in[2*w*h] - ( - b[1]*(out[w*h]-in[2*w*h]) + b[2]*(out[0]-in[2*w*h]) - b[3]*(iminus-in[2*w*h]) );
+                /* second convolution goes in vertical direction ( y's ) :
+                   all columns of a block advance together row by row */
+                for ( i = 0 ; i < w ; i += n )
+                {
+                        n = ( t ) ? MIG_MIN2 ( t->len , w - i ) : MIG_MIN2 ( GAUSS_IIR_BLOCK , w - i );
 
-        // the remainder of the causal filter
-        for ( i = 3 ; i < z ; ++i )
-                out[i*w*h] = in[i*w*h] - ( - b[1]*(out[(i-1)*w*h]-in[i*w*h]) + b[2]*(out[(i-2)*w*h]-in[i*w*h]) - b[3]*(out[(i-3)*w*h]-in[i*w*h]) );
+                        /* columns crossing no active tile are left out */
+                        if ( t && !mig_im_tiles_any ( t , i , i , 0 , h - 1 , k , k ) )
+                        {
+                                for ( j = 0 ; j < h ; ++j )
+                                        memset ( out + i + j * w , 0x00 , n * sizeof(float) );
+                                continue;
+                        }
 
-        // The first three steps of the anticausal filter
-        uu[0] = out[w*h*(z-1)] - iplus;
-        uu[1] = out[w*h*(z-2)] - iplus;
-        uu[2] = out[w*h*(z-3)] - iplus;
+                        _gauss_iir_1d_cols ( out + i , out + i , n , h , w , slab->b , slab->M );
+                }
+        }
 
-        v[0] = M[0]*uu[0] - M[1]*uu[1] + M[2]*uu[2] + iplus;
-        v[1] = M[3]*uu[0] - M[4]*uu[1] + M[5]*uu[2] + iplus;
-        v[2] = M[6]*uu[0] - M[7]*uu[1] + M[8]*uu[2] + iplus;
+        return NULL;
+}
 
-        out[w*h*(z-1)] -= - b[1]*(v[0] - out[w*h*(z-1)]) + b[2]*(v[1]-out[w*h*(z-1)] ) - b[3]*(v[2]-out[w*h*(z-1)]);
-        out[w*h*(z-2)] -= - b[1]*(out[w*h*(z-1)]-out[w*h*(z-2)]) + b[2]*(v[0]-out[w*h*(z-2)] ) - b[3]*(v[1]-out[w*h*(z-2)]);
-        out[w*h*(z-3)] -= - b[1]*(out[w*h*(z-2)]-out[w*h*(z-3)]) + b[2]*(out[w*h*(z-1)]-out[w*h*(z-3)]) - b[3]*(v[0]-out[w*h*(z-3)]);
+/*****************************************************************************/
 
-        // the remainder of the anti-causal filter
-        for ( i = z - 4 ; i >= 0 ; --i )
-                out[i*w*h] -= - b[1]*(out[w*h*(i+1)]-out[w*h*i]) + b[2]*(out[w*h*(i+2)]-out[w*h*i]) - b[3]*(out[w*h*(i+3)]-out[w*h*i]);
+static void*
+_gauss_iir_z_slab ( void *arg )
+{
+        gauss_iir_slab_t *slab = (gauss_iir_slab_t*) arg;
+        const mig_im_tiles_t *t = slab->tiles;
+        int i , k , n , x , y;
+        int w = slab->w , wh = slab->w * slab->h;
+
+        /* a block of the slice plane may span several rows : this is what
+           blocks the z pass across y */
+        for ( i = slab->start ; i < slab->end ; i += n )
+        {
+                n = MIG_MIN2 ( GAUSS_IIR_BLOCK , slab->end - i );
+
+                if ( t )
+                {
+                        /* with tiles a block never leaves its tile row */
+                        x = i % w;
+                        y = i / w;
+                        n = MIG_MIN2 ( n , MIG_MIN2 ( ( x / t->len + 1 ) * t->len , w ) - x );
+
+                        if ( !mig_im_tiles_any ( t , x , x , y , y , 0 , slab->z - 1 ) )
+                        {
+                                for ( k = 0 ; k < slab->z ; ++k )
+                                        memset ( slab->out + i + k * wh , 0x00 , n * sizeof(float) );
+                                continue;
+                        }
+                }
+
+                _gauss_iir_1d_cols ( slab->out + i , slab->out + i , n , slab->z , wh , slab->b , slab->M );
+        }
+
+        return NULL;
+}
+
+/*****************************************************************************/
+
+static void
+_gauss_iir_run ( void* (*routine)( void* ) , const gauss_iir_slab_t *tmpl ,
+                 int len , int num_threads )
+{
+        gauss_iir_pass_t pass;
+        gauss_iir_slab_t slab;
+
+        pass.routine = routine;
+        pass.tmpl    = tmpl;
+        pass.len     = len;
+
+        /* keep z pass chunks aligned to column blocks */
+        num_threads = MIG_MAX2 ( MIG_MIN2 ( num_threads , len ) , 1 );
+        pass.chunk = ( len + num_threads * GAUSS_IIR_SLABS_PER_THREAD - 1 ) /
+                     ( num_threads * GAUSS_IIR_SLABS_PER_THREAD );
+        if ( routine == &_gauss_iir_z_slab )
+                pass.chunk = ( ( pass.chunk + GAUSS_IIR_BLOCK - 1 ) / GAUSS_IIR_BLOCK ) * GAUSS_IIR_BLOCK;
+        pass.chunk = MIG_MAX2 ( pass.chunk , 1 );
+
+        if ( num_threads > 1 &&
+             mig_ut_pool_run ( mig_ut_pool_chunks ( len , pass.chunk ) , num_threads ,
+                               &_gauss_iir_task , &pass ) == 0 )
+                return;
+
+        /* serial processing ( pool tasks never fail : the pool only
+           returns an error when it could not be set up ) */
+        slab = *tmpl;
+        slab.start = 0;
+        slab.end   = len;
+        routine ( &slab );
+}
+
+/*****************************************************************************/
+
+static int
+_gauss_iir_task ( void *arg ,
+                  int task ,
+                  int worker )
+{
+        gauss_iir_pass_t *pass = (gauss_iir_pass_t*) arg;
+        gauss_iir_slab_t slab = *( pass->tmpl );
+
+        slab.start = MIG_MIN2 ( task * pass->chunk , pass->len );
+        slab.end   = MIG_MIN2 ( ( task + 1 ) * pass->chunk , pass->len );
+        pass->routine ( &slab );
+
+        return 0;
 }
 
 /*****************************************************************************/
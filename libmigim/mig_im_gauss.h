@@ -17,6 +17,8 @@
 #include "mig_data_types.h"
 #include "mig_error_codes.h"
 
+#include "mig_im_tile.h"
+
 MIG_C_LINKAGE_START
 
 /*
@@ -52,6 +54,95 @@ MIG_C_LINKAGE_START
 void
 mig_im_gauss_iir_3d ( float *in , float *out , int w , int h , int z , float sigma );
 
+/*
+******************************************************************************
+*               3D GAUSSIAN IIR FILTERING - MULTITHREADED
+*
+* Description : Same as mig_im_gauss_iir_3d. The x and y passes are split
+*               in z slabs and the z pass in ranges of the slice plane,
+*               each range being processed by its own thread. Recursive
+*               y and z passes run on blocks of adjacent columns so that
+*               memory is always walked sequentially.
+*
+* Arguments   : in          - input signal
+*               out         - output filtered signal
+*               w           - input signal width
+*               h           - input signal height
+*               z           - input signal z
+*               sigma       - gaussian sigma
+*               num_threads - number of threads to use ( 1 -> serial )
+*
+* Returns     :
+*
+* Notes       : in and out may be the same buffer
+*
+******************************************************************************
+*/
+
+void
+mig_im_gauss_iir_3d_mt ( float *in , float *out , int w , int h , int z , float sigma , int num_threads );
+
+/*
+******************************************************************************
+*               3D GAUSSIAN IIR FILTERING - RESTRICTED TO TILES
+*
+* Description : Same as mig_im_gauss_iir_3d_mt but x rows, y columns and z
+*               columns crossing no active tile are not filtered and are
+*               set to zero instead. Input must be zero outside the active
+*               tiles, which should be dilated by a few sigmas around the
+*               non zero input so that the truncated gaussian tails are
+*               negligible.
+*
+* Arguments   : in          - input signal
+*               out         - output filtered signal
+*               w           - input signal width
+*               h           - input signal height
+*               z           - input signal z
+*               sigma       - gaussian sigma
+*               tiles       - active tiles ( NULL -> whole volume )
+*               num_threads - number of threads to use ( 1 -> serial )
+*
+* Returns     :
+*
+* Notes       : in and out may be the same buffer
+*
+******************************************************************************
+*/
+
+void
+mig_im_gauss_iir_3d_tiles ( float *in , float *out , int w , int h , int z , float sigma ,
+                            const mig_im_tiles_t *tiles , int num_threads );
+
+/*
+******************************************************************************
+*               3D GAUSSIAN IIR FILTERING - ANISOTROPIC
+*
+* Description : Same as mig_im_gauss_iir_3d_tiles with a separate sigma for
+*               the z pass , used on volumes whose slice spacing differs
+*               from the in-plane voxel size.
+*
+* Arguments   : in          - input signal
+*               out         - output filtered signal
+*               w           - input signal width
+*               h           - input signal height
+*               z           - input signal z
+*               sigma       - gaussian sigma along x and y
+*               sigma_z     - gaussian sigma along z
+*               tiles       - active tiles ( NULL -> whole volume )
+*               num_threads - number of threads to use ( 1 -> serial )
+*
+* Returns     :
+*
+* Notes       : in and out may be the same buffer
+*
+******************************************************************************
+*/
+
+void
+mig_im_gauss_iir_3d_aniso ( float *in , float *out , int w , int h , int z ,
+                            float sigma , float sigma_z ,
+                            const mig_im_tiles_t *tiles , int num_threads );
+
 /*
 ******************************************************************************
 *               2D GAUSSIAN IIR FILTERING
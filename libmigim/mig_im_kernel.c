@@ -168,11 +168,20 @@ mig_im_kernel_get_log_2d ( float sigma )
 /* hat is negative! */
 mig_kernel_t*
 mig_im_kernel_get_log_3d ( float sigma )
+{
+        return mig_im_kernel_get_log_3d_aniso ( sigma , 1.0f );
+}
+
+/*****************************************************************************/
+
+mig_kernel_t*
+mig_im_kernel_get_log_3d_aniso ( float sigma , float z_ratio )
 {
 	mig_kernel_t *log;
     float sigma2 , sigma4 , norm = 0.0f;
 	float abs_sum = 0.0f;
     float *idx;
+    float z2 = z_ratio * z_ratio;
     int i , j, k;
 	int offset;
 
@@ -188,7 +197,13 @@ mig_im_kernel_get_log_3d ( float sigma )
     if ( ( log->d % 2 ) == 0 )
             log->d ++;
     log->r = (int) ( log->d * 0.5f );
-	log->n = MIG_POW3(log->d);
+
+    /* z extent covers the same physical distance */
+    log->dz = (int) ( 3.0f * 2.0f * log->sigma / z_ratio );
+    if ( ( log->dz % 2 ) == 0 )
+            log->dz ++;
+    log->rz = (int) ( log->dz * 0.5f );
+	log->n = MIG_POW2(log->d) * log->dz;
 
     log->data = (float*)
         malloc ( log->n * sizeof(float) );
@@ -198,18 +213,18 @@ mig_im_kernel_get_log_3d ( float sigma )
         return NULL;
     }
 
-    idx = log->data + log->d * log->d * log->r   + log->r + log->r * log->d;
+    idx = log->data + log->d * log->d * log->rz  + log->r + log->r * log->d;
     sigma2 = MIG_POW2( sigma );
     sigma4 = MIG_POW2( sigma2 );
 
     /* calculate exponent */
-    for ( k = -log->r; k <= log->r ; ++k )
+    for ( k = -log->rz; k <= log->rz ; ++k )
 	{
 		for ( j = -log->r ; j <= log->r ; ++j )
 		{
 			for ( i = -log->r ; i <= log->r ; ++i )
 			{
-				idx[i+ j*log->d + k * log->d * log->d ] = expf( ( -((float)(i*i+j*j+k*k)) * 0.5f ) / sigma2 );
+				idx[i+ j*log->d + k * log->d * log->d ] = expf( ( -((float)(i*i+j*j) + z2 * (float)(k*k)) * 0.5f ) / sigma2 );
 				//norm += idx[i+j*log->d+ k * log->d * log->d ];
 			}
 		}
@@ -228,14 +243,14 @@ mig_im_kernel_get_log_3d ( float sigma )
     /* calculate rest */
     norm = 0.0f;
 	offset = 0;
-	for ( k =  -log->r ; k <= log->r ; ++k )
+	for ( k =  -log->rz ; k <= log->rz ; ++k )
 	{
 		for ( j = -log->r ; j <= log->r ; ++j )
 		{
 			for ( i = -log->r ; i <= log->r ; ++i )
 			{
 				offset = i+j*log->d + + k * log->d * log->d;
-				idx[offset] *=  ( ( (float)( i*i + j*j +k*k) ) - 3.0f * sigma2 ) / sigma4 ;
+				idx[offset] *=  ( ( (float)( i*i + j*j ) + z2 * (float)( k*k ) ) - 3.0f * sigma2 ) / sigma4 ;
 				/*norm is in such a way that sum of all terms is zero and maximum response is always 1*/
 				norm += idx[offset];
 				
@@ -59,6 +59,9 @@ typedef struct
         float scale;            /* sigma * SQRT(2) */
         float sigma;            /* sigma for gaussian like kernels */
 
+        int rz;                 /* z radius of 3d kernels */
+        int dz;                 /* z diameter of 3d kernels */
+
 } mig_kernel_t;
 
 /*
@@ -136,6 +139,29 @@ mig_im_kernel_get_log_2d ( float sigma );
 mig_kernel_t*
 mig_im_kernel_get_log_3d ( float sigma );
 
+/*
+******************************************************************************
+*               BUILD ANISOTROPIC 3D LAPLACIAN OF GAUSSIAN KERNEL
+*
+* Description : Same as mig_im_kernel_get_log_3d on a grid whose z spacing
+*               is z_ratio times the in-plane spacing. The LoG is isotropic
+*               in physical space : the kernel is sampled at squared
+*               distance i*i + j*j + ( z_ratio * k )^2 in-plane voxels.
+*
+* Arguments   : sigma   - gaussian sigma in in-plane voxels
+*               z_ratio - z spacing / in-plane spacing
+*
+* Returns     : filled mig_kernel_t structure on success
+*               NULL on error
+*
+* Notes       : kernel is d x d x dz , z radius is 3 * sigma / z_ratio
+*               z_ratio 1 gives exactly mig_im_kernel_get_log_3d
+*
+******************************************************************************
+*/
+mig_kernel_t*
+mig_im_kernel_get_log_3d_aniso ( float sigma , float z_ratio );
+
 /*
 ******************************************************************************
 *               BUILD 1D MEAN KERNEL
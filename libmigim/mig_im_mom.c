@@ -11,6 +11,12 @@
 
 #include "mig_im_mom.h"
 
+/* images sharing each block of mask values : _mom_tile_block is written for 4 */
+#define MOM_TILE_IMAGES 4
+
+/* pixels per mask block */
+#define MOM_BLOCK_PIXELS 1024
+
 /*
 ******************************************************************************
 *               LOCAL PROTOTYPES DECLARATION
@@ -21,6 +27,13 @@
 extern "C" {
 #endif
 
+/* dot products of a tile of normalized image blocks with all mask rows ,
+   carried on in acc from the previous block */
+static void
+_mom_tile_block ( const float *norm , int len ,
+                  const float *matrix , int num_rows , int stride ,
+                  float *acc );
+
 /* fill masks with computed polynomials values for the orders passed in orders */
 static int _compute_masks ( mig_im_mom_t *Masks );
 
@@ -61,7 +74,6 @@ mig_im_mom_get ( int size, int *orders , int num_orders )
 	mig_im_mom_t *Masks;	
 
 	int i;
-	int error_state = 0;
 
 	Masks = (mig_im_mom_t*)
             calloc ( 1 , sizeof(mig_im_mom_t) );
@@ -78,50 +90,22 @@ mig_im_mom_get ( int size, int *orders , int num_orders )
 	Masks->elemsperorder = MIG_POW2(size);
 
 	
-	/* allocate space for computed value */
+	/* allocate space for computed value : one contiguous matrix */
 
 	Masks->values_re = (float**) calloc ( Masks->num_orders , sizeof(float*) );
 	Masks->values_im = (float**) calloc ( Masks->num_orders , sizeof(float*) );
-		
+	Masks->matrix = (float*) calloc ( 2 * Masks->num_orders * Masks->elemsperorder , sizeof(float) );
 
-	if ( Masks->values_re == NULL || Masks->values_im == NULL)
+	if ( Masks->values_re == NULL || Masks->values_im == NULL || Masks->matrix == NULL )
 	{
+		mig_im_mom_del ( Masks );
 		return NULL;
 	}
 	
-	memset (Masks->values_re, 0x00000000 , Masks->num_orders * sizeof(float*) );
-	memset (Masks->values_im, 0x00000000 , Masks->num_orders * sizeof(float*) );
-
 	for ( i = 0; i != Masks->num_orders; ++i )
 	{
-		Masks->values_re[i] = (float*) calloc ( Masks->elemsperorder , sizeof(float) );
-		if ( Masks->values_re[i] == NULL )
-		{
-			error_state = 1;
-			break;
-		}
-		Masks->values_im[i] = (float*) calloc ( Masks->elemsperorder , sizeof(float) );
-		if ( Masks->values_im[i] == NULL )
-		{
-			error_state = 1;
-			break;
-		}
-	}
-
-	if (error_state)
-	{
-		for ( i = 0; i != Masks->num_orders; ++i )
-		{
-			if ( Masks->values_re[i] )
-				free ( Masks->values_re[i] );
-			if ( Masks->values_im[i] )
-				free ( Masks->values_im[i] );
-		}
-		
-		free ( Masks->values_re );
-		free ( Masks->values_im );
-
-		return MIG_ERROR_MEMORY;
+		Masks->values_re[i] = Masks->matrix + ( 2 * i ) * Masks->elemsperorder;
+		Masks->values_im[i] = Masks->matrix + ( 2 * i + 1 ) * Masks->elemsperorder;
 	}
 
 
@@ -129,6 +113,7 @@ mig_im_mom_get ( int size, int *orders , int num_orders )
 
 	if ( _compute_masks( Masks ) )
 	{
+		mig_im_mom_del ( Masks );
 		return NULL;
 	}
 	
@@ -144,36 +129,82 @@ mig_im_mom_crop_2D ( float *crop,
                     mig_im_mom_t *Masks , 
                     float *moments )
 {
-	int i;
-	int order_idx;
-	float temp_re = 0;
-	float temp_im = 0;
-	int nelem;
+	return mig_im_mom_batch_2D ( crop , 1 , size , Masks , moments );
+}
+
+/****************************************************************************/
+
+int
+mig_im_mom_batch_2D ( const float *crops ,
+                      int num ,
+                      int size ,
+                      mig_im_mom_t *Masks ,
+                      float *moments )
+{
+	float norm[MOM_TILE_IMAGES * MOM_BLOCK_PIXELS];
+	float *acc = NULL;
+	const float *crop;
+	double re , im;
+	int nelem , num_rows , tile , num_tile , start , len;
+	int i , k , r;
 
 	if (size != Masks->size)
 		return MIG_ERROR_PARAM;
 
 	nelem = MIG_POW2(size);
+	num_rows = 2 * Masks->num_orders;
 
-	for ( order_idx = 0; order_idx < Masks->num_orders; order_idx++ )
+	/* running sum of each image of a tile against each mask row */
+	acc = (float*) malloc ( MOM_TILE_IMAGES * num_rows * sizeof(float) );
+	if ( acc == NULL )
+		return MIG_ERROR_MEMORY;
+
+	for ( tile = 0; tile < num; tile += MOM_TILE_IMAGES )
 	{
-		temp_re = 0;
-		temp_im = 0;
+		num_tile = MIG_MIN2 ( MOM_TILE_IMAGES , num - tile );
 
-		for ( i = 0; i != nelem; i++ )
+		memset ( acc , 0 , MOM_TILE_IMAGES * num_rows * sizeof(float) );
+
+		for ( start = 0; start < nelem; start += MOM_BLOCK_PIXELS )
 		{
-			/*workaround for last row of resize */
-			temp_re += ( MIG_MAX2(0,crop[i] / MIG_MAX_16U) ) * ( Masks->values_re[order_idx][i] );
-			temp_im += ( MIG_MAX2(0,crop[i] / MIG_MAX_16U) ) * ( Masks->values_im[order_idx][i] );
+			len = MIG_MIN2 ( MOM_BLOCK_PIXELS , nelem - start );
+
+			/* normalize pixels once for all orders , a partial tile is
+			   padded with empty images */
+			if ( num_tile < MOM_TILE_IMAGES )
+				memset ( norm + num_tile * MOM_BLOCK_PIXELS , 0 ,
+				         ( MOM_TILE_IMAGES - num_tile ) * MOM_BLOCK_PIXELS * sizeof(float) );
+
+			for ( k = 0; k < num_tile; ++k )
+			{
+				crop = crops + (size_t)( tile + k ) * nelem + start;
+
+				/*workaround for last row of resize */
+				for ( i = 0; i < len; ++i )
+					norm[k * MOM_BLOCK_PIXELS + i] = MIG_MAX2 ( 0 , crop[i] / MIG_MAX_16U );
+			}
+
+			_mom_tile_block ( norm , len ,
+			                  Masks->matrix + start , num_rows , nelem , acc );
 		}
 
-		moments[order_idx] = sqrt ( MIG_POW2((double)temp_re) + MIG_POW2((double)temp_im) );
+		/* magnitudes */
+		for ( k = 0; k < num_tile; ++k )
+		{
+			for ( r = 0; r < Masks->num_orders; ++r )
+			{
+				re = acc[k * num_rows + 2 * r];
+				im = acc[k * num_rows + 2 * r + 1];
+				moments[(size_t)( tile + k ) * Masks->num_orders + r] = sqrt ( MIG_POW2(re) + MIG_POW2(im) );
+			}
+		}
 	}
-	
+
+	free ( acc );
+
 	return MIG_OK;
 }
 
-
 /****************************************************************************/
 
 void
@@ -185,6 +216,8 @@ mig_im_mom_del ( mig_im_mom_t *Masks )
 				free ( Masks->values_re );
 			if ( Masks->values_im )
 				free ( Masks->values_im );
+			if ( Masks->matrix )
+				free ( Masks->matrix );
             free ( Masks );
 
 		}
@@ -196,6 +229,51 @@ mig_im_mom_del ( mig_im_mom_t *Masks )
 ******************************************************************************
 */
 
+static void
+_mom_tile_block ( const float *norm , int len ,
+                  const float *matrix , int num_rows , int stride ,
+                  float *acc )
+{
+	const float *n0 = norm , *n1 = norm + MOM_BLOCK_PIXELS;
+	const float *n2 = norm + 2 * MOM_BLOCK_PIXELS , *n3 = norm + 3 * MOM_BLOCK_PIXELS;
+	const float *mask_re , *mask_im;
+	float re0 , re1 , re2 , re3 , im0 , im1 , im2 , im3;
+	float *a;
+	int r , i;
+
+	/* one float sum per image and mask row , pixels in increasing order :
+	   the same values as the former per order loop , which the deployed
+	   svm and whitening were trained on. Speed comes from sharing each
+	   mask value between the tile images and from the eight independent
+	   sums , not from reordering the sums */
+	for ( r = 0; r < num_rows; r += 2 )
+	{
+		mask_re = matrix + (size_t) r * stride;
+		mask_im = mask_re + stride;
+		a = acc + r;
+
+		re0 = a[0];            im0 = a[1];
+		re1 = a[num_rows];     im1 = a[num_rows + 1];
+		re2 = a[2 * num_rows]; im2 = a[2 * num_rows + 1];
+		re3 = a[3 * num_rows]; im3 = a[3 * num_rows + 1];
+
+		for ( i = 0; i < len; ++i )
+		{
+			re0 += n0[i] * mask_re[i];  im0 += n0[i] * mask_im[i];
+			re1 += n1[i] * mask_re[i];  im1 += n1[i] * mask_im[i];
+			re2 += n2[i] * mask_re[i];  im2 += n2[i] * mask_im[i];
+			re3 += n3[i] * mask_re[i];  im3 += n3[i] * mask_im[i];
+		}
+
+		a[0] = re0;            a[1] = im0;
+		a[num_rows] = re1;     a[num_rows + 1] = im1;
+		a[2 * num_rows] = re2; a[2 * num_rows + 1] = im2;
+		a[3 * num_rows] = re3; a[3 * num_rows + 1] = im3;
+	}
+}
+
+/*************************************************************************/
+
 int _compute_masks( mig_im_mom_t *Masks )
 {
 	int order_idx = 0;
@@ -54,6 +54,8 @@ typedef struct _mig_im_mom_t
 		int				elemsperorder;			/* at the same radius we have all the same lengths */
 		float			**values_re;		    /* for each order we have an array of discretized poly real values */
 		float			**values_im;			/* for each order we have an array of discretized poly imaginary values */
+		float			*matrix;				/* 2 * num_orders rows of elemsperorder values : real and imaginary
+												   mask of each order in turn , values_re and values_im point here */
 } mig_im_mom_t;
 
 
@@ -115,6 +117,42 @@ mig_im_mom_crop_2D ( float *crop,
                     mig_im_mom_t *Masks , 
                     float *moments );
 
+/*
+******************************************************************************
+*                       GET MOMENTS OF A BATCH OF 2D IMAGES
+*
+* Description : This function extracts moments from num images stored one
+*               after the other , as a product of the image matrix by the
+*               mask matrix. Images are processed in tiles which share each
+*               block of mask values , pixels are normalized once per image
+*               instead of once per order.
+*
+* Arguments   : crops      - num images of size x size pixels , contiguous
+*               num        - number of images
+*               size       - image side
+*               Masks      - prepared moment masks structure
+*               moments    - num rows of Masks->num_orders moments
+*
+* Returns     : MIG_OK on success
+*               MIG_ERROR_PARAM if size does not match the masks
+*               MIG_ERROR_MEMORY on error
+*
+* Notes       : moments of an image do not depend on the batch it comes
+*               with : mig_im_mom_crop_2D is a batch of one image. Each
+*               moment is the same float sum , in the same pixel order , as
+*               the former per order loop , so features match the models
+*               trained before batching.
+*
+******************************************************************************
+*/
+
+int
+mig_im_mom_batch_2D ( const float *crops ,
+                      int num ,
+                      int size ,
+                      mig_im_mom_t *Masks ,
+                      float *moments );
+
 /*
 ******************************************************************************
 *                       DELETE MOMENT MASKS STRUCTURE
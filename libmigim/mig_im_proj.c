@@ -182,6 +182,169 @@ mig_im_proj_mip_axes_vol_32f(  float *src , float *dst , int w , int h, int d, i
 }
 
 
+/* mip ranges and stack bounds of the cube of one radius */
+typedef struct _proj_cut_t
+{
+	int r , d;
+	int start1 , stop1 , start2 , stop2;
+	int lo , hi;                    /* direction 0 range inside the stack */
+	int x0 , x1 , y0 , y1 , z0 , z1;
+	float *mip0 , *mip1 , *mip2;
+
+} proj_cut_t;
+
+/* same ranges as mig_im_proj_mip_axes_vol_32f : the cube is never built ,
+   voxels outside the stack are 0 as in mig_im_bb_cut_3d and never raise a
+   max of non negative values. Direction 1 also takes row 0 of the next
+   slice and direction 2 slice d when their range ends past the cube , as
+   the pointer walk of mig_im_proj_mip_axes_vol_32f does : past the cube
+   nothing is read. */
+int
+mig_im_proj_mip_axes_cut_16u ( Mig16u *src , int w , int h , int z ,
+                               int cx , int cy , int cz , int r ,
+                               float ratio , float *dst )
+{
+	return mig_im_proj_mip_axes_cuts_16u ( src , w , h , z , cx , cy , cz ,
+	                                       &r , 1 , ratio , dst );
+}
+
+/* cubes of smaller radii lie inside the largest one : a single walk over
+   the rows of the largest cube feeds the mips of every radius whose cube
+   holds the row */
+int
+mig_im_proj_mip_axes_cuts_16u ( Mig16u *src , int w , int h , int z ,
+                                int cx , int cy , int cz ,
+                                const int *radii , int num_radii ,
+                                float ratio , float *dst )
+{
+	proj_cut_t cuts[MIG_PROJ_MAX_CUTS];
+	proj_cut_t *c;
+	int n , d , start0 , stop0;
+	int i , j , k , cj , ck;
+	int y0 , y1 , z0 , z1;
+	int in1 , in1_prev , in2;
+	float *row1 , *row1_prev , *row2;
+	float v , m;
+	Mig16u *slice , *row;
+
+	if (ratio < 0 || ratio > 1) return MIG_ERROR_PARAM;
+	if (num_radii < 1 || num_radii > MIG_PROJ_MAX_CUTS) return MIG_ERROR_PARAM;
+
+	y0 = y1 = z0 = z1 = 0;
+
+	for ( n = 0; n < num_radii; ++n )
+	{
+		c = &cuts[n];
+		c->r = radii[n];
+		c->d = d = 2 * c->r + 1;
+
+		/* mip ranges in cube coordinates , last index included */
+		start0 = d * (1.0001 - ratio) / 2;
+		stop0 = MIN(d - start0 + 1, d) - 1;
+
+		c->start1 = d * (1.001 - ratio) / 2;
+		c->stop1 = MIN(d - c->start1 + 1, d);
+
+		c->start2 = d * (1.001 - ratio) / 2;
+		c->stop2 = MIN(d - c->start2 + 1, d);
+
+		c->mip0 = dst;
+		c->mip1 = dst + d * d;
+		c->mip2 = dst + 2 * d * d;
+		dst += 3 * d * d;
+
+		memset ( c->mip0 , 0 , 3 * d * d * sizeof(float) );
+
+		/* cube part inside the stack , as in mig_im_bb_cut_3d */
+		c->x0 = ( ( cx - c->r ) < 0 )? cx : c->r;
+		c->x1 = ( ( cx + c->r ) >= w )? (w - cx) - 1 : c->r;
+
+		c->y0 = ( ( cy - c->r ) < 0 )? cy : c->r;
+		c->y1 = ( ( cy + c->r ) >= h )? (h - cy) - 1 : c->r;
+
+		c->z0 = ( ( cz - c->r ) < 0 )? cz : c->r;
+		c->z1 = ( ( cz + c->r ) >= z )? (z - cz) - 1 : c->r;
+
+		c->lo = MAX(-c->x0, start0 - c->r);
+		c->hi = MIN(c->x1, stop0 - c->r);
+
+		/* rows of the largest cube */
+		y0 = MAX(y0, c->y0);
+		y1 = MAX(y1, c->y1);
+		z0 = MAX(z0, c->z0);
+		z1 = MAX(z1, c->z1);
+	}
+
+	for ( k = -z0; k <= z1; ++k )
+	{
+		slice = src + cx + cy * w + ( cz + k ) * w * h;
+
+		for ( j = -y0; j <= y1; ++j )
+		{
+			row = slice + j * w;
+
+			for ( n = 0; n < num_radii; ++n )
+			{
+				c = &cuts[n];
+				if ( k < -c->z0 || k > c->z1 || j < -c->y0 || j > c->y1 )
+					continue;
+
+				d = c->d;
+				ck = k + c->r;
+				cj = j + c->r;
+
+				in1 = ( cj >= c->start1 && cj <= c->stop1 );
+				in1_prev = ( c->stop1 == d && cj == 0 && ck > 0 );
+				in2 = ( ck >= c->start2 && ck <= c->stop2 );
+
+				row1 = c->mip1 + ck * d + c->r;
+				row1_prev = c->mip1 + ( ck - 1 ) * d + c->r;
+				row2 = c->mip2 + cj * d + c->r;
+
+				/* direction 0 : along x */
+				m = 0.0f;
+				for ( i = c->lo; i <= c->hi; ++i )
+				{
+					v = (float) row[i];
+					if ( m < v )
+						m = v;
+				}
+				c->mip0[ck * d + cj] = m;
+
+				/* direction 1 : along y */
+				if ( in1 )
+					for ( i = -c->x0; i <= c->x1; ++i )
+					{
+						v = (float) row[i];
+						if ( row1[i] < v )
+							row1[i] = v;
+					}
+
+				if ( in1_prev )
+					for ( i = -c->x0; i <= c->x1; ++i )
+					{
+						v = (float) row[i];
+						if ( row1_prev[i] < v )
+							row1_prev[i] = v;
+					}
+
+				/* direction 2 : along z */
+				if ( in2 )
+					for ( i = -c->x0; i <= c->x1; ++i )
+					{
+						v = (float) row[i];
+						if ( row2[i] < v )
+							row2[i] = v;
+					}
+			}
+		}
+	}
+
+	return MIG_OK;
+}
+
+/*******************************************************************/
+
 int mig_im_proj_mip_z_stack_single(  float *src , float *dst , int w , int h, int d, int z, int radius)
 {
 	int rc = 0;
@@ -15,6 +15,31 @@ MIG_C_LINKAGE_START
 extern int
 mig_im_proj_mip_axes_vol_32f(  float *src , float *dst , int w , int h, int d, int dir_idx, float ratio);
 
+/*
+ * mips along the 3 axes of the cube of radius r around ( cx , cy , cz ) of a
+ * 16 bit stack , without cutting the cube : dst holds 3 images of
+ * ( 2r + 1 )^2 values laid out as mig_im_proj_mip_axes_vol_32f lays out
+ * the mips of the cube cut by mig_im_bb_cut_3d. Stack voxels are read once.
+ */
+extern int
+mig_im_proj_mip_axes_cut_16u ( Mig16u *src , int w , int h , int z ,
+                               int cx , int cy , int cz , int r ,
+                               float ratio , float *dst );
+
+/* largest number of radii of mig_im_proj_mip_axes_cuts_16u */
+#define MIG_PROJ_MAX_CUTS 8
+
+/*
+ * mig_im_proj_mip_axes_cut_16u for num_radii cubes around the same center ,
+ * reading the voxels of the largest cube once : dst holds the 3 mips of
+ * every radius , one ( 2r + 1 )^2 x 3 block after the other in radii order.
+ */
+extern int
+mig_im_proj_mip_axes_cuts_16u ( Mig16u *src , int w , int h , int z ,
+                                int cx , int cy , int cz ,
+                                const int *radii , int num_radii ,
+                                float ratio , float *dst );
+
 extern int
 mig_im_proj_mip_z_stack_single(  float *src , float *dst , int w , int h, int d, int z, int radius);
 
@@ -11,6 +11,54 @@
 
 #include "mig_im_regc.h"
 
+#include <pthread.h>
+
+/*
+******************************************************************************
+*                               LOCAL DATA TYPES
+******************************************************************************
+*/
+
+/* initial number of runs allocated by a labeling thread */
+#define REGC_RUNS_INIT 1024
+
+/* consecutive on voxels along a row */
+typedef struct _regc_run_t
+{
+        int             x0 , x1;    /* first and last voxel of run */
+        int             y , z;      /* run row and slice */
+        int             parent;     /* union find parent : never greater than run index */
+        float           peak;       /* highest voxel value along run */
+
+} regc_run_t;
+
+/* runs found by a single labeling thread */
+typedef struct _regc_slab_t
+{
+        float           *Binary;    /* input volume */
+        int             w;          /* volume width */
+        int             h;          /* volume height */
+        int             start;      /* first slice of slab */
+        int             end;        /* one past last slice of slab */
+        regc_run_t      *runs;      /* runs in raster order */
+        int             num_runs;   /* number of runs found */
+        int             max_runs;   /* allocated runs */
+        int             *rows;      /* first run of every slab row + one past last run */
+        int             rc;         /* 0 on success , -1 on allocation error */
+
+} regc_slab_t;
+
+/* region visited by mig_im_regc_merge_near */
+typedef struct _regc_near_t
+{
+        float           score;      /* region score */
+        int             idx;        /* region index in list order */
+
+} regc_near_t;
+
+/* hash of the cell holding x , y , z cell coordinates */
+#define REGC_CELL_HASH(x,y,z) ( (unsigned int)(x) * 73856093u ^ (unsigned int)(y) * 19349663u ^ (unsigned int)(z) * 83492791u )
+
 /*
 ******************************************************************************
 *                               LOCAL PROTOTYPES DECLARATION
@@ -19,35 +67,65 @@
 
 /*
 ******************************************************************************
-*                       PROCESS A SINGLE 3D CONNECTED REGION
+*                       FIND AND MERGE RUNS OF A SLAB
 *
-* Description : This function finds the pixels belonging to a single
-*               26 connected 3D region starting from a single pixel
-*               known to belong to the region.
+* Description : This function splits every row of a z slab in runs of on
+*               voxels and merges runs 26 connected to runs of the
+*               previous row and of the previous slice of the same slab.
 *
-* Arguments   : x      - horizontal coordinate of first pixel
-*               y      - vertical coordinate of first pixel
-*               z      - z coordinate of first pixel
-*               Binary - 3D input stack
-*               Width  - input stack width
-*               Height - input stack height
-*               Depth  - input stack z
-*               Region - found 3D region ( returned )
+* Arguments   : arg - regc_slab_t describing the slab
 *
-* Returns     : 0 on success
-*               -1 or error
+* Returns     : NULL
 *
-* Notes       : Input array ( Binary ) is zeroed as new pixels blonging to 3D region
-*               are found !
+* Notes       : Binary voxels of the slab are zeroed as runs are found !
 *
 ******************************************************************************
 */
 
+static void*
+_regc_slab ( void *arg );
+
+/*
+******************************************************************************
+*                       MERGE TOUCHING RUNS OF TWO ROWS
+*
+* Description : This function merges every run in [a0,a1) with every run
+*               in [b0,b1) it touches. Runs of both rows are sorted along x
+*               and touch if they overlap or are diagonal neighbours.
+*
+* Arguments   : runs   - run array
+*               a0, a1 - runs of first row
+*               b0, b1 - runs of second row
+*
+* Returns     :
+*
+******************************************************************************
+*/
+
+static void
+_regc_link_rows ( regc_run_t *runs , int a0 , int a1 , int b0 , int b1 );
+
+/*
+******************************************************************************
+*                       FIND ROOT RUN
+******************************************************************************
+*/
+
 static int
-_process_region_3d ( int x , int y , int z ,
-                     float *Binary ,
-                     int Width , int Height , int Depth ,
-                     mig_im_region_t *Region );
+_regc_find ( regc_run_t *runs , int i );
+
+/*
+******************************************************************************
+*                       COMPARE REGIONS BY DECREASING SCORE
+*
+* Description : qsort comparison function : higher scores first , ties
+*               broken by list order.
+*
+******************************************************************************
+*/
+
+static int
+_regc_near_cmp ( const void *a , const void *b );
 
 /*
 ******************************************************************************
@@ -90,43 +168,334 @@ mig_im_regc_3d ( float *Binary ,
                  int Width , int Height , int Depth ,
                  mig_lst_t *Regions )
 {
-        int i , j , k;
+        return mig_im_regc_3d_mt ( Binary , Width , Height , Depth , Regions , 1 );
+}
+
+/******************************************************************************/
+
+int
+mig_im_regc_3d_mt ( float *Binary ,
+                    int Width , int Height , int Depth ,
+                    mig_lst_t *Regions , int num_threads )
+{
+        int i , j , t , created;
+        int chunk , num_runs , num_regions , off , prev;
+        int rc = -1;
+        pthread_t *threads = NULL;
+        regc_slab_t *slabs = NULL;
+        regc_run_t *runs = NULL;
+        int *label = NULL;
+        int *size = NULL;
+        double *sum = NULL;
+        float *peak = NULL;
         mig_im_region_t *NewRegion = NULL;
 
-        for ( k = 0 ; k < Depth  ; ++ k )
+        if ( Depth <= 0 )
+                return 0;
+
+        num_threads = MIG_MAX2 ( MIG_MIN2 ( num_threads , Depth ) , 1 );
+        chunk = ( Depth + num_threads - 1 ) / num_threads;
+
+        threads = (pthread_t*) malloc ( num_threads * sizeof(pthread_t) );
+        slabs = (regc_slab_t*) calloc ( num_threads , sizeof(regc_slab_t) );
+        if ( threads == NULL || slabs == NULL )
+                goto error;
+
+        for ( t = 0 ; t < num_threads ; ++t )
         {
-                for ( j = 0 ; j < Height ; ++ j )
+                slabs[t].Binary = Binary;
+                slabs[t].w      = Width;
+                slabs[t].h      = Height;
+                slabs[t].start  = MIG_MIN2 ( t * chunk , Depth );
+                slabs[t].end    = MIG_MIN2 ( ( t + 1 ) * chunk , Depth );
+        }
+
+        /* 1. runs of every slab : thread 0 work is done by calling thread */
+        for ( t = 1 , created = 0 ; t < num_threads ; ++t )
+        {
+                if ( pthread_create ( &( threads[t] ) , NULL , &_regc_slab , &( slabs[t] ) ) != 0 )
+                        break;
+                ++created;
+        }
+
+        _regc_slab ( &( slabs[0] ) );
+
+        for ( t = 1 ; t <= created ; ++t )
+                pthread_join ( threads[t] , NULL );
+
+        /* slabs whose thread could not be created are done serially */
+        for ( t = created + 1 ; t < num_threads ; ++t )
+                _regc_slab ( &( slabs[t] ) );
+
+        for ( t = 0 , num_runs = 0 ; t < num_threads ; ++t )
+        {
+                if ( slabs[t].rc != 0 )
+                        goto error;
+                num_runs += slabs[t].num_runs;
+        }
+
+        if ( num_runs == 0 )
+        {
+                rc = 0;
+                goto error;
+        }
+
+        /* 2. gather runs in raster order and merge slab boundaries */
+        runs = (regc_run_t*) malloc ( num_runs * sizeof(regc_run_t) );
+        if ( runs == NULL )
+                goto error;
+
+        for ( t = 0 , off = 0 , prev = 0 ; t < num_threads ; ++t )
+        {
+                for ( i = 0 ; i < slabs[t].num_runs ; ++i )
                 {
-                        for ( i = 0 ; i < Width ; ++i )
+                        runs[off+i] = slabs[t].runs[i];
+                        runs[off+i].parent += off;
+                }
+
+                /* first slice of this slab against last slice of previous one */
+                if ( t > 0 && slabs[t].start < slabs[t].end )
+                {
+                        for ( j = 0 ; j < Height ; ++j )
                         {
-                                /* skip zero pixels */
-							if ( Binary[i+j*Width+k*Width*Height] <= MIG_EPS_32F )
-                                        continue;
+                                for ( i = MIG_MAX2 ( j - 1 , 0 ) ; i <= MIG_MIN2 ( j + 1 , Height - 1 ) ; ++i )
+                                {
+                                        int r = ( slabs[t-1].end - slabs[t-1].start - 1 ) * Height + i;
+
+                                        _regc_link_rows ( runs ,
+                                                          prev + slabs[t-1].rows[r] , prev + slabs[t-1].rows[r+1] ,
+                                                          off + slabs[t].rows[j] , off + slabs[t].rows[j+1] );
+                                }
+                        }
+                }
 
-                                /* if we get here we struck a white (on)
-                                   pixel -> new region */
-                                NewRegion = (mig_im_region_t*) calloc ( 1 , sizeof(mig_im_region_t) );
-                                if ( NewRegion == NULL )
-                                        goto error;
+                prev = off;
+                off += slabs[t].num_runs;
+        }
 
-                                /* calculate properties for this region */
-                                if ( _process_region_3d ( i , j , k , Binary ,
-                                        Width , Height , Depth , NewRegion ) == -1 )
-                                        goto error;
+        /* 3. parents precede children : a single ordered pass flattens trees */
+        label = (int*) malloc ( num_runs * sizeof(int) );
+        if ( label == NULL )
+                goto error;
 
-                                /* add new region to stack */
-                                if ( mig_lst_put_tail ( Regions , NewRegion ) != 0 )
-                                        goto error;
-                        }
+        for ( i = 0 , num_regions = 0 ; i < num_runs ; ++i )
+        {
+                runs[i].parent = runs[runs[i].parent].parent;
+                label[i] = ( runs[i].parent == i ) ? num_regions++ : label[runs[i].parent];
+        }
+
+        /* 4. region properties summed over runs */
+        size = (int*) calloc ( num_regions , sizeof(int) );
+        sum = (double*) calloc ( 3 * num_regions , sizeof(double) );
+        peak = (float*) calloc ( num_regions , sizeof(float) );
+        if ( size == NULL || sum == NULL || peak == NULL )
+                goto error;
+
+        for ( i = 0 ; i < num_runs ; ++i )
+        {
+                int len = runs[i].x1 - runs[i].x0 + 1;
+
+                j = label[i];
+                size[j] += len;
+                sum[3*j]   += 0.5 * (double) ( runs[i].x0 + runs[i].x1 ) * len;
+                sum[3*j+1] += (double) runs[i].y * len;
+                sum[3*j+2] += (double) runs[i].z * len;
+                peak[j] = MIG_MAX2 ( peak[j] , runs[i].peak );
+        }
+
+        /* regions are labeled in order of their first run */
+        for ( j = 0 ; j < num_regions ; ++j )
+        {
+                NewRegion = (mig_im_region_t*) calloc ( 1 , sizeof(mig_im_region_t) );
+                if ( NewRegion == NULL )
+                        goto error;
+
+                NewRegion->size = size[j];
+                NewRegion->centroid[0] = (float) sum[3*j]   / size[j];
+                NewRegion->centroid[1] = (float) sum[3*j+1] / size[j];
+                NewRegion->centroid[2] = (float) sum[3*j+2] / size[j];
+                NewRegion->score = peak[j];
+
+                /* add new region to stack */
+                if ( mig_lst_put_tail ( Regions , NewRegion ) != 0 )
+                {
+                        free ( NewRegion );
+                        goto error;
                 }
         }
 
-        return 0;
+        rc = 0;
 
 error :
 
         /* clean up */
-        return -1;
+        if ( slabs )
+        {
+                for ( t = 0 ; t < num_threads ; ++t )
+                {
+                        if ( slabs[t].runs )
+                                free ( slabs[t].runs );
+                        if ( slabs[t].rows )
+                                free ( slabs[t].rows );
+                }
+                free ( slabs );
+        }
+        if ( threads )
+                free ( threads );
+        if ( runs )
+                free ( runs );
+        if ( label )
+                free ( label );
+        if ( size )
+                free ( size );
+        if ( sum )
+                free ( sum );
+        if ( peak )
+                free ( peak );
+
+        return rc;
+}
+
+/******************************************************************************/
+
+int
+mig_im_regc_merge_near ( mig_lst_t *Regions ,
+                         float factor ,
+                         float z_ratio )
+{
+        int i , j , n , num , num_buckets , cx , cy , cz;
+        int rc = -1;
+        float d2 , dmax , rmax , cell;
+        regc_near_t *order = NULL;
+        float *pos = NULL , *rad = NULL;
+        int *cells = NULL , *heads = NULL , *next = NULL;
+        char *keep = NULL;
+        mig_lst_node *node , *Next;
+        mig_im_region_t *Reg;
+        unsigned int b;
+
+        num = mig_lst_len ( Regions );
+        if ( num < 2 || factor <= 0.0f )
+                return 0;
+
+        if ( z_ratio <= 0.0f )
+                z_ratio = 1.0f;
+
+        for ( num_buckets = 1 ; num_buckets < 2 * num ; num_buckets <<= 1 )
+                ;
+
+        order = (regc_near_t*) malloc ( num * sizeof(regc_near_t) );
+        pos = (float*) malloc ( 3 * num * sizeof(float) );
+        rad = (float*) malloc ( num * sizeof(float) );
+        cells = (int*) malloc ( 3 * num * sizeof(int) );
+        next = (int*) malloc ( num * sizeof(int) );
+        keep = (char*) calloc ( num , sizeof(char) );
+        heads = (int*) malloc ( num_buckets * sizeof(int) );
+        if ( order == NULL || pos == NULL || rad == NULL ||
+             cells == NULL || next == NULL || keep == NULL || heads == NULL )
+                goto error;
+
+        /* positions and radii in in-plane voxels */
+        for ( node = Regions->head , i = 0 , rmax = 0.0f ; node != NULL ; node = node->next , ++i )
+        {
+                Reg = (mig_im_region_t*) node->data;
+
+                pos[3*i]   = Reg->centroid[0];
+                pos[3*i+1] = Reg->centroid[1];
+                pos[3*i+2] = Reg->centroid[2] * z_ratio;
+
+                rad[i] = ( Reg->radius > 0.0f ) ? Reg->radius :
+                         cbrtf ( 3.0f * (float) Reg->size * z_ratio / ( 4.0f * (float) MIG_PI ) );
+                rmax = MIG_MAX2 ( rmax , rad[i] );
+
+                order[i].score = Reg->score;
+                order[i].idx = i;
+        }
+
+        /* no pair can be farther apart than a cell along any axis */
+        cell = MIG_MAX2 ( factor * rmax , 1.0f );
+        for ( i = 0 ; i < num ; ++i )
+        {
+                cells[3*i]   = (int) floorf ( pos[3*i]   / cell );
+                cells[3*i+1] = (int) floorf ( pos[3*i+1] / cell );
+                cells[3*i+2] = (int) floorf ( pos[3*i+2] / cell );
+        }
+
+        for ( b = 0 ; b < (unsigned int) num_buckets ; ++b )
+                heads[b] = -1;
+
+        /* strongest regions first : a region is kept unless a stronger
+           kept region lies within merge distance */
+        qsort ( order , num , sizeof(regc_near_t) , &_regc_near_cmp );
+
+        for ( n = 0 ; n < num ; ++n )
+        {
+                i = order[n].idx;
+                keep[i] = 1;
+
+                for ( cz = cells[3*i+2] - 1 ; keep[i] && cz <= cells[3*i+2] + 1 ; ++cz )
+                for ( cy = cells[3*i+1] - 1 ; keep[i] && cy <= cells[3*i+1] + 1 ; ++cy )
+                for ( cx = cells[3*i]   - 1 ; keep[i] && cx <= cells[3*i]   + 1 ; ++cx )
+                {
+                        b = REGC_CELL_HASH ( cx , cy , cz ) & ( num_buckets - 1 );
+                        for ( j = heads[b] ; j >= 0 ; j = next[j] )
+                        {
+                                if ( cells[3*j] != cx || cells[3*j+1] != cy || cells[3*j+2] != cz )
+                                        continue;
+
+                                d2 = MIG_POW2 ( pos[3*i]   - pos[3*j] ) +
+                                     MIG_POW2 ( pos[3*i+1] - pos[3*j+1] ) +
+                                     MIG_POW2 ( pos[3*i+2] - pos[3*j+2] );
+                                dmax = factor * MIG_MAX2 ( rad[i] , rad[j] );
+
+                                if ( d2 <= dmax * dmax )
+                                {
+                                        keep[i] = 0;
+                                        break;
+                                }
+                        }
+                }
+
+                if ( !keep[i] )
+                        continue;
+
+                b = REGC_CELL_HASH ( cells[3*i] , cells[3*i+1] , cells[3*i+2] ) & ( num_buckets - 1 );
+                next[i] = heads[b];
+                heads[b] = i;
+        }
+
+        /* unlink merged regions : kept ones retain their order */
+        for ( node = Regions->head , i = 0 , n = 0 ; node != NULL ; ++i )
+        {
+                Next = node->next;
+                if ( !keep[i] )
+                {
+                        free ( mig_lst_rem_node ( Regions , node ) );
+                        ++n;
+                }
+                node = Next;
+        }
+
+        rc = n;
+
+error :
+
+        if ( order )
+                free ( order );
+        if ( pos )
+                free ( pos );
+        if ( rad )
+                free ( rad );
+        if ( cells )
+                free ( cells );
+        if ( next )
+                free ( next );
+        if ( keep )
+                free ( keep );
+        if ( heads )
+                free ( heads );
+
+        return rc;
 }
 
 /******************************************************************************/
@@ -273,105 +642,138 @@ static int _search_dir[26][3] =
 
 /****************************************************************************/
 
-static int
-_process_region_3d ( int x , int y , int z ,
-                     float *Binary ,
-                     int Width , int Height , int Depth ,
-                     mig_im_region_t *Region )
-{    
-    typedef struct _pix_t { int coord[3]; } pix_t;
+static void*
+_regc_slab ( void *arg )
+{
+        regc_slab_t *slab = (regc_slab_t*) arg;
+        regc_run_t *tmp;
+        float *p;
+        int i , j , k , r , y;
+        int w = slab->w , h = slab->h;
+        int num_rows = ( slab->end - slab->start ) * h;
+
+        slab->rc = -1;
+
+        slab->rows = (int*) malloc ( ( num_rows + 1 ) * sizeof(int) );
+        slab->runs = (regc_run_t*) malloc ( REGC_RUNS_INIT * sizeof(regc_run_t) );
+        if ( slab->rows == NULL || slab->runs == NULL )
+                return NULL;
+        slab->max_runs = REGC_RUNS_INIT;
+
+        for ( k = slab->start ; k < slab->end ; ++k )
+        {
+                for ( j = 0 ; j < h ; ++j )
+                {
+                        r = ( k - slab->start ) * h + j;
+                        p = slab->Binary + j * w + k * w * h;
 
-    pix_t *CurrentPixel = NULL;
-    pix_t *NewPixel = NULL;
-    mig_stack_t Pixels;
-    int i;
-    int newx , newy , newz;
-	int index;
+                        slab->rows[r] = slab->num_runs;
 
-    /* initialize stack */
-    mig_stack_init ( &Pixels , &free );
+                        for ( i = 0 ; i < w ; ++i )
+                        {
+                                /* skip zero pixels */
+                                if ( p[i] <= MIG_EPS_32F )
+                                        continue;
 
-    /* push first pixel on the stack */
-    NewPixel = (pix_t*) malloc ( sizeof(pix_t) );
-    if ( NewPixel == NULL )
-        goto error;
+                                if ( slab->num_runs == slab->max_runs )
+                                {
+                                        tmp = (regc_run_t*) realloc ( slab->runs , 2 * slab->max_runs * sizeof(regc_run_t) );
+                                        if ( tmp == NULL )
+                                                return NULL;
+                                        slab->runs = tmp;
+                                        slab->max_runs *= 2;
+                                }
+
+                                tmp = slab->runs + slab->num_runs;
+                                tmp->x0 = i;
+                                tmp->y = j;
+                                tmp->z = k;
+                                tmp->parent = slab->num_runs++;
+                                tmp->peak = 0.0f;
+
+                                /* zero run voxels like region growing did */
+                                for ( ; i < w && p[i] > MIG_EPS_32F ; ++i )
+                                {
+                                        tmp->peak = MIG_MAX2 ( tmp->peak , p[i] );
+                                        p[i] = 0.0f;
+                                }
+                                tmp->x1 = i - 1;
+                        }
 
-    NewPixel->coord[0] = x;
-    NewPixel->coord[1] = y;
-    NewPixel->coord[2] = z;
+                        /* previous row of current slice */
+                        if ( j > 0 )
+                                _regc_link_rows ( slab->runs , slab->rows[r-1] , slab->rows[r] ,
+                                                  slab->rows[r] , slab->num_runs );
 
-    if ( mig_stack_push( &Pixels , NewPixel ) == -1 )
-        goto error;
+                        /* three nearest rows of previous slice */
+                        if ( k == slab->start )
+                                continue;
 
-    /* Mark pushed pixel as being in queue */
-    Binary[x+y*Width+z*Width*Height] = 0.0f;
+                        for ( y = MIG_MAX2 ( j - 1 , 0 ) ; y <= MIG_MIN2 ( j + 1 , h - 1 ) ; ++y )
+                                _regc_link_rows ( slab->runs , slab->rows[r-h-j+y] , slab->rows[r-h-j+y+1] ,
+                                                  slab->rows[r] , slab->num_runs );
+                }
+        }
 
-    /* start processing all neighbourhood
-       pixels -> when queue is empty we have finished */
-    while ( mig_stack_pop( &Pixels , (void**) &CurrentPixel ) != -1 )
-    {
-        /* add coordinates to Region properties */
-        Region->centroid[0] += (float) CurrentPixel->coord[0];
-        Region->centroid[1] += (float) CurrentPixel->coord[1];
-        Region->centroid[2] += (float) CurrentPixel->coord[2];
-        Region->size ++;
+        slab->rows[num_rows] = slab->num_runs;
+        slab->rc = 0;
 
-        /* for all neighbours of current pixel */
-		for ( i = 0 ; i < 26 ; ++i )
-        {
-            newx = CurrentPixel->coord[0] + _search_dir[i][0];
-			newy = CurrentPixel->coord[1] + _search_dir[i][1];
-			newz = CurrentPixel->coord[2] + _search_dir[i][2];
-
-			/* check boundary pixels */
-            if ( ( newx < 0 ) || ( newy < 0 ) || ( newz < 0 ) ||
-                 ( newx >= Width ) || ( newy >= Height ) || ( newz >= Depth ) )
-                continue;
+        return NULL;
+}
 
-            /* we found an "on" neighbour */
-			/* AAAA Gianluca: Thresholding sets to zero all pixels
-				values under threshold but doesn't set the others to 1.0f */
-			/* if ( Binary[(int)( newx + newy * Width + newz * Width * Height ) ] == 1.0f )*/
+/****************************************************************************/
 
-			/* TODO: this fails on linux with newz greather than about 300, WHY?)*/
-			index = newx + newy * Width + newz * Width * Height;
-			if ( Binary[ index ] > MIG_EPS_32F )
-			{
-				NewPixel = (pix_t*) malloc ( sizeof(pix_t));
-				if ( NewPixel == NULL )
-					goto error;
+static void
+_regc_link_rows ( regc_run_t *runs , int a0 , int a1 , int b0 , int b1 )
+{
+        int ra , rb;
 
-				NewPixel->coord[0] = newx;
-				NewPixel->coord[1] = newy;
-				NewPixel->coord[2] = newz;
+        while ( a0 < a1 && b0 < b1 )
+        {
+                if ( runs[a0].x1 + 1 < runs[b0].x0 )
+                {
+                        ++a0;
+                        continue;
+                }
 
-				/* add NewPixel to Pixels stack */
-				if ( mig_stack_push ( &Pixels , NewPixel ) == -1 )
-					goto error;
+                if ( runs[b0].x1 + 1 < runs[a0].x0 )
+                {
+                        ++b0;
+                        continue;
+                }
 
-				/* mark NewPixel as being in queue */
-				Binary[ index ] = 0.0f;
-			}
+                /* touching runs : smaller root wins so that parents
+                   always precede children */
+                ra = _regc_find ( runs , a0 );
+                rb = _regc_find ( runs , b0 );
+                if ( ra < rb )
+                        runs[rb].parent = ra;
+                else if ( rb < ra )
+                        runs[ra].parent = rb;
+
+                /* advance run ending first : the other may touch more */
+                if ( runs[a0].x1 < runs[b0].x1 )
+                        ++a0;
+                else
+                        ++b0;
         }
+}
 
-        /* free CurrentPixel structure */
-        free ( CurrentPixel );
-    } /* while stack is full */
-
-    /* final region centroid calculation */
-    Region->centroid[0] /= Region->size;
-    Region->centroid[1] /= Region->size;
-    Region->centroid[2] /= Region->size;
-
-    return 0;
+/****************************************************************************/
 
-error :
+static int
+_regc_find ( regc_run_t *runs , int i )
+{
+        /* path halving */
+        while ( runs[i].parent != i )
+        {
+                runs[i].parent = runs[runs[i].parent].parent;
+                i = runs[i].parent;
+        }
 
-    /* cleanup*/
-    return -1;
+        return i;
 }
 
-
 /****************************************************************************/
 
 static int
@@ -514,3 +916,17 @@ error :
         /* clean up */
         return -1;
 }
+
+/****************************************************************************/
+
+static int
+_regc_near_cmp ( const void *a , const void *b )
+{
+        const regc_near_t *ra = (const regc_near_t*) a;
+        const regc_near_t *rb = (const regc_near_t*) b;
+
+        if ( ra->score != rb->score )
+                return ( ra->score > rb->score ) ? -1 : 1;
+
+        return ra->idx - rb->idx;
+}
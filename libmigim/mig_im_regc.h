@@ -54,6 +54,40 @@ mig_im_regc_3d ( float *Binary ,
                  int Width , int Height , int Depth ,
                  mig_lst_t *Regions );
 
+/*
+******************************************************************************
+*       CALCULATE CENTROIDS OF 3D CONNECTED COMPONENTS - MULTITHREADED
+*
+* Description : Same as mig_im_regc_3d. Every row is split in runs of on
+*               voxels, runs touching each other are merged using union
+*               find and region properties are summed over runs. Runs are
+*               found and merged inside z slabs, each slab being processed
+*               by its own thread, and slab boundaries are merged last.
+*
+* Arguments   : Binary      - Imput volume ( should contain only the values 0.0 and 1.0 )
+*               Width       - width of input volume
+*               Height      - height of input volume
+*               Depth       - z of input volume
+*               Regions     - Preallocated but empty list. Resulting centroids are
+*                             going to be store here.
+*               num_threads - number of threads to use ( 1 -> serial )
+*
+* Returns     : 0 on success
+*               -1 or error
+*
+* Notes       : Binary array is zeroed in the process of labeling !
+*               Regions are listed in the order of their first voxel
+*               ( z , y , x raster order ) like mig_im_regc_3d does.
+*               Region score is the highest Binary value of its voxels.
+*
+******************************************************************************
+*/
+
+int
+mig_im_regc_3d_mt ( float *Binary ,
+                    int Width , int Height , int Depth ,
+                    mig_lst_t *Regions , int num_threads );
+
 
 /*
 ******************************************************************************
@@ -106,6 +140,38 @@ mig_im_regc_3d_odd ( float *Binary ,
                  int Width , int Height , int Depth ,
                  mig_lst_t *Regions );
 
+
+/*
+******************************************************************************
+*               MERGE NEARBY REGIONS
+*
+* Description : This function merges regions whose centroids lie closer
+*               than factor times the larger of their radii , keeping the
+*               region with highest score. Regions are visited by
+*               decreasing score and looked up on a spatial hash of the
+*               regions kept so far , whose cells are as large as the
+*               largest merge distance.
+*
+* Arguments   : Regions - list of mig_im_region_t ( modified )
+*               factor  - merge distance relative to region radius
+*               z_ratio - z voxel size / in-plane voxel size
+*
+* Returns     : number of regions removed on success
+*               -1 on error ( Regions is left unchanged )
+*
+* Notes       : Radii are in-plane voxels : regions with no radius use the
+*               radius of the sphere of the same volume. Kept regions
+*               retain their list order. Removed regions are released
+*               with free and must not own 2D objects.
+*
+******************************************************************************
+*/
+
+int
+mig_im_regc_merge_near ( mig_lst_t *Regions ,
+                         float factor ,
+                         float z_ratio );
+
 MIG_C_LINKAGE_END
 
 #endif /* __MIG_REGC_H__ */
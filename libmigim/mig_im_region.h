@@ -32,6 +32,7 @@ typedef struct _mig_im_region_t
         float       centroid[3];    /* x , y , z centroid */
         float       radius;         /* used for circular and spherical regions : in pixels */
         int         size;           /* size in voxels */
+        float       score;          /* peak input value over region voxels ( 0 if unknown ) */
         mig_lst_t   objs;           /* mig_im_region_t 2D objects making up 3D object */  
 
 } mig_im_region_t;
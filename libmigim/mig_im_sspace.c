@@ -43,8 +43,55 @@ _cpy_dbl2flt ( double *Src, float *Dst, int len );
 
 #endif  /* MATLAB */
 
+#include "mig_ut_pool.h"
 
+#include <pthread.h>
 
+/* candidates per batched radius task */
+#define SSPACE_BATCH_CHUNK 8
+
+/* 2D extrema are searched on the 3x3 pixels around the window center :
+   responses are only needed this far from it */
+#define SSPACE_2D_REACH 2
+
+/*
+******************************************************************************
+*                       LOCAL DATA TYPES
+******************************************************************************
+*/
+
+/* batched radius run shared by all pool workers */
+typedef struct _sspace_batch_t
+{
+        Mig16u          *src;           /* 16 bit volume */
+        int             w;              /* volume width */
+        int             h;              /* volume height */
+        int             z;              /* volume z */
+        const int       *centers;       /* x , y , z voxel coordinates of every candidate */
+        int             num;            /* number of candidates */
+        mig_sspace_t    *ScaleSpace;    /* shared , read only */
+        float           *responses;     /* candidates x sigmas center responses */
+        float           **windows;      /* one window buffer per worker */
+        double          **shells;       /* one shells buffer per worker */
+
+} sspace_batch_t;
+
+/* LoG kernel shared by all scale spaces of the process : built on first
+   use and never modified nor freed afterwards */
+typedef struct _sspace_bank_t
+{
+        int             type;           /* 0 -> 3D kernel , 1 -> 2D kernel */
+        float           sigma;          /* kernel sigma in voxels */
+        float           z_ratio;        /* z voxel size / in-plane voxel size */
+        mig_kernel_t    *kernel;        /* LoG kernel */
+        float           *profile;       /* 3D kernel values by squared distance from center */
+        struct _sspace_bank_t *next;
+
+} sspace_bank_t;
+
+/* process wide kernel bank */
+static sspace_bank_t   *_bank = NULL;
+static pthread_mutex_t _bank_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /*
 ******************************************************************************
@@ -65,6 +112,7 @@ _cpy_dbl2flt ( double *Src, float *Dst, int len );
 *               num_sigmas   - on return will contain the total number
 *                              of LoG kernels
 *				type		 - type of scale space analysis 0 3d, 1 2d
+*               z_ratio      - z voxel size / in-plane voxel size of 3d kernels
 *
 * Returns     : NULL terminated array of mig_kernel_t on success
 *               NULL on error
@@ -80,7 +128,8 @@ _get_log_kernels ( SigmaSpacing spacing ,
                    float sigma_end ,
                    float sigma_inc ,
                    int   *num_sigmas,
-				   int type);
+				   int type,
+                   float z_ratio);
 
 /*
 ******************************************************************************
@@ -143,6 +192,226 @@ _get_buffers ( int window_voxels ,
 static void
 _del_buffers ( float **buffers );
 
+/*
+******************************************************************************
+*                       GET SHARED LOG KERNEL
+*
+* Description : This function returns the process wide LoG kernel of given
+*               type and sigma, building it on first request. 3D kernels
+*               also get their radial profile : 3D LoG kernels only depend
+*               on i*i + j*j + k*k so the profile of 3 * r * r + 1 values
+*               holds exactly the kernel values. Anisotropic kernels only
+*               depend on i*i + j*j and |k| : their profile holds
+*               ( rz + 1 ) rows of 2 * r * r + 1 values.
+*
+* Arguments   : type    - 0 for 3D kernel , 1 for 2D kernel
+*               sigma   - kernel sigma in voxels
+*               z_ratio - z voxel size / in-plane voxel size ( 3D only )
+*
+* Returns     : bank entry on success
+*               NULL on error
+*
+* Notes       : Thread safe. Entries are shared and must not be modified
+*               nor freed !
+*
+******************************************************************************
+*/
+
+static sspace_bank_t*
+_bank_get ( int type ,
+            float sigma ,
+            float z_ratio );
+
+/*
+******************************************************************************
+*                       GATHER RADIAL PROFILES OF 3D LOG KERNELS
+*
+* Description : This function lists the shared profiles of 3D LoG kernels.
+*
+* Arguments   : kernels    - NULL terminated list of shared 3D LoG kernels
+*               num_sigmas - number of kernels
+*               z_ratio    - z voxel size / in-plane voxel size of kernels
+*
+* Returns     : list of num_sigmas shared profiles
+*               NULL on error
+*
+* Notes       : only the list must be freed , profiles are shared !
+*
+******************************************************************************
+*/
+
+static float**
+_get_log_profiles ( mig_kernel_t **kernels ,
+                    int num_sigmas ,
+                    float z_ratio );
+
+/*
+******************************************************************************
+*                       2D SCRATCH LENGTH
+*
+* Description : This function returns the number of floats needed by
+*               _sspace_build_2d to evaluate responses up to reach pixels
+*               from the window center.
+*
+* Arguments   : ScaleSpace - 2D scale space structure
+*               reach      - half side of evaluated block
+*
+* Returns     : number of floats
+*
+******************************************************************************
+*/
+
+static int
+_sspace_rows_len ( mig_sspace_t *ScaleSpace ,
+                   int reach );
+
+/*
+******************************************************************************
+*                       BUILD 2D SCALE SPACE REPRESENTATION AROUND CENTER
+*
+* Description : This function evaluates the normalized 2D LoG responses of
+*               all scales on the ( 2 * reach + 1 ) square block around the
+*               window center. Kernels are the outer z plane of the 3D LoG
+*               kernels , borders are mirrored and products are summed in
+*               the order of mig_im_log_2d_full , so responses are those of
+*               the full window convolution.
+*
+* Arguments   : SrcSignal  - input 2D window
+*               ScaleSpace - 2D scale space structure
+*               reach      - half side of evaluated block ( window_radius
+*                            -> whole window )
+*               rows       - _sspace_rows_len working values
+*
+* Returns     : 0 on success
+*               -1 if a kernel is too large for mirroring the window
+*
+* Notes       : Normalized LoG responses : multiplied by -sigma*sigma !
+*               Data outside the block is left untouched.
+*
+******************************************************************************
+*/
+
+static int
+_sspace_build_2d ( float *SrcSignal ,
+                   mig_sspace_t *ScaleSpace ,
+                   int reach ,
+                   float *rows );
+
+/*
+******************************************************************************
+*                       NUMBER OF WINDOW SHELLS
+*
+* Description : This function returns the number of shell sums needed to
+*               evaluate center responses of a 3D scale space : one per
+*               squared distance on isotropic windows , one per squared
+*               in-plane distance and |k| on anisotropic ones.
+*
+* Arguments   : ScaleSpace - 3D scale space structure
+*
+* Returns     : number of shells
+*
+******************************************************************************
+*/
+
+static int
+_sspace_shells_len ( mig_sspace_t *ScaleSpace );
+
+/*
+******************************************************************************
+*                       3D LOG RESPONSES ON WINDOW CENTER
+*
+* Description : This function evaluates all 3D LoG kernels on the center
+*               voxel of a scale space window.
+*
+* Arguments   : SrcSignal  - input 3D window
+*               ScaleSpace - 3D scale space structure
+*               shells     - _sspace_shells_len working values
+*               responses  - num_sigmas center responses ( returned )
+*
+* Returns     : 0 on success
+*               -1 if a kernel does not fit inside the window
+*
+* Notes       : Responses are multiplied by -1 !
+*
+******************************************************************************
+*/
+
+static int
+_sspace_center_3d ( float *SrcSignal ,
+                    mig_sspace_t *ScaleSpace ,
+                    double *shells ,
+                    float *responses );
+
+/*
+******************************************************************************
+*                       ANISOTROPIC 3D LOG RESPONSES ON WINDOW CENTER
+*
+* Description : Same as _sspace_center_3d on windows whose z spacing differs
+*               from the in-plane one. Shells are indexed by squared in-plane
+*               distance and |k| , they grow one in-plane square ring at a
+*               time over the whole window depth.
+*
+* Arguments   : SrcSignal  - input 3D window
+*               ScaleSpace - anisotropic 3D scale space structure
+*               shells     - _sspace_shells_len working values
+*               responses  - num_sigmas center responses ( returned )
+*
+* Returns     : 0 on success
+*               -1 if a kernel does not fit inside the window
+*
+* Notes       : Responses are multiplied by -1 !
+*
+******************************************************************************
+*/
+
+static int
+_sspace_center_3d_aniso ( float *SrcSignal ,
+                          mig_sspace_t *ScaleSpace ,
+                          double *shells ,
+                          float *responses );
+
+/*
+******************************************************************************
+*                       SELECT RADIUS FROM CENTER RESPONSES
+*
+* Description : This function builds a region centered on the window center
+*               whose radius is the response weighted mean of scales.
+*
+* Arguments   : ScaleSpace - 3D scale space structure
+*               responses  - num_sigmas center responses
+*
+* Returns     : region on success
+*               NULL if scale lies at the border of the scale range or on error
+*
+******************************************************************************
+*/
+
+static mig_im_region_t*
+_sspace_reg_radius ( mig_sspace_t *ScaleSpace ,
+                     const float *responses );
+
+/*
+******************************************************************************
+*                       BATCHED RADIUS TASK
+*
+* Description : This function computes center responses of a chunk of
+*               SSPACE_BATCH_CHUNK candidates.
+*
+* Arguments   : arg    - sspace_batch_t
+*               task   - chunk index
+*               worker - pool worker , selects window and shells buffers
+*
+* Returns     : 0 on success
+*               -1 on error
+*
+******************************************************************************
+*/
+
+static int
+_sspace_batch ( void *arg ,
+                int task ,
+                int worker );
+
 /*
 ******************************************************************************
 *                       FIND MAXIMUM IN 3D BUFFER
@@ -181,11 +450,13 @@ _find_max_3d ( float *buffer ,
 *                       FIND MAXIMUM IN 2D BUFFER
 *
 * Description : This function finds the maximum value and its coordinates inside
-*               a 2D buffer.
+*               a square block of a 2D buffer.
 *
-* Arguments   : buffer - input 3D buffer to be searched.
-*               w      - buffer width.
-*               h      - buffer height.
+* Arguments   : buffer - input 2D buffer to be searched.
+*               d      - buffer width.
+*               x0     - block first column.
+*               y0     - block first row.
+*               len    - block side.
 *               xc     - maximum horizontal coordinate (returned).
 *               yc     - maximum vertical coordinate (returned).
 *               val    - maximum value (returned).
@@ -199,8 +470,10 @@ _find_max_3d ( float *buffer ,
 
 static void
 _find_max_2d ( float *buffer ,
-               int w ,
-               int h ,
+               int d ,
+               int x0 ,
+               int y0 ,
+               int len ,
                float *xc ,
                float *yc ,
                float *val );
@@ -239,6 +512,7 @@ _sspace_thr ( mig_sspace_t *ScaleSpace );
 *
 *
 * Arguments   : ScaleSpace - scale space representation
+*               Mask       - pixels where it is 0 can not be extrema ( NULL -> none )
 *
 * Returns     : total number of found extrema.
 *
@@ -248,33 +522,36 @@ _sspace_thr ( mig_sspace_t *ScaleSpace );
 */
 
 static int
-_sspace_extrema_3d ( mig_sspace_t *ScaleSpace );
+_sspace_extrema_3d ( mig_sspace_t *ScaleSpace ,
+                     const float *Mask );
 
 /*
 ******************************************************************************
-*                       FIND SCALE SPACE EXTREMA
+*                       FIND 2D SCALE SPACE EXTREMA
 *
 * Description : This function locates pixels which are local maxima inside
 *               the scale space representation buffers ( ScaleSpace->data ).
-*               A 3x3x3 neighbourhood around the center of each scale space
-*               data buffer is scanned. For each pixel inside this neighbourhood
-*               we look at adjacent 8 connected pixels and see if the our current
-*               central pixel is the maximum amongs its neighbours. If so the center
-*               pixel value is copies inside the ScaleSpace->extrema[current scale]
-*               array.
-*
+*               The 3x3 pixels around the center of each scale space data
+*               buffer are tested against their 8 connected neighbours.
+*               Pixels below ScaleSpace->threshold or not positive are
+*               rejected before the neighbour test. Values of maxima are
+*               copied inside the center block of ScaleSpace->extrema[scale] ,
+*               other pixels of the block are zeroed.
 *
 * Arguments   : ScaleSpace - scale space representation
+*               Mask       - pixels where it is 0 can not be extrema ( NULL -> none )
 *
-* Returns     : total number of found extrema.
+* Returns     : total number of found extrema ( already thresholded ).
 *
-* Notes       : This could be sped up because we make too many comparaisons !
+* Notes       : Only the center block of extrema buffers is written , the
+*               rest stays zero from allocation.
 *
 ******************************************************************************
 */
 
 static int
-_sspace_extrema_2d ( mig_sspace_t *ScaleSpace );
+_sspace_extrema_2d ( mig_sspace_t *ScaleSpace ,
+                     const float *Mask );
 
 /*
 ******************************************************************************
@@ -386,17 +663,38 @@ mig_im_sspace_get ( int SSpaceType ,
                     SigmaSpacing spacing ,
                     float sigma_start , float sigma_end , float sigma_inc ,
                     float threshold )
+{
+        return mig_im_sspace_get_aniso ( SSpaceType , spacing ,
+                                         sigma_start , sigma_end , sigma_inc ,
+                                         threshold , 1.0f );
+}
+
+/*****************************************************************************/
+
+mig_sspace_t*
+mig_im_sspace_get_aniso ( int SSpaceType ,
+                          SigmaSpacing spacing ,
+                          float sigma_start , float sigma_end , float sigma_inc ,
+                          float threshold ,
+                          float z_ratio )
 {
         mig_sspace_t *ScaleSpace = NULL;
 
+        /* slice spacing only matters to 3D scale spaces */
+        if ( SSpaceType != 0 || z_ratio <= 0.0f )
+                z_ratio = 1.0f;
+
         ScaleSpace = (mig_sspace_t*) calloc ( 1 , sizeof( mig_sspace_t ) );
         if ( ScaleSpace == NULL )
                 return NULL;
 
-        /* build up LoG kernels array*/
+        /* build up LoG kernels array : 3D kernels for both types , 2D
+           scale spaces convolve with their outer z plane and detection
+           results depend on it */
         ScaleSpace->kernels =
                 _get_log_kernels ( spacing , sigma_start , sigma_end , sigma_inc ,
-                                   &( ScaleSpace->num_sigmas ), ScaleSpace->type );
+                                   &( ScaleSpace->num_sigmas ), 0 ,
+                                   z_ratio );
         if ( ScaleSpace->kernels == NULL )
         {
                 free ( ScaleSpace );
@@ -404,10 +702,14 @@ mig_im_sspace_get ( int SSpaceType ,
         }
 
         ScaleSpace->type = SSpaceType;
+        ScaleSpace->z_ratio = z_ratio;
 		ScaleSpace->window_radius = (int)( 3.0f * sigma_end +  1.5f );
         ScaleSpace->window_len    = 2 * ScaleSpace->window_radius + 1;
+        ScaleSpace->window_radius_z = ( z_ratio == 1.0f ) ? ScaleSpace->window_radius :
+            (int)( 3.0f * sigma_end / z_ratio + 1.5f );
+        ScaleSpace->window_len_z  = 2 * ScaleSpace->window_radius_z + 1;
         ScaleSpace->window_voxels = (SSpaceType == 0 ) ? \
-            MIG_POW3( ScaleSpace->window_len ) : MIG_POW2( ScaleSpace->window_len );
+            MIG_POW2( ScaleSpace->window_len ) * ScaleSpace->window_len_z : MIG_POW2( ScaleSpace->window_len );
 
         ScaleSpace->sigma_start = sigma_start;
         ScaleSpace->sigma_end   = sigma_end;
@@ -427,6 +729,17 @@ mig_im_sspace_get ( int SSpaceType ,
                 free ( ScaleSpace );
                 return NULL;
 			}
+
+			/* center responses are evaluated on window shells */
+			ScaleSpace->profiles = _get_log_profiles ( ScaleSpace->kernels ,
+                                          ScaleSpace->num_sigmas , z_ratio );
+			ScaleSpace->shells = (double*) malloc ( _sspace_shells_len ( ScaleSpace ) * sizeof(double) );
+			ScaleSpace->responses = (float*) malloc ( ScaleSpace->num_sigmas * sizeof(float) );
+			if ( ScaleSpace->profiles == NULL || ScaleSpace->shells == NULL || ScaleSpace->responses == NULL )
+			{
+                mig_im_sspace_del ( ScaleSpace );
+                return NULL;
+			}
 			
 			
 			/* allocate memory for scale space extrema JUST FOR COMPATIBILITY */
@@ -463,6 +776,13 @@ mig_im_sspace_get ( int SSpaceType ,
                 return NULL;
 			}
 
+			/* responses are only built around window center */
+			ScaleSpace->rows = (float*) malloc ( _sspace_rows_len ( ScaleSpace , SSPACE_2D_REACH ) * sizeof(float) );
+			if ( ScaleSpace->rows == NULL )
+			{
+                mig_im_sspace_del ( ScaleSpace );
+                return NULL;
+			}
 		}
         return ScaleSpace;
 }
@@ -471,36 +791,53 @@ mig_im_sspace_get ( int SSpaceType ,
 
 mig_im_region_t*
 mig_im_sspace ( float *Input , mig_sspace_t *ScaleSpace )
+{
+        return mig_im_sspace_masked ( Input , NULL , ScaleSpace );
+}
+
+/*****************************************************************************/
+
+mig_im_region_t*
+mig_im_sspace_masked ( float *Input , const float *Mask , mig_sspace_t *ScaleSpace )
 {
         int rc = 0;
 
         if ( Input == NULL || ScaleSpace == NULL )
                 return NULL;
 
-        /* build scale space representation for input signal */
-        rc = _sspace_build ( Input , ScaleSpace );
+        /* 2D extrema only look at the window center */
+        if ( ScaleSpace->type == 0 )
+        {
+            /* build scale space representation for input signal */
+            rc = _sspace_build ( Input , ScaleSpace );
+            if ( rc != 0 )
+                    return NULL;
+
+            /* find scale space extrema */
+            rc = _sspace_extrema_3d ( ScaleSpace , Mask );
+
+            /* if there are no local extrema or
+               inside the scale space representation
+               return NULL */
+            if ( rc == 0 )
+                    return NULL;
+
+            /* threshold scale space extrema */
+            _sspace_thr ( ScaleSpace );
+
+            return _sspace_reg_3d ( ScaleSpace );
+        }
+
+        rc = _sspace_build_2d ( Input , ScaleSpace , SSPACE_2D_REACH , ScaleSpace->rows );
         if ( rc != 0 )
                 return NULL;
 
-        /* find scale space extrema */
-        if ( ScaleSpace->type == 0 )
-            rc = _sspace_extrema_3d ( ScaleSpace );
-        else
-            rc = _sspace_extrema_2d ( ScaleSpace );
-
-        /* if there are no local extrema or
-           inside the scale space representation
-           return NULL */
+        /* extrema are thresholded while searched */
+        rc = _sspace_extrema_2d ( ScaleSpace , Mask );
         if ( rc == 0 )
                 return NULL;
 
-        /* threshold scale space extrema */
-        _sspace_thr ( ScaleSpace );
-
-        if ( ScaleSpace->type == 0 )
-            return _sspace_reg_3d ( ScaleSpace );
-        else
-            return _sspace_reg_2d ( ScaleSpace );
+        return _sspace_reg_2d ( ScaleSpace );
 }
 
 
@@ -515,6 +852,14 @@ mig_im_sspace_del ( mig_sspace_t *ScaleSpace )
         _del_log_kernels ( ScaleSpace->kernels );
         _del_buffers     ( ScaleSpace->data );
         _del_buffers     ( ScaleSpace->extrema );
+        if ( ScaleSpace->profiles )
+                free ( ScaleSpace->profiles );
+        if ( ScaleSpace->shells )
+                free ( ScaleSpace->shells );
+        if ( ScaleSpace->responses )
+                free ( ScaleSpace->responses );
+        if ( ScaleSpace->rows )
+                free ( ScaleSpace->rows );
         free ( ScaleSpace );
 }
 
@@ -525,16 +870,6 @@ mig_im_sspace_radius ( float *Input , mig_sspace_t *ScaleSpace )
 {
         int rc = 0;
 
-		int scale = 0;
-
-		float response;
-
-
-
-		float weighted_scale,sum_weights;
-
-		mig_im_region_t *Region;
-
         if ( Input == NULL || ScaleSpace == NULL )
                 return NULL;
 
@@ -550,63 +885,121 @@ mig_im_sspace_radius ( float *Input , mig_sspace_t *ScaleSpace )
         rc = _sspace_build_oncenter ( Input , ScaleSpace );
         if ( rc != 0 )
                 return NULL;
-		
-		/* find radius */
-		/* weighted sum of square responses, with threshold*/ 
-		weighted_scale = 0.0f;
-		sum_weights = 0.0f;
 
-		for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
+        return _sspace_reg_radius ( ScaleSpace , ScaleSpace->responses );
+}
+
+/*****************************************************************************/
+
+int
+mig_im_sspace_radius_batch ( Mig16u *Src , int w , int h , int z ,
+                             mig_lst_t *Candidates ,
+                             mig_sspace_t *ScaleSpace ,
+                             mig_lst_t *Results ,
+                             int num_threads )
+{
+        int i , t , num , num_tasks;
+        int rc = -1;
+        int *centers = NULL;
+        float *responses = NULL;
+        sspace_batch_t batch;
+        mig_lst_node *node;
+        mig_im_region_t *Cand , *Region;
+
+        if ( Src == NULL || ScaleSpace == NULL || ScaleSpace->type != 0 )
+                return -1;
+
+        num = mig_lst_len ( Candidates );
+        if ( num == 0 )
+                return 0;
+
+        num_tasks = mig_ut_pool_chunks ( num , SSPACE_BATCH_CHUNK );
+        num_threads = MIG_MAX2 ( MIG_MIN2 ( num_threads , num_tasks ) , 1 );
+
+        batch.windows = NULL;
+        batch.shells  = NULL;
+
+        /* candidate window centers */
+        centers = (int*) malloc ( 3 * num * sizeof(int) );
+        responses = (float*) malloc ( num * ScaleSpace->num_sigmas * sizeof(float) );
+        batch.windows = (float**) calloc ( num_threads , sizeof(float*) );
+        batch.shells = (double**) calloc ( num_threads , sizeof(double*) );
+        if ( centers == NULL || responses == NULL || batch.windows == NULL || batch.shells == NULL )
+                goto error;
+
+        for ( t = 0 ; t < num_threads ; ++t )
         {
-			response = ScaleSpace->data[scale][0];
-			/*consider only positive responses higher then set threshold*/
-			if ( response > MIG_MAX2(ScaleSpace->threshold,0) )
-			{
-				weighted_scale += response * ScaleSpace->kernels[scale]->scale;
-				sum_weights += response;
-			}
-		}
-		if (sum_weights > 0.0f)
-			weighted_scale /= sum_weights;
+                batch.windows[t] = (float*) malloc ( ScaleSpace->window_voxels * sizeof(float) );
+                batch.shells[t] = (double*) malloc ( _sspace_shells_len ( ScaleSpace ) * sizeof(double) );
+                if ( batch.windows[t] == NULL || batch.shells[t] == NULL )
+                        goto error;
+        }
 
+        for ( node = Candidates->head , i = 0 ; node != NULL ; node = node->next , ++i )
+        {
+                Cand = (mig_im_region_t*) node->data;
+                centers[3*i]   = (int)( Cand->centroid[0] + 0.5f );
+                centers[3*i+1] = (int)( Cand->centroid[1] + 0.5f );
+                centers[3*i+2] = (int)( Cand->centroid[2] + 0.5f );
+        }
 
-		/* create new reg */
-		/*send this check to FPR-1  and substitude with the commented one*/
-		/*if (weighted_scale > ScaleSpace->kernels[0]->scale - 0.001)*/
-		if (weighted_scale > ScaleSpace->kernels[1]->scale - 0.001 &&
-			weighted_scale < ScaleSpace->kernels[ScaleSpace->num_sigmas - 2]->scale + 0.001)/*scalemax < ScaleSpace->num_sigmas - 1)*/
-		{
-			 Region = (mig_im_region_t*)
-                calloc ( 1 , sizeof( mig_im_region_t ) );
-			 if ( Region == NULL )
-                return NULL;
-			Region->centroid[0] = 0.0f;
-			Region->centroid[1] = 0.0f;
-			Region->centroid[2] = 0.0f;
-			/*Region->radius    = 0.5f * ( ( ScaleSpace->kernels[scalemax]->scale ));*/
-			#if defined(SS_BIG_RADII_COMPENSATION)
-			/* big radii compensation: big radii are usually a little underestimated */
-			/* the reason may reside in more detail in the nodule surface, giving lower responses */
-			Region->radius    =
-				( 0.5f + SS_BIG_RADII_COMPENSATION * sqrt(
-					( weighted_scale - ScaleSpace->kernels[0]->scale )/
-					( ScaleSpace->kernels[ScaleSpace->num_sigmas - 1]->scale - ScaleSpace->kernels[0]->scale)
-					)
-				)
-				* ( weighted_scale );
-			#else
-			Region->radius    = 0.5f * ( weighted_scale );
-			#endif
+        batch.src        = Src;
+        batch.w          = w;
+        batch.h          = h;
+        batch.z          = z;
+        batch.centers    = centers;
+        batch.num        = num;
+        batch.ScaleSpace = ScaleSpace;
+        batch.responses  = responses;
+
+        /* candidate costs vary with their neighbourhood : chunks are
+           balanced by the work stealing pool */
+        if ( mig_ut_pool_run ( num_tasks , num_threads , &_sspace_batch , &batch ) != 0 )
+                goto error;
+
+        /* select radii in candidate order */
+        for ( node = Candidates->head , i = 0 ; node != NULL ; node = node->next , ++i )
+        {
+                Region = _sspace_reg_radius ( ScaleSpace , responses + i * ScaleSpace->num_sigmas );
+                if ( Region == NULL )
+                        continue;
 
-			Region->size      = (int) ( (4.0f/3.0f) * MIG_PI * MIG_POW3( Region->radius ) );
+                Cand = (mig_im_region_t*) node->data;
+                Region->centroid[0] += Cand->centroid[0];
+                Region->centroid[1] += Cand->centroid[1];
+                Region->centroid[2] += Cand->centroid[2];
 
-			return Region;
-		}
-		else
-		{
-			return NULL;
-		}
+                if ( mig_lst_put_tail ( Results , Region ) != 0 )
+                {
+                        free ( Region );
+                        goto error;
+                }
+        }
+
+        rc = 0;
 
+error :
+
+        if ( centers )
+                free ( centers );
+        if ( responses )
+                free ( responses );
+        if ( batch.windows )
+        {
+                for ( t = 0 ; t < num_threads ; ++t )
+                        if ( batch.windows[t] )
+                                free ( batch.windows[t] );
+                free ( batch.windows );
+        }
+        if ( batch.shells )
+        {
+                for ( t = 0 ; t < num_threads ; ++t )
+                        if ( batch.shells[t] )
+                                free ( batch.shells[t] );
+                free ( batch.shells );
+        }
+
+        return rc;
 }
 
 
@@ -624,9 +1017,11 @@ _get_log_kernels ( SigmaSpacing spacing ,
                    float sigma_end ,
                    float sigma_inc ,
                    int   *num_sigmas,
-				   int type)
+				   int type,
+                   float z_ratio)
 {
         mig_kernel_t **KernelList = NULL;
+        sspace_bank_t *Entry;
         float sigma_curr = sigma_start;
         float tmp;
         int i;
@@ -652,15 +1047,14 @@ _get_log_kernels ( SigmaSpacing spacing ,
 				{
 						assert ( sigma_curr < sigma_end );
                 
-						if (type == 1)
-							KernelList[i] = mig_im_kernel_get_log_2d ( sigma_curr );
-						else if (type == 0)
-							KernelList[i] = mig_im_kernel_get_log_3d ( sigma_curr );
-						else
+						if (type != 1 && type != 0)
 							goto error;
-                        
-                        if ( KernelList[i] == NULL )
+
+						/* kernels are shared by all scale spaces */
+						Entry = _bank_get ( type , sigma_curr , z_ratio );
+                        if ( Entry == NULL )
                                 goto error;
+						KernelList[i] = Entry->kernel;
 
                         ++i ;
                         sigma_curr += sigma_inc;
@@ -689,15 +1083,14 @@ _get_log_kernels ( SigmaSpacing spacing ,
                 {
 						assert (sigma_curr < sigma_end);
 
-						if (type == 1)
-							KernelList[i] = mig_im_kernel_get_log_2d ( sigma_curr );
-						else if (type == 0)
-							KernelList[i] = mig_im_kernel_get_log_3d ( sigma_curr );
-						else
+						if (type != 1 && type != 0)
 							goto error;
 
-                        if ( KernelList[i] == NULL )
+						/* kernels are shared by all scale spaces */
+						Entry = _bank_get ( type , sigma_curr , z_ratio );
+                        if ( Entry == NULL )
                                 goto error;
+						KernelList[i] = Entry->kernel;
 
                         ++i ;
                         sigma_curr *= SS_K;
@@ -706,14 +1099,12 @@ _get_log_kernels ( SigmaSpacing spacing ,
         }
 		
         /* last element is sigma_end */
-		if (type == 1)
-			KernelList[*num_sigmas-1] = mig_im_kernel_get_log_2d ( sigma_end );
-		else if (type == 0)
-			KernelList[*num_sigmas-1] = mig_im_kernel_get_log_3d ( sigma_end );
-		else
+		if (type != 1 && type != 0)
 			goto error;
-        if ( KernelList[*num_sigmas-1] == NULL )
+		Entry = _bank_get ( type , sigma_end , z_ratio );
+        if ( Entry == NULL )
             goto error;
+		KernelList[*num_sigmas-1] = Entry->kernel;
 
 		/* this should keep things portable */
 		KernelList[*num_sigmas] = NULL;
@@ -731,19 +1122,10 @@ error :
 static void
 _del_log_kernels ( mig_kernel_t **kernels )
 {
-    int i;
-
     if ( kernels == NULL )
         return;
-    
-    for ( i = 0 ; ; ++i )
-    {
-        if ( kernels[i] == NULL )
-			break;
-		mig_im_kernel_delete ( kernels[i] );
-
-    }
 
+    /* kernels belong to the process wide bank */
     free ( kernels );
 }
 
@@ -765,37 +1147,155 @@ _get_buffers ( int window_voxels ,
         /* start allocating buffers */
         for ( i = 0 ; i < num_sigmas ; ++i )
         {
-                Buffers[i] = malloc ( window_voxels * sizeof( float ) );
+                Buffers[i] = calloc ( window_voxels , sizeof( float ) );
                 if ( Buffers[i] == NULL )
                         goto error;
         }
 		/* GF: this keeps things portable */
 		Buffers [num_sigmas] = NULL;
 
-        return Buffers;
+        return Buffers;
+
+error :
+
+        _del_buffers ( Buffers );
+        return NULL;
+}
+
+/*****************************************************************************/
+
+static void
+_del_buffers ( float **buffers )
+{
+        float **idx = buffers;
+
+        if ( buffers == NULL )
+                return;
+
+        do
+        {
+                free ( *idx );
+        } while ( *idx++ );
+
+        free ( buffers );
+}
+
+/*****************************************************************************/
+
+static float**
+_get_log_profiles ( mig_kernel_t **kernels ,
+                    int num_sigmas ,
+                    float z_ratio )
+{
+        float **Profiles = NULL;
+        sspace_bank_t *Entry;
+        int i;
+
+        Profiles = (float**)
+                calloc ( num_sigmas , sizeof( float* ) );
+        if ( Profiles == NULL )
+                return NULL;
+
+        for ( i = 0 ; i < num_sigmas ; ++i )
+        {
+                Entry = _bank_get ( 0 , kernels[i]->sigma , z_ratio );
+                if ( Entry == NULL || Entry->kernel != kernels[i] )
+                {
+                        free ( Profiles );
+                        return NULL;
+                }
+
+                Profiles[i] = Entry->profile;
+        }
+
+        return Profiles;
+}
+
+/*****************************************************************************/
+
+static sspace_bank_t*
+_bank_get ( int type ,
+            float sigma ,
+            float z_ratio )
+{
+        sspace_bank_t *Entry;
+        float *center;
+        int i , j , k , r , d , nq;
+
+        if ( type != 0 )
+                z_ratio = 1.0f;
+
+        pthread_mutex_lock ( &_bank_lock );
+
+        for ( Entry = _bank ; Entry != NULL ; Entry = Entry->next )
+                if ( Entry->type == type && Entry->sigma == sigma && Entry->z_ratio == z_ratio )
+                        goto out;
+
+        /* first request : build kernel */
+        Entry = (sspace_bank_t*) calloc ( 1 , sizeof( sspace_bank_t ) );
+        if ( Entry == NULL )
+                goto out;
+
+        Entry->type  = type;
+        Entry->sigma = sigma;
+        Entry->z_ratio = z_ratio;
+        Entry->kernel = ( type == 0 ) ? mig_im_kernel_get_log_3d_aniso ( sigma , z_ratio ) :
+                                        mig_im_kernel_get_log_2d ( sigma );
+        if ( Entry->kernel == NULL )
+                goto error;
+
+        if ( type == 0 && z_ratio != 1.0f )
+        {
+                r = Entry->kernel->r;
+                d = Entry->kernel->d;
+                nq = 2 * r * r + 1;
+
+                /* squared distances which are not a sum of two squares stay zero */
+                Entry->profile = (float*) calloc ( ( Entry->kernel->rz + 1 ) * nq , sizeof( float ) );
+                if ( Entry->profile == NULL )
+                        goto error;
 
-error :
+                /* one in-plane octant and one z side cover every entry */
+                center = Entry->kernel->data + r + r * d + Entry->kernel->rz * d * d;
+                for ( k = 0 ; k <= Entry->kernel->rz ; ++k )
+                        for ( j = 0 ; j <= r ; ++j )
+                                for ( i = 0 ; i <= j ; ++i )
+                                        Entry->profile[k*nq+i*i+j*j] = center[i+j*d+k*d*d];
+        }
+        else if ( type == 0 )
+        {
+                r = Entry->kernel->r;
+                d = Entry->kernel->d;
 
-        _del_buffers ( Buffers );
-        return NULL;
-}
+                /* squared distances which are not a sum of three squares stay zero */
+                Entry->profile = (float*) calloc ( 3 * r * r + 1 , sizeof( float ) );
+                if ( Entry->profile == NULL )
+                        goto error;
 
-/*****************************************************************************/
+                /* one octant covers every squared distance */
+                center = Entry->kernel->data + r + r * d + r * d * d;
+                for ( k = 0 ; k <= r ; ++k )
+                        for ( j = 0 ; j <= k ; ++j )
+                                for ( i = 0 ; i <= j ; ++i )
+                                        Entry->profile[i*i+j*j+k*k] = center[i+j*d+k*d*d];
+        }
 
-static void
-_del_buffers ( float **buffers )
-{
-        float **idx = buffers;
+        /* entry is complete before being published */
+        Entry->next = _bank;
+        _bank = Entry;
 
-        if ( buffers == NULL )
-                return;
+out :
 
-        do
-        {
-                free ( *idx );
-        } while ( *idx++ );
+        pthread_mutex_unlock ( &_bank_lock );
+        return Entry;
 
-        free ( buffers );
+error :
+
+        if ( Entry->kernel )
+                mig_im_kernel_delete ( Entry->kernel );
+        free ( Entry );
+        Entry = NULL;
+        goto out;
 }
 
 /*****************************************************************************/
@@ -849,30 +1349,32 @@ _find_max_3d ( float *buffer ,
 
 static void
 _find_max_2d ( float *buffer ,
-               int w , int h ,
+               int d , int x0 , int y0 , int len ,
                float *xc , float *yc ,
                float *val )
 {
     int i , j;
     int num = 0;
+    float *row;
 
     *val = 0.0f;
     *xc = *yc = 0.0f;
 
-    for ( j = 0 ; j < h ; ++j )
+    for ( j = y0 ; j < y0 + len ; ++j )
     {
-        for ( i = 0 ; i < w ; ++i , ++buffer )
+        row = buffer + x0 + j * d;
+        for ( i = x0 ; i < x0 + len ; ++i , ++row )
         {
-            if ( *buffer > *val )
+            if ( *row > *val )
             {
-                *val = *buffer;
+                *val = *row;
                 *xc  = (float)i;
                 *yc  = (float)j;
                 num = 1;
             }
             else
             {
-                if ( *buffer == *val )
+                if ( *row == *val )
                 {
                     *xc += (float)i;
                     *yc += (float)j;
@@ -892,6 +1394,7 @@ int
 _sspace_build ( float *SrcSignal , mig_sspace_t *ScaleSpace )
 {
     int scale , i , rc;
+    float *rows;
 	
 	/*DEBUG*************************************
 	int l, m;
@@ -932,21 +1435,16 @@ _sspace_build ( float *SrcSignal , mig_sspace_t *ScaleSpace )
         return 0;
     }
 	
-    /* 2D scale space */
-    for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
-    {
-        rc = mig_im_log_2d_full ( SrcSignal ,
-                    ScaleSpace->data[scale] ,
-                    ScaleSpace->window_len ,
-                    ScaleSpace->window_len ,
-                    ScaleSpace->kernels[scale] );
-        if ( rc != 0 )
-            return -1;
+    /* 2D scale space : whole window */
+    rows = (float*) malloc ( _sspace_rows_len ( ScaleSpace , ScaleSpace->window_radius ) * sizeof(float) );
+    if ( rows == NULL )
+        return -1;
 
-        for ( i = 0 ; i < ScaleSpace->window_voxels ; ++i )
-            ScaleSpace->data[scale][i] *=
-                -MIG_POW2( ScaleSpace->kernels[scale]->sigma );
-    }
+    rc = _sspace_build_2d ( SrcSignal , ScaleSpace , ScaleSpace->window_radius , rows );
+
+    free ( rows );
+    if ( rc != 0 )
+        return -1;
 	
 	/*DEBUG**********************************
 	tmp_float_p = ScaleSpace->data[0];
@@ -968,44 +1466,382 @@ _sspace_build ( float *SrcSignal , mig_sspace_t *ScaleSpace )
 /*****************************************************************************/
 
 static int
-_sspace_build_oncenter ( float *SrcSignal , mig_sspace_t *ScaleSpace )
+_sspace_rows_len ( mig_sspace_t *ScaleSpace ,
+                   int reach )
 {
-    int scale ,  rc;
-	
-    if ( ScaleSpace->type == 0 )    /* 3D scale space */
+    int n = 2 * reach + 1;
+    int r = ScaleSpace->kernels[ScaleSpace->num_sigmas-1]->r;
+
+    /* kernels grow with sigma : last one is the largest */
+    return MIG_POW2( n + 2 * r );
+}
+
+/*****************************************************************************/
+
+static int
+_sspace_build_2d ( float *SrcSignal ,
+                   mig_sspace_t *ScaleSpace ,
+                   int reach ,
+                   float *rows )
+{
+    int d = ScaleSpace->window_len;
+    int c = ScaleSpace->window_radius;
+    int n = 2 * reach + 1;
+    int scale , r , kd , len , t , x , y , k , l , p;
+    float *kernel , *src , *dst , *line , *pix;
+    float norm , sum;
+
+    for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
     {
-        for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
+        r      = ScaleSpace->kernels[scale]->r;
+        kd     = ScaleSpace->kernels[scale]->d;
+        norm   = -MIG_POW2( ScaleSpace->kernels[scale]->sigma );
+
+        /* outer z plane : first kd * kd values */
+        kernel = ScaleSpace->kernels[scale]->data + r + r * kd;
+
+        /* mirrored borders reach at most one window side */
+        if ( c + reach + r > 2 * ( d - 1 ) )
+            return -1;
+
+        /* mirrored block read by the convolution */
+        len = n + 2 * r;
+        for ( t = 0 ; t < len ; ++t )
         {
+            p = c - reach - r + t;
+            p = ( p < 0 ) ? -p : ( ( p >= d ) ? 2 * ( d - 1 ) - p : p );
+            src  = SrcSignal + p * d;
+            line = rows + t * len;
 
-			/* here compute only on the center voxel */
-            rc = mig_im_log_3d_center ( SrcSignal ,
-                    ScaleSpace->data[scale] ,
-                    ScaleSpace->window_len ,
-                    ScaleSpace->window_len ,
-                    ScaleSpace->window_len ,
-                    ScaleSpace->kernels[scale] );
-            if ( rc != 0 )
-                return -1;
-			
-			/*why this? */
-            //ScaleSpace->data[scale][0] *=
-            //        -MIG_POW2( ScaleSpace->kernels[scale]->sigma );
+            for ( x = 0 ; x < len ; ++x )
+            {
+                p = c - reach - r + x;
+                p = ( p < 0 ) ? -p : ( ( p >= d ) ? 2 * ( d - 1 ) - p : p );
+                line[x] = src[p];
+            }
+        }
+
+        for ( y = 0 ; y < n ; ++y )
+        {
+            dst = ScaleSpace->data[scale] + ( c - reach ) + ( c - reach + y ) * d;
+
+            for ( x = 0 ; x < n ; ++x )
+            {
+                pix = rows + ( y + r ) * len + x + r;
+                sum = 0.0f;
+
+                for ( k = -r ; k <= r ; ++k )
+                    for ( l = -r ; l <= r ; ++l )
+                        sum += pix[l+k*len] * kernel[l+k*kd];
 
-			/* just change sign */
-			ScaleSpace->data[scale][0] *= -1.0;
+                dst[x] = sum * norm;
+            }
         }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+static int
+_sspace_build_oncenter ( float *SrcSignal , mig_sspace_t *ScaleSpace )
+{
+    int scale;
+
+    if ( ScaleSpace->type == 0 )    /* 3D scale space */
+    {
+        if ( _sspace_center_3d ( SrcSignal , ScaleSpace ,
+                                 ScaleSpace->shells , ScaleSpace->responses ) != 0 )
+            return -1;
+
+        for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
+            ScaleSpace->data[scale][0] = ScaleSpace->responses[scale];
 
         return 0;
     }
-	
-
-	
 
     /* 2D scale space */
 	/* TODO:not implemented yet */
 	return -1;
 }
 
+/*****************************************************************************/
+
+static int
+_sspace_center_3d ( float *SrcSignal ,
+                    mig_sspace_t *ScaleSpace ,
+                    double *shells ,
+                    float *responses )
+{
+    int scale , rr , i , j , k , t , r , done;
+    int c = ScaleSpace->window_radius;
+    int d = ScaleSpace->window_len;
+    double sum;
+    float *row;
+    float *profile;
+
+    if ( ScaleSpace->z_ratio != 1.0f )
+        return _sspace_center_3d_aniso ( SrcSignal , ScaleSpace , shells , responses );
+
+    /* LoG kernels only depend on the squared distance from their center :
+       the center response is the dot product of the kernel profile with
+       window sums over shells of equal squared distance. Shells grow one
+       cube surface at a time and are shared by all sigmas */
+    done = -1;
+
+    for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
+    {
+        r = ScaleSpace->kernels[scale]->r;
+        if ( r > c )
+            return -1;
+
+        /* kernels are sorted by sigma : restart only if radius shrinks */
+        if ( r < done )
+            done = -1;
+
+        if ( done < 0 )
+            memset ( shells , 0x00 , ( 3 * c * c + 1 ) * sizeof(double) );
+
+        /* add surfaces of cubes of radius done+1 ... r */
+        for ( t = done + 1 ; t <= r ; ++t )
+        {
+            for ( k = -t ; k <= t ; ++k )
+            {
+                for ( j = -t ; j <= t ; ++j )
+                {
+                    row = SrcSignal + c + ( c + j ) * d + ( c + k ) * d * d;
+                    rr  = j * j + k * k;
+
+                    /* whole row on cube faces orthogonal to y and z */
+                    if ( k == -t || k == t || j == -t || j == t )
+                    {
+                        for ( i = -t ; i <= t ; ++i )
+                            shells[rr+i*i] += row[i];
+                    }
+                    /* only end points otherwise */
+                    else
+                    {
+                        shells[rr+t*t] += row[-t];
+                        if ( t > 0 )
+                            shells[rr+t*t] += row[t];
+                    }
+                }
+            }
+        }
+        done = r;
+
+        sum = 0.0;
+        profile = ScaleSpace->profiles[scale];
+        for ( rr = 0 ; rr <= 3 * r * r ; ++rr )
+            sum += profile[rr] * shells[rr];
+
+        /* just change sign */
+        responses[scale] = (float) -sum;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+static int
+_sspace_center_3d_aniso ( float *SrcSignal ,
+                          mig_sspace_t *ScaleSpace ,
+                          double *shells ,
+                          float *responses )
+{
+    int scale , i , j , k , t , r , rz , done , nq , nr;
+    int c  = ScaleSpace->window_radius;
+    int cz = ScaleSpace->window_radius_z;
+    int d  = ScaleSpace->window_len;
+    double sum;
+    double *shell;
+    float *plane;
+    float *profile;
+
+    /* kernels only depend on i*i + j*j and |k| : shells are kept per |k|
+       in rows of 2 * c * c + 1 squared in-plane distances. Rings are
+       summed over the whole window depth so that any z radius is ready */
+    nq = 2 * c * c + 1;
+    done = -1;
+
+    for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
+    {
+        r  = ScaleSpace->kernels[scale]->r;
+        rz = ScaleSpace->kernels[scale]->rz;
+        if ( r > c || rz > cz )
+            return -1;
+
+        /* kernels are sorted by sigma : restart only if radius shrinks */
+        if ( r < done )
+            done = -1;
+
+        if ( done < 0 )
+            memset ( shells , 0x00 , ( cz + 1 ) * nq * sizeof(double) );
+
+        /* add square rings of radius done+1 ... r */
+        for ( k = -cz ; k <= cz ; ++k )
+        {
+            plane = SrcSignal + c + c * d + ( cz + k ) * d * d;
+            shell = shells + MIG_ABS( k ) * nq;
+
+            for ( t = done + 1 ; t <= r ; ++t )
+            {
+                for ( j = -t ; j <= t ; ++j )
+                {
+                    /* whole row on ring sides orthogonal to y */
+                    if ( j == -t || j == t )
+                    {
+                        for ( i = -t ; i <= t ; ++i )
+                            shell[i*i+j*j] += plane[i+j*d];
+                    }
+                    /* only end points otherwise */
+                    else
+                    {
+                        shell[t*t+j*j] += plane[-t+j*d];
+                        if ( t > 0 )
+                            shell[t*t+j*j] += plane[t+j*d];
+                    }
+                }
+            }
+        }
+        done = r;
+
+        sum = 0.0;
+        profile = ScaleSpace->profiles[scale];
+        nr = 2 * r * r + 1;
+        for ( k = 0 ; k <= rz ; ++k )
+            for ( i = 0 ; i < nr ; ++i )
+                sum += profile[k*nr+i] * shells[k*nq+i];
+
+        /* just change sign */
+        responses[scale] = (float) -sum;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+static int
+_sspace_shells_len ( mig_sspace_t *ScaleSpace )
+{
+    if ( ScaleSpace->z_ratio != 1.0f )
+        return ( ScaleSpace->window_radius_z + 1 ) *
+               ( 2 * MIG_POW2( ScaleSpace->window_radius ) + 1 );
+
+    return 3 * MIG_POW2( ScaleSpace->window_radius ) + 1;
+}
+
+/*****************************************************************************/
+
+static mig_im_region_t*
+_sspace_reg_radius ( mig_sspace_t *ScaleSpace ,
+                     const float *responses )
+{
+		int scale = 0;
+
+		float response;
+
+		float weighted_scale,sum_weights;
+
+		mig_im_region_t *Region;
+
+		/* find radius */
+		/* weighted sum of square responses, with threshold*/ 
+		weighted_scale = 0.0f;
+		sum_weights = 0.0f;
+
+		for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
+        {
+			response = responses[scale];
+			/*consider only positive responses higher then set threshold*/
+			if ( response > MIG_MAX2(ScaleSpace->threshold,0) )
+			{
+				weighted_scale += response * ScaleSpace->kernels[scale]->scale;
+				sum_weights += response;
+			}
+		}
+		if (sum_weights > 0.0f)
+			weighted_scale /= sum_weights;
+
+
+		/* create new reg */
+		/*send this check to FPR-1  and substitude with the commented one*/
+		/*if (weighted_scale > ScaleSpace->kernels[0]->scale - 0.001)*/
+		if (weighted_scale > ScaleSpace->kernels[1]->scale - 0.001 &&
+			weighted_scale < ScaleSpace->kernels[ScaleSpace->num_sigmas - 2]->scale + 0.001)/*scalemax < ScaleSpace->num_sigmas - 1)*/
+		{
+			 Region = (mig_im_region_t*)
+                calloc ( 1 , sizeof( mig_im_region_t ) );
+			 if ( Region == NULL )
+                return NULL;
+			Region->centroid[0] = 0.0f;
+			Region->centroid[1] = 0.0f;
+			Region->centroid[2] = 0.0f;
+			/*Region->radius    = 0.5f * ( ( ScaleSpace->kernels[scalemax]->scale ));*/
+			#if defined(SS_BIG_RADII_COMPENSATION)
+			/* big radii compensation: big radii are usually a little underestimated */
+			/* the reason may reside in more detail in the nodule surface, giving lower responses */
+			Region->radius    =
+				( 0.5f + SS_BIG_RADII_COMPENSATION * sqrt(
+					( weighted_scale - ScaleSpace->kernels[0]->scale )/
+					( ScaleSpace->kernels[ScaleSpace->num_sigmas - 1]->scale - ScaleSpace->kernels[0]->scale)
+					)
+				)
+				* ( weighted_scale );
+			#else
+			Region->radius    = 0.5f * ( weighted_scale );
+			#endif
+
+			/* voxels are z_ratio times longer along z */
+			Region->size      = (int) ( (4.0f/3.0f) * MIG_PI * MIG_POW3( Region->radius ) / ScaleSpace->z_ratio );
+
+			return Region;
+		}
+		else
+		{
+			return NULL;
+		}
+
+}
+
+
+/*****************************************************************************/
+
+static int
+_sspace_batch ( void *arg ,
+                int task ,
+                int worker )
+{
+        sspace_batch_t *batch = (sspace_batch_t*) arg;
+        mig_sspace_t *ScaleSpace = batch->ScaleSpace;
+        float *window = batch->windows[worker];
+        double *shells = batch->shells[worker];
+        float *responses;
+        int i , end , scale;
+
+        end = MIG_MIN2 ( ( task + 1 ) * SSPACE_BATCH_CHUNK , batch->num );
+
+        for ( i = task * SSPACE_BATCH_CHUNK ; i < end ; ++i )
+        {
+                /* copy data from original stack into scale space input buffer */
+                mig_im_bb_cut_3d_aniso ( batch->src , batch->w , batch->h , batch->z ,
+                                         batch->centers[3*i] , batch->centers[3*i+1] , batch->centers[3*i+2] ,
+                                         window , ScaleSpace->window_radius , ScaleSpace->window_radius_z );
+
+                responses = batch->responses + i * ScaleSpace->num_sigmas;
+                if ( _sspace_center_3d ( window , ScaleSpace , shells , responses ) != 0 )
+                        return -1;
+
+                /* LoG is linear : scale responses instead of window to [0,1] */
+                for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
+                        responses[scale] /= 65535.0f;
+        }
+
+        return 0;
+}
 
 /*****************************************************************************/
 
@@ -1026,7 +1862,8 @@ _sspace_thr ( mig_sspace_t *ScaleSpace )
 /*****************************************************************************/
 
 static int
-_sspace_extrema_3d ( mig_sspace_t *ScaleSpace )
+_sspace_extrema_3d ( mig_sspace_t *ScaleSpace ,
+                     const float *Mask )
 {
     int scale;
     int i , j , k;
@@ -1055,6 +1892,10 @@ _sspace_extrema_3d ( mig_sspace_t *ScaleSpace )
             {
                 for ( i = -1 ; i <= 1 ; ++i )
                 {
+                    /* pixels outside mask can not be extrema */
+                    if ( Mask && Mask[(r+i)+(r+j)*d+(r+k)*d*d] == 0.0f )
+                        continue;
+
                     /* current pixel inside cube */
                     curr = data + ( r + i ) + ( r + j ) * d + ( r + k ) * d * d;
                     max = *curr;
@@ -1095,13 +1936,14 @@ _sspace_extrema_3d ( mig_sspace_t *ScaleSpace )
 /*****************************************************************************/
 
 static int
-_sspace_extrema_2d ( mig_sspace_t *ScaleSpace )
+_sspace_extrema_2d ( mig_sspace_t *ScaleSpace ,
+                     const float *Mask )
 {
     int scale;
-    int i , j;
-    int l , m;
+    int i , j , v;
     int num_extrema = 0 , r , d;
-    float max;
+    int greater;
+    float thr = ScaleSpace->threshold;
     float *data;
     float *extrema;
     float *curr;
@@ -1109,44 +1951,37 @@ _sspace_extrema_2d ( mig_sspace_t *ScaleSpace )
     r = ScaleSpace->window_radius;
     d = ScaleSpace->window_len;
 
-    for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale , ++data )
+    for ( scale = 0 ; scale < ScaleSpace->num_sigmas ; ++scale )
     {
         data    = ScaleSpace->data[scale];
         extrema = ScaleSpace->extrema[scale];
 
-        /* zero out extrema buffer */
-        memset ( extrema , 0x00 , ScaleSpace->window_voxels * sizeof(float) );
-    
-        /* test 8 pixels around cube center and
-           cube center to see if they are local maxima
+        /* test 8 pixels around window center and
+           window center to see if they are local maxima
         */
         for ( j = -1 ; j <= 1 ; ++j )
         {
             for ( i = -1 ; i <= 1 ; ++i )
             {
-                /* current pixel inside cube */
-                curr = data + ( r + i ) + ( r + j ) * d;
-                max = *curr;
-                    
-                /* test a 3x3x3 neighbourhood around current pixel */
-                for ( m = -1 ; m <= 1 ; ++m )
-                {
-                    for ( l = -1 ; l <= 1 ; ++l )
-                    {
-                        if ( curr[l+m*d] > max )
-                        {
-                            max = curr[l+m*d];
-                            goto out;
-                        }
-                    } /* l */
-                } /* m */
+                v = ( r + i ) + ( r + j ) * d;
+                curr = data + v;
+                extrema[v] = 0.0f;
+
+                /* thresholded or outside mask : no need to look around */
+                if ( ( *curr <= 0.0f ) || ( *curr < thr ) )
+                    continue;
 
-                out :
+                if ( Mask && Mask[v] == 0.0f )
+                    continue;
 
-                /* if the current pixel is the maximum save its value inside output buffer */
-                if ( ( *curr == max ) && ( max != 0.0f ) )
+                /* current pixel is a maximum if no neighbour is greater */
+                greater = ( curr[-d-1] > *curr ) | ( curr[-d] > *curr ) | ( curr[-d+1] > *curr ) |
+                          ( curr[-1]   > *curr ) |                        ( curr[1]    > *curr ) |
+                          ( curr[d-1]  > *curr ) | ( curr[d]  > *curr ) | ( curr[d+1]  > *curr );
+
+                if ( !greater )
                 {
-                    extrema[(r+i)+(r+j)*d] = max;
+                    extrema[v] = *curr;
                     ++ num_extrema;
                 }
             } /* i */
@@ -1311,6 +2146,9 @@ _sspace_reg_2d ( mig_sspace_t *ScaleSpace )
         float x1 = 0.0f , y1 = 0.0f , val1 = 0.0f;
         float x2 = 0.0f , y2 = 0.0f , val2 = 0.0f;
 
+        /* extrema only live on the 3x3 block around window center */
+        int   c0 = ScaleSpace->window_radius - 1;
+
         Region = (mig_im_region_t*)
                 calloc ( 1 , sizeof( mig_im_region_t ) );
         if ( Region == NULL )
@@ -1323,8 +2161,7 @@ _sspace_reg_2d ( mig_sspace_t *ScaleSpace )
         for ( scale_idx = 0 ; scale_idx < ScaleSpace->num_sigmas ; ++ scale_idx )
         {
                 _find_max_2d ( extrema_idx[scale_idx] ,
-                               ScaleSpace->window_len ,
-                               ScaleSpace->window_len ,
+                               ScaleSpace->window_len , c0 , c0 , 3 ,
                                &x1 , &y1 , &val1 );
 
                 if ( val1 > max )
@@ -1367,8 +2204,7 @@ _sspace_reg_2d ( mig_sspace_t *ScaleSpace )
         {
                 /* find values inside next sigma : sigma with index 2 */
                 _find_max_2d ( extrema_idx[1] ,
-                               ScaleSpace->window_len ,
-                               ScaleSpace->window_len ,
+                               ScaleSpace->window_len , c0 , c0 , 3 ,
                                &x2 , &y2 , &val2 );
 
                 x1 = xmax;
@@ -1384,8 +2220,7 @@ _sspace_reg_2d ( mig_sspace_t *ScaleSpace )
 
                         /* find values inside next sigma : sigma with index num_signmas - 2 */
                         _find_max_2d ( extrema_idx[ScaleSpace->num_sigmas-2] ,
-                                       ScaleSpace->window_len ,
-                                       ScaleSpace->window_len ,
+                                       ScaleSpace->window_len , c0 , c0 , 3 ,
                                        &x1 , &y1 , &val1 );
 
                         x2 = xmax;
@@ -1398,14 +2233,12 @@ _sspace_reg_2d ( mig_sspace_t *ScaleSpace )
                 {
                         /* previous sigma cube */
                         _find_max_2d ( extrema_idx[scalemax-1] ,
-                                       ScaleSpace->window_len ,
-                                       ScaleSpace->window_len ,
+                                       ScaleSpace->window_len , c0 , c0 , 3 ,
                                        &x1 , &y1 , &val1 );
 
                         /* next sigma cube */
                         _find_max_2d ( extrema_idx[scalemax+1] ,
-                                       ScaleSpace->window_len ,
-                                       ScaleSpace->window_len ,
+                                       ScaleSpace->window_len , c0 , c0 , 3 ,
                                        &x2 , &y2 , &val2 );
                 }
         }
@@ -1654,7 +2487,7 @@ mexFunction ( int nlhs , mxArray *plhs[] ,
 			//_fakeReturn(1);
 		}
 		else
-			rc = _sspace_extrema_2d ( SSpace );
+			rc = _sspace_extrema_2d ( SSpace , NULL );
 
 		/* create output */
 		plhs[0] = mxCreateNumericMatrix ( SSpace->window_voxels , SSpace->num_sigmas , mxSINGLE_CLASS, mxREAL);
@@ -68,10 +68,18 @@ typedef struct _mig_sspace_t
 
         float threshold;                /* scale space responses threshold */
 
-        mig_kernel_t **kernels;         /* scale space LoG kernels */
-        float        **data;            /* buffers for scale space representation of input signal */
+        mig_kernel_t **kernels;         /* scale space LoG kernels ( shared , read only ) */
+        float        **data;            /* buffers for scale space representation of input signal ( 2D : only
+                                           pixels near the window center are filled ) */
         float        **extrema;         /* buffers for scale space extrema */
+        float        **profiles;        /* 3D LoG kernel values by squared distance from kernel center ( shared , read only ) */
+        double       *shells;           /* window sums by squared distance from window center */
+        float        *responses;        /* 3D LoG center responses , one per sigma */
+        float        *rows;             /* 2D mirrored input block around window center */
 
+        float z_ratio;                  /* z voxel size / in-plane voxel size ( 1 -> isotropic ) */
+        int window_radius_z;            /* scale space buffer z radius */
+        int window_len_z;               /* scale space buffer z diameter */
 
 
 } mig_sspace_t;
@@ -105,6 +113,9 @@ typedef struct _mig_sspace_t
 *               NULL on error
 *
 * Notes       : scale space structure must be freed using sspace_del
+*               LoG kernels are taken from a process wide bank where each
+*               sigma is built once and shared by all threads and studies.
+*               They live until process exit and must not be modified.
 *
 ******************************************************************************
 */
@@ -115,6 +126,42 @@ mig_im_sspace_get ( int SSpaceType ,
                     float sigma_start , float sigma_end , float sigma_inc ,
                     float threshold );
 
+/*
+******************************************************************************
+*                       PREPARE ANISOTROPIC SCALE SPACE STRUCTURE
+*
+* Description : Same as mig_im_sspace_get for a 3D scale space working on
+*               the native slice spacing of the volume. Sigmas and radii are
+*               expressed in in-plane voxels , the LoG kernels and the window
+*               are shrunk along z by z_ratio so that they cover the same
+*               physical extent as on an isotropic grid.
+*
+* Arguments   : SSpaceType    - 0 for 3D scale space , 1 for 2D scale space
+*               spacing       - sigmas spacing ( GEOMETRIC or ARITHMETIC )
+*               sigma_start   - starting sigma ( should be > 0 )
+*               sigma_end     - end sigma ( should be > sigma_start )
+*               sigma_inc     - distance between adjacent sigmas
+*               threshold     - scale space responses threshold
+*               z_ratio       - z voxel size / in-plane voxel size
+*
+* Returns     : filled in mig_sspace_t structure on success
+*               NULL on error
+*
+* Notes       : z_ratio is ignored by 2D scale spaces. A z_ratio of 1 gives
+*               exactly mig_im_sspace_get. Only the center responses
+*               ( mig_im_sspace_radius and mig_im_sspace_radius_batch ) are
+*               available on anisotropic scale spaces.
+*
+******************************************************************************
+*/
+
+mig_sspace_t*
+mig_im_sspace_get_aniso ( int SSpaceType ,
+                          SigmaSpacing spacing ,
+                          float sigma_start , float sigma_end , float sigma_inc ,
+                          float threshold ,
+                          float z_ratio );
+
 /*
 ******************************************************************************
 *                       PERFORM SCALE SPACE PROCESSING
@@ -145,6 +192,33 @@ mig_im_sspace_get ( int SSpaceType ,
 mig_im_region_t*
 mig_im_sspace ( float *Input , mig_sspace_t *ScaleSpace );
 
+/*
+******************************************************************************
+*                       PERFORM MASKED SCALE SPACE PROCESSING
+*
+* Description : Same as mig_im_sspace but local extrema are only searched on
+*               pixels where Mask is not zero ( e.g. inside the lung ).
+*
+* Arguments   : Input        - input signal on which to perform scale space filtering
+*               Mask         - window of the same size as Input ( NULL -> no mask )
+*               ScaleSpace   - scale space structure
+*
+* Returns     : filled in region_t structure on success
+*               NULL if no apropriate scale space response was found or an error
+*               occurd
+*
+* Notes       : Returned region coordinates are expressed with respect to
+*               the centroid of the input signal.
+*               2D scale spaces evaluate LoG responses on the pixels the
+*               extrema search reads only and reject pixels below
+*               threshold before comparing them with their neighbours.
+*
+******************************************************************************
+*/
+
+mig_im_region_t*
+mig_im_sspace_masked ( float *Input , const float *Mask , mig_sspace_t *ScaleSpace );
+
 /*
 ******************************************************************************
 *                       DELETE SCALE SPACE STRUCTURE
@@ -192,6 +266,46 @@ mig_im_sspace_del ( mig_sspace_t *ScaleSpace );
 mig_im_region_t*
 mig_im_sspace_radius ( float *Input , mig_sspace_t *ScaleSpace );
 
+/*
+******************************************************************************
+*                       FAST BEST RADIUS COMPUTATION - BATCHED
+*
+* Description : Same as mig_im_sspace_radius applied to every candidate of a
+*               list. Candidate windows are read straight from the 16 bit
+*               volume into per thread buffers and the center responses of
+*               all candidates x sigmas are stored in a single matrix from
+*               which radii are selected. Candidates are split in chunks
+*               run on a work stealing pool ( mig_ut_pool_run ).
+*
+* Arguments   : Src          - 16 bit volume
+*               w            - volume width
+*               h            - volume height
+*               z            - volume z
+*               Candidates   - list of mig_im_region_t in volume coordinates
+*               ScaleSpace   - 3D scale space structure
+*               Results      - list where found regions are appended
+*               num_threads  - number of threads to use ( 1 -> serial )
+*
+* Returns     : 0 on success
+*               -1 on error
+*
+* Notes       : Results regions are placed on the candidate centroids and
+*               keep the candidate order. Candidates list is not modified.
+*               On anisotropic scale spaces radii are in in-plane voxels
+*               while sizes are in volume voxels.
+*               Input voxels are scaled to [0,1] as mig_im_util_mat2gray_32f
+*               does with range [0,65535].
+*
+******************************************************************************
+*/
+
+int
+mig_im_sspace_radius_batch ( Mig16u *Src , int w , int h , int z ,
+                             mig_lst_t *Candidates ,
+                             mig_sspace_t *ScaleSpace ,
+                             mig_lst_t *Results ,
+                             int num_threads );
+
 MIG_C_LINKAGE_END
 
 #endif /* __MIG_IM_SSPACE_H__ */
@@ -6,6 +6,7 @@
 #include "mig_im_conv.h"
 
 #include "mig_im_bb.h"
+#include "mig_im_tile.h"
 #include "mig_error_codes.h"
 
 /**************************************************/
@@ -244,4 +245,126 @@ mig_im_thr_32f_3d_local_mean ( Mig32f *in , int w , int h , int z , int radius )
 	mig_im_kernel_delete ( kernel );
 	return rc;
 
-}
\ No newline at end of file
+}
+
+
+/* same as mig_im_thr_32f_3d_local_mean, convolutions are skipped where
+   no non zero voxel can be affected. Voxels equal to zero are never
+   changed by thresholding so restricting the mean to tiles holding non
+   zero voxels gives exactly the same result */
+
+int
+mig_im_thr_32f_3d_local_mean_tiles ( Mig32f *in , int w , int h , int z , int radius , int tile_len )
+{
+	int i,j,k;
+	Mig32f *pIm = in;
+	Mig32f *buf1;
+	Mig32f *buf2;
+	Mig32f *pBuf = NULL;
+
+	int rc = MIG_OK;
+
+	mig_kernel_t *kernel;
+	mig_im_tiles_t *tiles;
+
+	tiles = mig_im_tiles_get_32f ( in , w , h , z , tile_len );
+	if ( tiles == NULL )
+		return MIG_ERROR_MEMORY;
+
+	/* nothing survived fixed threshold */
+	if ( tiles->num_on == 0 )
+	{
+		mig_im_tiles_del ( tiles );
+		return MIG_OK;
+	}
+
+	kernel = mig_im_kernel_get_mean_1d( radius );
+
+	buf1 = (Mig32f*) calloc ( w * h * z, sizeof(Mig32f) );
+	if ( buf1 == NULL )
+	{
+		mig_im_kernel_delete ( kernel );
+		mig_im_tiles_del ( tiles );
+		return MIG_ERROR_MEMORY;
+	}
+
+	buf2 = (Mig32f*) calloc ( w * h * z, sizeof(Mig32f) );
+	if ( buf2 == NULL )
+	{
+		mig_im_kernel_delete ( kernel );
+		mig_im_tiles_del ( tiles );
+		free ( buf1 );
+		return MIG_ERROR_MEMORY;
+	}
+
+	/* convolution in x : rows outside tiles are zero */
+    for ( j = 0 ; j < z ; ++j )
+    {
+        for ( i = 0 ; i < h ; ++i )
+        {
+            if ( !mig_im_tiles_any ( tiles , 0 , w - 1 , i , i , j , j ) )
+                continue;
+
+            rc = mig_im_conv_1d_x ( in + i * w + j * w * h , 
+                    buf2 + i * w + j * w * h , w , kernel );
+        }
+    }
+
+    /* convolution in y : only columns feeding z convolution of tiles */
+    for ( j = 0 ; j < z ; ++j )
+    {
+        for ( i = 0 ; i < w ; ++i )
+        {
+            if ( !mig_im_tiles_any ( tiles , i , i , 0 , h - 1 , j - radius , j + radius ) )
+                continue;
+
+            rc = mig_im_conv_1d_y ( buf2 + i + j * w * h ,
+                    buf1 + i + j * w * h , w , h , kernel );
+        }
+    }
+
+    /* convolution in z : skipped columns hold no non zero voxel and are
+       left untouched by thresholding whatever buf2 contains */
+    for ( j = 0 ; j < h ; ++j )
+    {
+        for ( i = 0 ; i < w ; ++i )
+        {
+            if ( !mig_im_tiles_any ( tiles , i , i , j , j , 0 , z - 1 ) )
+                continue;
+
+            rc = mig_im_conv_1d_z ( buf1 + i + j * w ,
+                    buf2 + i + j * w , w , h , z , kernel );
+        }
+    }
+
+	/*  threshold using mean: retain if value > mean*/
+
+	pBuf = buf2;
+
+	for ( k = 0; k < z; ++k )
+	{
+		for ( j = 0; j < h; ++j )
+		{
+			for ( i = 0; i < w; ++i )
+			{
+				if ( *pIm < ( *pBuf ) )
+				{
+					
+					*pIm = 0.0f;
+				}
+			
+				++pIm;
+				++pBuf;
+			}
+
+		}
+
+	}
+	
+	free (buf1);
+	free (buf2);
+	mig_im_kernel_delete ( kernel );
+	mig_im_tiles_del ( tiles );
+	return rc;
+
+}
@@ -25,6 +25,11 @@ mig_im_thr_32f_i_val ( Mig32f *im , int s , float thr );
 int
 mig_im_thr_32f_3d_local_mean ( Mig32f *in , int w , int h , int z , int radius );
 
+/* same as above, box means are computed only around tiles of side
+   tile_len holding non zero voxels */
+int
+mig_im_thr_32f_3d_local_mean_tiles ( Mig32f *in , int w , int h , int z , int radius , int tile_len );
+
 MIG_C_LINKAGE_END
 
 #endif /* __MIG_IM_THR_H__ */
@@ -0,0 +1,276 @@
+/*
+******************************************************************************
+*
+* Filename    : mig_im_tile.c
+* Description : 3D tile activity maps
+*
+******************************************************************************
+*/
+
+#include "mig_im_tile.h"
+
+/*
+******************************************************************************
+*               LOCAL PROTOTYPES DECLARATION
+******************************************************************************
+*/
+
+/*
+******************************************************************************
+*                       ALLOCATE EMPTY TILE MAP
+*
+* Description : This function allocates a tile map with all tiles inactive.
+*
+* Arguments   : w   - volume width
+*               h   - volume height
+*               z   - volume z
+*               len - tile side length in voxels
+*
+* Returns     : tile map on success
+*               NULL on error
+*
+******************************************************************************
+*/
+
+static mig_im_tiles_t*
+_tiles_alloc ( int w , int h , int z , int len );
+
+/*
+******************************************************************************
+*                       COUNT ACTIVE TILES
+******************************************************************************
+*/
+
+static void
+_tiles_count ( mig_im_tiles_t *t );
+
+/*
+******************************************************************************
+*               GLOBAL PROTOTYPES IMPLEMENTATION
+******************************************************************************
+*/
+
+mig_im_tiles_t*
+mig_im_tiles_get_16u ( const Mig16u *src , int w , int h , int z , int len )
+{
+        int i , j , k;
+        int tx , ty , tz;
+        Mig8u *row;
+        mig_im_tiles_t *t;
+
+        t = _tiles_alloc ( w , h , z , len );
+        if ( t == NULL )
+                return NULL;
+
+        for ( k = 0 ; k < z ; ++k )
+        {
+                tz = k / len;
+
+                for ( j = 0 ; j < h ; ++j , src += w )
+                {
+                        ty  = j / len;
+                        row = t->on + ( ty + tz * t->th ) * t->tw;
+
+                        for ( i = 0 ; i < w ; ++i )
+                        {
+                                if ( src[i] != 0 )
+                                {
+                                        /* skip to next tile of this row */
+                                        tx = i / len;
+                                        row[tx] = 1;
+                                        i = ( tx + 1 ) * len - 1;
+                                }
+                        }
+                }
+        }
+
+        _tiles_count ( t );
+        return t;
+}
+
+/****************************************************************************/
+
+mig_im_tiles_t*
+mig_im_tiles_get_32f ( const float *src , int w , int h , int z , int len )
+{
+        int i , j , k;
+        int tx , ty , tz;
+        Mig8u *row;
+        mig_im_tiles_t *t;
+
+        t = _tiles_alloc ( w , h , z , len );
+        if ( t == NULL )
+                return NULL;
+
+        for ( k = 0 ; k < z ; ++k )
+        {
+                tz = k / len;
+
+                for ( j = 0 ; j < h ; ++j , src += w )
+                {
+                        ty  = j / len;
+                        row = t->on + ( ty + tz * t->th ) * t->tw;
+
+                        for ( i = 0 ; i < w ; ++i )
+                        {
+                                if ( src[i] != 0.0f )
+                                {
+                                        /* skip to next tile of this row */
+                                        tx = i / len;
+                                        row[tx] = 1;
+                                        i = ( tx + 1 ) * len - 1;
+                                }
+                        }
+                }
+        }
+
+        _tiles_count ( t );
+        return t;
+}
+
+/****************************************************************************/
+
+mig_im_tiles_t*
+mig_im_tiles_dilate ( const mig_im_tiles_t *src , int margin )
+{
+        int i , j , k , l;
+        int r;
+        Mig8u *tmp;
+        mig_im_tiles_t *dst;
+
+        dst = _tiles_alloc ( src->w , src->h , src->z , src->len );
+        if ( dst == NULL )
+                return NULL;
+
+        tmp = (Mig8u*) calloc ( src->tw * src->th * src->tz , sizeof(Mig8u) );
+        if ( tmp == NULL )
+        {
+                mig_im_tiles_del ( dst );
+                return NULL;
+        }
+
+        /* dilation radius in tiles : a voxel at distance margin from an
+           active tile can be at most ceil(margin/len) tiles away */
+        r = ( MIG_MAX2 ( margin , 0 ) + src->len - 1 ) / src->len;
+
+        /* separable box dilation : x -> dst , y -> tmp , z -> dst */
+        for ( k = 0 ; k < src->tz ; ++k )
+                for ( j = 0 ; j < src->th ; ++j )
+                        for ( i = 0 ; i < src->tw ; ++i )
+                                if ( MIG_IM_TILE_ON ( src , i , j , k ) )
+                                        for ( l = MIG_MAX2 ( i - r , 0 ) ; l <= MIG_MIN2 ( i + r , src->tw - 1 ) ; ++l )
+                                                MIG_IM_TILE_ON ( dst , l , j , k ) = 1;
+
+        for ( k = 0 ; k < src->tz ; ++k )
+                for ( j = 0 ; j < src->th ; ++j )
+                        for ( i = 0 ; i < src->tw ; ++i )
+                                if ( MIG_IM_TILE_ON ( dst , i , j , k ) )
+                                        for ( l = MIG_MAX2 ( j - r , 0 ) ; l <= MIG_MIN2 ( j + r , src->th - 1 ) ; ++l )
+                                                tmp[ i + l * src->tw + k * src->tw * src->th ] = 1;
+
+        memset ( dst->on , 0x00 , src->tw * src->th * src->tz * sizeof(Mig8u) );
+
+        for ( k = 0 ; k < src->tz ; ++k )
+                for ( j = 0 ; j < src->th ; ++j )
+                        for ( i = 0 ; i < src->tw ; ++i )
+                                if ( tmp[ i + j * src->tw + k * src->tw * src->th ] )
+                                        for ( l = MIG_MAX2 ( k - r , 0 ) ; l <= MIG_MIN2 ( k + r , src->tz - 1 ) ; ++l )
+                                                MIG_IM_TILE_ON ( dst , i , j , l ) = 1;
+
+        free ( tmp );
+
+        _tiles_count ( dst );
+        return dst;
+}
+
+/****************************************************************************/
+
+int
+mig_im_tiles_any ( const mig_im_tiles_t *t ,
+                   int x0 , int x1 ,
+                   int y0 , int y1 ,
+                   int z0 , int z1 )
+{
+        int i , j , k;
+
+        /* clip box to volume */
+        x0 = MIG_MAX2 ( x0 , 0 );
+        y0 = MIG_MAX2 ( y0 , 0 );
+        z0 = MIG_MAX2 ( z0 , 0 );
+        x1 = MIG_MIN2 ( x1 , t->w - 1 );
+        y1 = MIG_MIN2 ( y1 , t->h - 1 );
+        z1 = MIG_MIN2 ( z1 , t->z - 1 );
+
+        if ( ( x0 > x1 ) || ( y0 > y1 ) || ( z0 > z1 ) )
+                return 0;
+
+        for ( k = z0 / t->len ; k <= z1 / t->len ; ++k )
+                for ( j = y0 / t->len ; j <= y1 / t->len ; ++j )
+                        for ( i = x0 / t->len ; i <= x1 / t->len ; ++i )
+                                if ( MIG_IM_TILE_ON ( t , i , j , k ) )
+                                        return 1;
+
+        return 0;
+}
+
+/****************************************************************************/
+
+void
+mig_im_tiles_del ( mig_im_tiles_t *t )
+{
+        if ( t == NULL )
+                return;
+
+        if ( t->on )
+                free ( t->on );
+
+        free ( t );
+}
+
+/*
+******************************************************************************
+*               LOCAL PROTOTYPES IMPLEMENTATION
+******************************************************************************
+*/
+
+static mig_im_tiles_t*
+_tiles_alloc ( int w , int h , int z , int len )
+{
+        mig_im_tiles_t *t;
+
+        if ( len < 1 )
+                return NULL;
+
+        t = (mig_im_tiles_t*) calloc ( 1 , sizeof(mig_im_tiles_t) );
+        if ( t == NULL )
+                return NULL;
+
+        t->w   = w;
+        t->h   = h;
+        t->z   = z;
+        t->len = len;
+        t->tw  = ( w + len - 1 ) / len;
+        t->th  = ( h + len - 1 ) / len;
+        t->tz  = ( z + len - 1 ) / len;
+
+        t->on = (Mig8u*) calloc ( t->tw * t->th * t->tz , sizeof(Mig8u) );
+        if ( t->on == NULL )
+        {
+                free ( t );
+                return NULL;
+        }
+
+        return t;
+}
+
+/****************************************************************************/
+
+static void
+_tiles_count ( mig_im_tiles_t *t )
+{
+        int i;
+
+        t->num_on = 0;
+        for ( i = 0 ; i < t->tw * t->th * t->tz ; ++i )
+                t->num_on += ( t->on[i] != 0 );
+}
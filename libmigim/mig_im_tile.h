@@ -0,0 +1,162 @@
+/*
+******************************************************************************
+*
+* Filename    : mig_im_tile.h
+* Description : 3D tile activity maps. A volume is split into cubic tiles
+*               and every tile carries an on/off flag telling whether
+*               processing kernels must visit it.
+*
+******************************************************************************
+*/
+
+#ifndef __MIG_IM_TILE_H__
+#define __MIG_IM_TILE_H__
+
+#include "mig_config.h"
+#include "mig_defs.h"
+#include "mig_data_types.h"
+#include "mig_error_codes.h"
+
+MIG_C_LINKAGE_START
+
+/*
+******************************************************************************
+*                               TILE MAP REPRESENTATION
+******************************************************************************
+*/
+
+typedef struct _mig_im_tiles_t
+{
+        int     w , h , z;      /* volume size in voxels */
+        int     len;            /* tile side length in voxels */
+        int     tw , th , tz;   /* number of tiles along x , y and z */
+        int     num_on;         /* number of active tiles */
+        Mig8u   *on;            /* tw * th * tz activity flags */
+
+} mig_im_tiles_t;
+
+/* activity flag of tile ( tx , ty , tz ) */
+#define MIG_IM_TILE_ON(t,x,y,z) \
+        ( (t)->on[ (x) + (y) * (t)->tw + (z) * (t)->tw * (t)->th ] )
+
+/*
+******************************************************************************
+*                               PROTOTYPES
+******************************************************************************
+*/
+
+/*
+******************************************************************************
+*                       BUILD TILE MAP FROM 16 BIT VOLUME
+*
+* Description : This function marks as active every tile holding at least
+*               one non zero voxel. Segmented lung stacks are zero outside
+*               the lung masks so the resulting map covers lung parenchyma.
+*
+* Arguments   : src - input volume
+*               w   - input volume width
+*               h   - input volume height
+*               z   - input volume z
+*               len - tile side length in voxels
+*
+* Returns     : tile map on success
+*               NULL on error
+*
+* Notes       : tile map must be freed using mig_im_tiles_del
+*
+******************************************************************************
+*/
+
+mig_im_tiles_t*
+mig_im_tiles_get_16u ( const Mig16u *src , int w , int h , int z , int len );
+
+/*
+******************************************************************************
+*                       BUILD TILE MAP FROM FLOAT VOLUME
+*
+* Description : This function marks as active every tile holding at least
+*               one non zero voxel.
+*
+* Arguments   : src - input volume
+*               w   - input volume width
+*               h   - input volume height
+*               z   - input volume z
+*               len - tile side length in voxels
+*
+* Returns     : tile map on success
+*               NULL on error
+*
+* Notes       : tile map must be freed using mig_im_tiles_del
+*
+******************************************************************************
+*/
+
+mig_im_tiles_t*
+mig_im_tiles_get_32f ( const float *src , int w , int h , int z , int len );
+
+/*
+******************************************************************************
+*                       DILATE TILE MAP
+*
+* Description : This function returns a copy of src where every tile lying
+*               within margin voxels of an active tile is active too.
+*
+* Arguments   : src    - input tile map
+*               margin - dilation distance in voxels
+*
+* Returns     : dilated tile map on success
+*               NULL on error
+*
+* Notes       : tile map must be freed using mig_im_tiles_del
+*
+******************************************************************************
+*/
+
+mig_im_tiles_t*
+mig_im_tiles_dilate ( const mig_im_tiles_t *src , int margin );
+
+/*
+******************************************************************************
+*                       ACTIVE TILES INSIDE A VOXEL BOX
+*
+* Description : This function tells whether any tile intersecting the voxel
+*               box [x0,x1] x [y0,y1] x [z0,z1] is active.
+*
+* Arguments   : t              - tile map
+*               x0 , x1        - box x range ( inclusive )
+*               y0 , y1        - box y range ( inclusive )
+*               z0 , z1        - box z range ( inclusive )
+*
+* Returns     : 1 if box touches an active tile
+*               0 otherwise
+*
+* Notes       : box is clipped to volume size
+*
+******************************************************************************
+*/
+
+int
+mig_im_tiles_any ( const mig_im_tiles_t *t ,
+                   int x0 , int x1 ,
+                   int y0 , int y1 ,
+                   int z0 , int z1 );
+
+/*
+******************************************************************************
+*                       DELETE TILE MAP
+*
+* Description : This function frees memory taken up by tile map
+*
+* Arguments   : t - tile map to be freed
+*
+* Returns     :
+*
+******************************************************************************
+*/
+
+void
+mig_im_tiles_del ( mig_im_tiles_t *t );
+
+MIG_C_LINKAGE_END
+
+#endif /* __MIG_IM_TILE_H__ */
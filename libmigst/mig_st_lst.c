@@ -469,7 +469,6 @@ void*
 mig_lst_rem_pos (mig_lst_t *list, int pos)
 {
     mig_lst_node *ind;
-    void *data;
     int cnt = 0;
 
     assert(list);
@@ -483,6 +482,17 @@ mig_lst_rem_pos (mig_lst_t *list, int pos)
     while (cnt++ < pos)
             ind = ind->next;
 
+    return mig_lst_rem_node (list, ind);
+}
+
+/****************************************************************************/
+void*
+mig_lst_rem_node (mig_lst_t *list, mig_lst_node *ind)
+{
+    void *data;
+
+    assert(list && ind);
+
     data = ind->data;
     if (ind->prev)
     {
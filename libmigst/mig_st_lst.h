@@ -101,6 +101,9 @@ mig_lst_put_tail ( mig_lst_t *list , void *data );
 void*
 mig_lst_rem_pos ( mig_lst_t *list , int pos );
 
+void*
+mig_lst_rem_node ( mig_lst_t *list , mig_lst_node *node );
+
 void*
 mig_lst_rem ( mig_lst_t *list , void *data , mig_lst_cmp_f f );
 
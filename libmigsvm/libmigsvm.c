@@ -1,5 +1,73 @@
 #include "libmigsvm.h"
 #include "svm.h"
+#include "mig_data_types.h"
+#include "mig_ut_fs.h"
+
+#include <ctype.h>
+
+/* examples sharing each support vector load in the batched decision */
+#define SVM_TILE_EXAMPLES 4
+
+/* independent partial sums of a dot product ( one simd register ) */
+#define SVM_LANES 8
+
+/* examples per mig_svm_decision_batch call of mig_svm_predict_batch */
+#define SVM_PREDICT_CHUNK 64
+
+#define SVM_TWO_PI 6.28318530717958647692
+
+/* bundle layout : header , then arrays at SVM_BUNDLE_ALIGN offsets */
+#define SVM_BUNDLE_MAGIC        "MIGSVMB"
+#define SVM_BUNDLE_VERSION      2
+#define SVM_BUNDLE_BYTE_ORDER   0x01020304
+#define SVM_BUNDLE_ALIGN        64
+
+/* random examples checked by mig_svm_bundle_verify */
+#define SVM_BUNDLE_CHECKS       64
+#define SVM_BUNDLE_CHECK_SEED   2463534242u
+
+/* largest num_sv , len_sv and len_in accepted from a bundle */
+#define SVM_BUNDLE_MAX_DIM      ( 1 << 24 )
+
+#define SVM_BUNDLE_ALIGNED(a)   ( ( (a) + SVM_BUNDLE_ALIGN - 1 ) / SVM_BUNDLE_ALIGN * SVM_BUNDLE_ALIGN )
+
+/* bundle arrays */
+typedef enum
+{
+    SVM_BUNDLE_SV_MAT ,         /* num_sv x len_sv float */
+    SVM_BUNDLE_SV_COEF ,        /* num_sv float */
+    SVM_BUNDLE_SV_NORM ,        /* num_sv double */
+    SVM_BUNDLE_SV_OFF ,         /* num_sv double , optional */
+    SVM_BUNDLE_IN_MAT ,         /* len_sv x len_in float , optional */
+    SVM_BUNDLE_IN_OFF ,         /* len_sv float , optional */
+    SVM_BUNDLE_SECTIONS
+
+} SVM_BUNDLE_SECTION;
+
+typedef struct _svm_bundle_header_t
+{
+    char    magic[8];                       /* SVM_BUNDLE_MAGIC */
+    Mig32u  version;                        /* SVM_BUNDLE_VERSION */
+    Mig32u  byte_order;                     /* SVM_BUNDLE_BYTE_ORDER as written */
+
+    Mig32s  type_kernel;
+    Mig32s  deg;
+    Mig32f  gamma;
+    Mig32f  coef0;
+    Mig32f  rho;
+    Mig32s  labels[2];
+    Mig32s  num_sv_class[2];
+    Mig32s  num_sv;
+    Mig32s  len_sv;
+    Mig32s  len_in;
+    Mig32s  compiled;                       /* scaling / whitening compiled in , 0 or 1 */
+
+    Mig32u  off[SVM_BUNDLE_SECTIONS];       /* array offsets from file start , 0 if absent */
+    Mig32u  size[SVM_BUNDLE_SECTIONS];      /* array sizes in bytes */
+    Mig32u  len;                            /* file length */
+    Mig32u  checksum[2];                    /* 64 bit fnv-1a of the file , this field zeroed */
+
+} svm_bundle_header_t;
 
 /******************************************************************/
 /* PRIVATE PROTOTYPES */
@@ -11,6 +79,19 @@ _dot ( const float *sv , const float *x , int len );
 static double 
 _squared_norm ( const float *sv , const float *x , int len );
 
+static void
+_dot_tile ( const float *sv , const float **x , int len , double *dots );
+
+static double
+_f_from_dot ( const mig_svm_t *svm , double dot , double sv_norm , double x_norm );
+
+static void
+_bundle_checksum ( const svm_bundle_header_t *hdr , const unsigned char *data , size_t len ,
+                   Mig32u *checksum );
+
+static double
+_rng_uniform ( Mig32u *state );
+
 static double
 _f_lin  ( const float *sv , const float *x , float param1 , float param2 , float param3 , int len );
 
@@ -108,17 +189,26 @@ mig_svm_model_load ( const char *model_file_name , mig_svm_t *model )
 	/* was this, but it's wrong as of libsvm 2.91! */
     /* model->len_sv = max_idx;*/
 	model->len_sv = max_idx +1;
+	model->len_in = model->len_sv;
 
     /* allocate memory for support vector coefficients */
     model->sv_coef = (float*) calloc ( model->num_sv , sizeof(float) );
     if ( model->sv_coef == NULL )
         goto error;
 
-    /* allocate memory for support vectors */
+    /* allocate memory for support vectors : one matrix , rows in sv */
     model->sv = (float**) calloc ( model->num_sv , sizeof(float*) );
     if ( model->sv == NULL )
         goto error;
 
+    model->sv_mat = (float*) calloc ( model->num_sv * model->len_sv , sizeof(float) );
+    if ( model->sv_mat == NULL )
+        goto error;
+
+    model->sv_norm = (double*) calloc ( model->num_sv , sizeof(double) );
+    if ( model->sv_norm == NULL )
+        goto error;
+
 
     /* start filling in support vector coefficients and support
        vecto values */
@@ -127,10 +217,8 @@ mig_svm_model_load ( const char *model_file_name , mig_svm_t *model )
         /* copy coeff */
         model->sv_coef[i] = tmp_model->sv_coef[0][i];
 
-        /* allocate space for sv */
-        model->sv[i] = (float*) calloc ( model->len_sv , sizeof(float) );
-        if ( model->sv[i] == NULL )
-            goto error;
+        /* row of sv */
+        model->sv[i] = model->sv_mat + i * model->len_sv;
         
         /* copy sv */
         j = 0;
@@ -144,6 +232,8 @@ mig_svm_model_load ( const char *model_file_name , mig_svm_t *model )
             ++j;
             curr = tmp_model->SV[i]+j;
         }
+
+        model->sv_norm[i] = _dot ( model->sv[i] , model->sv[i] , model->len_sv );
     }
 
 	svm_free_and_destroy_model ( &tmp_model );
@@ -152,24 +242,107 @@ mig_svm_model_load ( const char *model_file_name , mig_svm_t *model )
 error :
     
     svm_free_and_destroy_model ( &tmp_model );
+    mig_svm_model_free ( model );
     return MIG_ERROR_UNSUPPORTED;
 }
 
 /******************************************************************/
 
+int
+mig_svm_model_write ( const char *model_file_name , const mig_svm_t *model )
+{
+    static const char *kernel_names[] = { "linear" , "polynomial" , "rbf" , "sigmoid" };
+    FILE *fp;
+    int i , j;
+
+    if ( model_file_name == NULL || model == NULL )
+        return MIG_ERROR_PARAM;
+
+    /* text format has no input map */
+    if ( model->compiled || model->in_mat || model->sv_off || model->len_in != model->len_sv )
+        return MIG_ERROR_UNSUPPORTED;
+
+    fp = fopen ( model_file_name , "w" );
+    if ( fp == NULL )
+        return MIG_ERROR_IO;
+
+    /* header , kernel parameters as libsvm writes them */
+    fprintf ( fp , "svm_type c_svc\n" );
+    fprintf ( fp , "kernel_type %s\n" , kernel_names[model->type_kernel] );
+    if ( model->type_kernel == MIG_POLY )
+        fprintf ( fp , "degree %d\n" , model->deg );
+    if ( model->type_kernel != MIG_LINEAR )
+        fprintf ( fp , "gamma %.9g\n" , model->gamma );
+    if ( model->type_kernel == MIG_POLY || model->type_kernel == MIG_SIGMOID )
+        fprintf ( fp , "coef0 %.9g\n" , model->coef0 );
+    fprintf ( fp , "nr_class 2\n" );
+    fprintf ( fp , "total_sv %d\n" , model->num_sv );
+    fprintf ( fp , "rho %.9g\n" , model->rho );
+    fprintf ( fp , "label %d %d\n" , model->labels[0] , model->labels[1] );
+    fprintf ( fp , "nr_sv %d %d\n" , model->num_sv_class[0] , model->num_sv_class[1] );
+    fprintf ( fp , "SV\n" );
+
+    /* coefficient and every feature , indexes from 0 */
+    for ( i = 0 ; i < model->num_sv ; ++i )
+    {
+        fprintf ( fp , "%.9g " , model->sv_coef[i] );
+        for ( j = 0 ; j < model->len_sv ; ++j )
+            fprintf ( fp , "%d:%.9g " , j , model->sv[i][j] );
+        fprintf ( fp , "\n" );
+    }
+
+    if ( ferror ( fp ) )
+    {
+        fclose ( fp );
+        return MIG_ERROR_IO;
+    }
+
+    if ( fclose ( fp ) == EOF )
+        return MIG_ERROR_IO;
+
+    return MIG_OK;
+}
+
+/******************************************************************/
+
 void
 mig_svm_model_free ( mig_svm_t *model )
 {
-    int i;
+    /* bundle : arrays belong to the mapping */
+    if ( model->map )
+    {
+        mig_ut_fs_unmap ( (mig_ut_fs_map_t*) model->map );
+        free ( model->map );
+
+        if ( model->sv )
+            free ( model->sv );
+
+        memset ( model , 0x00 , sizeof(mig_svm_t) );
+        return;
+    }
 
     if ( model->sv_coef )
         free ( model->sv_coef );    
     
-    for ( i = 0 ; i < model->num_sv ; ++ i )
-        if ( model->sv[i] )
-            free ( model->sv[i] );
+    if ( model->sv_mat )
+        free ( model->sv_mat );
+
+    if ( model->sv_norm )
+        free ( model->sv_norm );
+
+    if ( model->sv )
+        free ( model->sv );
+
+    if ( model->in_mat )
+        free ( model->in_mat );
 
-    free ( model->sv );
+    if ( model->in_off )
+        free ( model->in_off );
+
+    if ( model->sv_off )
+        free ( model->sv_off );
+
+    memset ( model , 0x00 , sizeof(mig_svm_t) );
 }
 
 /******************************************************************/
@@ -421,6 +594,122 @@ mig_svm_scale_params_free ( mig_svm_scale_t *scale_params )
 
 /******************************************************************/
 
+#define DATA_LINE_LEN    65536
+
+int
+mig_svm_data_load ( const char *data_file_name , int len , mig_svm_data_t *data )
+{
+    FILE *fp;
+    char *line = NULL , *p , *end;
+    void *tmp;
+    int cap = 0 , idx;
+    int rc = MIG_ERROR_UNSUPPORTED;
+
+    if ( data_file_name == NULL || data == NULL || len < 1 )
+        return MIG_ERROR_PARAM;
+
+    memset ( data , 0x00 , sizeof(mig_svm_data_t) );
+    data->len = len;
+
+    fp = fopen ( data_file_name , "r" );
+    if ( fp == NULL )
+        return MIG_ERROR_IO;
+
+    line = (char*) malloc ( DATA_LINE_LEN );
+    if ( line == NULL )
+    {
+        rc = MIG_ERROR_MEMORY;
+        goto error;
+    }
+
+    while ( fgets ( line , DATA_LINE_LEN , fp ) != NULL )
+    {
+        p = line;
+        while ( isspace ( (unsigned char) *p ) )
+            ++p;
+        if ( *p == '\0' )
+            continue;
+
+        /* grow by doubling */
+        if ( data->num == cap )
+        {
+            cap = cap ? 2 * cap : 1024;
+
+            tmp = realloc ( data->labels , cap * sizeof(int) );
+            if ( tmp == NULL )
+            {
+                rc = MIG_ERROR_MEMORY;
+                goto error;
+            }
+            data->labels = (int*) tmp;
+
+            tmp = realloc ( data->feats , (size_t) cap * len * sizeof(float) );
+            if ( tmp == NULL )
+            {
+                rc = MIG_ERROR_MEMORY;
+                goto error;
+            }
+            data->feats = (float*) tmp;
+        }
+
+        /* label idx:value idx:value ... */
+        data->labels[data->num] = (int) strtol ( p , &end , 10 );
+        if ( end == p )
+            goto error;
+
+        memset ( data->feats + (size_t) data->num * len , 0x00 , len * sizeof(float) );
+        for ( p = end ; ; p = end )
+        {
+            idx = (int) strtol ( p , &end , 10 );
+            if ( end == p || *end != ':' )
+                break;
+            if ( idx < 0 || idx >= len )
+                goto error;
+
+            p = end + 1;
+            data->feats[(size_t) data->num * len + idx] = (float) strtod ( p , &end );
+            if ( end == p )
+                goto error;
+        }
+
+        ++data->num;
+    }
+
+    if ( ferror ( fp ) )
+    {
+        rc = MIG_ERROR_IO;
+        goto error;
+    }
+
+    free ( line );
+    fclose ( fp );
+    return MIG_OK;
+
+error :
+
+    if ( line )
+        free ( line );
+    fclose ( fp );
+    mig_svm_data_free ( data );
+    return rc;
+}
+
+/******************************************************************/
+
+void
+mig_svm_data_free ( mig_svm_data_t *data )
+{
+    if ( data->labels )
+        free ( data->labels );
+
+    if ( data->feats )
+        free ( data->feats );
+
+    memset ( data , 0x00 , sizeof(mig_svm_data_t) );
+}
+
+/******************************************************************/
+
 
 int
 mig_svm_predict ( const mig_svm_t *svm , mig_svm_example_t *x )
@@ -428,9 +717,13 @@ mig_svm_predict ( const mig_svm_t *svm , mig_svm_example_t *x )
     int i;
     double sum = 0.0f;
 
-    if ( x->len != (svm->len_sv))
+    if ( x->len != (svm->len_in))
         return MIG_ERROR_UNSUPPORTED;
 
+    /* compiled models are only evaluated by the batched decision */
+    if ( svm->in_mat || svm->sv_off )
+        return mig_svm_predict_batch ( svm , x->feat , 1 , &( x->label ) );
+
     for ( i = 0 ; i < svm->num_sv ; ++ i )
     {
         sum += ( svm->sv_coef[i] ) * svm->kernel_f ( svm->sv[i] , x->feat , svm->gamma , svm->coef0 , (float)svm->deg , svm->len_sv );
@@ -442,6 +735,649 @@ mig_svm_predict ( const mig_svm_t *svm , mig_svm_example_t *x )
     x->label = ( sum == 1 ) ? ( svm->labels[0] ) : ( svm->labels[1] );
     return MIG_OK;
 }
+/******************************************************************/
+
+int
+mig_svm_model_compile ( mig_svm_t *svm , const mig_svm_scale_t *scales , float nsigma ,
+                        const float *mat , int len_in )
+{
+    double *a = NULL , *b = NULL , *u = NULL;
+    double m , s , dot;
+    float *sv_mat = NULL , **sv = NULL;
+    double *sv_off = NULL , *sv_norm = NULL;
+    int len , num_sv;
+    int i , j , k;
+
+    if ( svm == NULL || len_in < 1 )
+        return MIG_ERROR_PARAM;
+
+    len = svm->len_sv;
+    if ( ( mat == NULL && len_in != len ) ||
+         ( scales && ( scales->len != len_in || nsigma == 0.0f ) ) )
+        return MIG_ERROR_PARAM;
+
+    /* random features keep their phases in sv_off */
+    if ( svm->compiled || svm->in_mat || ( svm->sv_off && svm->type_kernel != MIG_RFF ) ||
+         svm->len_in != svm->len_sv || svm->map )
+        return MIG_ERROR_UNSUPPORTED;
+
+    /* A = mat * diag( 1 / ( nsigma * std ) ) , b = - A * mean */
+    a = (double*) calloc ( len * len_in , sizeof(double) );
+    b = (double*) calloc ( len , sizeof(double) );
+    if ( a == NULL || b == NULL )
+        goto error;
+
+    for ( i = 0 ; i < len ; ++i )
+        for ( j = 0 ; j < len_in ; ++j )
+        {
+            m = ( mat ) ? mat[i * len_in + j] : (double)( i == j );
+            s = ( scales ) ? 1.0 / ( (double) nsigma * scales->std[j] ) : 1.0;
+
+            a[i * len_in + j] = m * s;
+            if ( scales )
+                b[i] -= m * s * scales->mean[j];
+        }
+
+    /* rbf : | sv - ( A x + b ) | can not be folded , keep the map */
+    if ( svm->type_kernel == MIG_RBF )
+    {
+        svm->in_mat = (float*) malloc ( len * len_in * sizeof(float) );
+        svm->in_off = (float*) malloc ( len * sizeof(float) );
+        if ( svm->in_mat == NULL || svm->in_off == NULL )
+            goto error;
+
+        for ( i = 0 ; i < len * len_in ; ++i )
+            svm->in_mat[i] = (float) a[i];
+        for ( i = 0 ; i < len ; ++i )
+            svm->in_off[i] = (float) b[i];
+
+        svm->len_in = len_in;
+        svm->compiled = 1;
+
+        free ( a );
+        free ( b );
+        return MIG_OK;
+    }
+
+    /* dot product kernels : sv . ( A x + b ) = ( A^T sv ) . x + sv . b ,
+       a linear model is the single vector sum( coef * sv ) */
+    num_sv = ( svm->type_kernel == MIG_LINEAR ) ? 1 : svm->num_sv;
+
+    sv_mat  = (float*) calloc ( num_sv * len_in , sizeof(float) );
+    sv      = (float**) calloc ( num_sv , sizeof(float*) );
+    sv_off  = (double*) calloc ( num_sv , sizeof(double) );
+    sv_norm = (double*) calloc ( num_sv , sizeof(double) );
+    u       = (double*) calloc ( len , sizeof(double) );
+    if ( sv_mat == NULL || sv == NULL || sv_off == NULL || sv_norm == NULL || u == NULL )
+        goto error;
+
+    for ( i = 0 ; i < num_sv ; ++i )
+    {
+        /* support vector to fold */
+        if ( svm->type_kernel == MIG_LINEAR )
+        {
+            for ( k = 0 ; k < svm->num_sv ; ++k )
+                for ( j = 0 ; j < len ; ++j )
+                    u[j] += (double) svm->sv_coef[k] * svm->sv[k][j];
+        }
+        else
+        {
+            for ( j = 0 ; j < len ; ++j )
+                u[j] = svm->sv[i][j];
+        }
+
+        sv[i] = sv_mat + i * len_in;
+        for ( j = 0 ; j < len_in ; ++j )
+        {
+            dot = 0.0;
+            for ( k = 0 ; k < len ; ++k )
+                dot += u[k] * a[k * len_in + j];
+            sv[i][j] = (float) dot;
+        }
+
+        sv_off[i] = ( svm->sv_off ) ? svm->sv_off[i] : 0.0;
+        for ( k = 0 ; k < len ; ++k )
+            sv_off[i] += u[k] * b[k];
+
+        sv_norm[i] = _dot ( sv[i] , sv[i] , len_in );
+    }
+
+    if ( svm->type_kernel == MIG_LINEAR )
+    {
+        svm->sv_coef[0] = 1.0f;
+        svm->num_sv_class[0] = 1;
+        svm->num_sv_class[1] = 0;
+    }
+
+    free ( svm->sv_mat );
+    free ( svm->sv );
+    free ( svm->sv_norm );
+    if ( svm->sv_off )
+        free ( svm->sv_off );
+
+    svm->sv_mat  = sv_mat;
+    svm->sv      = sv;
+    svm->sv_off  = sv_off;
+    svm->sv_norm = sv_norm;
+    svm->num_sv  = num_sv;
+    svm->len_sv  = len_in;
+    svm->len_in  = len_in;
+    svm->compiled = 1;
+
+    free ( a );
+    free ( b );
+    free ( u );
+    return MIG_OK;
+
+error :
+
+    if ( a )
+        free ( a );
+    if ( b )
+        free ( b );
+    if ( u )
+        free ( u );
+    if ( sv_mat )
+        free ( sv_mat );
+    if ( sv )
+        free ( sv );
+    if ( sv_off )
+        free ( sv_off );
+    if ( sv_norm )
+        free ( sv_norm );
+
+    if ( svm->in_mat )
+        free ( svm->in_mat );
+    if ( svm->in_off )
+        free ( svm->in_off );
+    svm->in_mat = NULL;
+    svm->in_off = NULL;
+
+    return MIG_ERROR_MEMORY;
+}
+/******************************************************************/
+
+int
+mig_svm_bundle_write ( const char *bundle_file_name , const mig_svm_t *svm )
+{
+    svm_bundle_header_t hdr;
+    const void *arrays[SVM_BUNDLE_SECTIONS];
+    size_t size[SVM_BUNDLE_SECTIONS];
+    unsigned char *buf = NULL;
+    size_t len;
+    FILE *f = NULL;
+    int i;
+
+    if ( bundle_file_name == NULL || svm == NULL || svm->sv_mat == NULL )
+        return MIG_ERROR_PARAM;
+
+    memset ( &hdr , 0x00 , sizeof(hdr) );
+    memcpy ( hdr.magic , SVM_BUNDLE_MAGIC , sizeof(SVM_BUNDLE_MAGIC) );
+    hdr.version         = SVM_BUNDLE_VERSION;
+    hdr.byte_order      = SVM_BUNDLE_BYTE_ORDER;
+    hdr.type_kernel     = (Mig32s) svm->type_kernel;
+    hdr.deg             = svm->deg;
+    hdr.gamma           = svm->gamma;
+    hdr.coef0           = svm->coef0;
+    hdr.rho             = svm->rho;
+    hdr.labels[0]       = svm->labels[0];
+    hdr.labels[1]       = svm->labels[1];
+    hdr.num_sv_class[0] = svm->num_sv_class[0];
+    hdr.num_sv_class[1] = svm->num_sv_class[1];
+    hdr.num_sv          = svm->num_sv;
+    hdr.len_sv          = svm->len_sv;
+    hdr.len_in          = svm->len_in;
+    hdr.compiled        = ( svm->compiled != 0 );
+
+    arrays[SVM_BUNDLE_SV_MAT]  = svm->sv_mat;
+    arrays[SVM_BUNDLE_SV_COEF] = svm->sv_coef;
+    arrays[SVM_BUNDLE_SV_NORM] = svm->sv_norm;
+    arrays[SVM_BUNDLE_SV_OFF]  = svm->sv_off;
+    arrays[SVM_BUNDLE_IN_MAT]  = svm->in_mat;
+    arrays[SVM_BUNDLE_IN_OFF]  = svm->in_off;
+
+    size[SVM_BUNDLE_SV_MAT]  = (size_t) svm->num_sv * svm->len_sv * sizeof(float);
+    size[SVM_BUNDLE_SV_COEF] = (size_t) svm->num_sv * sizeof(float);
+    size[SVM_BUNDLE_SV_NORM] = (size_t) svm->num_sv * sizeof(double);
+    size[SVM_BUNDLE_SV_OFF]  = ( svm->sv_off ) ? (size_t) svm->num_sv * sizeof(double) : 0;
+    size[SVM_BUNDLE_IN_MAT]  = ( svm->in_mat ) ? (size_t) svm->len_sv * svm->len_in * sizeof(float) : 0;
+    size[SVM_BUNDLE_IN_OFF]  = ( svm->in_mat ) ? (size_t) svm->len_sv * sizeof(float) : 0;
+
+    /* arrays after the header , each one aligned */
+    len = SVM_BUNDLE_ALIGNED( sizeof(hdr) );
+    for ( i = 0 ; i < SVM_BUNDLE_SECTIONS ; ++i )
+    {
+        if ( size[i] == 0 )
+            continue;
+
+        hdr.off[i]  = (Mig32u) len;
+        hdr.size[i] = (Mig32u) size[i];
+        len = SVM_BUNDLE_ALIGNED( len + size[i] );
+    }
+
+    /* offsets and sizes are 32 bit */
+    if ( (unsigned long long) len > 0xFFFFFFFFULL )
+        return MIG_ERROR_UNSUPPORTED;
+    hdr.len = (Mig32u) len;
+
+    buf = (unsigned char*) calloc ( len , 1 );
+    if ( buf == NULL )
+        return MIG_ERROR_MEMORY;
+
+    for ( i = 0 ; i < SVM_BUNDLE_SECTIONS ; ++i )
+        if ( hdr.size[i] )
+            memcpy ( buf + hdr.off[i] , arrays[i] , hdr.size[i] );
+
+    _bundle_checksum ( &hdr , buf , len , hdr.checksum );
+    memcpy ( buf , &hdr , sizeof(hdr) );
+
+    f = fopen ( bundle_file_name , "wb" );
+    if ( f == NULL )
+    {
+        free ( buf );
+        return MIG_ERROR_IO;
+    }
+
+    if ( fwrite ( buf , 1 , len , f ) != len )
+    {
+        fclose ( f );
+        free ( buf );
+        return MIG_ERROR_IO;
+    }
+
+    free ( buf );
+    if ( fclose ( f ) == EOF )
+        return MIG_ERROR_IO;
+
+    return MIG_OK;
+}
+
+/******************************************************************/
+
+int
+mig_svm_bundle_load ( const char *bundle_file_name , mig_svm_t *svm )
+{
+    mig_ut_fs_map_t *map = NULL;
+    const unsigned char *data;
+    svm_bundle_header_t hdr;
+    Mig32u checksum[2];
+    unsigned long long expected[SVM_BUNDLE_SECTIONS];
+    int i , rc;
+
+    if ( bundle_file_name == NULL || svm == NULL )
+        return MIG_ERROR_PARAM;
+
+    memset ( svm , 0x00 , sizeof(mig_svm_t) );
+
+    map = (mig_ut_fs_map_t*) calloc ( 1 , sizeof(mig_ut_fs_map_t) );
+    if ( map == NULL )
+        return MIG_ERROR_MEMORY;
+
+    rc = mig_ut_fs_map ( bundle_file_name , map );
+    if ( rc != MIG_OK )
+    {
+        free ( map );
+        return rc;
+    }
+
+    data = (const unsigned char*) map->data;
+    rc = MIG_ERROR_UNSUPPORTED;
+
+    /* header */
+    if ( map->len < sizeof(hdr) )
+        goto error;
+
+    memcpy ( &hdr , data , sizeof(hdr) );
+    if ( memcmp ( hdr.magic , SVM_BUNDLE_MAGIC , sizeof(SVM_BUNDLE_MAGIC) ) != 0 ||
+         hdr.version != SVM_BUNDLE_VERSION ||
+         hdr.byte_order != SVM_BUNDLE_BYTE_ORDER ||
+         hdr.len != map->len ||
+         hdr.num_sv < 1 || hdr.num_sv > SVM_BUNDLE_MAX_DIM ||
+         hdr.len_sv < 1 || hdr.len_sv > SVM_BUNDLE_MAX_DIM ||
+         hdr.len_in < 1 || hdr.len_in > SVM_BUNDLE_MAX_DIM ||
+         ( hdr.compiled != 0 && hdr.compiled != 1 ) )
+        goto error;
+
+    /* whole file , header included , before anything else is trusted */
+    _bundle_checksum ( &hdr , data , hdr.len , checksum );
+    if ( checksum[0] != hdr.checksum[0] || checksum[1] != hdr.checksum[1] )
+        goto error;
+
+    /* arrays : sizes from the bounded dimensions in 64 bit , inside the file and aligned */
+    expected[SVM_BUNDLE_SV_MAT]  = (unsigned long long) hdr.num_sv * hdr.len_sv * sizeof(float);
+    expected[SVM_BUNDLE_SV_COEF] = (unsigned long long) hdr.num_sv * sizeof(float);
+    expected[SVM_BUNDLE_SV_NORM] = (unsigned long long) hdr.num_sv * sizeof(double);
+    expected[SVM_BUNDLE_SV_OFF]  = (unsigned long long) hdr.num_sv * sizeof(double);
+    expected[SVM_BUNDLE_IN_MAT]  = (unsigned long long) hdr.len_sv * hdr.len_in * sizeof(float);
+    expected[SVM_BUNDLE_IN_OFF]  = (unsigned long long) hdr.len_sv * sizeof(float);
+
+    for ( i = 0 ; i < SVM_BUNDLE_SECTIONS ; ++i )
+    {
+        if ( hdr.size[i] == 0 && i > SVM_BUNDLE_SV_NORM )
+            continue;
+
+        if ( (unsigned long long) hdr.size[i] != expected[i] ||
+             hdr.off[i] < sizeof(hdr) || hdr.off[i] % SVM_BUNDLE_ALIGN ||
+             (unsigned long long) hdr.off[i] + hdr.size[i] > hdr.len )
+            goto error;
+    }
+
+    if ( ( hdr.size[SVM_BUNDLE_IN_MAT] == 0 ) != ( hdr.size[SVM_BUNDLE_IN_OFF] == 0 ) ||
+         ( hdr.size[SVM_BUNDLE_IN_MAT] == 0 && hdr.len_in != hdr.len_sv ) ||
+         ( hdr.size[SVM_BUNDLE_IN_MAT] != 0 && hdr.compiled == 0 ) ||
+         ( hdr.type_kernel == MIG_RFF && hdr.size[SVM_BUNDLE_SV_OFF] == 0 ) )
+        goto error;
+
+    /* model */
+    svm->type_svm        = MIG_C_SVC;
+    svm->type_kernel     = (MIG_SVM_KERNEL_TYPE) hdr.type_kernel;
+    switch ( svm->type_kernel )
+    {
+        case MIG_LINEAR :
+                svm->kernel_f = &_f_lin;
+                break;
+
+        case MIG_POLY :
+                svm->kernel_f = &_f_poly;
+                break;
+
+        case MIG_RBF :
+                svm->kernel_f = &_f_rbf;
+                break;
+
+        case MIG_SIGMOID :
+                svm->kernel_f = &_f_sig;
+                break;
+
+        /* evaluated by the batched decision only */
+        case MIG_RFF :
+                svm->kernel_f = NULL;
+                break;
+
+        default :
+                goto error;
+    }
+
+    svm->deg             = hdr.deg;
+    svm->gamma           = hdr.gamma;
+    svm->coef0           = hdr.coef0;
+    svm->rho             = hdr.rho;
+    svm->labels[0]       = hdr.labels[0];
+    svm->labels[1]       = hdr.labels[1];
+    svm->num_sv_class[0] = hdr.num_sv_class[0];
+    svm->num_sv_class[1] = hdr.num_sv_class[1];
+    svm->num_sv          = hdr.num_sv;
+    svm->len_sv          = hdr.len_sv;
+    svm->len_in          = hdr.len_in;
+    svm->compiled        = hdr.compiled;
+
+    /* arrays are used in place , read only */
+    svm->sv_mat  = (float*) ( data + hdr.off[SVM_BUNDLE_SV_MAT] );
+    svm->sv_coef = (float*) ( data + hdr.off[SVM_BUNDLE_SV_COEF] );
+    svm->sv_norm = (double*) ( data + hdr.off[SVM_BUNDLE_SV_NORM] );
+    if ( hdr.size[SVM_BUNDLE_SV_OFF] )
+        svm->sv_off = (double*) ( data + hdr.off[SVM_BUNDLE_SV_OFF] );
+    if ( hdr.size[SVM_BUNDLE_IN_MAT] )
+    {
+        svm->in_mat = (float*) ( data + hdr.off[SVM_BUNDLE_IN_MAT] );
+        svm->in_off = (float*) ( data + hdr.off[SVM_BUNDLE_IN_OFF] );
+    }
+
+    /* row pointers are the only private memory */
+    svm->sv = (float**) calloc ( svm->num_sv , sizeof(float*) );
+    if ( svm->sv == NULL )
+    {
+        rc = MIG_ERROR_MEMORY;
+        goto error;
+    }
+
+    for ( i = 0 ; i < svm->num_sv ; ++i )
+        svm->sv[i] = svm->sv_mat + i * svm->len_sv;
+
+    svm->map = map;
+    return MIG_OK;
+
+error :
+
+    mig_ut_fs_unmap ( map );
+    free ( map );
+    memset ( svm , 0x00 , sizeof(mig_svm_t) );
+    return rc;
+}
+
+/******************************************************************/
+
+int
+mig_svm_bundle_verify ( const char *bundle_file_name , const mig_svm_t *svm )
+{
+    mig_svm_t bundle;
+    float *x = NULL;
+    double *dec = NULL;
+    Mig32u state = SVM_BUNDLE_CHECK_SEED;
+    int i , rc;
+
+    if ( bundle_file_name == NULL || svm == NULL )
+        return MIG_ERROR_PARAM;
+
+    rc = mig_svm_bundle_load ( bundle_file_name , &bundle );
+    if ( rc != MIG_OK )
+        return rc;
+
+    if ( bundle.len_in != svm->len_in || bundle.compiled != svm->compiled )
+    {
+        rc = MIG_ERROR_UNSUPPORTED;
+        goto error;
+    }
+
+    x = (float*) malloc ( SVM_BUNDLE_CHECKS * svm->len_in * sizeof(float) );
+    dec = (double*) malloc ( 2 * SVM_BUNDLE_CHECKS * sizeof(double) );
+    if ( x == NULL || dec == NULL )
+    {
+        rc = MIG_ERROR_MEMORY;
+        goto error;
+    }
+
+    /* random examples in [ -1 , 1 ] , the same on every run */
+    for ( i = 0 ; i < SVM_BUNDLE_CHECKS * svm->len_in ; ++i )
+        x[i] = (float)( 2.0 * _rng_uniform ( &state ) - 1.0 );
+
+    rc = mig_svm_decision_batch ( svm , x , SVM_BUNDLE_CHECKS , dec );
+    if ( rc == MIG_OK )
+        rc = mig_svm_decision_batch ( &bundle , x , SVM_BUNDLE_CHECKS , dec + SVM_BUNDLE_CHECKS );
+    if ( rc != MIG_OK )
+        goto error;
+
+    /* same arrays , same code : decisions must be bit identical */
+    if ( memcmp ( dec , dec + SVM_BUNDLE_CHECKS , SVM_BUNDLE_CHECKS * sizeof(double) ) != 0 )
+        rc = MIG_ERROR_UNSUPPORTED;
+
+error :
+
+    if ( x )
+        free ( x );
+    if ( dec )
+        free ( dec );
+    mig_svm_model_free ( &bundle );
+    return rc;
+}
+
+
+
+/******************************************************************/
+
+int
+mig_svm_rff_init ( mig_svm_t *approx , const mig_svm_t *svm , int num_features , unsigned int seed )
+{
+    Mig32u state = ( seed != 0 ) ? (Mig32u) seed : 1;
+    double scale , u , sum;
+    int len , d , i , j;
+
+    if ( approx == NULL || svm == NULL || num_features < 1 )
+        return MIG_ERROR_PARAM;
+
+    if ( svm->type_kernel != MIG_RBF || svm->in_mat || svm->sv_off || svm->len_in != svm->len_sv )
+        return MIG_ERROR_UNSUPPORTED;
+
+    len = svm->len_sv;
+
+    memset ( approx , 0x00 , sizeof(mig_svm_t) );
+    approx->type_svm        = svm->type_svm;
+    approx->type_kernel     = MIG_RFF;
+    approx->gamma           = svm->gamma;
+    approx->num_sv          = num_features;
+    approx->len_sv          = len;
+    approx->len_in          = len;
+    approx->rho             = svm->rho;
+    approx->labels[0]       = svm->labels[0];
+    approx->labels[1]       = svm->labels[1];
+    approx->num_sv_class[0] = num_features;
+
+    approx->sv_mat  = (float*) malloc ( num_features * len * sizeof(float) );
+    approx->sv      = (float**) malloc ( num_features * sizeof(float*) );
+    approx->sv_norm = (double*) malloc ( num_features * sizeof(double) );
+    approx->sv_off  = (double*) malloc ( num_features * sizeof(double) );
+    approx->sv_coef = (float*) malloc ( num_features * sizeof(float) );
+    if ( approx->sv_mat == NULL || approx->sv == NULL || approx->sv_norm == NULL ||
+         approx->sv_off == NULL || approx->sv_coef == NULL )
+    {
+        mig_svm_model_free ( approx );
+        return MIG_ERROR_MEMORY;
+    }
+
+    /* exp( -gamma | x - y |^2 ) = E[ 2 cos( w . x + b ) cos( w . y + b ) ]
+       for w ~ N( 0 , 2 gamma I ) and b ~ U[ 0 , 2 pi ) */
+    scale = sqrt ( 2.0 * svm->gamma );
+    for ( d = 0 ; d < num_features ; ++d )
+    {
+        approx->sv[d] = approx->sv_mat + d * len;
+        for ( j = 0 ; j < len ; ++j )
+        {
+            /* box muller */
+            u = _rng_uniform ( &state );
+            approx->sv[d][j] = (float)( scale * sqrt ( -2.0 * log ( u ) ) *
+                                        cos ( SVM_TWO_PI * _rng_uniform ( &state ) ) );
+        }
+
+        approx->sv_off[d]  = SVM_TWO_PI * _rng_uniform ( &state );
+        approx->sv_norm[d] = _dot ( approx->sv[d] , approx->sv[d] , len );
+    }
+
+    /* coefficients : kernel expansion of the support vectors on the features */
+    for ( d = 0 ; d < num_features ; ++d )
+    {
+        sum = 0.0;
+        for ( i = 0 ; i < svm->num_sv ; ++i )
+            sum += svm->sv_coef[i] * cos ( _dot ( approx->sv[d] , svm->sv[i] , len ) + approx->sv_off[d] );
+
+        approx->sv_coef[d] = (float)( 2.0 * sum / num_features );
+    }
+
+    return MIG_OK;
+}
+
+/******************************************************************/
+
+int
+mig_svm_decision_batch ( const mig_svm_t *svm , const float *x , int num , double *dec )
+{
+    const float *xt[SVM_TILE_EXAMPLES];
+    double x_norm[SVM_TILE_EXAMPLES];
+    double sum[SVM_TILE_EXAMPLES];
+    double dots[SVM_TILE_EXAMPLES];
+    float *mapped = NULL;
+    int n , e , i , ne;
+    int len;
+
+    if ( svm == NULL || x == NULL || dec == NULL )
+        return MIG_ERROR_PARAM;
+
+    len = svm->len_sv;
+
+    /* examples of the tile through the compiled input map */
+    if ( svm->in_mat )
+    {
+        mapped = (float*) malloc ( SVM_TILE_EXAMPLES * len * sizeof(float) );
+        if ( mapped == NULL )
+            return MIG_ERROR_MEMORY;
+    }
+
+    for ( n = 0 ; n < num ; n += SVM_TILE_EXAMPLES )
+    {
+        /* a partial tile repeats its last example */
+        ne = MIG_MIN2 ( SVM_TILE_EXAMPLES , num - n );
+        for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+            xt[e] = x + ( n + MIG_MIN2 ( e , ne - 1 ) ) * svm->len_in;
+
+        /* each row of the map is a dot product with the whole tile */
+        if ( mapped )
+        {
+            for ( i = 0 ; i < len ; ++i )
+            {
+                _dot_tile ( svm->in_mat + i * svm->len_in , xt , svm->len_in , dots );
+                for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+                    mapped[e * len + i] = (float)( dots[e] + svm->in_off[i] );
+            }
+
+            for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+                xt[e] = mapped + e * len;
+        }
+
+        for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+        {
+            x_norm[e] = _dot ( xt[e] , xt[e] , len );
+            sum[e] = 0.0;
+        }
+
+        /* every support vector row is read once per tile */
+        for ( i = 0 ; i < svm->num_sv ; ++i )
+        {
+            _dot_tile ( svm->sv_mat + i * len , xt , len , dots );
+
+            if ( svm->sv_off )
+                for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+                    dots[e] += svm->sv_off[i];
+
+            for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+                sum[e] += svm->sv_coef[i] * _f_from_dot ( svm , dots[e] , svm->sv_norm[i] , x_norm[e] );
+        }
+
+        for ( e = 0 ; e < ne ; ++e )
+            dec[n + e] = sum[e] - svm->rho;
+    }
+
+    if ( mapped )
+        free ( mapped );
+
+    return MIG_OK;
+}
+
+/******************************************************************/
+
+int
+mig_svm_predict_batch ( const mig_svm_t *svm , const float *x , int num , int *labels )
+{
+    double dec[SVM_PREDICT_CHUNK];
+    int n , e , ne;
+    int rc;
+
+    if ( svm == NULL || x == NULL || labels == NULL )
+        return MIG_ERROR_PARAM;
+
+    for ( n = 0 ; n < num ; n += SVM_PREDICT_CHUNK )
+    {
+        ne = MIG_MIN2 ( SVM_PREDICT_CHUNK , num - n );
+
+        rc = mig_svm_decision_batch ( svm , x + n * svm->len_in , ne , dec );
+        if ( rc != MIG_OK )
+            return rc;
+
+        /* same sign rule as mig_svm_predict */
+        for ( e = 0 ; e < ne ; ++e )
+            labels[n + e] = ( MIG_SGN( dec[e] ) == 1 ) ? ( svm->labels[0] ) : ( svm->labels[1] );
+    }
+
+    return MIG_OK;
+}
 
 /******************************************************************/
 /* PRIVATE IMPLEMENTATIONS */
@@ -473,6 +1409,112 @@ _squared_norm ( const float *sv , const float *x , int len )
 
 /******************************************************************/
 
+static void
+_dot_tile ( const float *sv , const float **x , int len , double *dots )
+{
+    float acc[SVM_TILE_EXAMPLES][SVM_LANES];
+    int i , e , l;
+    int len_lanes = len - len % SVM_LANES;
+    double dot;
+
+    memset ( acc , 0x00 , sizeof(acc) );
+
+    /* lanes are independent : the inner loop maps on simd registers */
+    for ( i = 0 ; i < len_lanes ; i += SVM_LANES )
+        for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+            for ( l = 0 ; l < SVM_LANES ; ++l )
+                acc[e][l] += sv[i + l] * x[e][i + l];
+
+    for ( e = 0 ; e < SVM_TILE_EXAMPLES ; ++e )
+    {
+        dot = 0.0;
+        for ( l = 0 ; l < SVM_LANES ; ++l )
+            dot += acc[e][l];
+        for ( i = len_lanes ; i < len ; ++i )
+            dot += sv[i] * x[e][i];
+        dots[e] = dot;
+    }
+}
+
+/******************************************************************/
+
+static double
+_f_from_dot ( const mig_svm_t *svm , double dot , double sv_norm , double x_norm )
+{
+    double res;
+
+    switch ( svm->type_kernel )
+    {
+        case MIG_POLY :
+                return pow ( (double) svm->gamma * dot + (double) svm->coef0 , (double) svm->deg );
+
+        case MIG_RBF :
+                /* | sv - x |^2 , rounding may take it below 0 */
+                res = sv_norm + x_norm - 2.0 * dot;
+                if ( res < 0.0 )
+                    res = 0.0;
+                return exp ( -(double) svm->gamma * res );
+
+        case MIG_SIGMOID :
+                return tanh ( (double) svm->gamma * dot + (double) svm->coef0 );
+
+        case MIG_RFF :
+                /* dot carries the phase in sv_off */
+                return cos ( dot );
+
+        default :
+                return dot;
+    }
+}
+/******************************************************************/
+
+static void
+_bundle_checksum ( const svm_bundle_header_t *hdr , const unsigned char *data , size_t len ,
+                   Mig32u *checksum )
+{
+    unsigned long long h = 14695981039346656037ULL;
+    svm_bundle_header_t zeroed;
+    const unsigned char *p = (const unsigned char*) &zeroed;
+    size_t i;
+
+    /* the header with its checksum field zeroed , then the file after it */
+    memcpy ( &zeroed , hdr , sizeof(zeroed) );
+    zeroed.checksum[0] = 0;
+    zeroed.checksum[1] = 0;
+
+    for ( i = 0 ; i < sizeof(zeroed) ; ++i )
+    {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+
+    for ( i = sizeof(zeroed) ; i < len ; ++i )
+    {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+
+    checksum[0] = (Mig32u)( h & 0xFFFFFFFFULL );
+    checksum[1] = (Mig32u)( h >> 32 );
+}
+
+
+/******************************************************************/
+
+static double
+_rng_uniform ( Mig32u *state )
+{
+    /* xorshift32 : same features on every platform for a seed */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    /* ( 0 , 1 ) , log safe */
+    return ( ( *state >> 8 ) + 0.5 ) / 16777216.0;
+}
+
+/******************************************************************/
+
 static double
 _f_lin ( const float *sv , const float *x , float param1 , float param2 , float param3 , int len )
 {
@@ -36,7 +36,8 @@ typedef enum
     MIG_LINEAR ,
     MIG_POLY ,
     MIG_RBF , 
-    MIG_SIGMOID
+    MIG_SIGMOID ,
+    MIG_RFF             /* random fourier features of an rbf kernel : cos( sv . x + sv_off ) */
 
 } MIG_SVM_KERNEL_TYPE;
 
@@ -63,13 +64,24 @@ typedef struct _mig_svm_t
 
 	int     num_sv;		        /* total number of support vectors */
 	int     len_sv;             /* support vector lenght */
-	float   **sv;		        /* support vectors */
+	float   **sv;		        /* support vectors : rows of sv_mat */
+	float   *sv_mat;	        /* num_sv x len_sv support vector matrix */
+	double  *sv_norm;	        /* squared norms of the support vectors */
 	float   *sv_coef;	        /* coefficients for SVs in decision functions */
 	float   rho;		        /* constants in decision functions */
 
 	int     labels[2];		    /* label to assign to each class */
 	int     num_sv_class[2];	/* number of support vectors for each class */
 
+	/* input map compiled into the model by mig_svm_model_compile */
+	int     compiled;           /* 1 once scaling / whitening are compiled in */
+	int     len_in;             /* features of an input example ( len_sv if not compiled ) */
+	float   *in_mat;            /* len_sv x len_in map applied to rbf inputs , NULL if none */
+	float   *in_off;            /* len_sv offset added by in_mat */
+	double  *sv_off;            /* per sv offset of folded dot products , NULL if none */
+
+	void    *map;               /* read only mapping of a bundle holding the arrays , NULL if none */
+
 } mig_svm_t;
 
 
@@ -83,6 +95,17 @@ typedef struct _mig_svm_scale_t
 } mig_svm_scale_t;
 
 
+/* labelled examples of a libsvm data file */
+typedef struct _mig_svm_data_t
+{
+    int     num;        /* number of examples */
+    int     len;        /* features per example */
+    int     *labels;    /* label of every example */
+    float   *feats;     /* num x len features , one example after the other */
+
+} mig_svm_data_t;
+
+
 /*
 ******************************************************************************
 *                               PROTOTYPES
@@ -108,6 +131,32 @@ typedef struct _mig_svm_scale_t
 int
 mig_svm_model_load ( const char *model_file_name , mig_svm_t *model );
 
+/*
+******************************************************************************
+*               WRITE SVM MODEL TO FILE
+*
+* Description : This function writes a model in the libsvm text format read
+*               by mig_svm_model_load , every support vector with all of its
+*               features so that the feature count survives a reload.
+*
+* Arguments   : model_file_name - filename ( full path ).
+*               model           - model to write.
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL.
+*               MIG_ERROR_IO            if the file could not be written.
+*               MIG_ERROR_UNSUPPORTED   if the model is compiled : the text
+*                                       format has no input map.
+*
+* Notes : Support vectors are written in model order , model->num_sv_class
+*         gives the per class counts of the file.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_model_write ( const char *model_file_name , const mig_svm_t *model );
+
 /*
 ******************************************************************************
 *               FREE SVM MODEL
@@ -195,6 +244,46 @@ mig_svm_scale_params_write ( const char *scale_params_file_name , mig_svm_scale_
 void
 mig_svm_scale_params_free ( mig_svm_scale_t *scale_params );
 
+/*
+******************************************************************************
+*               LOAD LABELLED EXAMPLES FROM A LIBSVM DATA FILE
+*
+* Description : This function loads the examples of a libsvm data file ,
+*               one "label idx:value idx:value ..." line per example with
+*               indexes from 0 , as written by the training tools.
+*
+* Arguments   : data_file_name - filename ( full path ).
+*               len            - features per example , missing ones are 0.
+*               data           - loaded examples ( preallocated ).
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL
+*                                       or len < 1.
+*               MIG_ERROR_IO            if the file could not be read.
+*               MIG_ERROR_UNSUPPORTED   if there is a syntax error in the file
+*                                       or an index out of [ 0 , len ).
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_data_load ( const char *data_file_name , int len , mig_svm_data_t *data );
+
+/*
+******************************************************************************
+*               FREE LABELLED EXAMPLES
+*
+* Description : This function frees the examples loaded by mig_svm_data_load.
+*
+* Arguments   : data - examples to free.
+*
+******************************************************************************
+*/
+
+void
+mig_svm_data_free ( mig_svm_data_t *data );
+
 
 /*
 ******************************************************************************
@@ -220,6 +309,208 @@ mig_svm_scale_params_free ( mig_svm_scale_t *scale_params );
 int
 mig_svm_predict ( const mig_svm_t *svm , mig_svm_example_t *x );
 
+/*
+******************************************************************************
+*               COMPILE FEATURE SCALING AND WHITENING INTO THE MODEL
+*
+* Description : This function composes the scaling x' = ( x - mean ) /
+*               ( nsigma * std ) and the linear map y = mat * x' applied to
+*               the features before prediction into a single affine map
+*               y = A * x + b , and moves it into the model so that raw
+*               features can be predicted directly :
+*               - linear , polynomial , sigmoid and random feature kernels :
+*                 A is folded into the support vectors ( sv <- A^T sv ) and b
+*                 into a per sv offset of the dot products. A linear model is
+*                 further reduced to its single weight vector.
+*               - rbf kernel : the map is kept in the model and applied once
+*                 per tile of examples by the batched decision.
+*
+* Arguments   : svm    - loaded support vector machine structure.
+*               scales - scaling parameters of len_in features , NULL if none.
+*               nsigma - scaling std multiplier.
+*               mat    - svm->len_sv x len_in row major map , NULL if none
+*                        ( len_in must then be svm->len_sv ).
+*               len_in - number of raw features.
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if sizes do not match.
+*               MIG_ERROR_UNSUPPORTED   if the model is already compiled or mapped.
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+* Notes : After compiling , examples have len_in features and every
+*         prediction goes through mig_svm_predict_batch.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_model_compile ( mig_svm_t *svm , const mig_svm_scale_t *scales , float nsigma ,
+                        const float *mat , int len_in );
+
+/*
+******************************************************************************
+*               APPROXIMATE AN RBF MODEL WITH RANDOM FOURIER FEATURES
+*
+* Description : This function builds a model whose decision is a dense
+*               projection of the example on num_features random directions
+*               followed by a linear model of their cosines :
+*               sum( coef * cos( w . x + b ) ) - rho. Directions w and phases
+*               b are drawn from the kernel spectrum , the coefficients are
+*               the projection of the rbf expansion on the features , which
+*               callers can refit on training data.
+*
+* Arguments   : approx       - approximated model ( output , preallocated ).
+*               svm          - rbf model to approximate , not compiled.
+*               num_features - number of random features.
+*               seed         - random seed , same features for a seed.
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL
+*                                       or num_features < 1.
+*               MIG_ERROR_UNSUPPORTED   if svm is not an rbf model or is compiled.
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+* Notes : Features are stored as support vectors ( sv_mat , phases in
+*         sv_off ) : prediction costs num_features x len whatever the number
+*         of support vectors of svm , and the model can be compiled and
+*         bundled as a dot product model. It has no libsvm text format.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_rff_init ( mig_svm_t *approx , const mig_svm_t *svm , int num_features , unsigned int seed );
+
+/*
+******************************************************************************
+*               WRITE SVM MODEL BUNDLE
+*
+* Description : This function writes a model , compiled or not , as a single
+*               binary bundle : kernel parameters , whether scaling and
+*               whitening are compiled in , support vector matrix ,
+*               coefficients , norms and the compiled input map , each array
+*               aligned for direct use. A checksum covers the whole file.
+*
+* Arguments   : bundle_file_name - filename ( full path ).
+*               svm              - model to write.
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL.
+*               MIG_ERROR_IO            if the file could not be written.
+*               MIG_ERROR_UNSUPPORTED   if the bundle would exceed 4 GB.
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_bundle_write ( const char *bundle_file_name , const mig_svm_t *svm );
+
+/*
+******************************************************************************
+*               LOAD SVM MODEL BUNDLE
+*
+* Description : This function maps a bundle written by mig_svm_bundle_write
+*               read only and points the model arrays into the mapping :
+*               nothing is parsed or copied , and processes loading the same
+*               bundle share its pages.
+*
+* Arguments   : bundle_file_name - filename ( full path ).
+*               svm              - loaded model structure ( preallocated ).
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL.
+*               MIG_ERROR_IO            if the file could not be mapped.
+*               MIG_ERROR_UNSUPPORTED   if the file is not a valid bundle , its
+*                                       dimensions are out of range or its
+*                                       checksum does not match.
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+* Notes : The model is released by mig_svm_model_free and can not be compiled.
+*         svm->compiled tells whether the bundle expects raw features.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_bundle_load ( const char *bundle_file_name , mig_svm_t *svm );
+
+/*
+******************************************************************************
+*               VERIFY SVM MODEL BUNDLE
+*
+* Description : This function loads a bundle written from svm and checks
+*               that its decisions on a fixed set of random examples are
+*               bit identical to the ones of svm , as tools writing bundles
+*               do before a bundle is deployed.
+*
+* Arguments   : bundle_file_name - filename ( full path ).
+*               svm              - model the bundle was written from.
+*
+* Returns     : MIG_OK                  if the bundle matches the model.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL.
+*               MIG_ERROR_UNSUPPORTED   if the bundle does not load or its
+*                                       decisions differ.
+*               MIG_ERROR_IO            if the file could not be mapped.
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_bundle_verify ( const char *bundle_file_name , const mig_svm_t *svm );
+
+/*
+******************************************************************************
+*               SVM DECISION VALUES FOR A BATCH OF EXAMPLES
+*
+* Description : This function computes the decision values of num examples.
+*               Dot products of the examples with the support vector matrix
+*               are computed a tile of examples at a time , then turned into
+*               kernel values ( rbf from the support vector norms ) and
+*               summed with the coefficients.
+*
+* Arguments   : svm - support vector machine structure.
+*               x   - num examples of svm->len_in features , one after the other.
+*               num - number of examples.
+*               dec - num decision values ( output ).
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL.
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+* Notes : Products are accumulated in float , kernels and sums in double :
+*         decision values agree with mig_svm_predict up to float rounding.
+*         A decision value >= 0 means label svm->labels[0].
+*
+******************************************************************************
+*/
+
+int
+mig_svm_decision_batch ( const mig_svm_t *svm , const float *x , int num , double *dec );
+
+/*
+******************************************************************************
+*               PREDICT SVM LABELS FOR A BATCH OF EXAMPLES
+*
+* Description : This function predicts the labels of num examples from
+*               their mig_svm_decision_batch decision values.
+*
+* Arguments   : svm    - support vector machine structure.
+*               x      - num examples of svm->len_in features , one after the other.
+*               num    - number of examples.
+*               labels - num labels read from svm->labels ( output ).
+*
+* Returns     : MIG_OK                  on success.
+*               MIG_ERROR_PARAM         if one of the input parameters is NULL.
+*               MIG_ERROR_MEMORY        if there was a memory error.
+*
+******************************************************************************
+*/
+
+int
+mig_svm_predict_batch ( const mig_svm_t *svm , const float *x , int num , int *labels );
+
 /*
  ****************************************************************************
  * Allocate scaling structure with feat_len length
@@ -15,6 +15,8 @@ main ( int argc , char **argv )
     int i , j , rc;
     float **sv2;
     float f = 1.0f;
+    float batch[24];
+    int labels[2];
 
     printf ( "\nLoading model..." );
     rc = mig_svm_model_load ( argv[1] , &model );
@@ -68,6 +70,12 @@ main ( int argc , char **argv )
     rc = mig_svm_predict ( &model , &x );
     printf ( "\n 2. Return code was : %d , label was : %d" , rc , x.label );
 
+    printf ( "\nPredicting labels as a batch..." );
+    memcpy ( batch , feat1 , sizeof(feat1) );
+    memcpy ( batch + 12 , feat2 , sizeof(feat2) );
+    rc = mig_svm_predict_batch ( &model , batch , 2 , labels );
+    printf ( "\n Return code was : %d , labels were : %d %d" , rc , labels[0] , labels[1] );
+
     printf ( "\nFreeing model..." );
     mig_svm_model_free ( &model );
 
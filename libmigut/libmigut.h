@@ -10,6 +10,7 @@
 #include "mig_ut_fs.h"
 #include "mig_ut_lock.h"
 #include "mig_ut_dll.h"
+#include "mig_ut_pool.h"
 
 #endif /* __LIBMIG_UT_H__ */
 
@@ -4,6 +4,7 @@
 
 #if !defined(WIN32)
 #include <errno.h>
+#include <sys/mman.h>
 #endif
 
 /************************************/
@@ -593,4 +594,118 @@ mig_uf_fs_iswritable ( char *path , int *iswritable )
 #endif /* LINUX */
 /************************************/
 
+/************************************/
+#if defined(WIN32)
+/************************************/
+
+int
+mig_ut_fs_map ( const char *path , mig_ut_fs_map_t *map )
+{
+	HANDLE file , mapping;
+	DWORD len_hi , len_lo;
+
+	if ( path == NULL || map == NULL )
+		return MIG_ERROR_PARAM;
+
+	mig_memz ( map , sizeof(mig_ut_fs_map_t) );
+
+	file = CreateFile ( path , GENERIC_READ , FILE_SHARE_READ , NULL ,
+	                    OPEN_EXISTING , FILE_ATTRIBUTE_NORMAL , NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return MIG_ERROR_IO;
+
+	/* empty files , and files over 4 GB whose length would be truncated */
+	len_lo = GetFileSize ( file , &len_hi );
+	if ( len_lo == 0 || len_hi != 0 )
+	{
+		CloseHandle ( file );
+		return MIG_ERROR_IO;
+	}
+
+	/* the mapping keeps the file open */
+	mapping = CreateFileMapping ( file , NULL , PAGE_READONLY , 0 , 0 , NULL );
+	CloseHandle ( file );
+	if ( mapping == NULL )
+		return MIG_ERROR_IO;
+
+	map->data = MapViewOfFile ( mapping , FILE_MAP_READ , 0 , 0 , 0 );
+	if ( map->data == NULL )
+	{
+		CloseHandle ( mapping );
+		return MIG_ERROR_IO;
+	}
+
+	map->len = (size_t) len_lo;
+	map->handle = mapping;
+
+	return MIG_OK;
+}
+
+/************************************/
+
+void
+mig_ut_fs_unmap ( mig_ut_fs_map_t *map )
+{
+	if ( map == NULL || map->data == NULL )
+		return;
+
+	UnmapViewOfFile ( map->data );
+	CloseHandle ( (HANDLE) map->handle );
+
+	mig_memz ( map , sizeof(mig_ut_fs_map_t) );
+}
 
+/************************************/
+#else   /* LINUX */
+/************************************/
+
+int
+mig_ut_fs_map ( const char *path , mig_ut_fs_map_t *map )
+{
+	struct stat st;
+	void *data;
+	int fd;
+
+	if ( path == NULL || map == NULL )
+		return MIG_ERROR_PARAM;
+
+	mig_memz ( map , sizeof(mig_ut_fs_map_t) );
+
+	fd = open ( path , O_RDONLY );
+	if ( fd < 0 )
+		return MIG_ERROR_IO;
+
+	if ( fstat ( fd , &st ) != 0 || st.st_size <= 0 )
+	{
+		close ( fd );
+		return MIG_ERROR_IO;
+	}
+
+	/* the mapping keeps the file open */
+	data = mmap ( NULL , (size_t) st.st_size , PROT_READ , MAP_SHARED , fd , 0 );
+	close ( fd );
+	if ( data == MAP_FAILED )
+		return MIG_ERROR_IO;
+
+	map->data = data;
+	map->len = (size_t) st.st_size;
+
+	return MIG_OK;
+}
+
+/************************************/
+
+void
+mig_ut_fs_unmap ( mig_ut_fs_map_t *map )
+{
+	if ( map == NULL || map->data == NULL )
+		return;
+
+	munmap ( (void*) map->data , map->len );
+
+	mig_memz ( map , sizeof(mig_ut_fs_map_t) );
+}
+
+/************************************/
+#endif /* LINUX */
+/************************************/
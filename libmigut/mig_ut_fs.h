@@ -79,6 +79,26 @@ mig_uf_fs_isreadable ( char *path , int *isreadable );
 extern int
 mig_uf_fs_iswritable ( char *path , int *iswritable );
 
+/************************/
+/* READ ONLY MAPPING    */
+/************************/
+
+/* a whole file mapped read only : processes mapping the same file
+   share its physical pages */
+typedef struct _mig_ut_fs_map_t
+{
+	const void *data;       /* file contents */
+	size_t     len;         /* file length in bytes */
+	void       *handle;     /* WIN32 : file mapping object */
+
+} mig_ut_fs_map_t;
+
+extern int
+mig_ut_fs_map ( const char *path , mig_ut_fs_map_t *map );
+
+extern void
+mig_ut_fs_unmap ( mig_ut_fs_map_t *map );
+
 MIG_C_LINKAGE_END
 
 
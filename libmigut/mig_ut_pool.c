@@ -0,0 +1,293 @@
+/*
+******************************************************************************
+*
+* Filename    : mig_ut_pool.c
+* Description : Work stealing task pool
+*
+******************************************************************************
+*/
+
+#include "mig_ut_pool.h"
+
+#include <pthread.h>
+
+/*
+******************************************************************************
+*                       LOCAL DATA TYPES
+******************************************************************************
+*/
+
+/* tasks still owned by a single worker */
+typedef struct _pool_range_t
+{
+        pthread_mutex_t lock;           /* guards lo and hi */
+        int             lo;             /* next task to run */
+        int             hi;             /* one past last owned task */
+
+} pool_range_t;
+
+/* state shared by all workers of a run */
+typedef struct _pool_t
+{
+        mig_ut_task_f   routine;        /* task routine */
+        void            *arg;           /* task routine user data */
+        int             num_workers;    /* number of workers */
+        pool_range_t    *ranges;        /* one range per worker */
+        pthread_mutex_t lock;           /* guards failed */
+        int             failed;         /* a task returned non zero */
+
+} pool_t;
+
+/* a worker and the run it belongs to */
+typedef struct _pool_worker_t
+{
+        pool_t          *pool;
+        int             id;
+
+} pool_worker_t;
+
+/*
+******************************************************************************
+*                       LOCAL PROTOTYPES DECLARATION
+******************************************************************************
+*/
+
+/*
+******************************************************************************
+*                       GET NEXT TASK
+*
+* Description : This function pops the next task of a worker range or ,
+*               if the range is empty , steals the upper half of the
+*               largest range of the other workers.
+*
+* Arguments   : pool - pool run
+*               id   - worker index
+*
+* Returns     : task index
+*               -1 if no task is left
+*
+******************************************************************************
+*/
+
+static int
+_pool_next ( pool_t *pool ,
+             int id );
+
+/*
+******************************************************************************
+*                       WORKER ROUTINE
+*
+* Description : This function runs tasks until none is left or a task fails.
+*
+* Arguments   : arg - pool_worker_t
+*
+* Returns     : NULL
+*
+******************************************************************************
+*/
+
+static void*
+_pool_worker ( void *arg );
+
+/*
+******************************************************************************
+*               GLOBAL PROTOTYPES IMPLEMENTATION
+******************************************************************************
+*/
+
+int
+mig_ut_pool_run ( int num_tasks ,
+                  int num_threads ,
+                  mig_ut_task_f routine ,
+                  void *arg )
+{
+        pool_t pool;
+        pool_worker_t *workers = NULL;
+        pthread_t *threads = NULL;
+        int t , created , rc;
+
+        if ( routine == NULL || num_tasks < 0 )
+                return -1;
+
+        if ( num_tasks == 0 )
+                return 0;
+
+        /* serial : plain loop in task order */
+        num_threads = MIG_MAX2 ( MIG_MIN2 ( num_threads , num_tasks ) , 1 );
+        if ( num_threads == 1 )
+        {
+                for ( t = 0 ; t < num_tasks ; ++t )
+                        if ( routine ( arg , t , 0 ) != 0 )
+                                return -1;
+                return 0;
+        }
+
+        pool.routine     = routine;
+        pool.arg         = arg;
+        pool.num_workers = num_threads;
+        pool.failed      = 0;
+        pool.ranges      = (pool_range_t*) malloc ( num_threads * sizeof(pool_range_t) );
+        workers = (pool_worker_t*) malloc ( num_threads * sizeof(pool_worker_t) );
+        threads = (pthread_t*) malloc ( num_threads * sizeof(pthread_t) );
+        if ( pool.ranges == NULL || workers == NULL || threads == NULL )
+        {
+                rc = -1;
+                goto error;
+        }
+
+        pthread_mutex_init ( &( pool.lock ) , NULL );
+
+        /* contiguous initial ranges keep neighbouring tasks on one worker */
+        for ( t = 0 ; t < num_threads ; ++t )
+        {
+                pthread_mutex_init ( &( pool.ranges[t].lock ) , NULL );
+                pool.ranges[t].lo = (int)( ( (long long) num_tasks * t ) / num_threads );
+                pool.ranges[t].hi = (int)( ( (long long) num_tasks * ( t + 1 ) ) / num_threads );
+
+                workers[t].pool = &pool;
+                workers[t].id   = t;
+        }
+
+        /* worker 0 is the calling thread , missing workers get stolen from */
+        for ( t = 1 , created = 0 ; t < num_threads ; ++t )
+        {
+                if ( pthread_create ( &( threads[t] ) , NULL , &_pool_worker , &( workers[t] ) ) != 0 )
+                        break;
+                ++created;
+        }
+
+        _pool_worker ( &( workers[0] ) );
+
+        for ( t = 1 ; t <= created ; ++t )
+                pthread_join ( threads[t] , NULL );
+
+        rc = pool.failed ? -1 : 0;
+
+        for ( t = 0 ; t < num_threads ; ++t )
+                pthread_mutex_destroy ( &( pool.ranges[t].lock ) );
+        pthread_mutex_destroy ( &( pool.lock ) );
+
+error :
+
+        if ( pool.ranges )
+                free ( pool.ranges );
+        if ( workers )
+                free ( workers );
+        if ( threads )
+                free ( threads );
+
+        return rc;
+}
+
+/*****************************************************************************/
+
+int
+mig_ut_pool_chunks ( int num_items ,
+                     int chunk_len )
+{
+        if ( num_items <= 0 )
+                return 0;
+
+        if ( chunk_len < 1 )
+                chunk_len = 1;
+
+        return ( num_items + chunk_len - 1 ) / chunk_len;
+}
+
+/*
+******************************************************************************
+*               LOCAL PROTOTYPES IMPLEMENTATION
+******************************************************************************
+*/
+
+static int
+_pool_next ( pool_t *pool ,
+             int id )
+{
+        pool_range_t *own = &( pool->ranges[id] );
+        pool_range_t *victim;
+        int task = -1;
+        int t , best , left , mid , hi;
+
+        pthread_mutex_lock ( &( own->lock ) );
+        if ( own->lo < own->hi )
+                task = own->lo++;
+        pthread_mutex_unlock ( &( own->lock ) );
+
+        while ( task < 0 )
+        {
+                /* pick the worker with most tasks left ( a hint only ) */
+                best = -1;
+                left = 0;
+                for ( t = 0 ; t < pool->num_workers ; ++t )
+                {
+                        if ( t == id )
+                                continue;
+
+                        pthread_mutex_lock ( &( pool->ranges[t].lock ) );
+                        if ( pool->ranges[t].hi - pool->ranges[t].lo > left )
+                        {
+                                left = pool->ranges[t].hi - pool->ranges[t].lo;
+                                best = t;
+                        }
+                        pthread_mutex_unlock ( &( pool->ranges[t].lock ) );
+                }
+
+                if ( best < 0 )
+                        return -1;
+
+                /* steal upper half , victim keeps working from its lower end */
+                victim = &( pool->ranges[best] );
+                pthread_mutex_lock ( &( victim->lock ) );
+                hi  = victim->hi;
+                mid = victim->lo + ( victim->hi - victim->lo ) / 2;
+                if ( mid < hi )
+                        victim->hi = mid;
+                pthread_mutex_unlock ( &( victim->lock ) );
+
+                /* victim ran out meanwhile : look again */
+                if ( mid >= hi )
+                        continue;
+
+                pthread_mutex_lock ( &( own->lock ) );
+                task    = mid;
+                own->lo = mid + 1;
+                own->hi = hi;
+                pthread_mutex_unlock ( &( own->lock ) );
+        }
+
+        return task;
+}
+
+/*****************************************************************************/
+
+static void*
+_pool_worker ( void *arg )
+{
+        pool_worker_t *worker = (pool_worker_t*) arg;
+        pool_t *pool = worker->pool;
+        int task , failed;
+
+        for ( ;; )
+        {
+                pthread_mutex_lock ( &( pool->lock ) );
+                failed = pool->failed;
+                pthread_mutex_unlock ( &( pool->lock ) );
+
+                if ( failed )
+                        break;
+
+                task = _pool_next ( pool , worker->id );
+                if ( task < 0 )
+                        break;
+
+                if ( pool->routine ( pool->arg , task , worker->id ) != 0 )
+                {
+                        pthread_mutex_lock ( &( pool->lock ) );
+                        pool->failed = 1;
+                        pthread_mutex_unlock ( &( pool->lock ) );
+                }
+        }
+
+        return NULL;
+}
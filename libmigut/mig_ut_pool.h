@@ -0,0 +1,109 @@
+/*
+******************************************************************************
+*
+* Filename    : mig_ut_pool.h
+* Description : Work stealing task pool
+*
+******************************************************************************
+*/
+
+#ifndef __MIG_UT_POOL_H__
+#define __MIG_UT_POOL_H__
+
+#include "mig_config.h"
+#include "mig_defs.h"
+
+MIG_C_LINKAGE_START
+
+/*
+******************************************************************************
+*                               DATA TYPES
+******************************************************************************
+*/
+
+/*
+******************************************************************************
+*                               TASK ROUTINE
+*
+* Description : Processes a single task of a pool run.
+*
+* Arguments   : arg    - user data shared by all tasks
+*               task   - task index in [ 0 , num_tasks )
+*               worker - index in [ 0 , num_threads ) of the worker running
+*                        the task : lets tasks use per worker buffers
+*
+* Returns     : 0 on success
+*               any other value stops the run
+*
+******************************************************************************
+*/
+
+typedef int (*mig_ut_task_f)( void *arg , int task , int worker );
+
+/*
+******************************************************************************
+*                               PROTOTYPES
+******************************************************************************
+*/
+
+/*
+******************************************************************************
+*                       RUN TASKS ON A WORK STEALING POOL
+*
+* Description : This function runs tasks 0 ... num_tasks - 1 on num_threads
+*               workers. Every worker starts with a contiguous range of
+*               tasks which it processes in increasing order. A worker
+*               whose range is exhausted steals the upper half of the
+*               largest remaining range , so that uneven tasks ( lungs of
+*               different size , candidates of different radius ) keep all
+*               workers busy until the end.
+*
+* Arguments   : num_tasks   - number of tasks
+*               num_threads - number of workers ( 1 -> serial , in order )
+*               routine     - task routine
+*               arg         - user data passed to every task
+*
+* Returns     : 0 if every task returned 0
+*               -1 if a task failed or on memory error
+*
+* Notes       : Worker 0 is the calling thread. Workers which can not be
+*               created are replaced by the others. Task order inside a run
+*               is not defined : tasks should write their results into
+*               slots indexed by task so that callers can merge them in
+*               task order , which keeps output deterministic. After a
+*               failure no new task is started.
+*
+******************************************************************************
+*/
+
+int
+mig_ut_pool_run ( int num_tasks ,
+                  int num_threads ,
+                  mig_ut_task_f routine ,
+                  void *arg );
+
+/*
+******************************************************************************
+*                       SPLIT ITEMS IN TASKS
+*
+* Description : This function returns the number of chunks of at most
+*               chunk_len items needed to cover num_items items.
+*
+* Arguments   : num_items - number of items
+*               chunk_len - items per chunk ( < 1 -> 1 )
+*
+* Returns     : number of chunks
+*
+* Notes       : chunk c covers items [ c * chunk_len , MIN( ( c + 1 ) *
+*               chunk_len , num_items ) )
+*
+******************************************************************************
+*/
+
+int
+mig_ut_pool_chunks ( int num_items ,
+                     int chunk_len );
+
+MIG_C_LINKAGE_END
+
+#endif /* __MIG_UT_POOL_H__ */
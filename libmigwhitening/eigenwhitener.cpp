@@ -13,6 +13,7 @@ using namespace Eigen;
 const float _Eps = 1e-5f;
 
 	EigenWhitener::EigenWhitener()
+		: feat_num(0)
 	{
 	}
 	;
@@ -93,6 +94,7 @@ const float _Eps = 1e-5f;
 
 
 		feat_num = nfeat;
+		update_transform();
 		return 0;
 	}
 	;
@@ -133,6 +135,7 @@ const float _Eps = 1e-5f;
 		{
 			return 1;
 		}
+		update_transform();
 		return 0;
 	}
 	;
@@ -170,7 +173,7 @@ const float _Eps = 1e-5f;
 	}
 	;
 
-	int EigenWhitener::apply ( const float* const in_vec, const float* out_vec)
+	int EigenWhitener::apply ( const float* const in_vec, const float* out_vec) const
 	{
 		//map to eigen data structures
 		Map<VectorXf> in_vec_map(const_cast<float*> (in_vec), feat_num);
@@ -184,3 +187,48 @@ const float _Eps = 1e-5f;
 		return 0;
 	}
 	; 
+
+	int EigenWhitener::apply_batch ( const float* const in_mat, float* const out_mat, const int num ) const
+	{
+		typedef Matrix<float, Dynamic, Dynamic, RowMajor> RowMatrixXf;
+
+		//one feature vector per row
+		Map<const RowMatrixXf> in_map(in_mat, num, feat_num);
+		Map<RowMatrixXf> out_map(out_mat, num, feat_num);
+
+		//the product goes through a temporary when whitening in place
+		if (in_mat == out_mat)
+			out_map = in_map * transform;
+		else
+			out_map.noalias() = in_map * transform;
+
+		return 0;
+	}
+	;
+
+	int EigenWhitener::len () const
+	{
+		return feat_num;
+	}
+	;
+
+	int EigenWhitener::matrix ( float* const mat ) const
+	{
+		//M = diag(inv_sqrt_eigenvalues) * eigenvectors^T
+		for (int i = 0; i != feat_num; ++i)
+		{
+			for (int j = 0; j != feat_num; ++j)
+			{
+				mat[i * feat_num + j] = inv_sqrt_eigenvalues(i) * eigenvectors(j,i);
+			}
+		}
+		return 0;
+	}
+	;
+
+	void EigenWhitener::update_transform ()
+	{
+		//M^T = eigenvectors * diag(inv_sqrt_eigenvalues)
+		transform = eigenvectors * inv_sqrt_eigenvalues.col(0).asDiagonal();
+	}
+	;
@@ -32,13 +32,38 @@ public:
 
 	int save ( const char* const fname );
 
-	int apply ( const float* const in_vec, const float* out_vec);
+	int apply ( const float* const in_vec, const float* out_vec) const;
+
+	/**
+	 ************************************************
+	 *  whiten num row major feature vectors with one
+	 *  matrix product , out_mat may be in_mat.
+	 *  const methods only read the whitener , so
+	 *  threads can share one instance
+	 ************************************************
+	 */
+	int apply_batch ( const float* const in_mat, float* const out_mat, const int num ) const;
+
+	/**
+	 ************************************************
+	 *  number of features and row major matrix M
+	 *  such that apply computes out_vec = M * in_vec
+	 ************************************************
+	 */
+	int len () const;
+
+	int matrix ( float* const mat ) const;
 	
 
 private:
+	void update_transform ();
+
 	int feat_num;
 	Eigen::MatrixXf inv_sqrt_eigenvalues;
 	Eigen::MatrixXf eigenvectors;
+
+	//M^T , applied on the right of row major feature vectors
+	Eigen::MatrixXf transform;
 };
 
 #endif /* __EIGENWHITENER_H__*/
\ No newline at end of file
@@ -21,11 +21,26 @@ int mig_whitening_compute( EigenWhitener* whitener, float** feat_mat, int nfeat,
 	return whitener->compute( const_cast < const float **const >(feat_mat), nfeat, nfeatvec);
 }
 
-int mig_whitening_apply( EigenWhitener* whitener, float* in_vec, float* out_vec )
+int mig_whitening_apply( const EigenWhitener* whitener, float* in_vec, float* out_vec )
 {
 	return whitener->apply( in_vec, out_vec );
 }
 
+int mig_whitening_apply_batch( const EigenWhitener* whitener, const float* in_mat, float* out_mat, int num )
+{
+	return whitener->apply_batch( in_mat, out_mat, num );
+}
+
+int mig_whitening_len( const EigenWhitener* whitener )
+{
+	return whitener->len();
+}
+
+int mig_whitening_matrix( const EigenWhitener* whitener, float* mat )
+{
+	return whitener->matrix( mat );
+}
+
 int mig_whitening_load( EigenWhitener* whitener, char* fname )
 {
 	return whitener->load( fname ) ;
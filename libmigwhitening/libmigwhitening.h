@@ -32,7 +32,16 @@ MIG_C_LINKAGE_START
 
 int mig_whitening_compute( EigenWhitener* whitener, float** feat_mat, int nfeat, int nfeatvec );
 
-int mig_whitening_apply( EigenWhitener* whitener, float* in_vec, float* out_vec );
+int mig_whitening_apply( const EigenWhitener* whitener, float* in_vec, float* out_vec );
+
+/* whiten num row major vectors of len features with one matrix product ,
+   out_mat may be in_mat ; a loaded whitener is only read , threads can share it */
+int mig_whitening_apply_batch( const EigenWhitener* whitener, const float* in_mat, float* out_mat, int num );
+
+/* number of features and row major len x len matrix applied by mig_whitening_apply */
+int mig_whitening_len( const EigenWhitener* whitener );
+
+int mig_whitening_matrix( const EigenWhitener* whitener, float* mat );
 
 int mig_whitening_load( EigenWhitener* whitener, char* fname );
 
@@ -66,4 +66,18 @@ int main()
 	whitener.apply(in_vec, out_vec);
 	std::cout << "expected: 5.0465 0.5093 -0.6090\n";
 	std::cout << "obtained: " << out_vec[0] << " " << out_vec[1] << " " << out_vec[2];
+
+	//batch whitening in place must match apply row by row
+	float max_diff = 0.f;
+	whitener.apply_batch(&data_mat[0][0], &data_mat[0][0], 10);
+	for (int i= 0; i!= 10; ++i)
+	{
+		whitener.apply(feat_mat[i], out_vec);
+		for (int j = 0; j!=3; ++j)
+		{
+			float diff = out_vec[j] - data_mat[i][j];
+			max_diff = diff > max_diff ? diff : (-diff > max_diff ? -diff : max_diff);
+		}
+	}
+	std::cout << "\nbatch max difference: " << max_diff << "\n";
 }
\ No newline at end of file
@@ -199,6 +199,15 @@ mig_cad_init ( mig_dic_t *params )
 
     _Fpr2DLL = mig_ut_ini_getstring ( params , PARAM_FPR2_DLL , NULL );
 
+    /* anisotropic detection is detection only : fpr2 mips and moments
+       assume the isotropic geometry its models were trained on */
+    if ( _FlagPerformDetection == 1 && _FlagPerformFpr2 == 1 &&
+         mig_ut_ini_getint ( params , PARAM_DET_ANISOTROPIC , DEFAULT_PARAM_DET_ANISOTROPIC ) )
+    {
+        LOG4CPLUS_FATAL ( _CadLogger , " detection:anisotropic can not be used with fpr2 , disable one of them..." );
+        return MIG_ERROR_PARAM;
+    }
+
     /***********************************************/
     /* next enrey to process / save results queues */
     /***********************************************/
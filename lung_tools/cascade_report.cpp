@@ -0,0 +1,276 @@
+#include "mig_config.h"
+#include "mig_defs.h"
+#include "mig_error_codes.h"
+
+#include "libmigsvm.h"
+
+#include <time.h>
+#include <float.h>
+
+/*******************************************************************/
+#define APP_NAME        "cascade_report"
+#define APP_DESC        "Sensitivity / false positives of the fpr2 cascade on a labelled feature file"
+
+/* mip directions of a candidate , consecutive rows of the feature file */
+#define NDIR            3
+
+#define NUM_THRESHOLDS  20
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+/* cascade outcome at one threshold */
+typedef struct _outcome_t
+{
+   int      tp;         /* positive candidates classified positive */
+   int      fp;         /* negative candidates classified positive */
+   long     evals;      /* directions the full model was evaluated on */
+
+} outcome_t;
+
+static void
+_usage ();
+
+static int
+_check_candidates ( const mig_svm_data_t *ff );
+
+static int
+_scores ( const mig_svm_t *svm , const mig_svm_data_t *ff , double *scores , double *secs );
+
+static void
+_simulate ( const double *full , const double *first , double threshold ,
+            const mig_svm_data_t *ff , int min_pos , outcome_t *out );
+
+static int
+_cmp_double ( const void *a , const void *b );
+
+/*******************************************************************/
+/* MAIN */
+/*******************************************************************/
+
+int
+main ( int argc , char **argv )
+{
+   mig_svm_t full , first;
+   mig_svm_data_t ff;
+   double *full_scores = NULL , *first_scores = NULL , *sorted = NULL;
+   double full_secs , first_secs , threshold , speedup;
+   outcome_t base , out;
+   int min_pos , num_thr , num_pos , rejected , j , i;
+
+   if ( argc != 5 && argc != 6 )
+   {
+      _usage ();
+      exit ( EXIT_FAILURE );
+   }
+
+   min_pos = atoi ( argv[4] );
+   num_thr = ( argc == 6 ) ? atoi ( argv[5] ) : NUM_THRESHOLDS;
+   if ( min_pos < 1 || min_pos > NDIR || num_thr < 1 )
+   {
+      _usage ();
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_model_load ( argv[2] , &full ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Loading model %s..." , argv[2] );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_model_load ( argv[3] , &first ) != MIG_OK || first.len_sv != full.len_sv )
+   {
+      fprintf ( stderr , "\nERROR. Loading cascade model %s..." , argv[3] );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_data_load ( argv[1] , full.len_sv , &ff ) != MIG_OK || _check_candidates ( &ff ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Reading features %s..." , argv[1] );
+      exit ( EXIT_FAILURE );
+   }
+
+   full_scores = (double*) malloc ( ff.num * sizeof(double) );
+   first_scores = (double*) malloc ( ff.num * sizeof(double) );
+   sorted = (double*) malloc ( ff.num * sizeof(double) );
+   if ( full_scores == NULL || first_scores == NULL || sorted == NULL )
+   {
+      fprintf ( stderr , "\nERROR. Memory..." );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( _scores ( &full , &ff , full_scores , &full_secs ) != MIG_OK ||
+        _scores ( &first , &ff , first_scores , &first_secs ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Classifying features..." );
+      exit ( EXIT_FAILURE );
+   }
+
+   for ( i = 0 , num_pos = 0 ; i < ff.num ; i += NDIR )
+      if ( ff.labels[i] == 1 )
+         ++num_pos;
+
+   /* reference : full model with early exit only , same labels as no cascade */
+   _simulate ( full_scores , first_scores , -DBL_MAX , &ff , min_pos , &base );
+
+   printf ( "\n%s : %d candidates , %d positive , min_pos_labels %d" ,
+            argv[1] , ff.num / NDIR , num_pos , min_pos );
+   printf ( "\nfull model %.3g s , cascade model %.3g s on %d directions\n" ,
+            full_secs , first_secs , ff.num );
+   printf ( "\n%12s %8s %8s %8s %8s %8s %8s" ,
+            "threshold" , "rejected" , "sens" , "fp" , "lost_tp" , "evals" , "speedup" );
+
+   /* thresholds at quantiles of the first stage scores */
+   memcpy ( sorted , first_scores , ff.num * sizeof(double) );
+   qsort ( sorted , ff.num , sizeof(double) , &_cmp_double );
+
+   for ( j = -1 ; j < num_thr ; ++j )
+   {
+      threshold = ( j < 0 ) ? -DBL_MAX : sorted[ (long) j * ( ff.num - 1 ) / num_thr ];
+
+      if ( j < 0 )
+         out = base;
+      else
+         _simulate ( full_scores , first_scores , threshold , &ff , min_pos , &out );
+
+      /* cost in full model evaluations , first stage included when used */
+      speedup = full_secs / ( ( j < 0 ? 0.0 : first_secs ) + full_secs * out.evals / ff.num );
+
+      for ( i = 0 , rejected = 0 ; i < ff.num ; ++i )
+         if ( first_scores[i] < threshold )
+            ++rejected;
+
+      if ( j < 0 )
+         printf ( "\n%12s" , "off" );
+      else
+         printf ( "\n%12.4f" , threshold );
+
+      printf ( " %7.1f%% %7.2f%% %8d %8d %7.1f%% %7.2fx" ,
+               100.0 * rejected / ff.num ,
+               num_pos ? 100.0 * out.tp / num_pos : 0.0 ,
+               out.fp , base.tp - out.tp ,
+               100.0 * out.evals / ff.num , speedup );
+   }
+   printf ( "\n" );
+
+   free ( full_scores );
+   free ( first_scores );
+   free ( sorted );
+   mig_svm_data_free ( &ff );
+   mig_svm_model_free ( &full );
+   mig_svm_model_free ( &first );
+
+   exit ( EXIT_SUCCESS );
+}
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+static void
+_usage ()
+{
+   printf ( "\n%s." , APP_DESC );
+   printf ( "\nDirections rejected by the cascade model are not passed to the full" );
+   printf ( "\nmodel ; rows of the table are thresholds as in fpr2:cascade_threshold." );
+   printf ( "\n\nUsage : %s features model cascade min_pos_labels [num_thresholds]" , APP_NAME );
+   printf ( "\n\t features       - whitened libsvm feature file from training , %d rows per candidate" , NDIR );
+   printf ( "\n\t model          - full libsvm model file" );
+   printf ( "\n\t cascade        - first stage libsvm model file" );
+   printf ( "\n\t min_pos_labels - positive directions needed for a positive candidate" );
+   printf ( "\n\t num_thresholds - thresholds tried , default %d" , NUM_THRESHOLDS );
+   printf ( "\n" );
+}
+
+/*******************************************************************/
+
+static int
+_check_candidates ( const mig_svm_data_t *ff )
+{
+   int i;
+
+   /* every candidate has all of its directions , with one label */
+   if ( ff->num == 0 || ff->num % NDIR != 0 )
+      return MIG_ERROR_UNSUPPORTED;
+
+   for ( i = 0 ; i < ff->num ; ++i )
+      if ( ff->labels[i] != ff->labels[i - i % NDIR] )
+         return MIG_ERROR_UNSUPPORTED;
+
+   return MIG_OK;
+}
+
+/*******************************************************************/
+
+static int
+_scores ( const mig_svm_t *svm , const mig_svm_data_t *ff , double *scores , double *secs )
+{
+   clock_t start = clock ();
+   int i , rc;
+
+   rc = mig_svm_decision_batch ( svm , ff->feats , ff->num , scores );
+   if ( rc != MIG_OK )
+      return rc;
+
+   *secs = (double) ( clock () - start ) / CLOCKS_PER_SEC;
+
+   /* scores are positive for label 1 */
+   if ( svm->labels[0] != 1 )
+      for ( i = 0 ; i < ff->num ; ++i )
+         scores[i] = -scores[i];
+
+   return MIG_OK;
+}
+
+/*******************************************************************/
+
+static void
+_simulate ( const double *full , const double *first , double threshold ,
+            const mig_svm_data_t *ff , int min_pos , outcome_t *out )
+{
+   int c , idir , pos , left;
+
+   memset ( out , 0 , sizeof(outcome_t) );
+
+   /* same early exit as fpr2 : a direction is classified only while the
+      candidate label can still change */
+   for ( c = 0 ; c < ff->num ; c += NDIR )
+   {
+      for ( idir = 0 , left = 0 ; idir < NDIR ; ++idir )
+         if ( first[c + idir] >= threshold )
+            ++left;
+
+      for ( idir = 0 , pos = 0 ; idir < NDIR ; ++idir )
+      {
+         if ( pos >= min_pos || pos + left < min_pos )
+            break;
+         if ( first[c + idir] < threshold )
+            continue;
+
+         --left;
+         ++out->evals;
+         if ( full[c + idir] > 0 )
+            ++pos;
+      }
+
+      if ( pos >= min_pos )
+      {
+         if ( ff->labels[c] == 1 )
+            ++out->tp;
+         else
+            ++out->fp;
+      }
+   }
+}
+
+/*******************************************************************/
+
+static int
+_cmp_double ( const void *a , const void *b )
+{
+   double da = *(const double*) a;
+   double db = *(const double*) b;
+
+   return ( da > db ) - ( da < db );
+}
@@ -0,0 +1,261 @@
+#include "mig_config.h"
+#include "mig_defs.h"
+#include "mig_error_codes.h"
+
+#include "libmigsvm.h"
+#include "libmigwhitening.h"
+
+#include "svm_report.h"
+#include "svm_fit.h"
+
+#include <time.h>
+#include <math.h>
+
+#include <Eigen/Dense>
+
+/*******************************************************************/
+#define APP_NAME        "svm_approx"
+#define APP_DESC        "Approximate an rbf svm model with random fourier features"
+
+/* mip directions of a candidate , consecutive rows of the feature file */
+#define NDIR            3
+
+/* random features are the same for every run */
+#define RFF_SEED        1
+
+/* ridge of the least squares fit , relative to the mean feature energy.
+   Random cosines are many and become nearly dependent on the training
+   features as num_features grows : with the svm_reduce ridge , thousands
+   of features get coefficients several times larger that cancel each
+   other , for no gain in agreement */
+#define FIT_RIDGE       1e-6
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+typedef Eigen::VectorXd vec_t;
+
+/* random feature map : directions as columns , phases */
+typedef struct _rff_map_t
+{
+   svm_fit_mat_t  wt;
+   vec_t          phase;
+
+} rff_map_t;
+
+static void
+_usage ();
+
+static int
+_decisions ( const mig_svm_t *svm , const mig_svm_data_t *data , double *dec , double *secs );
+
+static void
+_rff_map ( const svm_fit_mat_t &x , svm_fit_mat_t &phi , const void *ctx );
+
+static int
+_fit ( mig_svm_t *approx , const mig_svm_data_t *data , const double *dec );
+
+/*******************************************************************/
+/* MAIN */
+/*******************************************************************/
+
+int
+main ( int argc , char **argv )
+{
+   mig_svm_t model , approx;
+   mig_svm_data_t data;
+   EigenWhitener whitener;
+   float *whitening = NULL;
+   double *dec = NULL , *proj = NULL , *fit = NULL;
+   double full_secs , approx_secs;
+   int num_features , min_pos = 2;
+   int len , i , rc;
+
+   if ( argc != 6 && argc != 7 )
+   {
+      _usage ();
+      exit ( EXIT_FAILURE );
+   }
+
+   num_features = atoi ( argv[4] );
+   if ( argc == 7 )
+      min_pos = atoi ( argv[6] );
+   if ( num_features < 1 || min_pos < 1 || min_pos > NDIR )
+   {
+      _usage ();
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_model_load ( argv[1] , &model ) != MIG_OK || model.type_kernel != MIG_RBF )
+   {
+      fprintf ( stderr , "\nERROR. Loading rbf model %s..." , argv[1] );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_whitening_load ( &whitener , argv[2] ) != 0 )
+   {
+      fprintf ( stderr , "\nERROR. Loading whitening %s..." , argv[2] );
+      exit ( EXIT_FAILURE );
+   }
+
+   len = mig_whitening_len ( &whitener );
+   if ( len != model.len_sv )
+   {
+      fprintf ( stderr , "\nERROR. Whitening has %d features , model %d..." , len , model.len_sv );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_data_load ( argv[3] , model.len_sv , &data ) != MIG_OK || data.num % NDIR != 0 )
+   {
+      fprintf ( stderr , "\nERROR. Reading features %s..." , argv[3] );
+      exit ( EXIT_FAILURE );
+   }
+
+   dec = (double*) malloc ( data.num * sizeof(double) );
+   proj = (double*) malloc ( data.num * sizeof(double) );
+   fit = (double*) malloc ( data.num * sizeof(double) );
+   whitening = (float*) malloc ( len * len * sizeof(float) );
+   if ( dec == NULL || proj == NULL || fit == NULL || whitening == NULL )
+   {
+      fprintf ( stderr , "\nERROR. Memory..." );
+      exit ( EXIT_FAILURE );
+   }
+
+   /* random features , coefficients projected from the support vectors */
+   rc = mig_svm_rff_init ( &approx , &model , num_features , RFF_SEED );
+   if ( rc == MIG_OK )
+      rc = _decisions ( &model , &data , dec , &full_secs );
+   if ( rc == MIG_OK )
+      rc = _decisions ( &approx , &data , proj , &approx_secs );
+
+   /* then refit on the training features */
+   if ( rc == MIG_OK )
+      rc = _fit ( &approx , &data , dec );
+   if ( rc == MIG_OK )
+      rc = _decisions ( &approx , &data , fit , &approx_secs );
+   if ( rc != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Building approximation : %d..." , rc );
+      exit ( EXIT_FAILURE );
+   }
+
+   printf ( "\n%s : %d support vectors -> %d random features" ,
+            argv[1] , model.num_sv , num_features );
+   printf ( "\ndecision time per direction : full %.3g us , approximated %.3g us" ,
+            1e6 * full_secs / data.num , 1e6 * approx_secs / data.num );
+
+   /* decisions positive for label 1 */
+   if ( model.labels[0] != 1 )
+      for ( i = 0 ; i < data.num ; ++i )
+      {
+         dec[i]  = -dec[i];
+         proj[i] = -proj[i];
+         fit[i]  = -fit[i];
+      }
+
+   svm_report ( &data , NDIR , min_pos , dec , proj , "projected" );
+   svm_report ( &data , NDIR , min_pos , dec , fit , "fitted" );
+
+   /* deployed as a bundle on raw features , like svm_bundle */
+   mig_whitening_matrix ( &whitener , whitening );
+   rc = mig_svm_model_compile ( &approx , NULL , 1.0f , whitening , len );
+   if ( rc == MIG_OK )
+      rc = mig_svm_bundle_write ( argv[5] , &approx );
+   if ( rc == MIG_OK )
+      rc = mig_svm_bundle_verify ( argv[5] , &approx );
+   if ( rc != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Writing bundle %s : %d..." , argv[5] , rc );
+      exit ( EXIT_FAILURE );
+   }
+
+   printf ( "\nWritten %s\n" , argv[5] );
+
+   free ( dec );
+   free ( proj );
+   free ( fit );
+   free ( whitening );
+   mig_svm_data_free ( &data );
+   mig_svm_model_free ( &model );
+   mig_svm_model_free ( &approx );
+
+   exit ( EXIT_SUCCESS );
+}
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+static void
+_usage ()
+{
+   printf ( "\n%s." , APP_DESC );
+   printf ( "\nPrediction becomes a projection on num_features random directions and a" );
+   printf ( "\nlinear model of their cosines , fitted on the features. Decisions of the" );
+   printf ( "\nfull and approximated models are compared , then the approximation is" );
+   printf ( "\nwritten with the whitening compiled in as a bundle for fpr2:svm_bundle_file." );
+   printf ( "\n\nUsage : %s model whitening features num_features bundle [min_pos_labels]" , APP_NAME );
+   printf ( "\n\t model          - rbf libsvm model file" );
+   printf ( "\n\t whitening      - whitening file" );
+   printf ( "\n\t features       - whitened libsvm feature file from training , %d rows per candidate" , NDIR );
+   printf ( "\n\t num_features   - random features of the approximation" );
+   printf ( "\n\t bundle         - output bundle file" );
+   printf ( "\n\t min_pos_labels - positive directions of a positive candidate , default 2" );
+   printf ( "\n" );
+}
+
+/*******************************************************************/
+
+static int
+_decisions ( const mig_svm_t *svm , const mig_svm_data_t *data , double *dec , double *secs )
+{
+   clock_t start = clock ();
+   int rc;
+
+   rc = mig_svm_decision_batch ( svm , data->feats , data->num , dec );
+   *secs = (double) ( clock () - start ) / CLOCKS_PER_SEC;
+
+   return rc;
+}
+
+/*******************************************************************/
+
+static void
+_rff_map ( const svm_fit_mat_t &x , svm_fit_mat_t &phi , const void *ctx )
+{
+   const rff_map_t *m = (const rff_map_t*) ctx;
+   int d = (int) m->wt.cols ();
+
+   /* cos( W x + b ) */
+   phi.leftCols ( d ) = x * m->wt;
+   phi.leftCols ( d ).rowwise () += m->phase.transpose ();
+   phi.leftCols ( d ) = phi.leftCols ( d ).array ().cos ().matrix ();
+}
+
+/*******************************************************************/
+
+static int
+_fit ( mig_svm_t *approx , const mig_svm_data_t *data , const double *dec )
+{
+   int d = approx->num_sv;
+   Eigen::Map<const Eigen::Matrix<float , Eigen::Dynamic , Eigen::Dynamic , Eigen::RowMajor> >
+      w ( approx->sv_mat , d , approx->len_sv );
+   rff_map_t m;
+   vec_t beta;
+   int i , rc;
+
+   m.wt = w.cast<double> ().transpose ();
+   m.phase = Eigen::Map<const vec_t> ( approx->sv_off , d );
+
+   rc = svm_fit_ridge ( data , dec , d , &_rff_map , &m , FIT_RIDGE , beta );
+   if ( rc != MIG_OK )
+      return rc;
+
+   /* decision = sum beta cos - rho */
+   for ( i = 0 ; i < d ; ++i )
+      approx->sv_coef[i] = (float) beta ( i );
+   approx->rho = (float) -beta ( d );
+
+   return MIG_OK;
+}
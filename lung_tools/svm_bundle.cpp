@@ -0,0 +1,141 @@
+#include "mig_config.h"
+#include "mig_defs.h"
+#include "mig_error_codes.h"
+
+#include "libmigsvm.h"
+#include "libmigwhitening.h"
+
+/*******************************************************************/
+#define APP_NAME        "svm_bundle"
+#define APP_DESC        "Convert svm model and whitening into a binary bundle"
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+static void
+_usage ();
+
+/*******************************************************************/
+/* MAIN */
+/*******************************************************************/
+
+int
+main ( int argc , char **argv )
+{
+   mig_svm_t model;
+   mig_svm_scale_t scales;
+   mig_svm_scale_t *scales_p = NULL;
+   EigenWhitener whitener;
+   float *whitening = NULL;
+   float nsigma = 1.0f;
+   int len , rc;
+
+   if ( argc != 4 && argc != 6 )
+   {
+      _usage ();
+      exit ( EXIT_FAILURE );
+   }
+
+   /* libsvm text model */
+   rc = mig_svm_model_load ( argv[1] , &model );
+   if ( rc != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Loading model %s..." , argv[1] );
+      exit ( EXIT_FAILURE );
+   }
+
+   /* whitening */
+   if ( mig_whitening_load ( &whitener , argv[2] ) != 0 )
+   {
+      fprintf ( stderr , "\nERROR. Loading whitening %s..." , argv[2] );
+      exit ( EXIT_FAILURE );
+   }
+
+   len = mig_whitening_len ( &whitener );
+   if ( len != model.len_sv )
+   {
+      fprintf ( stderr , "\nERROR. Whitening has %d features , model %d..." , len , model.len_sv );
+      exit ( EXIT_FAILURE );
+   }
+
+   /* optional scaling applied before whitening */
+   if ( argc == 6 )
+   {
+      rc = mig_svm_scale_params_load ( argv[4] , &scales );
+      if ( rc != MIG_OK )
+      {
+         fprintf ( stderr , "\nERROR. Loading scaling %s..." , argv[4] );
+         exit ( EXIT_FAILURE );
+      }
+
+      nsigma = (float) atof ( argv[5] );
+      if ( nsigma == 0 )
+      {
+         fprintf ( stderr , "\nERROR. %s is not a valid nsigma..." , argv[5] );
+         exit ( EXIT_FAILURE );
+      }
+
+      scales_p = &scales;
+   }
+
+   whitening = (float*) malloc ( len * len * sizeof(float) );
+   if ( whitening == NULL )
+   {
+      fprintf ( stderr , "\nERROR. Memory..." );
+      exit ( EXIT_FAILURE );
+   }
+
+   mig_whitening_matrix ( &whitener , whitening );
+
+   /* scaling and whitening go into the model */
+   rc = mig_svm_model_compile ( &model , scales_p , nsigma , whitening , len );
+   free ( whitening );
+   if ( rc != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Compiling model : %d..." , rc );
+      exit ( EXIT_FAILURE );
+   }
+
+   rc = mig_svm_bundle_write ( argv[3] , &model );
+   if ( rc != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Writing bundle %s..." , argv[3] );
+      exit ( EXIT_FAILURE );
+   }
+
+   rc = mig_svm_bundle_verify ( argv[3] , &model );
+   if ( rc != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Bundle %s does not match model..." , argv[3] );
+      exit ( EXIT_FAILURE );
+   }
+
+   printf ( "\nWritten %s : %d support vectors , %d features , kernel %d\n" ,
+            argv[3] , model.num_sv , model.len_in , (int) model.type_kernel );
+
+   mig_svm_model_free ( &model );
+   if ( scales_p )
+      mig_svm_scale_params_free ( scales_p );
+
+   exit ( EXIT_SUCCESS );
+}
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+static void
+_usage ()
+{
+   printf ( "\n%s." , APP_DESC );
+   printf ( "\nFeature scaling and whitening are compiled into the model ,");
+   printf ( "\nwhich lung_cad maps read only from the bundle." );
+   printf ( "\n\nUsage : %s model whitening bundle [scaling nsigma]" , APP_NAME );
+   printf ( "\n\t model     - libsvm model file" );
+   printf ( "\n\t whitening - whitening file" );
+   printf ( "\n\t bundle    - output bundle file" );
+   printf ( "\n\t scaling   - optional mean / std scaling file , applied first" );
+   printf ( "\n\t nsigma    - std multiplier of the scaling" );
+   printf ( "\n" );
+}
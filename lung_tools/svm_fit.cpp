@@ -0,0 +1,63 @@
+/*
+******************************************************************************
+*
+* Filename    : svm_fit.cpp
+* Description : Ridge least squares fit of svm decision values
+*
+******************************************************************************
+*/
+
+#include "mig_config.h"
+#include "mig_defs.h"
+#include "mig_error_codes.h"
+
+#include "svm_fit.h"
+
+/* feature rows per block of the normal equations */
+#define SVM_FIT_CHUNK   4096
+
+/*******************************************************************/
+/* EXPORTS */
+/*******************************************************************/
+
+int
+svm_fit_ridge ( const mig_svm_data_t *data , const double *dec , int num_basis ,
+                svm_fit_map_f map , const void *ctx , double ridge ,
+                Eigen::VectorXd &beta )
+{
+   svm_fit_mat_t a = svm_fit_mat_t::Zero ( num_basis + 1 , num_basis + 1 );
+   Eigen::VectorXd b = Eigen::VectorXd::Zero ( num_basis + 1 );
+   svm_fit_mat_t x , phi;
+   int start , n;
+
+   Eigen::Map<const Eigen::Matrix<float , Eigen::Dynamic , Eigen::Dynamic , Eigen::RowMajor> >
+      feats ( data->feats , data->num , data->len );
+   Eigen::Map<const Eigen::VectorXd> f ( dec , data->num );
+
+   /* normal equations of [ map( x ) 1 ] beta = f , a block at a time */
+   for ( start = 0 ; start < data->num ; start += SVM_FIT_CHUNK )
+   {
+      n = MIG_MIN2 ( SVM_FIT_CHUNK , data->num - start );
+      x = feats.middleRows ( start , n ).cast<double> ();
+
+      phi.resize ( n , num_basis + 1 );
+      map ( x , phi , ctx );
+      phi.col ( num_basis ).setOnes ();
+
+      a.selfadjointView<Eigen::Lower> ().rankUpdate ( phi.transpose () );
+      b.noalias () += phi.transpose () * f.segment ( start , n );
+   }
+
+   a = a.selfadjointView<Eigen::Lower> ();
+   a.diagonal ().array () += ridge * a.diagonal ().mean ();
+
+   Eigen::LDLT<svm_fit_mat_t> ldlt ( a );
+   if ( ldlt.info () != Eigen::Success )
+      return MIG_ERROR_INTERNAL;
+
+   beta = ldlt.solve ( b );
+   if ( !beta.allFinite () )
+      return MIG_ERROR_INTERNAL;
+
+   return MIG_OK;
+}
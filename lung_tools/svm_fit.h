@@ -0,0 +1,51 @@
+/*
+******************************************************************************
+*
+* Filename    : svm_fit.h
+* Description : Ridge least squares fit of svm decision values
+*
+******************************************************************************
+*/
+
+#ifndef __SVM_FIT_H__
+#define __SVM_FIT_H__
+
+#include "libmigsvm.h"
+
+#include <Eigen/Dense>
+
+typedef Eigen::Matrix<double , Eigen::Dynamic , Eigen::Dynamic , Eigen::RowMajor> svm_fit_mat_t;
+
+/* fills the first num_basis columns of phi with the features of the rows of x */
+typedef void (*svm_fit_map_f) ( const svm_fit_mat_t &x , svm_fit_mat_t &phi , const void *ctx );
+
+/*
+******************************************************************************
+*                       FIT DECISION VALUES
+*
+* Description : This function solves [ map( x ) 1 ] beta = dec in the ridge
+*               least squares sense over the directions of data. The normal
+*               equations are accumulated a block of rows at a time , so
+*               memory does not grow with the feature file.
+*
+* Arguments   : data      - directions to fit on.
+*               dec       - decision values to fit , one per direction.
+*               num_basis - columns of the feature map.
+*               map       - feature map of a block of directions.
+*               ctx       - passed to map.
+*               ridge     - ridge relative to the mean diagonal of the
+*                           normal equations.
+*               beta      - num_basis coefficients , then the constant.
+*
+* Returns     : MIG_OK on success
+*               MIG_ERROR_INTERNAL if the system could not be solved
+*
+******************************************************************************
+*/
+
+int
+svm_fit_ridge ( const mig_svm_data_t *data , const double *dec , int num_basis ,
+                svm_fit_map_f map , const void *ctx , double ridge ,
+                Eigen::VectorXd &beta );
+
+#endif /* __SVM_FIT_H__ */
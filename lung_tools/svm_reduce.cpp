@@ -0,0 +1,339 @@
+#include "mig_config.h"
+#include "mig_defs.h"
+#include "mig_error_codes.h"
+
+#include "libmigsvm.h"
+
+#include "svm_report.h"
+#include "svm_fit.h"
+
+#include <float.h>
+#include <math.h>
+
+#include <Eigen/Dense>
+
+/*******************************************************************/
+#define APP_NAME        "svm_reduce"
+#define APP_DESC        "Reduce the support vectors of an rbf svm model to a budget"
+
+/* mip directions of a candidate , consecutive rows of the feature file */
+#define NDIR            3
+
+/* weighted k-means iterations placing the reduced support vectors */
+#define KMEANS_ITERS    20
+
+/* ridge of the least squares fit , relative to the mean kernel energy.
+   The budget is small and its centers are spread by k-means , so the
+   kernel columns are well conditioned : the ridge only guards against
+   coincident centers , a larger one would bias the few coefficients
+   away from the full decision ( svm_approx needs more ) */
+#define FIT_RIDGE       1e-8
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+typedef svm_fit_mat_t mat_t;
+typedef Eigen::VectorXd vec_t;
+
+/* rbf kernel map on the reduced vectors */
+typedef struct _rbf_map_t
+{
+   const mat_t    *centers;
+   vec_t          c_norm;
+   double         gamma;
+
+} rbf_map_t;
+
+static void
+_usage ();
+
+static void
+_centers ( const mig_svm_t *svm , int budget , mat_t &centers );
+
+static void
+_rbf_map ( const svm_fit_mat_t &x , svm_fit_mat_t &phi , const void *ctx );
+
+static int
+_fit ( const mig_svm_t *svm , const mat_t &centers , const mig_svm_data_t *data ,
+       const double *dec , vec_t &beta );
+
+static int
+_write ( const mig_svm_t *svm , const mat_t &centers , const vec_t &beta ,
+         const char *model_file_name );
+
+/*******************************************************************/
+/* MAIN */
+/*******************************************************************/
+
+int
+main ( int argc , char **argv )
+{
+   mig_svm_t model , reduced;
+   mig_svm_data_t data;
+   mat_t centers;
+   vec_t beta;
+   double *dec = NULL , *red = NULL;
+   int budget , min_pos = 2;
+
+   if ( argc != 5 && argc != 6 )
+   {
+      _usage ();
+      exit ( EXIT_FAILURE );
+   }
+
+   budget = atoi ( argv[3] );
+   if ( argc == 6 )
+      min_pos = atoi ( argv[5] );
+   if ( budget < 1 || min_pos < 1 || min_pos > NDIR )
+   {
+      _usage ();
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_model_load ( argv[1] , &model ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Loading model %s..." , argv[1] );
+      exit ( EXIT_FAILURE );
+   }
+
+   /* other kernels either collapse to one vector or have no reduced set */
+   if ( model.type_kernel != MIG_RBF || budget >= model.num_sv )
+   {
+      fprintf ( stderr , "\nERROR. Model %s : need an rbf model with more than %d support vectors..." ,
+                argv[1] , budget );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_data_load ( argv[2] , model.len_sv , &data ) != MIG_OK || data.num % NDIR != 0 )
+   {
+      fprintf ( stderr , "\nERROR. Reading features %s..." , argv[2] );
+      exit ( EXIT_FAILURE );
+   }
+
+   dec = (double*) malloc ( data.num * sizeof(double) );
+   red = (double*) malloc ( data.num * sizeof(double) );
+   if ( dec == NULL || red == NULL )
+   {
+      fprintf ( stderr , "\nERROR. Memory..." );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( mig_svm_decision_batch ( &model , data.feats , data.num , dec ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Classifying features..." );
+      exit ( EXIT_FAILURE );
+   }
+
+   /* reduced vectors where the support vectors weigh most , then
+      coefficients matching the full decision on the training features */
+   _centers ( &model , budget , centers );
+
+   if ( _fit ( &model , centers , &data , dec , beta ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Fitting reduced model..." );
+      exit ( EXIT_FAILURE );
+   }
+
+   if ( _write ( &model , centers , beta , argv[4] ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Writing model %s..." , argv[4] );
+      exit ( EXIT_FAILURE );
+   }
+
+   /* report on the model as written */
+   if ( mig_svm_model_load ( argv[4] , &reduced ) != MIG_OK ||
+        mig_svm_decision_batch ( &reduced , data.feats , data.num , red ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Reloading model %s..." , argv[4] );
+      exit ( EXIT_FAILURE );
+   }
+
+   printf ( "\n%s : %d support vectors -> %s : %d support vectors" ,
+            argv[1] , model.num_sv , argv[4] , reduced.num_sv );
+
+   /* decisions positive for label 1 */
+   if ( model.labels[0] != 1 )
+      for ( int i = 0 ; i < data.num ; ++i )
+      {
+         dec[i] = -dec[i];
+         red[i] = -red[i];
+      }
+
+   svm_report ( &data , NDIR , min_pos , dec , red , "reduced" );
+
+   free ( dec );
+   free ( red );
+   mig_svm_data_free ( &data );
+   mig_svm_model_free ( &model );
+   mig_svm_model_free ( &reduced );
+
+   exit ( EXIT_SUCCESS );
+}
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+static void
+_usage ()
+{
+   printf ( "\n%s." , APP_DESC );
+   printf ( "\nReduced vectors are weighted k-means centers of the support vectors ,");
+   printf ( "\ntheir coefficients a least squares fit of the full decision values on" );
+   printf ( "\nthe features. The result is a libsvm model file." );
+   printf ( "\n\nUsage : %s model features budget reduced_model [min_pos_labels]" , APP_NAME );
+   printf ( "\n\t model          - rbf libsvm model file" );
+   printf ( "\n\t features       - whitened libsvm feature file from training , %d rows per candidate" , NDIR );
+   printf ( "\n\t budget         - support vectors of the reduced model" );
+   printf ( "\n\t reduced_model  - output libsvm model file" );
+   printf ( "\n\t min_pos_labels - positive directions of a positive candidate , default 2" );
+   printf ( "\n" );
+}
+
+/*******************************************************************/
+
+static void
+_centers ( const mig_svm_t *svm , int budget , mat_t &centers )
+{
+   Eigen::Map<const Eigen::Matrix<float , Eigen::Dynamic , Eigen::Dynamic , Eigen::RowMajor> >
+      sv ( svm->sv_mat , svm->num_sv , svm->len_sv );
+   mat_t s = sv.cast<double> ();
+   mat_t sums ( budget , svm->len_sv );
+   vec_t s_norm = s.rowwise ().squaredNorm ();
+   vec_t w ( svm->num_sv ) , dist ( svm->num_sv ) , mass ( budget );
+   mat_t d;
+   double total , pick;
+   int i , k , it , best;
+
+   for ( i = 0 ; i < svm->num_sv ; ++i )
+      w ( i ) = fabs ( svm->sv_coef[i] );
+
+   /* k-means++ seeding on coefficient weighted support vectors */
+   srand ( 1 );
+   centers.resize ( budget , svm->len_sv );
+   dist.setConstant ( DBL_MAX );
+   best = 0;
+   for ( k = 0 ; k < budget ; ++k )
+   {
+      if ( k > 0 )
+      {
+         total = w.cwiseProduct ( dist ).sum ();
+         pick = total * rand () / ( (double) RAND_MAX + 1.0 );
+         for ( best = 0 ; best < svm->num_sv - 1 ; ++best )
+         {
+            pick -= w ( best ) * dist ( best );
+            if ( pick < 0.0 )
+               break;
+         }
+      }
+      else
+         w.maxCoeff ( &best );
+
+      centers.row ( k ) = s.row ( best );
+      dist = dist.cwiseMin ( ( s.rowwise () - centers.row ( k ) ).rowwise ().squaredNorm () );
+   }
+
+   /* lloyd iterations , weighted means */
+   for ( it = 0 ; it < KMEANS_ITERS ; ++it )
+   {
+      d = ( -2.0 * s * centers.transpose () ).colwise () + s_norm;
+      d.rowwise () += centers.rowwise ().squaredNorm ().transpose ();
+
+      sums.setZero ();
+      mass.setZero ();
+      for ( i = 0 ; i < svm->num_sv ; ++i )
+      {
+         d.row ( i ).minCoeff ( &best );
+         sums.row ( best ) += w ( i ) * s.row ( i );
+         mass ( best ) += w ( i );
+      }
+
+      /* empty clusters keep their center */
+      for ( k = 0 ; k < budget ; ++k )
+         if ( mass ( k ) > 0.0 )
+            centers.row ( k ) = sums.row ( k ) / mass ( k );
+   }
+}
+
+/*******************************************************************/
+
+static void
+_rbf_map ( const svm_fit_mat_t &x , svm_fit_mat_t &phi , const void *ctx )
+{
+   const rbf_map_t *m = (const rbf_map_t*) ctx;
+   int budget = (int) m->centers->rows ();
+
+   /* exp( -gamma | x - c |^2 ) */
+   phi.leftCols ( budget ) = ( -2.0 * x * m->centers->transpose () ).colwise ()
+                             + x.rowwise ().squaredNorm ();
+   phi.leftCols ( budget ).rowwise () += m->c_norm.transpose ();
+   phi.leftCols ( budget ) = ( -m->gamma * phi.leftCols ( budget ).cwiseMax ( 0.0 ) ).array ().exp ().matrix ();
+}
+
+/*******************************************************************/
+
+static int
+_fit ( const mig_svm_t *svm , const mat_t &centers , const mig_svm_data_t *data ,
+       const double *dec , vec_t &beta )
+{
+   rbf_map_t m;
+
+   m.centers = &centers;
+   m.c_norm  = centers.rowwise ().squaredNorm ();
+   m.gamma   = svm->gamma;
+
+   return svm_fit_ridge ( data , dec , (int) centers.rows () , &_rbf_map , &m , FIT_RIDGE , beta );
+}
+
+/*******************************************************************/
+
+static int
+_write ( const mig_svm_t *svm , const mat_t &centers , const vec_t &beta ,
+         const char *model_file_name )
+{
+   int budget = (int) centers.rows ();
+   mig_svm_t red;
+   int i , k , n , rc = MIG_ERROR_MEMORY;
+
+   memset ( &red , 0x00 , sizeof(mig_svm_t) );
+   red.type_svm     = svm->type_svm;
+   red.type_kernel  = svm->type_kernel;
+   red.gamma        = svm->gamma;
+   red.num_sv       = budget;
+   red.len_sv       = svm->len_sv;
+   red.len_in       = svm->len_sv;
+   red.labels[0]    = svm->labels[0];
+   red.labels[1]    = svm->labels[1];
+
+   /* decision = sum beta K - rho */
+   red.rho = (float) -beta ( budget );
+
+   red.sv_mat  = (float*) malloc ( budget * red.len_sv * sizeof(float) );
+   red.sv      = (float**) malloc ( budget * sizeof(float*) );
+   red.sv_coef = (float*) malloc ( budget * sizeof(float) );
+   if ( red.sv_mat == NULL || red.sv == NULL || red.sv_coef == NULL )
+      goto error;
+
+   /* libsvm order : vectors of the first label first */
+   for ( n = 0 , i = 0 ; i < 2 ; ++i )
+      for ( k = 0 ; k < budget ; ++k )
+      {
+         if ( ( beta ( k ) > 0.0 ) != ( i == 0 ) )
+            continue;
+
+         red.sv[n] = red.sv_mat + n * red.len_sv;
+         for ( int j = 0 ; j < red.len_sv ; ++j )
+            red.sv[n][j] = (float) centers ( k , j );
+         red.sv_coef[n] = (float) beta ( k );
+         ++red.num_sv_class[i];
+         ++n;
+      }
+
+   rc = mig_svm_model_write ( model_file_name , &red );
+
+error :
+
+   mig_svm_model_free ( &red );
+   return rc;
+}
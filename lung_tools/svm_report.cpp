@@ -0,0 +1,213 @@
+/*
+******************************************************************************
+*
+* Filename    : svm_report.cpp
+* Description : Agreement and froc of two svm models on labelled directions
+*
+******************************************************************************
+*/
+
+#include "mig_config.h"
+#include "mig_defs.h"
+#include "mig_error_codes.h"
+
+#include "svm_report.h"
+
+#include <float.h>
+#include <math.h>
+
+/* most directions of a candidate */
+#define SVM_REPORT_MAX_DIR  16
+
+/* false positive rates of negative candidates reported on the froc */
+static const double _FpRates[] = { 0.005 , 0.01 , 0.02 , 0.05 , 0.1 , 0.2 };
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+static int
+_candidate_scores ( const mig_svm_data_t *data , int ndir , const double *dec , int min_pos ,
+                    double *scores , int *labels );
+
+static double
+_threshold_at_fp ( const double *scores , const int *labels , int num , double fp_rate );
+
+static void
+_froc_point ( const double *scores , const int *labels , int num , double threshold ,
+              int *tp , int *fp );
+
+static int
+_cmp_double_desc ( const void *a , const void *b );
+
+/*******************************************************************/
+/* EXPORTS */
+/*******************************************************************/
+
+void
+svm_report ( const mig_svm_data_t *data , int ndir , int min_pos ,
+             const double *dec , const double *approx , const char *name )
+{
+   int num = data->num / ndir;
+   double *scores = NULL , *scores_approx = NULL;
+   int *labels = NULL;
+   double err = 0.0 , thr , thr_approx;
+   int agree = 0 , agree_c = 0 , num_pos , num_neg;
+   int tp , fp , tp_approx , fp_approx;
+   int i;
+
+   for ( i = 0 ; i < data->num ; ++i )
+   {
+      agree += ( ( dec[i] > 0 ) == ( approx[i] > 0 ) );
+      err += ( dec[i] - approx[i] ) * ( dec[i] - approx[i] );
+   }
+
+   printf ( "\n\ndirections : %d , label agreement %.2f%% , rms decision error %.4g" ,
+            data->num , 100.0 * agree / data->num , sqrt ( err / data->num ) );
+
+   scores = (double*) malloc ( num * sizeof(double) );
+   scores_approx = (double*) malloc ( num * sizeof(double) );
+   labels = (int*) malloc ( num * sizeof(int) );
+   if ( scores == NULL || scores_approx == NULL || labels == NULL ||
+        _candidate_scores ( data , ndir , dec , min_pos , scores , labels ) != MIG_OK ||
+        _candidate_scores ( data , ndir , approx , min_pos , scores_approx , labels ) != MIG_OK )
+   {
+      fprintf ( stderr , "\nERROR. Candidate labels..." );
+      goto error;
+   }
+
+   for ( i = 0 , num_pos = 0 ; i < num ; ++i )
+   {
+      num_pos += ( labels[i] == 1 );
+      agree_c += ( ( scores[i] > 0 ) == ( scores_approx[i] > 0 ) );
+   }
+   num_neg = num - num_pos;
+
+   printf ( "\ncandidates : %d ( %d positive ) , label agreement %.2f%%" ,
+            num , num_pos , 100.0 * agree_c / num );
+
+   /* operating point of the models */
+   _froc_point ( scores , labels , num , 0.0 , &tp , &fp );
+   _froc_point ( scores_approx , labels , num , 0.0 , &tp_approx , &fp_approx );
+   printf ( "\n\n%10s %18s %18s" , "" , "full" , name );
+   printf ( "\n%10s %8.2f%% %6d fp %8.2f%% %6d fp" , "threshold 0" ,
+            num_pos ? 100.0 * tp / num_pos : 0.0 , fp ,
+            num_pos ? 100.0 * tp_approx / num_pos : 0.0 , fp_approx );
+
+   /* froc : sensitivity at the same false positive rates */
+   printf ( "\n\n%10s %18s %18s" , "fp rate" , "full sens" , name );
+   for ( i = 0 ; i < (int)( sizeof(_FpRates) / sizeof(_FpRates[0]) ) ; ++i )
+   {
+      thr = _threshold_at_fp ( scores , labels , num , _FpRates[i] );
+      thr_approx = _threshold_at_fp ( scores_approx , labels , num , _FpRates[i] );
+      _froc_point ( scores , labels , num , thr , &tp , &fp );
+      _froc_point ( scores_approx , labels , num , thr_approx , &tp_approx , &fp_approx );
+
+      printf ( "\n%9.1f%% %8.2f%% %6d fp %8.2f%% %6d fp" , 100.0 * _FpRates[i] ,
+               num_pos ? 100.0 * tp / num_pos : 0.0 , fp ,
+               num_pos ? 100.0 * tp_approx / num_pos : 0.0 , fp_approx );
+   }
+   printf ( "\n( %d negative candidates )\n" , num_neg );
+
+error :
+
+   if ( scores )
+      free ( scores );
+   if ( scores_approx )
+      free ( scores_approx );
+   if ( labels )
+      free ( labels );
+}
+
+/*******************************************************************/
+/* PRIVATE */
+/*******************************************************************/
+
+static int
+_candidate_scores ( const mig_svm_data_t *data , int ndir , const double *dec , int min_pos ,
+                    double *scores , int *labels )
+{
+   double dir[SVM_REPORT_MAX_DIR];
+   int c , idir;
+
+   if ( ndir > SVM_REPORT_MAX_DIR || min_pos < 1 || min_pos > ndir )
+      return MIG_ERROR_PARAM;
+
+   /* a candidate is positive above the threshold when min_pos of its
+      directions are : its score is the min_pos-th largest decision */
+   for ( c = 0 ; c < data->num / ndir ; ++c )
+   {
+      for ( idir = 0 ; idir < ndir ; ++idir )
+      {
+         if ( data->labels[c * ndir + idir] != data->labels[c * ndir] )
+            return MIG_ERROR_UNSUPPORTED;
+         dir[idir] = dec[c * ndir + idir];
+      }
+
+      qsort ( dir , ndir , sizeof(double) , &_cmp_double_desc );
+      scores[c] = dir[min_pos - 1];
+      labels[c] = data->labels[c * ndir];
+   }
+
+   return MIG_OK;
+}
+
+/*******************************************************************/
+
+static double
+_threshold_at_fp ( const double *scores , const int *labels , int num , double fp_rate )
+{
+   double *neg;
+   double thr = DBL_MAX;
+   int i , n , k;
+
+   neg = (double*) malloc ( num * sizeof(double) );
+   if ( neg == NULL )
+      return thr;
+
+   for ( i = 0 , n = 0 ; i < num ; ++i )
+      if ( labels[i] != 1 )
+         neg[n++] = scores[i];
+
+   /* at most fp_rate of the negatives strictly above */
+   if ( n > 0 )
+   {
+      qsort ( neg , n , sizeof(double) , &_cmp_double_desc );
+      k = (int) floor ( fp_rate * n );
+      thr = ( k < n ) ? neg[k] : -DBL_MAX;
+   }
+
+   free ( neg );
+   return thr;
+}
+
+/*******************************************************************/
+
+static void
+_froc_point ( const double *scores , const int *labels , int num , double threshold ,
+              int *tp , int *fp )
+{
+   int i;
+
+   *tp = 0;
+   *fp = 0;
+   for ( i = 0 ; i < num ; ++i )
+      if ( scores[i] > threshold )
+      {
+         if ( labels[i] == 1 )
+            ++( *tp );
+         else
+            ++( *fp );
+      }
+}
+
+/*******************************************************************/
+
+static int
+_cmp_double_desc ( const void *a , const void *b )
+{
+   double da = *(const double*) a;
+   double db = *(const double*) b;
+
+   return ( da < db ) - ( da > db );
+}
@@ -0,0 +1,39 @@
+/*
+******************************************************************************
+*
+* Filename    : svm_report.h
+* Description : Agreement and froc of two svm models on labelled directions
+*
+******************************************************************************
+*/
+
+#ifndef __SVM_REPORT_H__
+#define __SVM_REPORT_H__
+
+#include "libmigsvm.h"
+
+/*
+******************************************************************************
+*                       COMPARE TWO MODELS ON A FEATURE FILE
+*
+* Description : This function prints the label agreement and rms difference
+*               of the decisions of a full model and of its approximation on
+*               every direction , then candidate agreement and sensitivity of
+*               both at the same false positive rates ( froc ) , a candidate
+*               being positive when min_pos of its directions are.
+*
+* Arguments   : data    - labelled directions , ndir rows per candidate.
+*               ndir    - directions per candidate.
+*               min_pos - positive directions of a positive candidate.
+*               dec     - decisions of the full model , positive for label 1.
+*               approx  - decisions of the approximated model , positive for label 1.
+*               name    - name of the approximated model in the tables.
+*
+******************************************************************************
+*/
+
+void
+svm_report ( const mig_svm_data_t *data , int ndir , int min_pos ,
+             const double *dec , const double *approx , const char *name );
+
+#endif /* __SVM_REPORT_H__ */
@@ -946,6 +946,17 @@ _train_scaling_whitening ( mig_lst_t *feat_lst)
 	int nfeat = feat->feat_len;
 	int nfeatvec = mig_lst_len(feat_lst) * feat->ndir;
 	float** feat_mat = (float**) calloc(nfeatvec,sizeof(float*));
+	/* rows of one nfeatvec x nfeat block , whitened at once */
+	float* feat_buf = (float*) malloc(nfeatvec * nfeat * sizeof(float));
+
+	if ( feat_mat == NULL || feat_buf == NULL )
+	{
+		if ( feat_mat )
+			free ( feat_mat );
+		if ( feat_buf )
+			free ( feat_buf );
+		return MIG_ERROR_MEMORY;
+	}
 
 	mig_lst_iter iter;
 	//iterate through feat_lst
@@ -957,7 +968,7 @@ _train_scaling_whitening ( mig_lst_t *feat_lst)
 	{
 		for ( int idir = 0; idir != feat->ndir; ++idir )
 		{
-			feat_mat[row] = (float*) calloc(nfeat, sizeof(float));
+			feat_mat[row] = feat_buf + row * nfeat;
 			for ( ifeat = 0; ifeat != nfeat; ++ifeat )
 			{
 				feat_mat[row][ifeat] = feat->feats[idir][ifeat];
@@ -971,11 +982,6 @@ _train_scaling_whitening ( mig_lst_t *feat_lst)
 	mig_whitening_compute(&_whitener, feat_mat, nfeat, nfeatvec);
 	
 	/* cleanup feat_mat */
-	for (int i = 0; i!=nfeatvec;++i)
-	{
-		free ( feat_mat[i]);
-	}
-
 	free(feat_mat);
 
 	/* save scales to file */
@@ -986,19 +992,22 @@ _train_scaling_whitening ( mig_lst_t *feat_lst)
 
 	free ( scale_fname );
 	
-	/* apply scales on the whole set */
+	/* apply scales on the whole set , in place , then copy back */
+	mig_whitening_apply_batch(&_whitener, feat_buf, feat_buf, nfeatvec);
+
 	mig_lst_iter_reset(&iter);
 	
+	row = 0;
 	while ( ( feat = (feat_t*) mig_lst_iter_next ( &iter ) ) != NULL )
 	{
 		for (int idir = 0; idir != feat->ndir; ++idir)
 		{
-			//copy to temp
-            std::vector<float> tempfeat(feat->feats[idir], feat->feats[idir]+feat->feat_len);
-			//replace with witened
-			rc = mig_whitening_apply(&_whitener, &tempfeat[0], feat->feats[idir]);
+			memcpy ( feat->feats[idir], feat_buf + row * nfeat, nfeat * sizeof(float) );
+			++row;
 		}
 	}
+
+	free ( feat_buf );
 	
 	return MIG_OK;
 }
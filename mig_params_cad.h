@@ -113,10 +113,21 @@
 
 /* keys into ini hashtable */
 
+#define PARAM_DET_ANISOTROPIC       "detection:anisotropic"   /* detection only , rejected with fpr2 */
+#define PARAM_DET_NUM_THREADS       "detection:num_threads"
+
 #define PARAM_DET_FR_RADII          "detection/radial:radii"
 #define PARAM_DET_FR_THR            "detection/radial:threshold"
 #define PARAM_DET_FR_THR_TYPE       "detection/radial:is_thr_percent_of_max"
 #define PARAM_DET_FR_BETA_THR		"detection/radial:beta_threshold"
+#define PARAM_DET_FR_NUM_THREADS    "detection/radial:num_threads"
+#define PARAM_DET_FR_TILE_LEN       "detection/radial:mask_tile_len"
+#define PARAM_DET_FR_PRECISION      "detection/radial:precision"
+#define PARAM_DET_FR_VALIDATE       "detection/radial:validate_precision"
+#define PARAM_DET_FR_COARSE_RADIUS  "detection/radial:coarse_radius"
+#define PARAM_DET_FR_COARSE_SCALE   "detection/radial:coarse_scale"
+#define PARAM_DET_FR_COARSE_THR     "detection/radial:coarse_threshold"
+#define PARAM_DET_FR_MERGE_DIST     "detection/radial:merge_distance"
 
 #define PARAM_DET_SSPACE_SPACING    "detection/sspace:spacing"
 #define PARAM_DET_SSPACE_INCREMENT  "detection/sspace:increment"
@@ -124,20 +135,35 @@
 #define PARAM_DET_SSPACE_MIN_DIAM   "detection/sspace:min_nod_diam"
 #define PARAM_DET_SSPACE_MAX_DIAM   "detection/sspace:max_nod_diam"
 #define PARAM_DET_SSPACE_THR        "detection/sspace:threshold"
+#define PARAM_DET_SSPACE_NUM_THREADS "detection/sspace:num_threads"
+#define PARAM_DET_SSPACE_LUNG_MASK  "detection/sspace:lung_mask"
 
 #define PARAM_DET_DUMP              "detection/debug:dump"
 #define PARAM_DET_DIR_DUMP          "detection/debug:dir_dump"
 
 /* default values */
+#define DEFAULT_PARAM_DET_ANISOTROPIC       0
+#define DEFAULT_PARAM_DET_NUM_THREADS       2
+
 #define DEFAULT_PARAM_DET_FR_THR            0.03f
 #define DEFAULT_PARAM_DET_FR_THR_TYPE       0
 #define DEFAULT_PARAM_DET_FR_BETA_THR       0.1f
+#define DEFAULT_PARAM_DET_FR_NUM_THREADS    1
+#define DEFAULT_PARAM_DET_FR_TILE_LEN       0
+#define DEFAULT_PARAM_DET_FR_PRECISION      0
+#define DEFAULT_PARAM_DET_FR_VALIDATE       0
+#define DEFAULT_PARAM_DET_FR_COARSE_RADIUS  0.0f
+#define DEFAULT_PARAM_DET_FR_COARSE_SCALE   2
+#define DEFAULT_PARAM_DET_FR_COARSE_THR     0.1f
+#define DEFAULT_PARAM_DET_FR_MERGE_DIST     0.0f
 
 #define DEFAULT_PARAM_DET_SSPACE_SPACING    0
 #define DEFAULT_PARAM_DET_SSPACE_INCREMENT  1.0f
 #define DEFAULT_PARAM_DET_SSPACE_MIN        2.0f
 #define DEFAULT_PARAM_DET_SSPACE_MAX        20.0f
 #define DEFAULT_PARAM_DET_SSPACE_THR        0.5f
+#define DEFAULT_PARAM_DET_SSPACE_NUM_THREADS 1
+#define DEFAULT_PARAM_DET_SSPACE_LUNG_MASK  0
 #define DEFAULT_PARAM_DET_DUMP              0
 #define DEFAULT_PARAM_DET_DIR_DUMP          "detection/"
 
@@ -154,6 +180,8 @@
 
 #define PARAM_FPR1_SKIP_BUILD3D             "fpr1:skip_build3d"
 
+#define PARAM_FPR1_NUM_THREADS              "fpr1:num_threads"
+
 #define PARAM_FPR1_MAX_SCAN_DISTANCE        "fpr1:delta_tolerance"
 #define PARAM_FPR1_DELTA_TOLERANCE          "fpr1:max_scan_distance"
 
@@ -204,6 +232,7 @@
 
 #define DEFAULT_PARAM_FPR1_SKIP_BUILD3D         0
 #define DEFAULT_PARAM_FPR1_APPLY_ONLY_RADIUS    0
+#define DEFAULT_PARAM_FPR1_NUM_THREADS          2
 
 #define DEFAULT_PARAM_FPR1_MAX_OBJ_LENGHT       13.0f
 #define DEFAULT_PARAM_FPR1_MIN_MAX_RADIUS			1.0f
@@ -221,6 +250,7 @@
 #define PARAM_FPR2_DLL                  "fpr2:dll"
 #define PARAM_FPR2_SVM_MODEL_FILE       "fpr2:svm_model_file"
 #define PARAM_FPR2_SVM_NORM_FILE        "fpr2:svm_norm_file"
+#define PARAM_FPR2_SVM_BUNDLE_FILE      "fpr2:svm_bundle_file"
 
 #define PARAM_FPR2_RESIZED_LEN          "fpr2:resized_len"
 
@@ -262,6 +292,10 @@
 #define PARAM_FPR2_MIN_POS_LABELS		"fpr2:min_pos_labels"
 #define PARAM_FPR2_CROP_SIZES			"fpr2:crop_sizes"
 #define	PARAM_FPR2_MOM_ORDERS			"fpr2:mom_orders"
+#define PARAM_FPR2_NUM_THREADS			"fpr2:num_threads"
+#define PARAM_FPR2_CASCADE_MODEL_FILE	"fpr2:cascade_model_file"
+#define PARAM_FPR2_CASCADE_BUNDLE_FILE	"fpr2:cascade_bundle_file"
+#define PARAM_FPR2_CASCADE_THRESHOLD	"fpr2:cascade_threshold"
 
 /* default values */
 /* OLD FPR2 PARAMS */
@@ -276,6 +310,8 @@
 #define DEFAULT_PARAM_FPR2_MIN_POS_LABELS	2
 #define DEFAULT_PARAM_FPR2_CROP_SIZES	64
 #define DEFAULT_PARAM_FPR2_MOM_ORDERS   { 1, 2, 3, 4, 5, 6, 7, 8 }
+#define DEFAULT_PARAM_FPR2_NUM_THREADS	2
+#define DEFAULT_PARAM_FPR2_CASCADE_THRESHOLD	-1.0
 
 
 